@@ -0,0 +1,28 @@
+include (CheckCSourceCompiles)
+
+# The io_uring stream issues the io_uring syscalls directly, so it needs
+# only the kernel headers, new enough to have linked timeouts and fast poll.
+set (MONGOC_ENABLE_IO_URING 0)
+
+if (NOT ENABLE_IO_URING MATCHES "ON|OFF|AUTO")
+   message (FATAL_ERROR "ENABLE_IO_URING option must be ON, OFF, or AUTO")
+endif ()
+
+if (NOT ENABLE_IO_URING STREQUAL OFF)
+   check_c_source_compiles ("
+      #include <linux/io_uring.h>
+      #include <sys/syscall.h>
+      int main (void) {
+         struct io_uring_sqe sqe;
+         struct __kernel_timespec ts = {0};
+         sqe.opcode = IORING_OP_LINK_TIMEOUT;
+         return __NR_io_uring_setup + IORING_FEAT_FAST_POLL + sqe.opcode +
+            (int) ts.tv_sec;
+      }" HAVE_IO_URING)
+
+   if (HAVE_IO_URING)
+      set (MONGOC_ENABLE_IO_URING 1)
+   elseif (ENABLE_IO_URING STREQUAL ON)
+      message (FATAL_ERROR "io_uring headers not found")
+   endif ()
+endif ()
@@ -0,0 +1,65 @@
+include (CheckSymbolExists)
+
+if (NOT ENABLE_ZSTD MATCHES "ON|AUTO|OFF")
+   message (FATAL_ERROR "ENABLE_ZSTD option must be ON, AUTO, or OFF")
+endif ()
+
+if (NOT ENABLE_ZSTD STREQUAL OFF)
+   message (STATUS "Searching for compression library header zstd.h")
+   find_path (
+      ZSTD_INCLUDE_DIRS NAMES zstd.h
+      PATHS /include /usr/include /usr/local/include /usr/share/include /opt/include c:/zstd/include
+      DOC "Searching for zstd.h")
+
+   if (NOT ZSTD_INCLUDE_DIRS)
+      if (ENABLE_ZSTD STREQUAL ON)
+         message (FATAL_ERROR "  Not found (specify -DCMAKE_INCLUDE_PATH=/path/to/zstd/include for zstd compression)")
+      else ()
+         message (STATUS "  Not found (specify -DCMAKE_INCLUDE_PATH=/path/to/zstd/include for zstd compression)")
+      endif ()
+   else ()
+      message (STATUS "  Found in ${ZSTD_INCLUDE_DIRS}")
+      message (STATUS "Searching for libzstd")
+      find_library (
+         ZSTD_LIBRARIES NAMES zstd
+         PATHS /usr/lib /lib /usr/local/lib /usr/share/lib /opt/lib /opt/share/lib /var/lib c:/zstd/lib
+         DOC "Searching for libzstd")
+
+      if (ZSTD_LIBRARIES)
+         message (STATUS "  Found ${ZSTD_LIBRARIES}")
+
+         # The streaming API the compressor uses is stable since zstd 1.4.0
+         set (CMAKE_REQUIRED_INCLUDES ${ZSTD_INCLUDE_DIRS})
+         set (CMAKE_REQUIRED_LIBRARIES ${ZSTD_LIBRARIES})
+         check_symbol_exists (ZSTD_compressStream2 zstd.h HAVE_ZSTD_COMPRESSSTREAM2)
+         unset (CMAKE_REQUIRED_INCLUDES)
+         unset (CMAKE_REQUIRED_LIBRARIES)
+
+         if (NOT HAVE_ZSTD_COMPRESSSTREAM2)
+            if (ENABLE_ZSTD STREQUAL ON)
+               message (FATAL_ERROR "  zstd 1.4.0 or later is required for zstd compression")
+            else ()
+               message (STATUS "  zstd 1.4.0 or later is required for zstd compression, disabling it")
+            endif ()
+            set (ZSTD_LIBRARIES "")
+         endif ()
+      else ()
+         if (ENABLE_ZSTD STREQUAL ON)
+            message (FATAL_ERROR "  Not found (specify -DCMAKE_LIBRARY_PATH=/path/to/zstd/lib for zstd compression)")
+         else ()
+            message (STATUS "  Not found (specify -DCMAKE_LIBRARY_PATH=/path/to/zstd/lib for zstd compression)")
+         endif ()
+      endif ()
+   endif ()
+
+   if (ZSTD_INCLUDE_DIRS AND ZSTD_LIBRARIES)
+      set (MONGOC_ENABLE_COMPRESSION_ZSTD 1)
+      set (MONGOC_ENABLE_COMPRESSION 1)
+   endif ()
+endif ()
+
+if (NOT ZSTD_INCLUDE_DIRS OR NOT ZSTD_LIBRARIES)
+   set (ZSTD_INCLUDE_DIRS "")
+   set (ZSTD_LIBRARIES "")
+   set (MONGOC_ENABLE_COMPRESSION_ZSTD 0)
+endif ()
@@ -121,6 +121,14 @@ future_functions = [
                      param("bson_ptr", "reply"),
                      param("bson_error_ptr", "error")]),
 
+    future_function("uint32_t",
+                    "mongoc_bulk_operation_execute_parallel",
+                    [param("mongoc_bulk_operation_ptr", "bulk"),
+                     param("mongoc_client_pool_ptr", "pool"),
+                     param("uint32_t", "max_parallelism"),
+                     param("bson_ptr", "reply"),
+                     param("bson_error_ptr", "error")]),
+
     future_function("bool",
                     "mongoc_database_read_command_with_opts",
                     [param("mongoc_database_ptr", "database"),
@@ -192,8 +192,46 @@ opts_structs = OrderedDict([
         write_concern_option,
         ordered_option,
         session_option,
+        ('zeroCopy', {
+            'type': 'bool',
+            'field': 'zero_copy',
+            'help': 'Set to ``true`` to send inserted documents without copying them into the bulk operation. Each document passed to :symbol:`mongoc_bulk_operation_insert` or :symbol:`mongoc_bulk_operation_insert_with_opts` must then stay valid and unmodified until :symbol:`mongoc_bulk_operation_execute` returns.'
+        }),
     ], allow_extra=False, ordered='true')),
 
+    ('mongoc_bulk_writer_opts_t', Struct([
+        write_concern_option,
+        bypass_option,
+        ('maxBatchDocuments', {
+            'type': 'int64_t',
+            'convert': '_mongoc_convert_int64_positive',
+            'field': 'max_batch_documents',
+            'help': 'Flush the operations added so far once there are this many. Defaults to 1000.'
+        }),
+        ('maxBatchBytes', {
+            'type': 'int64_t',
+            'convert': '_mongoc_convert_int64_positive',
+            'field': 'max_batch_bytes',
+            'help': 'Flush the operations added so far once they take this many bytes. Defaults to 16 MB.'
+        }),
+        ('flushIntervalMS', {
+            'type': 'int64_t',
+            'convert': '_mongoc_convert_int64_positive',
+            'field': 'flush_interval_ms',
+            'help': 'Flush an operation at most this many milliseconds after it was added. Defaults to 100.'
+        }),
+        ('maxBufferedBytes', {
+            'type': 'int64_t',
+            'convert': '_mongoc_convert_int64_positive',
+            'field': 'max_buffered_bytes',
+            'help': 'Block functions that add operations while operations that are not yet flushed take this many bytes. Must be at least "maxBatchBytes". Defaults to 64 MB.'
+        }),
+    ], allow_extra=False,
+       maxBatchDocuments='1000',
+       maxBatchBytes='(16 * 1024 * 1024)',
+       flushIntervalMS='100',
+       maxBufferedBytes='(64 * 1024 * 1024)')),
+
     ('mongoc_bulk_insert_opts_t', Struct([
         validate_option,
     ], validate='_mongoc_default_insert_vflags', allow_extra=False)),
@@ -2030,6 +2030,47 @@ bson_init_static (bson_t *bson, const uint8_t *data, size_t length)
 }
 
 
+bool
+bson_init_with_buffer (bson_t *bson, uint8_t *buf, size_t buf_len, size_t offset)
+{
+   bson_impl_alloc_t *impl = (bson_impl_alloc_t *) bson;
+   uint32_t len_le;
+   size_t length;
+
+   BSON_ASSERT (bson);
+   BSON_ASSERT (buf);
+
+   if ((buf_len > INT_MAX) || (offset > buf_len) || (buf_len - offset < 5)) {
+      return false;
+   }
+
+   memcpy (&len_le, buf + offset, sizeof (len_le));
+   length = BSON_UINT32_FROM_LE (len_le);
+
+   if ((length < 5) || (length > buf_len - offset)) {
+      return false;
+   }
+
+   if (buf[offset + length - 1]) {
+      return false;
+   }
+
+   impl->flags = BSON_FLAG_STATIC;
+   impl->len = (uint32_t) length;
+   impl->parent = NULL;
+   impl->depth = 0;
+   impl->buf = &impl->alloc;
+   impl->buflen = &impl->alloclen;
+   impl->offset = offset;
+   impl->alloc = buf;
+   impl->alloclen = buf_len;
+   impl->realloc = bson_realloc_ctx;
+   impl->realloc_func_ctx = NULL;
+
+   return true;
+}
+
+
 bson_t *
 bson_new (void)
 {
@@ -2434,6 +2475,10 @@ bson_destroy_with_steal (bson_t *bson, bool steal, uint32_t *length)
 
       alloc = (bson_impl_alloc_t *) bson;
       ret = *alloc->buf;
+      if (alloc->offset) {
+         /* see bson_init_with_buffer */
+         memmove (ret, ret + alloc->offset, bson->len);
+      }
       *alloc->buf = NULL;
    }
 
@@ -217,6 +217,24 @@ BSON_EXPORT (bool)
 bson_init_static (bson_t *b, const uint8_t *data, size_t length);
 
 
+/**
+ * bson_init_with_buffer:
+ * @b: A pointer to a bson_t.
+ * @buf: A buffer allocated with bson_malloc().
+ * @buf_len: The length of @buf.
+ * @offset: The offset of the BSON document within @buf.
+ *
+ * Initializes a bson_t that takes ownership of @buf, which contains a BSON
+ * document at @offset. No copy of the document is made; @buf is freed by
+ * bson_destroy().
+ *
+ * Returns: true if initialized successfully; otherwise false and @b is not
+ * initialized.
+ */
+BSON_EXPORT (bool)
+bson_init_with_buffer (bson_t *b, uint8_t *buf, size_t buf_len, size_t offset);
+
+
 /**
  * bson_init:
  * @b: A pointer to a bson_t.
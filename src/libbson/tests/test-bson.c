@@ -1346,6 +1346,43 @@ test_bson_init_static (void)
 }
 
 
+static void
+test_bson_init_with_buffer (void)
+{
+   bson_t b;
+   bson_t *doc;
+   uint8_t *buf;
+   uint8_t *stolen;
+   uint32_t len;
+   bson_iter_t iter;
+
+   doc = BCON_NEW ("a", BCON_INT32 (1));
+
+   /* a document surrounded by other bytes */
+   buf = bson_malloc0 (3 + doc->len + 2);
+   memcpy (buf + 3, bson_get_data (doc), doc->len);
+
+   BSON_ASSERT (!bson_init_with_buffer (&b, buf, 3 + doc->len + 2, 4));
+   BSON_ASSERT (!bson_init_with_buffer (&b, buf, 3 + doc->len - 1, 3));
+   BSON_ASSERT (bson_init_with_buffer (&b, buf, 3 + doc->len + 2, 3));
+   BSON_ASSERT (!(b.flags & BSON_FLAG_RDONLY));
+   BSON_ASSERT (bson_get_data (&b) == buf + 3);
+   BSON_ASSERT (bson_equal (&b, doc));
+
+   /* it can grow */
+   BSON_ASSERT (BSON_APPEND_UTF8 (&b, "b", "a string long enough to realloc"));
+   BSON_ASSERT (bson_iter_init_find (&iter, &b, "a"));
+   BSON_ASSERT (bson_iter_init_find (&iter, &b, "b"));
+
+   stolen = bson_destroy_with_steal (&b, true, &len);
+   BSON_ASSERT (bson_init_static (&b, stolen, len));
+   BSON_ASSERT (bson_iter_init_find (&iter, &b, "b"));
+   bson_free (stolen);
+
+   bson_destroy (doc);
+}
+
+
 static void
 test_bson_new_from_buffer (void)
 {
@@ -2377,6 +2414,7 @@ test_bson_install (TestSuite *suite)
    TestSuite_Add (suite, "/bson/new_from_buffer", test_bson_new_from_buffer);
    TestSuite_Add (suite, "/bson/init", test_bson_init);
    TestSuite_Add (suite, "/bson/init_static", test_bson_init_static);
+   TestSuite_Add (suite, "/bson/init_with_buffer", test_bson_init_with_buffer);
    TestSuite_Add (suite, "/bson/basic", test_bson_alloc);
    TestSuite_Add (suite, "/bson/append_overflow", test_bson_append_overflow);
    TestSuite_Add (suite, "/bson/append_array", test_bson_append_array);
@@ -34,8 +34,9 @@ MD_FLAGS = [
     "MONGOC_MD_FLAG_ENABLE_RDTSCP",
     "MONGOC_MD_FLAG_HAVE_SCHED_GETCPU",
     "MONGOC_MD_FLAG_ENABLE_SHM_COUNTERS",
-    "MONGOC_MD_FLAG_TRACE"
-    "MONGOC_MD_FLAG_ENABLE_ICU"
+    "MONGOC_MD_FLAG_TRACE",
+    "MONGOC_MD_FLAG_ENABLE_ICU",
+    "MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZSTD"
 ]
 
 def main():
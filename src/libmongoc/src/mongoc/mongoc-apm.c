@@ -31,6 +31,9 @@ append_documents_from_cmd (const mongoc_cmd_t *cmd,
 {
    int32_t doc_len;
    bson_t doc;
+   const uint8_t *payload;
+   uint8_t *gathered = NULL;
+   size_t n;
    const uint8_t *pos;
    const char *field_name;
    bson_t bson;
@@ -38,10 +41,25 @@ append_documents_from_cmd (const mongoc_cmd_t *cmd,
    const char *key;
    uint32_t i;
 
-   if (!cmd->payload || !cmd->payload_size) {
+   if ((!cmd->payload && !cmd->payload_iovcnt) || !cmd->payload_size) {
       return;
    }
 
+   if (cmd->payload_iovcnt) {
+      /* documents may span segments, copy them together to walk them */
+      gathered = bson_malloc ((size_t) cmd->payload_size);
+      for (i = 0, n = 0; i < cmd->payload_iovcnt; i++) {
+         memcpy (gathered + n,
+                 cmd->payload_iov[i].iov_base,
+                 cmd->payload_iov[i].iov_len);
+         n += cmd->payload_iov[i].iov_len;
+      }
+
+      payload = gathered;
+   } else {
+      payload = cmd->payload;
+   }
+
    if (!event->command_owned) {
       event->command = bson_copy (event->command);
       event->command_owned = true;
@@ -53,9 +71,9 @@ append_documents_from_cmd (const mongoc_cmd_t *cmd,
    BSON_ASSERT (field_name);
    BSON_ASSERT (BSON_APPEND_ARRAY_BEGIN (event->command, field_name, &bson));
 
-   pos = cmd->payload;
+   pos = payload;
    i = 0;
-   while (pos < cmd->payload + cmd->payload_size) {
+   while (pos < payload + cmd->payload_size) {
       memcpy (&doc_len, pos, sizeof (doc_len));
       doc_len = BSON_UINT32_FROM_LE (doc_len);
       BSON_ASSERT (bson_init_static (&doc, pos, (size_t) doc_len));
@@ -67,6 +85,7 @@ append_documents_from_cmd (const mongoc_cmd_t *cmd,
    }
 
    bson_append_array_end (event->command, &bson);
+   bson_free (gathered);
 }
 
 
@@ -71,6 +71,15 @@ typedef struct _mongoc_async_cmd {
    char ns[MONGOC_NAMESPACE_MAX];
    struct addrinfo *dns_result;
 
+   /* when the cmd is due to initiate or time out, and its position in
+    * async->timers */
+   int64_t timer;
+   size_t timer_index;
+   /* the events its stream is registered for with async->epoll_fd */
+   mongoc_socket_fd_t fd;
+   int watched_events;
+   bool unwatchable;
+
    struct _mongoc_async_cmd *next;
    struct _mongoc_async_cmd *prev;
 } mongoc_async_cmd_t;
@@ -90,9 +99,23 @@ mongoc_async_cmd_new (mongoc_async_t *async,
                       void *cb_data,
                       int64_t timeout_msec);
 
+mongoc_async_cmd_t *
+mongoc_async_cmd_new_opmsg (mongoc_async_t *async,
+                            mongoc_stream_t *stream,
+                            const bson_t *cmd,
+                            mongoc_async_cmd_cb_t cb,
+                            void *cb_data,
+                            int64_t timeout_msec);
+
 void
 mongoc_async_cmd_destroy (mongoc_async_cmd_t *acmd);
 
+bool
+mongoc_async_cmd_process_revents (mongoc_async_cmd_t *acmd, int revents);
+
+int64_t
+mongoc_async_cmd_deadline (const mongoc_async_cmd_t *acmd);
+
 bool
 mongoc_async_cmd_run (mongoc_async_cmd_t *acmd);
 
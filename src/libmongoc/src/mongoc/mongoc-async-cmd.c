@@ -27,7 +27,6 @@
 #include "mongoc-server-description-private.h"
 #include "mongoc-topology-scanner-private.h"
 #include "mongoc-log.h"
-#include "utlist.h"
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-stream-tls.h"
@@ -117,9 +116,14 @@ mongoc_async_cmd_run (mongoc_async_cmd_t *acmd)
    }
 
    if (result == MONGOC_ASYNC_CMD_IN_PROGRESS) {
+      /* the phase may have changed the cmd's state or events */
+      mongoc_async_update (acmd->async, acmd);
       return true;
    }
 
+   /* before the callback, which may close the stream */
+   mongoc_async_unwatch (acmd->async, acmd);
+
    rtt_msec = (bson_get_monotonic_time () - acmd->cmd_started) / 1000;
 
    if (result == MONGOC_ASYNC_CMD_SUCCESS) {
@@ -157,6 +161,28 @@ _mongoc_async_cmd_init_send (mongoc_async_cmd_t *acmd, const char *dbname)
    acmd->bytes_written = 0;
 }
 
+/* like _mongoc_async_cmd_init_send, for an OP_MSG whose body is acmd->cmd,
+ * which must include "$db" */
+static void
+_mongoc_async_cmd_init_send_opmsg (mongoc_async_cmd_t *acmd)
+{
+   acmd->rpc.header.msg_len = 0;
+   acmd->rpc.header.request_id = ++acmd->async->request_id;
+   acmd->rpc.header.response_to = 0;
+   acmd->rpc.header.opcode = MONGOC_OPCODE_MSG;
+   acmd->rpc.msg.flags = 0;
+   acmd->rpc.msg.n_sections = 1;
+   acmd->rpc.msg.sections[0].payload_type = 0;
+   acmd->rpc.msg.sections[0].payload.bson_document =
+      bson_get_data (&acmd->cmd);
+
+   _mongoc_rpc_gather (&acmd->rpc, &acmd->array);
+   acmd->iovec = (mongoc_iovec_t *) acmd->array.data;
+   acmd->niovec = acmd->array.len;
+   _mongoc_rpc_swab_to_le (&acmd->rpc);
+   acmd->bytes_written = 0;
+}
+
 void
 _mongoc_async_cmd_state_start (mongoc_async_cmd_t *acmd, bool is_setup_done)
 {
@@ -212,20 +238,95 @@ mongoc_async_cmd_new (mongoc_async_t *async,
 
    _mongoc_async_cmd_state_start (acmd, is_setup_done);
 
-   async->ncmds++;
-   DL_APPEND (async->cmds, acmd);
+   mongoc_async_add (async, acmd);
 
    return acmd;
 }
 
 
+/* run @cmd as an OP_MSG on @stream, which is connected, set up, and idle */
+mongoc_async_cmd_t *
+mongoc_async_cmd_new_opmsg (mongoc_async_t *async,
+                            mongoc_stream_t *stream,
+                            const bson_t *cmd,
+                            mongoc_async_cmd_cb_t cb,
+                            void *cb_data,
+                            int64_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd;
+
+   BSON_ASSERT (stream);
+   BSON_ASSERT (cmd);
+
+   acmd = (mongoc_async_cmd_t *) bson_malloc0 (sizeof (*acmd));
+   acmd->async = async;
+   acmd->timeout_msec = timeout_msec;
+   acmd->stream = stream;
+   acmd->cb = cb;
+   acmd->data = cb_data;
+   acmd->connect_started = bson_get_monotonic_time ();
+   bson_copy_to (cmd, &acmd->cmd);
+
+   _mongoc_array_init (&acmd->array, sizeof (mongoc_iovec_t));
+   _mongoc_buffer_init (&acmd->buffer, NULL, 0, NULL, NULL);
+
+   _mongoc_async_cmd_init_send_opmsg (acmd);
+
+   _mongoc_async_cmd_state_start (acmd, true);
+
+   mongoc_async_add (async, acmd);
+
+   return acmd;
+}
+
+
+/* run @acmd's next step if @revents, as returned by poll () for its stream,
+ * shows it is ready or has failed. returns true if it was run */
+bool
+mongoc_async_cmd_process_revents (mongoc_async_cmd_t *acmd, int revents)
+{
+   if (revents & (POLLERR | POLLHUP)) {
+      int hup = revents & POLLHUP;
+      if (acmd->state == MONGOC_ASYNC_CMD_SEND) {
+         bson_set_error (&acmd->error,
+                         MONGOC_ERROR_STREAM,
+                         MONGOC_ERROR_STREAM_CONNECT,
+                         hup ? "connection refused"
+                             : "unknown connection error");
+      } else {
+         bson_set_error (&acmd->error,
+                         MONGOC_ERROR_STREAM,
+                         MONGOC_ERROR_STREAM_SOCKET,
+                         hup ? "connection closed" : "unknown socket error");
+      }
+
+      acmd->state = MONGOC_ASYNC_CMD_ERROR_STATE;
+   }
+
+   if ((revents & acmd->events) ||
+       acmd->state == MONGOC_ASYNC_CMD_ERROR_STATE) {
+      (void) mongoc_async_cmd_run (acmd);
+      return true;
+   }
+
+   return false;
+}
+
+
+/* when @acmd times out, in bson_get_monotonic_time () microseconds */
+int64_t
+mongoc_async_cmd_deadline (const mongoc_async_cmd_t *acmd)
+{
+   return acmd->connect_started + acmd->timeout_msec * 1000;
+}
+
+
 void
 mongoc_async_cmd_destroy (mongoc_async_cmd_t *acmd)
 {
    BSON_ASSERT (acmd);
 
-   DL_DELETE (acmd->async->cmds, acmd);
-   acmd->async->ncmds--;
+   mongoc_async_remove (acmd->async, acmd);
 
    bson_destroy (&acmd->cmd);
 
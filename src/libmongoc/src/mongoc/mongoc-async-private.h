@@ -32,6 +32,15 @@ typedef struct _mongoc_async {
    struct _mongoc_async_cmd *cmds;
    size_t ncmds;
    uint32_t request_id;
+   /* a min-heap of the ncmds cmds, ordered by their next timer */
+   struct _mongoc_async_cmd **timers;
+   size_t timers_size;
+   /* with epoll, cmds' streams stay registered until the cmd completes.
+    * -1 until mongoc_async_run first needs it, or if epoll is unavailable */
+   int epoll_fd;
+   /* cmds with a stream that can't be registered, like a custom stream with
+    * no socket. mongoc_async_run falls back to poll () while there are any */
+   size_t nunwatchable;
 } mongoc_async_t;
 
 typedef enum {
@@ -66,6 +75,21 @@ mongoc_async_destroy (mongoc_async_t *async);
 void
 mongoc_async_run (mongoc_async_t *async);
 
+void
+mongoc_async_process_timers (mongoc_async_t *async, int64_t now);
+
+void
+mongoc_async_add (mongoc_async_t *async, struct _mongoc_async_cmd *acmd);
+
+void
+mongoc_async_remove (mongoc_async_t *async, struct _mongoc_async_cmd *acmd);
+
+void
+mongoc_async_update (mongoc_async_t *async, struct _mongoc_async_cmd *acmd);
+
+void
+mongoc_async_unwatch (mongoc_async_t *async, struct _mongoc_async_cmd *acmd);
+
 BSON_END_DECLS
 
 #endif /* MONGOC_ASYNC_PRIVATE_H */
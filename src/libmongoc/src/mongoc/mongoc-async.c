@@ -22,8 +22,15 @@
 #include "utlist.h"
 #include "mongoc.h"
 #include "mongoc-socket-private.h"
+#include "mongoc-stream-private.h"
 #include "mongoc-util-private.h"
 
+#ifdef MONGOC_HAVE_EPOLL
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
 #undef MONGOC_LOG_DOMAIN
 #define MONGOC_LOG_DOMAIN "async"
 
@@ -33,6 +40,8 @@ mongoc_async_new ()
 {
    mongoc_async_t *async = (mongoc_async_t *) bson_malloc0 (sizeof (*async));
 
+   async->epoll_fd = -1;
+
    return async;
 }
 
@@ -46,160 +55,432 @@ mongoc_async_destroy (mongoc_async_t *async)
       mongoc_async_cmd_destroy (acmd);
    }
 
+#ifdef MONGOC_HAVE_EPOLL
+   if (async->epoll_fd != -1) {
+      close (async->epoll_fd);
+   }
+#endif
+
+   bson_free (async->timers);
    bson_free (async);
 }
 
+
+/*
+ * The timers heap. Each cmd's timer is when it is due to initiate, if it is
+ * waiting to, otherwise when it times out. Canceled cmds are due at once.
+ */
+
+static int64_t
+_mongoc_async_cmd_timer (const mongoc_async_cmd_t *acmd)
+{
+   if (acmd->state == MONGOC_ASYNC_CMD_CANCELED_STATE) {
+      return INT64_MIN;
+   }
+
+   if (acmd->state == MONGOC_ASYNC_CMD_INITIATE) {
+      return acmd->connect_started + acmd->initiate_delay_ms * 1000;
+   }
+
+   return mongoc_async_cmd_deadline (acmd);
+}
+
+static void
+_mongoc_async_timers_set (mongoc_async_t *async,
+                          size_t i,
+                          mongoc_async_cmd_t *acmd)
+{
+   async->timers[i] = acmd;
+   acmd->timer_index = i;
+}
+
+static void
+_mongoc_async_timers_sift_up (mongoc_async_t *async, size_t i)
+{
+   mongoc_async_cmd_t *acmd = async->timers[i];
+   size_t parent;
+
+   while (i > 0) {
+      parent = (i - 1) / 2;
+      if (async->timers[parent]->timer <= acmd->timer) {
+         break;
+      }
+
+      _mongoc_async_timers_set (async, i, async->timers[parent]);
+      i = parent;
+   }
+
+   _mongoc_async_timers_set (async, i, acmd);
+}
+
+static void
+_mongoc_async_timers_sift_down (mongoc_async_t *async, size_t i)
+{
+   mongoc_async_cmd_t *acmd = async->timers[i];
+   size_t n = async->ncmds;
+   size_t child;
+
+   for (;;) {
+      child = 2 * i + 1;
+      if (child >= n) {
+         break;
+      }
+
+      if (child + 1 < n &&
+          async->timers[child + 1]->timer < async->timers[child]->timer) {
+         child++;
+      }
+
+      if (acmd->timer <= async->timers[child]->timer) {
+         break;
+      }
+
+      _mongoc_async_timers_set (async, i, async->timers[child]);
+      i = child;
+   }
+
+   _mongoc_async_timers_set (async, i, acmd);
+}
+
+static void
+_mongoc_async_timers_fix (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+   size_t i = acmd->timer_index;
+
+   if (i > 0 && acmd->timer < async->timers[(i - 1) / 2]->timer) {
+      _mongoc_async_timers_sift_up (async, i);
+   } else {
+      _mongoc_async_timers_sift_down (async, i);
+   }
+}
+
+
+/*
+ * epoll registrations. A cmd's stream is registered while it is in progress
+ * and unregistered before its final callback, which may close the stream.
+ */
+
+#ifdef MONGOC_HAVE_EPOLL
+static uint32_t
+_mongoc_async_epoll_events (int events)
+{
+   return ((events & POLLIN) ? EPOLLIN : 0) |
+          ((events & POLLOUT) ? EPOLLOUT : 0);
+}
+
+static int
+_mongoc_async_poll_revents (uint32_t events)
+{
+   return ((events & EPOLLIN) ? POLLIN : 0) |
+          ((events & EPOLLOUT) ? POLLOUT : 0) |
+          ((events & EPOLLERR) ? POLLERR : 0) |
+          ((events & EPOLLHUP) ? POLLHUP : 0);
+}
+#endif
+
+static void
+_mongoc_async_watch (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+#ifdef MONGOC_HAVE_EPOLL
+   struct epoll_event event = {0};
+   int op;
+
+   if (async->epoll_fd == -1 || !acmd->stream || acmd->unwatchable ||
+       acmd->watched_events == acmd->events) {
+      return;
+   }
+
+   if (acmd->watched_events) {
+      op = EPOLL_CTL_MOD;
+   } else if (_mongoc_stream_get_socket_fd (acmd->stream, &acmd->fd)) {
+      op = EPOLL_CTL_ADD;
+   } else {
+      acmd->unwatchable = true;
+      async->nunwatchable++;
+      return;
+   }
+
+   event.events = _mongoc_async_epoll_events (acmd->events);
+   event.data.ptr = acmd;
+
+   if (epoll_ctl (async->epoll_fd, op, acmd->fd, &event) == 0) {
+      acmd->watched_events = acmd->events;
+   } else {
+      MONGOC_WARNING ("epoll_ctl failed: %d, falling back to poll", errno);
+      mongoc_async_unwatch (async, acmd);
+      acmd->unwatchable = true;
+      async->nunwatchable++;
+   }
+#endif
+}
+
+void
+mongoc_async_unwatch (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+#ifdef MONGOC_HAVE_EPOLL
+   struct epoll_event event = {0};
+
+   if (acmd->watched_events) {
+      /* fails harmlessly if the stream was closed, removing it from epoll */
+      (void) epoll_ctl (async->epoll_fd, EPOLL_CTL_DEL, acmd->fd, &event);
+      acmd->watched_events = 0;
+   }
+#endif
+
+   if (acmd->unwatchable) {
+      acmd->unwatchable = false;
+      async->nunwatchable--;
+   }
+}
+
+
+/* start tracking a new cmd */
+void
+mongoc_async_add (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+   if (async->ncmds == async->timers_size) {
+      async->timers_size = BSON_MAX (8, async->timers_size * 2);
+      async->timers = (mongoc_async_cmd_t **) bson_realloc (
+         async->timers, sizeof (*async->timers) * async->timers_size);
+   }
+
+   async->ncmds++;
+   DL_APPEND (async->cmds, acmd);
+
+   acmd->timer = _mongoc_async_cmd_timer (acmd);
+   _mongoc_async_timers_set (async, async->ncmds - 1, acmd);
+   _mongoc_async_timers_sift_up (async, async->ncmds - 1);
+
+   _mongoc_async_watch (async, acmd);
+}
+
+
+void
+mongoc_async_remove (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+   mongoc_async_cmd_t *last;
+
+   mongoc_async_unwatch (async, acmd);
+
+   DL_DELETE (async->cmds, acmd);
+   async->ncmds--;
+
+   /* fill the hole with the last timer */
+   last = async->timers[async->ncmds];
+   if (last != acmd) {
+      _mongoc_async_timers_set (async, acmd->timer_index, last);
+      _mongoc_async_timers_fix (async, last);
+   }
+}
+
+
+/* call after changing a cmd's state, events, or initiate delay */
+void
+mongoc_async_update (mongoc_async_t *async, mongoc_async_cmd_t *acmd)
+{
+   int64_t timer = _mongoc_async_cmd_timer (acmd);
+
+   if (timer != acmd->timer) {
+      acmd->timer = timer;
+      _mongoc_async_timers_fix (async, acmd);
+   }
+
+   _mongoc_async_watch (async, acmd);
+}
+
+
+/* initiate the cmds that are due to, and fail and remove those that have
+ * timed out by @now or been canceled. takes O(log n) per cmd processed */
+void
+mongoc_async_process_timers (mongoc_async_t *async, int64_t now)
+{
+   mongoc_async_cmd_t *acmd;
+   mongoc_async_cmd_result_t result;
+
+   while (async->ncmds) {
+      acmd = async->timers[0];
+
+      if (acmd->state == MONGOC_ASYNC_CMD_CANCELED_STATE) {
+         result = MONGOC_ASYNC_CMD_ERROR;
+      } else if (acmd->state == MONGOC_ASYNC_CMD_INITIATE) {
+         if (now < acmd->timer) {
+            break;
+         }
+
+         /* time to initiate. on failure the cmd removes itself */
+         if (mongoc_async_cmd_run (acmd)) {
+            BSON_ASSERT (acmd->stream);
+         }
+
+         continue;
+      } else if (now > acmd->timer) {
+         bson_set_error (&acmd->error,
+                         MONGOC_ERROR_STREAM,
+                         MONGOC_ERROR_STREAM_CONNECT,
+                         acmd->state == MONGOC_ASYNC_CMD_SEND
+                            ? "connection timeout"
+                            : "socket timeout");
+
+         result = MONGOC_ASYNC_CMD_TIMEOUT;
+      } else {
+         break;
+      }
+
+      mongoc_async_unwatch (async, acmd);
+      acmd->cb (acmd, result, NULL, (now - acmd->connect_started) / 1000);
+
+      /* Remove acmd from the async->cmds doubly-linked list */
+      mongoc_async_cmd_destroy (acmd);
+   }
+}
+
+
+#ifdef MONGOC_HAVE_EPOLL
+/* wait for events on the registered streams and process them */
+static void
+_mongoc_async_epoll (mongoc_async_t *async,
+                     struct epoll_event **events,
+                     size_t *events_size,
+                     int32_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd;
+   int nactive;
+   int i;
+
+   if (*events_size < async->ncmds) {
+      *events_size = async->ncmds;
+      *events = (struct epoll_event *) bson_realloc (
+         *events, sizeof (**events) * *events_size);
+   }
+
+   nactive = epoll_wait (
+      async->epoll_fd, *events, (int) *events_size, (int) timeout_msec);
+
+   for (i = 0; i < nactive; i++) {
+      acmd = (mongoc_async_cmd_t *) (*events)[i].data.ptr;
+      (void) mongoc_async_cmd_process_revents (
+         acmd, _mongoc_async_poll_revents ((*events)[i].events));
+   }
+}
+#endif
+
+
+/* poll () every cmd with a stream and process the results */
+static void
+_mongoc_async_poll (mongoc_async_t *async,
+                    mongoc_stream_poll_t **poller,
+                    mongoc_async_cmd_t ***acmds_polled,
+                    size_t *poll_size,
+                    int32_t timeout_msec)
+{
+   mongoc_async_cmd_t *acmd;
+   ssize_t nactive = 0;
+   int nstreams = 0;
+   int i;
+
+   /* ncmds grows if we discover a replica & start calling ismaster on it */
+   if (*poll_size < async->ncmds) {
+      *poller = (mongoc_stream_poll_t *) bson_realloc (
+         *poller, sizeof (**poller) * async->ncmds);
+      *acmds_polled = (mongoc_async_cmd_t **) bson_realloc (
+         *acmds_polled, sizeof (**acmds_polled) * async->ncmds);
+      *poll_size = async->ncmds;
+   }
+
+   DL_FOREACH (async->cmds, acmd)
+   {
+      if (acmd->stream) {
+         (*acmds_polled)[nstreams] = acmd;
+         (*poller)[nstreams].stream = acmd->stream;
+         (*poller)[nstreams].events = acmd->events;
+         (*poller)[nstreams].revents = 0;
+         ++nstreams;
+      }
+   }
+
+   if (nstreams > 0) {
+      /* we need at least one stream to poll. */
+      nactive = mongoc_stream_poll (*poller, nstreams, timeout_msec);
+   } else {
+      /* all cmds are waiting to initiate */
+      _mongoc_usleep (timeout_msec * 1000);
+   }
+
+   for (i = 0; i < nstreams && nactive > 0; i++) {
+      if (mongoc_async_cmd_process_revents ((*acmds_polled)[i],
+                                            (*poller)[i].revents)) {
+         nactive--;
+      }
+   }
+}
+
+
 void
 mongoc_async_run (mongoc_async_t *async)
 {
-   mongoc_async_cmd_t *acmd, *tmp;
+   mongoc_async_cmd_t *acmd;
    mongoc_async_cmd_t **acmds_polled = NULL;
    mongoc_stream_poll_t *poller = NULL;
-   int nstreams, i;
-   ssize_t nactive = 0;
+   size_t poll_size = 0;
+#ifdef MONGOC_HAVE_EPOLL
+   struct epoll_event *events = NULL;
+   size_t events_size = 0;
+#endif
    int64_t now;
-   int64_t expire_at;
    int64_t poll_timeout_msec;
-   size_t poll_size;
+   size_t i;
 
    now = bson_get_monotonic_time ();
-   poll_size = 0;
+
+#ifdef MONGOC_HAVE_EPOLL
+   if (async->epoll_fd == -1) {
+      async->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+   }
+#endif
 
    /* CDRIVER-1571 reset start times in case a stream initiator was slow */
    DL_FOREACH (async->cmds, acmd)
    {
       acmd->connect_started = now;
+      acmd->timer = _mongoc_async_cmd_timer (acmd);
+      _mongoc_async_watch (async, acmd);
    }
 
-   while (async->ncmds) {
-      /* ncmds grows if we discover a replica & start calling ismaster on it */
-      if (poll_size < async->ncmds) {
-         poller = (mongoc_stream_poll_t *) bson_realloc (
-            poller, sizeof (*poller) * async->ncmds);
-         acmds_polled = (mongoc_async_cmd_t **) bson_realloc (
-            acmds_polled, sizeof (*acmds_polled) * async->ncmds);
-         poll_size = async->ncmds;
-      }
-
-      expire_at = INT64_MAX;
-      nstreams = 0;
-
-      /* check if any cmds are ready to be initiated. */
-      DL_FOREACH_SAFE (async->cmds, acmd, tmp)
-      {
-         if (acmd->state == MONGOC_ASYNC_CMD_INITIATE) {
-            BSON_ASSERT (!acmd->stream);
-            if (now >= acmd->initiate_delay_ms * 1000 + acmd->connect_started) {
-               /* time to initiate. */
-               if (mongoc_async_cmd_run (acmd)) {
-                  BSON_ASSERT (acmd->stream);
-               } else {
-                  /* this command was removed. */
-                  continue;
-               }
-            } else {
-               /* don't poll longer than the earliest cmd ready to init. */
-               expire_at = BSON_MIN (
-                  expire_at, acmd->connect_started + acmd->initiate_delay_ms);
-            }
-         }
-
-         if (acmd->stream) {
-            acmds_polled[nstreams] = acmd;
-            poller[nstreams].stream = acmd->stream;
-            poller[nstreams].events = acmd->events;
-            poller[nstreams].revents = 0;
-            expire_at = BSON_MIN (
-               expire_at, acmd->connect_started + acmd->timeout_msec * 1000);
-            ++nstreams;
-         }
-      }
+   for (i = async->ncmds / 2; i > 0; i--) {
+      _mongoc_async_timers_sift_down (async, i - 1);
+   }
 
-      if (async->ncmds == 0) {
-         /* all cmds failed to initiate and removed themselves. */
+   for (;;) {
+      mongoc_async_process_timers (async, now);
+      if (!async->ncmds) {
          break;
       }
 
-      poll_timeout_msec = BSON_MAX (0, (expire_at - now) / 1000);
+      /* round up, so we don't wake just before the earliest timer */
+      poll_timeout_msec =
+         BSON_MAX (0, (async->timers[0]->timer - now + 999) / 1000);
       BSON_ASSERT (poll_timeout_msec < INT32_MAX);
 
-      if (nstreams > 0) {
-         /* we need at least one stream to poll. */
-         nactive =
-            mongoc_stream_poll (poller, nstreams, (int32_t) poll_timeout_msec);
-      } else {
-         /* currently this does not get hit. we always have at least one command
-          * initialized with a stream. */
-         _mongoc_usleep (poll_timeout_msec * 1000);
-      }
-
-      if (nactive > 0) {
-         for (i = 0; i < nstreams; i++) {
-            mongoc_async_cmd_t *iter = acmds_polled[i];
-            if (poller[i].revents & (POLLERR | POLLHUP)) {
-               int hup = poller[i].revents & POLLHUP;
-               if (iter->state == MONGOC_ASYNC_CMD_SEND) {
-                  bson_set_error (&iter->error,
-                                  MONGOC_ERROR_STREAM,
-                                  MONGOC_ERROR_STREAM_CONNECT,
-                                  hup ? "connection refused"
-                                      : "unknown connection error");
-               } else {
-                  bson_set_error (&iter->error,
-                                  MONGOC_ERROR_STREAM,
-                                  MONGOC_ERROR_STREAM_SOCKET,
-                                  hup ? "connection closed"
-                                      : "unknown socket error");
-               }
-
-               iter->state = MONGOC_ASYNC_CMD_ERROR_STATE;
-            }
-
-            if ((poller[i].revents & poller[i].events) ||
-                iter->state == MONGOC_ASYNC_CMD_ERROR_STATE) {
-               (void) mongoc_async_cmd_run (iter);
-               nactive--;
-            }
-
-            if (!nactive) {
-               break;
-            }
-         }
-      }
-
-      DL_FOREACH_SAFE (async->cmds, acmd, tmp)
+#ifdef MONGOC_HAVE_EPOLL
+      if (async->epoll_fd != -1 && !async->nunwatchable) {
+         _mongoc_async_epoll (
+            async, &events, &events_size, (int32_t) poll_timeout_msec);
+      } else
+#endif
       {
-         bool remove_cmd = false;
-         mongoc_async_cmd_result_t result;
-
-         /* check if an initiated cmd has passed the connection timeout.  */
-         if (acmd->state != MONGOC_ASYNC_CMD_INITIATE &&
-             now > acmd->connect_started + acmd->timeout_msec * 1000) {
-            bson_set_error (&acmd->error,
-                            MONGOC_ERROR_STREAM,
-                            MONGOC_ERROR_STREAM_CONNECT,
-                            acmd->state == MONGOC_ASYNC_CMD_SEND
-                               ? "connection timeout"
-                               : "socket timeout");
-
-            remove_cmd = true;
-            result = MONGOC_ASYNC_CMD_TIMEOUT;
-         } else if (acmd->state == MONGOC_ASYNC_CMD_CANCELED_STATE) {
-            remove_cmd = true;
-            result = MONGOC_ASYNC_CMD_ERROR;
-         }
-
-         if (remove_cmd) {
-            acmd->cb (acmd, result, NULL, (now - acmd->connect_started) / 1000);
-
-            /* Remove acmd from the async->cmds doubly-linked list */
-            mongoc_async_cmd_destroy (acmd);
-         }
+         _mongoc_async_poll (async,
+                             &poller,
+                             &acmds_polled,
+                             &poll_size,
+                             (int32_t) poll_timeout_msec);
       }
 
       now = bson_get_monotonic_time ();
    }
 
+#ifdef MONGOC_HAVE_EPOLL
+   bson_free (events);
+#endif
    bson_free (poller);
    bson_free (acmds_polled);
 }
@@ -40,6 +40,8 @@ struct _mongoc_bulk_operation_t {
    mongoc_write_result_t result;
    bool executed;
    int64_t operation_id;
+   /* insert documents by reference, see the "zeroCopy" option */
+   bool zero_copy;
 };
 
 
@@ -17,7 +17,9 @@
 
 #include "mongoc-bulk-operation.h"
 #include "mongoc-bulk-operation-private.h"
+#include "mongoc-client-pool-private.h"
 #include "mongoc-client-private.h"
+#include "mongoc-thread-private.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-write-concern-private.h"
 #include "mongoc-util-private.h"
@@ -371,7 +373,12 @@ mongoc_bulk_operation_insert_with_opts (mongoc_bulk_operation_t *bulk,
          &bulk->commands, mongoc_write_command_t, bulk->commands.len - 1);
 
       if (last->type == MONGOC_WRITE_COMMAND_INSERT) {
-         _mongoc_write_command_insert_append (last, document);
+         if (bulk->zero_copy) {
+            _mongoc_write_command_insert_append_ref (last, document);
+         } else {
+            _mongoc_write_command_insert_append (last, document);
+         }
+
          ret = true;
          GOTO (done);
       }
@@ -379,12 +386,16 @@ mongoc_bulk_operation_insert_with_opts (mongoc_bulk_operation_t *bulk,
 
    _mongoc_write_command_init_insert (
       &command,
-      document,
+      bulk->zero_copy ? NULL : document,
       opts,
       bulk->flags,
       bulk->operation_id,
       !mongoc_write_concern_is_acknowledged (bulk->write_concern));
 
+   if (bulk->zero_copy) {
+      _mongoc_write_command_insert_append_ref (&command, document);
+   }
+
    _mongoc_array_append_val (&bulk->commands, command);
 
    ret = true;
@@ -688,31 +699,32 @@ mongoc_bulk_operation_replace_one (mongoc_bulk_operation_t *bulk,
    EXIT;
 }
 
-uint32_t
-mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
-                               bson_t *reply,                 /* OUT */
-                               bson_error_t *error)           /* OUT */
-{
-   mongoc_cluster_t *cluster;
-   mongoc_write_command_t *command;
-   mongoc_server_stream_t *server_stream;
-   bool ret;
-   uint32_t offset = 0;
-   int i;
-
-   ENTRY;
-
-   BSON_ASSERT (bulk);
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_operation_begin --
+ *
+ *       Check that @bulk can be executed and reset its result from any
+ *       previous execution.
+ *
+ * Returns:
+ *       true if @bulk can be executed; otherwise false and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
 
+static bool
+_mongoc_bulk_operation_begin (mongoc_bulk_operation_t *bulk,
+                              bson_error_t *error)
+{
    if (!bulk->client) {
       bson_set_error (error,
                       MONGOC_ERROR_COMMAND,
                       MONGOC_ERROR_COMMAND_INVALID_ARG,
                       "mongoc_bulk_operation_execute() requires a client "
                       "and one has not been set.");
-      GOTO (err);
+      return false;
    }
-   cluster = &bulk->client->cluster;
 
    if (bulk->executed) {
       _mongoc_write_result_destroy (&bulk->result);
@@ -727,14 +739,14 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
                       MONGOC_ERROR_COMMAND_INVALID_ARG,
                       "mongoc_bulk_operation_execute() requires a database "
                       "and one has not been set.");
-      GOTO (err);
+      return false;
    } else if (!bulk->collection) {
       bson_set_error (error,
                       MONGOC_ERROR_COMMAND,
                       MONGOC_ERROR_COMMAND_INVALID_ARG,
                       "mongoc_bulk_operation_execute() requires a collection "
                       "and one has not been set.");
-      GOTO (err);
+      return false;
    }
 
    /* error stored by functions like mongoc_bulk_operation_insert that
@@ -744,7 +756,7 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
          memcpy (error, &bulk->result.error, sizeof (bson_error_t));
       }
 
-      GOTO (err);
+      return false;
    }
 
    if (!bulk->commands.len) {
@@ -752,9 +764,35 @@ mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
                       MONGOC_ERROR_COMMAND,
                       MONGOC_ERROR_COMMAND_INVALID_ARG,
                       "Cannot do an empty bulk write");
+      return false;
+   }
+
+   return true;
+}
+
+
+uint32_t
+mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk, /* IN */
+                               bson_t *reply,                 /* OUT */
+                               bson_error_t *error)           /* OUT */
+{
+   mongoc_cluster_t *cluster;
+   mongoc_write_command_t *command;
+   mongoc_server_stream_t *server_stream;
+   bool ret;
+   uint32_t offset = 0;
+   int i;
+
+   ENTRY;
+
+   BSON_ASSERT (bulk);
+
+   if (!_mongoc_bulk_operation_begin (bulk, error)) {
       GOTO (err);
    }
 
+   cluster = &bulk->client->cluster;
+
    for (i = 0; i < bulk->commands.len; i++) {
       if (bulk->server_id) {
          server_stream =
@@ -815,6 +853,323 @@ err:
    RETURN (false);
 }
 
+
+/* a run of documents from one of a bulk operation's commands, executed by
+ * whichever thread of mongoc_bulk_operation_execute_parallel claims it */
+typedef struct {
+   uint32_t command_index;
+   uint32_t first;       /* within the command */
+   uint32_t n_documents; /* all the command's documents, or a slice */
+   uint32_t offset;      /* index of the first document in the bulk */
+   uint32_t server_id;   /* set once executed */
+   mongoc_write_result_t result;
+} mongoc_bulk_parallel_unit_t;
+
+
+typedef struct {
+   mongoc_bulk_operation_t *bulk;
+   uint32_t server_id; /* the bulk's server hint, or 0 */
+   mongoc_array_t units;
+   volatile int32_t next_unit;
+   volatile int32_t stop;
+} mongoc_bulk_parallel_t;
+
+
+typedef struct {
+   mongoc_bulk_parallel_t *parallel;
+   mongoc_client_t *client;
+   bson_thread_t thread;
+} mongoc_bulk_parallel_worker_t;
+
+
+/* claim and execute units on @client until none are left */
+static void
+_mongoc_bulk_parallel_run (mongoc_bulk_parallel_t *parallel,
+                           mongoc_client_t *client)
+{
+   mongoc_bulk_operation_t *bulk = parallel->bulk;
+   mongoc_bulk_parallel_unit_t *unit;
+   mongoc_write_command_t *command;
+   mongoc_write_command_t slice;
+   mongoc_server_stream_t *server_stream;
+   bool whole;
+   int32_t i;
+
+   while (!parallel->stop) {
+      i = bson_atomic_int_add (&parallel->next_unit, 1) - 1;
+      if (i >= (int32_t) parallel->units.len) {
+         return;
+      }
+
+      unit = &_mongoc_array_index (
+         &parallel->units, mongoc_bulk_parallel_unit_t, i);
+
+      /* without a hint each unit selects a server of its own, so on a
+       * sharded cluster the units are spread over the mongos routers */
+      if (parallel->server_id) {
+         server_stream = mongoc_cluster_stream_for_server (&client->cluster,
+                                                           parallel->server_id,
+                                                           true,
+                                                           NULL,
+                                                           NULL,
+                                                           &unit->result.error);
+      } else {
+         server_stream = mongoc_cluster_stream_for_writes (
+            &client->cluster, NULL, NULL, &unit->result.error);
+      }
+
+      if (!server_stream) {
+         unit->result.failed = true;
+         unit->result.must_stop = true;
+         bson_atomic_int_add (&parallel->stop, 1);
+         return;
+      }
+
+      command = &_mongoc_array_index (
+         &bulk->commands, mongoc_write_command_t, unit->command_index);
+      whole = unit->n_documents == command->n_documents;
+
+      if (!whole) {
+         _mongoc_write_command_init_slice (
+            &slice, command, unit->first, unit->n_documents);
+      }
+
+      _mongoc_write_command_execute (whole ? command : &slice,
+                                     client,
+                                     server_stream,
+                                     bulk->database,
+                                     bulk->collection,
+                                     bulk->write_concern,
+                                     unit->offset,
+                                     NULL,
+                                     &unit->result);
+
+      if (!whole) {
+         _mongoc_write_command_destroy (&slice);
+      }
+
+      unit->server_id = server_stream->sd->id;
+      mongoc_server_stream_cleanup (server_stream);
+
+      if (unit->result.must_stop) {
+         bson_atomic_int_add (&parallel->stop, 1);
+      }
+   }
+}
+
+
+static void *
+_mongoc_bulk_parallel_worker (void *data)
+{
+   mongoc_bulk_parallel_worker_t *worker;
+
+   worker = (mongoc_bulk_parallel_worker_t *) data;
+   _mongoc_bulk_parallel_run (worker->parallel, worker->client);
+
+   return NULL;
+}
+
+
+/* divide @bulk's commands into units of at most @max_batch documents,
+ * and each command into at least @max_parallelism units if it can be */
+static void
+_mongoc_bulk_parallel_plan (mongoc_bulk_parallel_t *parallel,
+                            uint32_t max_parallelism,
+                            uint32_t max_batch)
+{
+   mongoc_bulk_operation_t *bulk = parallel->bulk;
+   mongoc_bulk_parallel_unit_t unit;
+   mongoc_write_command_t *command;
+   uint32_t offset = 0;
+   uint32_t unit_size;
+   size_t i;
+
+   for (i = 0; i < bulk->commands.len; i++) {
+      command =
+         &_mongoc_array_index (&bulk->commands, mongoc_write_command_t, i);
+      unit_size = (uint32_t) (((uint64_t) command->n_documents +
+                               max_parallelism - 1) /
+                              max_parallelism);
+      unit_size = BSON_MAX (1, BSON_MIN (unit_size, max_batch));
+
+      for (unit.first = 0; unit.first < command->n_documents;
+           unit.first += unit.n_documents) {
+         unit.command_index = (uint32_t) i;
+         unit.n_documents =
+            BSON_MIN (unit_size, command->n_documents - unit.first);
+         unit.offset = offset + unit.first;
+         unit.server_id = 0;
+         _mongoc_write_result_init (&unit.result);
+         _mongoc_array_append_val (&parallel->units, unit);
+      }
+
+      offset += command->n_documents;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_operation_execute_parallel --
+ *
+ *       Execute an unordered bulk operation on up to @max_parallelism
+ *       connections at once: the calling thread uses the bulk's client,
+ *       and each other thread a client from @pool. Commands are divided
+ *       into runs of documents that each thread executes as it finishes
+ *       the last, and the results are merged in the order of the bulk's
+ *       operations.
+ *
+ *       If fewer than @max_parallelism - 1 clients can be popped from
+ *       @pool without waiting, fewer threads are used.
+ *
+ * Returns:
+ *       The id of a server that executed operations, or 0 on failure and
+ *       @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint32_t
+mongoc_bulk_operation_execute_parallel (mongoc_bulk_operation_t *bulk,
+                                        mongoc_client_pool_t *pool,
+                                        uint32_t max_parallelism,
+                                        bson_t *reply,
+                                        bson_error_t *error)
+{
+   mongoc_bulk_parallel_t parallel;
+   mongoc_bulk_parallel_worker_t *workers;
+   mongoc_bulk_parallel_unit_t *unit;
+   mongoc_server_stream_t *server_stream;
+   uint32_t max_batch;
+   uint32_t max_workers;
+   uint32_t n_workers = 0;
+   uint32_t server_id = 0;
+   bool ret;
+   size_t i;
+
+   ENTRY;
+
+   BSON_ASSERT (bulk);
+   BSON_ASSERT (pool);
+
+   if (bulk->flags.ordered) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "mongoc_bulk_operation_execute_parallel() requires an "
+                      "unordered bulk operation");
+      _mongoc_bson_init_if_set (reply);
+      RETURN (0);
+   }
+
+   if (bulk->session) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "mongoc_bulk_operation_execute_parallel() cannot use "
+                      "a session");
+      _mongoc_bson_init_if_set (reply);
+      RETURN (0);
+   }
+
+   if (max_parallelism < 2) {
+      RETURN (mongoc_bulk_operation_execute (bulk, reply, error));
+   }
+
+   /* the caller's thread and one per client the pool can ever lend */
+   max_parallelism = BSON_MIN (max_parallelism - 1,
+                               _mongoc_client_pool_get_max_size (pool)) +
+                     1;
+
+   if (!_mongoc_bulk_operation_begin (bulk, error)) {
+      _mongoc_bson_init_if_set (reply);
+      RETURN (0);
+   }
+
+   /* the server's limit on documents per batch caps the units' size */
+   if (bulk->server_id) {
+      server_stream = mongoc_cluster_stream_for_server (
+         &bulk->client->cluster, bulk->server_id, true, NULL, reply, error);
+   } else {
+      server_stream = mongoc_cluster_stream_for_writes (
+         &bulk->client->cluster, NULL, reply, error);
+   }
+
+   if (!server_stream) {
+      /* stream_for_server and stream_for_writes initialize reply on error */
+      RETURN (0);
+   }
+
+   max_batch = (uint32_t) BSON_MAX (
+      1, mongoc_server_stream_max_write_batch_size (server_stream));
+   mongoc_server_stream_cleanup (server_stream);
+
+   parallel.bulk = bulk;
+   parallel.server_id = bulk->server_id;
+   parallel.next_unit = 0;
+   parallel.stop = 0;
+   _mongoc_array_init (&parallel.units, sizeof (mongoc_bulk_parallel_unit_t));
+   _mongoc_bulk_parallel_plan (&parallel, max_parallelism, max_batch);
+
+   /* no more threads than units: the caller's thread runs one of them */
+   max_workers = (uint32_t) BSON_MIN (max_parallelism - 1,
+                                      BSON_MAX (parallel.units.len, 1) - 1);
+   workers = (mongoc_bulk_parallel_worker_t *) bson_malloc0 (
+      BSON_MAX (max_workers, 1) * sizeof (mongoc_bulk_parallel_worker_t));
+
+   while (n_workers < max_workers) {
+      workers[n_workers].parallel = &parallel;
+      workers[n_workers].client = mongoc_client_pool_try_pop (pool);
+      if (!workers[n_workers].client) {
+         break;
+      }
+
+      if (bson_thread_create (&workers[n_workers].thread,
+                              _mongoc_bulk_parallel_worker,
+                              &workers[n_workers]) != 0) {
+         mongoc_client_pool_push (pool, workers[n_workers].client);
+         break;
+      }
+
+      n_workers++;
+   }
+
+   _mongoc_bulk_parallel_run (&parallel, bulk->client);
+
+   for (i = 0; i < n_workers; i++) {
+      bson_thread_join (workers[i].thread);
+      mongoc_client_pool_push (pool, workers[i].client);
+   }
+
+   for (i = 0; i < parallel.units.len; i++) {
+      unit = &_mongoc_array_index (
+         &parallel.units, mongoc_bulk_parallel_unit_t, i);
+      _mongoc_write_result_merge_result (&bulk->result, &unit->result);
+      _mongoc_write_result_destroy (&unit->result);
+      if (!server_id) {
+         server_id = unit->server_id;
+      }
+   }
+
+   if (server_id) {
+      bulk->server_id = server_id;
+   }
+
+   bson_free (workers);
+   _mongoc_array_destroy (&parallel.units);
+
+   _mongoc_bson_init_if_set (reply);
+   ret = MONGOC_WRITE_RESULT_COMPLETE (&bulk->result,
+                                       bulk->client->error_api_version,
+                                       bulk->write_concern,
+                                       MONGOC_ERROR_COMMAND /* err domain */,
+                                       reply,
+                                       error);
+
+   RETURN (ret ? server_id : 0);
+}
+
 void
 mongoc_bulk_operation_set_write_concern (
    mongoc_bulk_operation_t *bulk, const mongoc_write_concern_t *write_concern)
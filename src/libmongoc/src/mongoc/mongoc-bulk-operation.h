@@ -34,6 +34,7 @@ BSON_BEGIN_DECLS
 
 /* forward decl */
 struct _mongoc_client_session_t;
+struct _mongoc_client_pool_t;
 
 typedef struct _mongoc_bulk_operation_t mongoc_bulk_operation_t;
 typedef struct _mongoc_bulk_write_flags_t mongoc_bulk_write_flags_t;
@@ -45,6 +46,12 @@ MONGOC_EXPORT (uint32_t)
 mongoc_bulk_operation_execute (mongoc_bulk_operation_t *bulk,
                                bson_t *reply,
                                bson_error_t *error);
+MONGOC_EXPORT (uint32_t)
+mongoc_bulk_operation_execute_parallel (mongoc_bulk_operation_t *bulk,
+                                        struct _mongoc_client_pool_t *pool,
+                                        uint32_t max_parallelism,
+                                        bson_t *reply,
+                                        bson_error_t *error);
 MONGOC_EXPORT (void)
 mongoc_bulk_operation_delete (mongoc_bulk_operation_t *bulk,
                               const bson_t *selector)
@@ -0,0 +1,897 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-bulk-writer.h"
+#include "mongoc-bulk-operation-private.h"
+#include "mongoc-client-private.h"
+#include "mongoc-error.h"
+#include "mongoc-opts-private.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-trace-private.h"
+#include "mongoc-util-private.h"
+#include "mongoc-write-command-private.h"
+
+
+/* how often the writer's thread retries an exhausted pool */
+#define MONGOC_BULK_WRITER_POP_INTERVAL_MSEC 10
+
+
+/* operations flushed together. a batch's bulk operation is only a container
+ * for its write commands, which the writer's thread executes itself */
+typedef struct _mongoc_bulk_writer_batch_t {
+   mongoc_bulk_operation_t *bulk;
+   int64_t first_index; /* of its first operation, among the writer's */
+   int64_t n_operations;
+   int64_t n_bytes;
+   int64_t started; /* when its first operation was added */
+   struct _mongoc_bulk_writer_batch_t *next;
+} mongoc_bulk_writer_batch_t;
+
+
+struct _mongoc_bulk_writer_t {
+   mongoc_client_pool_t *pool;
+   char *database;
+   char *collection;
+   mongoc_write_concern_t *write_concern; /* NULL for the client's */
+   bool bypass;
+   int64_t max_batch_documents;
+   int64_t max_batch_bytes;
+   int64_t flush_interval_msec;
+   int64_t max_buffered_bytes;
+   mongoc_bulk_writer_error_cb_t error_cb;
+   void *error_context;
+   bson_thread_t thread;
+
+   /* the rest is protected by the mutex. the condition is broadcast when
+    * a batch is sealed or executed, and when the writer is destroyed */
+   bson_mutex_t mutex;
+   mongoc_cond_t cond;
+   mongoc_bulk_writer_batch_t *open; /* accepting operations, or NULL */
+   mongoc_bulk_writer_batch_t *queue_head; /* sealed, oldest first */
+   mongoc_bulk_writer_batch_t *queue_tail;
+   mongoc_bulk_writer_batch_t *idle; /* executed, kept for reuse */
+   int64_t n_operations;   /* added so far */
+   int64_t buffered_bytes; /* in batches not yet executed */
+   int64_t n_sealed;       /* batches */
+   int64_t n_executed;
+   bool shutdown;
+};
+
+
+typedef enum {
+   MONGOC_BULK_WRITER_INSERT,
+   MONGOC_BULK_WRITER_UPDATE_ONE,
+   MONGOC_BULK_WRITER_UPDATE_MANY,
+   MONGOC_BULK_WRITER_REPLACE_ONE,
+   MONGOC_BULK_WRITER_REMOVE_ONE,
+   MONGOC_BULK_WRITER_REMOVE_MANY,
+} mongoc_bulk_writer_op_t;
+
+
+static void *
+_mongoc_bulk_writer_run (void *data);
+
+
+/* the bytes the last of @bulk's write commands takes */
+static int64_t
+_mongoc_bulk_writer_last_len (const mongoc_bulk_operation_t *bulk)
+{
+   if (!bulk->commands.len) {
+      return 0;
+   }
+
+   return (int64_t) _mongoc_array_index (
+             &bulk->commands, mongoc_write_command_t, bulk->commands.len - 1)
+      .payload.len;
+}
+
+
+/* free @batch's write commands so it can be reused */
+static void
+_mongoc_bulk_writer_batch_reset (mongoc_bulk_writer_batch_t *batch)
+{
+   size_t i;
+
+   for (i = 0; i < batch->bulk->commands.len; i++) {
+      _mongoc_write_command_destroy (&_mongoc_array_index (
+         &batch->bulk->commands, mongoc_write_command_t, i));
+   }
+
+   batch->bulk->commands.len = 0;
+   batch->n_operations = 0;
+   batch->n_bytes = 0;
+   batch->next = NULL;
+}
+
+
+static void
+_mongoc_bulk_writer_batch_destroy (mongoc_bulk_writer_batch_t *batch)
+{
+   /* destroys the write commands */
+   mongoc_bulk_operation_destroy (batch->bulk);
+   bson_free (batch);
+}
+
+
+/* queue the open batch for the writer's thread. call with the mutex held */
+static void
+_mongoc_bulk_writer_seal (mongoc_bulk_writer_t *writer)
+{
+   mongoc_bulk_writer_batch_t *batch = writer->open;
+
+   if (!batch || !batch->n_operations) {
+      return;
+   }
+
+   writer->open = NULL;
+   if (writer->queue_tail) {
+      writer->queue_tail->next = batch;
+   } else {
+      writer->queue_head = batch;
+   }
+
+   writer->queue_tail = batch;
+   writer->n_sealed++;
+   mongoc_cond_broadcast (&writer->cond);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_writer_new --
+ *
+ *       Create a writer that flushes the write operations added to it to
+ *       @db.@collection in the background, with a client from @pool.
+ *
+ * Returns:
+ *       A new writer, or NULL if @opts are invalid and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_bulk_writer_t *
+mongoc_bulk_writer_new (mongoc_client_pool_t *pool,
+                        const char *db,
+                        const char *collection,
+                        const bson_t *opts,
+                        bson_error_t *error)
+{
+   mongoc_bulk_writer_t *writer;
+   mongoc_bulk_writer_opts_t writer_opts;
+   int r;
+
+   ENTRY;
+
+   BSON_ASSERT (pool);
+   BSON_ASSERT (db);
+   BSON_ASSERT (collection);
+
+   if (!_mongoc_bulk_writer_opts_parse (NULL, opts, &writer_opts, error)) {
+      _mongoc_bulk_writer_opts_cleanup (&writer_opts);
+      RETURN (NULL);
+   }
+
+   if (writer_opts.max_buffered_bytes < writer_opts.max_batch_bytes) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "Invalid \"maxBufferedBytes\" in opts: %" PRId64
+                      ". The value must be at least \"maxBatchBytes\", "
+                      "%" PRId64 ".",
+                      writer_opts.max_buffered_bytes,
+                      writer_opts.max_batch_bytes);
+      _mongoc_bulk_writer_opts_cleanup (&writer_opts);
+      RETURN (NULL);
+   }
+
+   writer = (mongoc_bulk_writer_t *) bson_malloc0 (sizeof *writer);
+   writer->pool = pool;
+   writer->database = bson_strdup (db);
+   writer->collection = bson_strdup (collection);
+   if (writer_opts.writeConcern) {
+      writer->write_concern =
+         mongoc_write_concern_copy (writer_opts.writeConcern);
+   }
+
+   writer->bypass = writer_opts.bypass;
+   writer->max_batch_documents = writer_opts.max_batch_documents;
+   writer->max_batch_bytes = writer_opts.max_batch_bytes;
+   writer->flush_interval_msec = writer_opts.flush_interval_ms;
+   writer->max_buffered_bytes = writer_opts.max_buffered_bytes;
+   bson_mutex_init (&writer->mutex);
+   mongoc_cond_init (&writer->cond);
+
+   _mongoc_bulk_writer_opts_cleanup (&writer_opts);
+
+   r = bson_thread_create (&writer->thread, _mongoc_bulk_writer_run, writer);
+   if (r != 0) {
+      MONGOC_ERROR ("could not start bulk writer thread: %s", strerror (r));
+      abort ();
+   }
+
+   RETURN (writer);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_writer_destroy --
+ *
+ *       Flush all operations, wait for them to complete, and free
+ *       @writer.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_bulk_writer_destroy (mongoc_bulk_writer_t *writer)
+{
+   mongoc_bulk_writer_batch_t *batch;
+
+   ENTRY;
+
+   if (!writer) {
+      EXIT;
+   }
+
+   bson_mutex_lock (&writer->mutex);
+   _mongoc_bulk_writer_seal (writer);
+   writer->shutdown = true;
+   mongoc_cond_broadcast (&writer->cond);
+   bson_mutex_unlock (&writer->mutex);
+
+   /* the thread executes the queued batches before it returns */
+   bson_thread_join (writer->thread);
+
+   if (writer->open) {
+      _mongoc_bulk_writer_batch_destroy (writer->open);
+   }
+
+   while (writer->idle) {
+      batch = writer->idle;
+      writer->idle = batch->next;
+      _mongoc_bulk_writer_batch_destroy (batch);
+   }
+
+   mongoc_cond_destroy (&writer->cond);
+   bson_mutex_destroy (&writer->mutex);
+   mongoc_write_concern_destroy (writer->write_concern);
+   bson_free (writer->database);
+   bson_free (writer->collection);
+   bson_free (writer);
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_writer_set_error_cb --
+ *
+ *       Set the function @writer's thread calls for each operation that
+ *       failed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_bulk_writer_set_error_cb (mongoc_bulk_writer_t *writer,
+                                 mongoc_bulk_writer_error_cb_t cb,
+                                 void *context)
+{
+   BSON_ASSERT (writer);
+
+   bson_mutex_lock (&writer->mutex);
+   writer->error_cb = cb;
+   writer->error_context = context;
+   bson_mutex_unlock (&writer->mutex);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_writer_add --
+ *
+ *       Add an operation to the open batch, first waiting while the
+ *       batches not yet executed take "maxBufferedBytes" or more. Queue
+ *       the batch if it reached "maxBatchDocuments" or "maxBatchBytes".
+ *
+ * Returns:
+ *       true if the operation was added; otherwise false and @error is
+ *       set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_bulk_writer_add (mongoc_bulk_writer_t *writer,
+                         mongoc_bulk_writer_op_t op,
+                         const bson_t *selector,
+                         const bson_t *document,
+                         const bson_t *opts,
+                         bson_error_t *error)
+{
+   mongoc_bulk_writer_batch_t *batch;
+   mongoc_bulk_operation_t *bulk;
+   size_t n_commands;
+   int64_t last_len;
+   int64_t n_bytes;
+   bool ret = false;
+
+   ENTRY;
+
+   BSON_ASSERT (writer);
+
+   bson_mutex_lock (&writer->mutex);
+
+   while (writer->buffered_bytes >= writer->max_buffered_bytes) {
+      /* flush what we have rather than wait for the interval */
+      _mongoc_bulk_writer_seal (writer);
+      mongoc_cond_wait (&writer->cond, &writer->mutex);
+   }
+
+   if (!writer->open) {
+      if (writer->idle) {
+         writer->open = writer->idle;
+         writer->idle = writer->idle->next;
+         writer->open->next = NULL;
+      } else {
+         writer->open = (mongoc_bulk_writer_batch_t *) bson_malloc0 (
+            sizeof (mongoc_bulk_writer_batch_t));
+         writer->open->bulk = mongoc_bulk_operation_new (false);
+         mongoc_bulk_operation_set_bypass_document_validation (
+            writer->open->bulk, writer->bypass);
+      }
+   }
+
+   batch = writer->open;
+   bulk = batch->bulk;
+   n_commands = bulk->commands.len;
+   last_len = _mongoc_bulk_writer_last_len (bulk);
+
+   switch (op) {
+   case MONGOC_BULK_WRITER_INSERT:
+      ret =
+         mongoc_bulk_operation_insert_with_opts (bulk, document, opts, error);
+      break;
+   case MONGOC_BULK_WRITER_UPDATE_ONE:
+      ret = mongoc_bulk_operation_update_one_with_opts (
+         bulk, selector, document, opts, error);
+      break;
+   case MONGOC_BULK_WRITER_UPDATE_MANY:
+      ret = mongoc_bulk_operation_update_many_with_opts (
+         bulk, selector, document, opts, error);
+      break;
+   case MONGOC_BULK_WRITER_REPLACE_ONE:
+      ret = mongoc_bulk_operation_replace_one_with_opts (
+         bulk, selector, document, opts, error);
+      break;
+   case MONGOC_BULK_WRITER_REMOVE_ONE:
+      ret = mongoc_bulk_operation_remove_one_with_opts (
+         bulk, selector, opts, error);
+      break;
+   case MONGOC_BULK_WRITER_REMOVE_MANY:
+      ret = mongoc_bulk_operation_remove_many_with_opts (
+         bulk, selector, opts, error);
+      break;
+   default:
+      BSON_ASSERT (false);
+   }
+
+   if (!ret) {
+      GOTO (done);
+   }
+
+   /* the operation was appended to the last command, or started a new one */
+   n_bytes = _mongoc_bulk_writer_last_len (bulk);
+   if (bulk->commands.len == n_commands) {
+      n_bytes -= last_len;
+   }
+
+   if (!batch->n_operations) {
+      batch->first_index = writer->n_operations;
+      batch->started = bson_get_monotonic_time ();
+      /* the writer's thread times the flush interval from now */
+      mongoc_cond_broadcast (&writer->cond);
+   }
+
+   batch->n_operations++;
+   batch->n_bytes += n_bytes;
+   writer->n_operations++;
+   writer->buffered_bytes += n_bytes;
+
+   if (batch->n_operations >= writer->max_batch_documents ||
+       batch->n_bytes >= writer->max_batch_bytes) {
+      _mongoc_bulk_writer_seal (writer);
+   }
+
+done:
+   bson_mutex_unlock (&writer->mutex);
+
+   RETURN (ret);
+}
+
+
+bool
+mongoc_bulk_writer_insert (mongoc_bulk_writer_t *writer,
+                           const bson_t *document,
+                           const bson_t *opts,
+                           bson_error_t *error)
+{
+   BSON_ASSERT (document);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_INSERT, NULL, document, opts, error);
+}
+
+
+bool
+mongoc_bulk_writer_update_one (mongoc_bulk_writer_t *writer,
+                               const bson_t *selector,
+                               const bson_t *document,
+                               const bson_t *opts,
+                               bson_error_t *error)
+{
+   BSON_ASSERT (selector);
+   BSON_ASSERT (document);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_UPDATE_ONE, selector, document, opts, error);
+}
+
+
+bool
+mongoc_bulk_writer_update_many (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *document,
+                                const bson_t *opts,
+                                bson_error_t *error)
+{
+   BSON_ASSERT (selector);
+   BSON_ASSERT (document);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_UPDATE_MANY, selector, document, opts, error);
+}
+
+
+bool
+mongoc_bulk_writer_replace_one (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *document,
+                                const bson_t *opts,
+                                bson_error_t *error)
+{
+   BSON_ASSERT (selector);
+   BSON_ASSERT (document);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_REPLACE_ONE, selector, document, opts, error);
+}
+
+
+bool
+mongoc_bulk_writer_remove_one (mongoc_bulk_writer_t *writer,
+                               const bson_t *selector,
+                               const bson_t *opts,
+                               bson_error_t *error)
+{
+   BSON_ASSERT (selector);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_REMOVE_ONE, selector, NULL, opts, error);
+}
+
+
+bool
+mongoc_bulk_writer_remove_many (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *opts,
+                                bson_error_t *error)
+{
+   BSON_ASSERT (selector);
+
+   return _mongoc_bulk_writer_add (
+      writer, MONGOC_BULK_WRITER_REMOVE_MANY, selector, NULL, opts, error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_bulk_writer_flush --
+ *
+ *       Flush the operations added so far without waiting for a
+ *       threshold, and wait until they have been executed and their
+ *       errors reported.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_bulk_writer_flush (mongoc_bulk_writer_t *writer)
+{
+   int64_t n_sealed;
+
+   ENTRY;
+
+   BSON_ASSERT (writer);
+
+   bson_mutex_lock (&writer->mutex);
+   _mongoc_bulk_writer_seal (writer);
+   n_sealed = writer->n_sealed;
+   while (writer->n_executed < n_sealed) {
+      mongoc_cond_wait (&writer->cond, &writer->mutex);
+   }
+
+   bson_mutex_unlock (&writer->mutex);
+
+   EXIT;
+}
+
+
+/* set @error from a document like {"code": 11000, "errmsg": "dupe"} */
+static void
+_mongoc_bulk_writer_parse_error (const bson_iter_t *doc,
+                                 uint32_t domain,
+                                 bson_error_t *error)
+{
+   bson_iter_t iter;
+   const char *errmsg = "";
+   int32_t code = 0;
+
+   if (BSON_ITER_HOLDS_DOCUMENT (doc) && bson_iter_recurse (doc, &iter)) {
+      while (bson_iter_next (&iter)) {
+         if (BSON_ITER_IS_KEY (&iter, "code")) {
+            code = bson_iter_int32 (&iter);
+         } else if (BSON_ITER_IS_KEY (&iter, "errmsg") &&
+                    BSON_ITER_HOLDS_UTF8 (&iter)) {
+            errmsg = bson_iter_utf8 (&iter, NULL);
+         }
+      }
+   }
+
+   bson_set_error (error, domain, (uint32_t) code, "%s", errmsg);
+}
+
+
+/* the operation at @index in @command's payload. walks the payload from
+ * operation @*i at byte @*offset, or from the start if @index is before */
+static void
+_mongoc_bulk_writer_operation (const mongoc_write_command_t *command,
+                               uint32_t index,
+                               uint32_t *i,
+                               uint32_t *offset,
+                               bson_t *operation)
+{
+   uint32_t len;
+
+   if (index < *i) {
+      *i = 0;
+      *offset = 0;
+   }
+
+   for (; *i < index; (*i)++) {
+      memcpy (&len, command->payload.data + *offset, 4);
+      *offset += BSON_UINT32_FROM_LE (len);
+   }
+
+   memcpy (&len, command->payload.data + *offset, 4);
+   BSON_ASSERT (bson_init_static (operation,
+                                  command->payload.data + *offset,
+                                  BSON_UINT32_FROM_LE (len)));
+}
+
+
+/* advance @iter to the next write error, and set @index to its index */
+static bool
+_mongoc_bulk_writer_next_write_error (bson_iter_t *iter, uint32_t *index)
+{
+   bson_iter_t child;
+
+   while (bson_iter_next (iter)) {
+      if (BSON_ITER_HOLDS_DOCUMENT (iter) && bson_iter_recurse (iter, &child) &&
+          bson_iter_find (&child, "index") && BSON_ITER_HOLDS_INT32 (&child)) {
+         *index = (uint32_t) bson_iter_int32 (&child);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_writer_report --
+ *
+ *       Call the error callback for each of @command's operations that
+ *       failed: each one with a write error, and if the command failed
+ *       or had a write concern error, each of the others too.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_bulk_writer_report (mongoc_bulk_writer_error_cb_t cb,
+                            void *context,
+                            mongoc_client_t *client,
+                            const mongoc_write_command_t *command,
+                            int64_t first_index,
+                            const mongoc_write_result_t *result)
+{
+   bson_iter_t iter;
+   bson_error_t error;
+   bson_error_t command_error;
+   bson_t operation;
+   uint32_t domain;
+   uint32_t next_failed = 0;
+   uint32_t index;
+   uint32_t i = 0;
+   uint32_t offset = 0;
+   bool has_command_error = false;
+   bool has_write_error;
+
+   if (client->error_api_version >= MONGOC_ERROR_API_VERSION_2) {
+      domain = MONGOC_ERROR_SERVER;
+   } else {
+      domain = MONGOC_ERROR_COMMAND;
+   }
+
+   if (result->error.domain) {
+      memcpy (&command_error, &result->error, sizeof command_error);
+      has_command_error = true;
+   } else if (result->n_writeConcernErrors &&
+              bson_iter_init_find (&iter, &result->writeConcernErrors, "0")) {
+      _mongoc_bulk_writer_parse_error (
+         &iter, MONGOC_ERROR_WRITE_CONCERN, &command_error);
+      has_command_error = true;
+   }
+
+   /* write errors are in order of their indexes */
+   has_write_error =
+      bson_iter_init (&iter, &result->writeErrors) &&
+      _mongoc_bulk_writer_next_write_error (&iter, &next_failed);
+
+   for (index = 0; index < command->n_documents; index++) {
+      if (has_write_error && next_failed == index) {
+         _mongoc_bulk_writer_parse_error (&iter, domain, &error);
+         has_write_error =
+            _mongoc_bulk_writer_next_write_error (&iter, &next_failed);
+      } else if (has_command_error) {
+         memcpy (&error, &command_error, sizeof error);
+      } else {
+         continue;
+      }
+
+      _mongoc_bulk_writer_operation (command, index, &i, &offset, &operation);
+      cb (first_index + index, &operation, &error, context);
+   }
+}
+
+
+/* execute @batch's write commands and report their failed operations */
+static void
+_mongoc_bulk_writer_execute (mongoc_bulk_writer_t *writer,
+                             mongoc_client_t *client,
+                             mongoc_bulk_writer_batch_t *batch)
+{
+   mongoc_bulk_writer_error_cb_t cb;
+   void *context;
+   const mongoc_write_concern_t *write_concern;
+   mongoc_write_command_t *command;
+   mongoc_server_stream_t *server_stream;
+   mongoc_write_result_t result;
+   int64_t index = batch->first_index;
+   size_t i;
+
+   bson_mutex_lock (&writer->mutex);
+   cb = writer->error_cb;
+   context = writer->error_context;
+   bson_mutex_unlock (&writer->mutex);
+
+   write_concern = COALESCE (writer->write_concern,
+                             mongoc_client_get_write_concern (client));
+
+   for (i = 0; i < batch->bulk->commands.len; i++) {
+      command = &_mongoc_array_index (
+         &batch->bulk->commands, mongoc_write_command_t, i);
+
+      _mongoc_write_result_init (&result);
+      server_stream = mongoc_cluster_stream_for_writes (
+         &client->cluster, NULL, NULL, &result.error);
+
+      if (server_stream) {
+         _mongoc_write_command_execute (command,
+                                        client,
+                                        server_stream,
+                                        writer->database,
+                                        writer->collection,
+                                        write_concern,
+                                        0,
+                                        NULL,
+                                        &result);
+         mongoc_server_stream_cleanup (server_stream);
+      } else {
+         result.failed = true;
+      }
+
+      if (cb) {
+         _mongoc_bulk_writer_report (
+            cb, context, client, command, index, &result);
+      }
+
+      _mongoc_write_result_destroy (&result);
+      index += command->n_documents;
+   }
+}
+
+
+/* report every operation of @batch as failed with @error, since it could
+ * not be executed */
+static void
+_mongoc_bulk_writer_fail (mongoc_bulk_writer_t *writer,
+                          mongoc_bulk_writer_batch_t *batch,
+                          const bson_error_t *error)
+{
+   mongoc_bulk_writer_error_cb_t cb;
+   void *context;
+   mongoc_write_command_t *command;
+   bson_t operation;
+   int64_t first_index = batch->first_index;
+   uint32_t index;
+   uint32_t i;
+   uint32_t offset;
+   size_t n;
+
+   bson_mutex_lock (&writer->mutex);
+   cb = writer->error_cb;
+   context = writer->error_context;
+   bson_mutex_unlock (&writer->mutex);
+
+   if (!cb) {
+      return;
+   }
+
+   for (n = 0; n < batch->bulk->commands.len; n++) {
+      command = &_mongoc_array_index (
+         &batch->bulk->commands, mongoc_write_command_t, n);
+
+      i = 0;
+      offset = 0;
+      for (index = 0; index < command->n_documents; index++) {
+         _mongoc_bulk_writer_operation (
+            command, index, &i, &offset, &operation);
+         cb (first_index + index, &operation, error, context);
+      }
+
+      first_index += command->n_documents;
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_bulk_writer_run --
+ *
+ *       The writer's thread: execute each queued batch, and queue the
+ *       open batch once its first operation is "flushIntervalMS" old.
+ *       Returns when the writer is destroyed and the queue is empty.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void *
+_mongoc_bulk_writer_run (void *data)
+{
+   mongoc_bulk_writer_t *writer;
+   mongoc_bulk_writer_batch_t *batch;
+   mongoc_client_t *client = NULL;
+   bson_error_t error;
+   bool shutdown;
+   int64_t due;
+   int64_t now;
+
+   writer = (mongoc_bulk_writer_t *) data;
+
+   bson_mutex_lock (&writer->mutex);
+
+   for (;;) {
+      if (!writer->queue_head && writer->open &&
+          writer->open->n_operations) {
+         due = writer->open->started + writer->flush_interval_msec * 1000;
+         now = bson_get_monotonic_time ();
+         if (now < due && !writer->shutdown) {
+            mongoc_cond_timedwait (
+               &writer->cond, &writer->mutex, (due - now + 999) / 1000);
+            continue;
+         }
+
+         _mongoc_bulk_writer_seal (writer);
+      }
+
+      if (writer->queue_head) {
+         batch = writer->queue_head;
+         writer->queue_head = batch->next;
+         if (!writer->queue_head) {
+            writer->queue_tail = NULL;
+         }
+
+         /* new operations go to the open batch meanwhile */
+         bson_mutex_unlock (&writer->mutex);
+
+         /* poll the pool rather than block in pop, which waits forever by
+          * default: wake early if the writer is destroyed meanwhile */
+         while (!client) {
+            client = mongoc_client_pool_try_pop (writer->pool);
+            if (!client) {
+               bson_mutex_lock (&writer->mutex);
+               if (!writer->shutdown) {
+                  mongoc_cond_timedwait (&writer->cond,
+                                         &writer->mutex,
+                                         MONGOC_BULK_WRITER_POP_INTERVAL_MSEC);
+               }
+               shutdown = writer->shutdown;
+               bson_mutex_unlock (&writer->mutex);
+               if (shutdown) {
+                  break;
+               }
+            }
+         }
+
+         if (client) {
+            _mongoc_bulk_writer_execute (writer, client, batch);
+         } else {
+            bson_set_error (&error,
+                            MONGOC_ERROR_CLIENT,
+                            MONGOC_ERROR_CLIENT_NOT_READY,
+                            "no client available from the pool before the "
+                            "bulk writer was destroyed");
+            _mongoc_bulk_writer_fail (writer, batch, &error);
+         }
+
+         bson_mutex_lock (&writer->mutex);
+         writer->buffered_bytes -= batch->n_bytes;
+         writer->n_executed++;
+         _mongoc_bulk_writer_batch_reset (batch);
+         batch->next = writer->idle;
+         writer->idle = batch;
+         mongoc_cond_broadcast (&writer->cond);
+         continue;
+      }
+
+      if (writer->shutdown) {
+         break;
+      }
+
+      mongoc_cond_wait (&writer->cond, &writer->mutex);
+   }
+
+   bson_mutex_unlock (&writer->mutex);
+
+   if (client) {
+      mongoc_client_pool_push (writer->pool, client);
+   }
+
+   return NULL;
+}
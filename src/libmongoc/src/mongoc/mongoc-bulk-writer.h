@@ -0,0 +1,93 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_BULK_WRITER_H
+#define MONGOC_BULK_WRITER_H
+
+#if !defined(MONGOC_INSIDE) && !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-macros.h"
+#include "mongoc-client-pool.h"
+
+
+BSON_BEGIN_DECLS
+
+
+typedef struct _mongoc_bulk_writer_t mongoc_bulk_writer_t;
+
+typedef void (*mongoc_bulk_writer_error_cb_t) (int64_t index,
+                                               const bson_t *operation,
+                                               const bson_error_t *error,
+                                               void *context);
+
+
+MONGOC_EXPORT (mongoc_bulk_writer_t *)
+mongoc_bulk_writer_new (mongoc_client_pool_t *pool,
+                        const char *db,
+                        const char *collection,
+                        const bson_t *opts,
+                        bson_error_t *error) BSON_GNUC_WARN_UNUSED_RESULT;
+MONGOC_EXPORT (void)
+mongoc_bulk_writer_destroy (mongoc_bulk_writer_t *writer);
+MONGOC_EXPORT (void)
+mongoc_bulk_writer_set_error_cb (mongoc_bulk_writer_t *writer,
+                                 mongoc_bulk_writer_error_cb_t cb,
+                                 void *context);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_insert (mongoc_bulk_writer_t *writer,
+                           const bson_t *document,
+                           const bson_t *opts,
+                           bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_update_one (mongoc_bulk_writer_t *writer,
+                               const bson_t *selector,
+                               const bson_t *document,
+                               const bson_t *opts,
+                               bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_update_many (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *document,
+                                const bson_t *opts,
+                                bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_replace_one (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *document,
+                                const bson_t *opts,
+                                bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_remove_one (mongoc_bulk_writer_t *writer,
+                               const bson_t *selector,
+                               const bson_t *opts,
+                               bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_bulk_writer_remove_many (mongoc_bulk_writer_t *writer,
+                                const bson_t *selector,
+                                const bson_t *opts,
+                                bson_error_t *error);
+MONGOC_EXPORT (void)
+mongoc_bulk_writer_flush (mongoc_bulk_writer_t *writer);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_BULK_WRITER_H */
@@ -0,0 +1,723 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-async-private.h"
+#include "mongoc-async-cmd-private.h"
+#include "mongoc-client-private.h"
+#include "mongoc-cluster-private.h"
+#include "mongoc-cmd-private.h"
+#include "mongoc-error.h"
+#include "mongoc-server-stream-private.h"
+#include "mongoc-stream-private.h"
+#include "mongoc-topology-private.h"
+#include "mongoc-trace-private.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "client-async"
+
+
+/* a command in flight. it has a connection to itself until it completes */
+typedef struct {
+   mongoc_client_t *client;
+   uint32_t server_id;
+   mongoc_cluster_node_t *node;
+   mongoc_server_stream_t *server_stream;
+   mongoc_cmd_parts_t parts;
+   mongoc_client_command_async_cb_t cb;
+   void *data;
+} mongoc_client_async_op_t;
+
+
+static void
+_mongoc_client_async_op_destroy (mongoc_client_async_op_t *op)
+{
+   mongoc_cmd_parts_cleanup (&op->parts);
+   mongoc_server_stream_cleanup (op->server_stream);
+   bson_free (op);
+}
+
+
+/* whether @conn is ready for reuse, after dropping the reply a hedged read
+ * left on it. sets @usable to false if it must be closed */
+static bool
+_mongoc_client_async_conn_ready (mongoc_client_t *client,
+                                 mongoc_client_async_conn_t *conn,
+                                 bool *usable)
+{
+   bool discarded;
+
+   *usable = true;
+
+   if (!conn->discard_reply) {
+      return true;
+   }
+
+   if (!_mongoc_cluster_node_discard_reply (&client->cluster,
+                                            conn->node,
+                                            conn->discard_request_id,
+                                            &discarded)) {
+      *usable = false;
+      return true;
+   }
+
+   if (discarded) {
+      conn->discard_reply = false;
+      return true;
+   }
+
+   if (conn->discard_expire &&
+       bson_get_monotonic_time () >= conn->discard_expire) {
+      *usable = false;
+      return true;
+   }
+
+   return false;
+}
+
+
+/* take an idle connection to @server_id, discarding any that predate the
+ * server's last reset. one still awaiting a hedged read's reply stays in
+ * the list */
+static mongoc_cluster_node_t *
+_mongoc_client_async_take_node (mongoc_client_t *client, uint32_t server_id)
+{
+   mongoc_array_t *idle = &client->async_idle;
+   mongoc_client_async_conn_t *conn;
+   mongoc_cluster_node_t *node;
+   int64_t generation;
+   bool usable;
+   size_t i;
+
+   generation =
+      mongoc_topology_server_generation (client->topology, server_id);
+
+   /* most recently used first. removal moves the last entry, which has been
+    * visited already, into the hole */
+   for (i = idle->len; i > 0; i--) {
+      conn = &_mongoc_array_index (idle, mongoc_client_async_conn_t, i - 1);
+      if (conn->server_id != server_id ||
+          !_mongoc_client_async_conn_ready (client, conn, &usable)) {
+         continue;
+      }
+
+      node = conn->node;
+      *conn = _mongoc_array_index (
+         idle, mongoc_client_async_conn_t, idle->len - 1);
+      idle->len--;
+
+      if (usable && (int64_t) node->generation == generation &&
+          !mongoc_stream_check_closed (node->stream)) {
+         return node;
+      }
+
+      _mongoc_cluster_node_destroy (node);
+   }
+
+   return NULL;
+}
+
+
+static void
+_mongoc_client_async_put_node (mongoc_client_t *client,
+                               uint32_t server_id,
+                               mongoc_cluster_node_t *node)
+{
+   mongoc_client_async_conn_t conn = {0};
+
+   conn.server_id = server_id;
+   conn.node = node;
+   _mongoc_array_append_val (&client->async_idle, conn);
+}
+
+
+static void
+_mongoc_client_async_init (mongoc_client_t *client)
+{
+   if (!client->async) {
+      client->async = mongoc_async_new ();
+      _mongoc_array_init (&client->async_idle,
+                          sizeof (mongoc_client_async_conn_t));
+      _mongoc_array_init (&client->async_wanted, sizeof (uint32_t));
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_checkout_node --
+ *
+ *       An idle connection to @server_id outside the client's cluster,
+ *       for a hedged read to run beside the cluster's own connection:
+ *       one left by the async API, an earlier hedged read, or
+ *       _mongoc_client_async_connect_node. Never connects, since a
+ *       hedged read can't wait for a handshake. Give it back with
+ *       _mongoc_client_async_checkin_node once it's idle, or with
+ *       _mongoc_client_async_checkin_node_discarding if a reply is still
+ *       on its way, or destroy it.
+ *
+ * Returns:
+ *       A node, or NULL if there is no idle connection to @server_id.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_cluster_node_t *
+_mongoc_client_async_checkout_node (mongoc_client_t *client,
+                                    uint32_t server_id)
+{
+   _mongoc_client_async_init (client);
+
+   return _mongoc_client_async_take_node (client, server_id);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_connect_node --
+ *
+ *       Connect to @server_id and keep the connection idle for a later
+ *       hedged read, unless there is an idle one already. Blocks for the
+ *       handshake, so hedged reads call _mongoc_client_async_want_node
+ *       instead. A failure is ignored rather than marking the server
+ *       Unknown: no application operation depended on it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_client_async_connect_node (mongoc_client_t *client,
+                                   uint32_t server_id)
+{
+   mongoc_cluster_node_t *node;
+   bson_error_t error;
+
+   _mongoc_client_async_init (client);
+
+   node = _mongoc_client_async_take_node (client, server_id);
+   if (!node) {
+      node = _mongoc_cluster_node_connect (&client->cluster, server_id, &error);
+      if (!node) {
+         TRACE ("no hedge connection to server %" PRIu32 ": %s",
+                server_id,
+                error.message);
+         return;
+      }
+   }
+
+   _mongoc_client_async_put_node (client, server_id, node);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_async_want_node --
+ *
+ *       Ask for a connection to @server_id for the next hedged read,
+ *       without blocking: _mongoc_client_async_connect_wanted makes it
+ *       later, after a single-threaded client's next scan, or on the
+ *       warming thread while a pooled client is idle.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_client_async_want_node (mongoc_client_t *client, uint32_t server_id)
+{
+   size_t i;
+
+   _mongoc_client_async_init (client);
+
+   /* one awaiting a hedged read's reply will be idle soon enough */
+   for (i = 0; i < client->async_idle.len; i++) {
+      if (_mongoc_array_index (
+             &client->async_idle, mongoc_client_async_conn_t, i)
+             .server_id == server_id) {
+         return;
+      }
+   }
+
+   for (i = 0; i < client->async_wanted.len; i++) {
+      if (_mongoc_array_index (&client->async_wanted, uint32_t, i) ==
+          server_id) {
+         return;
+      }
+   }
+
+   _mongoc_array_append_val (&client->async_wanted, server_id);
+}
+
+
+bool
+_mongoc_client_async_wants_nodes (const mongoc_client_t *client)
+{
+   return client->async && client->async_wanted.len > 0;
+}
+
+
+/* make the connections requested with _mongoc_client_async_want_node */
+void
+_mongoc_client_async_connect_wanted (mongoc_client_t *client)
+{
+   size_t i;
+
+   if (!_mongoc_client_async_wants_nodes (client)) {
+      return;
+   }
+
+   for (i = 0; i < client->async_wanted.len; i++) {
+      _mongoc_client_async_connect_node (
+         client, _mongoc_array_index (&client->async_wanted, uint32_t, i));
+   }
+
+   client->async_wanted.len = 0;
+}
+
+
+void
+_mongoc_client_async_checkin_node (mongoc_client_t *client,
+                                   uint32_t server_id,
+                                   mongoc_cluster_node_t *node)
+{
+   _mongoc_client_async_put_node (client, server_id, node);
+}
+
+
+/* give back @node while the reply to @request_id is still on its way. the
+ * next checkout drops it once it arrives, or closes @node after @expire_at
+ * if it isn't 0 */
+void
+_mongoc_client_async_checkin_node_discarding (mongoc_client_t *client,
+                                              uint32_t server_id,
+                                              mongoc_cluster_node_t *node,
+                                              uint32_t request_id,
+                                              int64_t expire_at)
+{
+   mongoc_client_async_conn_t *conn;
+
+   _mongoc_client_async_put_node (client, server_id, node);
+
+   conn = &_mongoc_array_index (&client->async_idle,
+                                mongoc_client_async_conn_t,
+                                client->async_idle.len - 1);
+   conn->discard_reply = true;
+   conn->discard_request_id = request_id;
+   conn->discard_expire = expire_at;
+}
+
+
+static void
+_mongoc_client_async_op_cb (mongoc_async_cmd_t *acmd,
+                            mongoc_async_cmd_result_t result,
+                            const bson_t *bson,
+                            int64_t rtt_msec)
+{
+   mongoc_client_async_op_t *op;
+   mongoc_client_t *client;
+   bson_error_t error;
+   bson_t empty = BSON_INITIALIZER;
+
+   ENTRY;
+
+   if (result == MONGOC_ASYNC_CMD_CONNECTED) {
+      EXIT;
+   }
+
+   op = (mongoc_client_async_op_t *) acmd->data;
+   client = op->client;
+
+   if (result == MONGOC_ASYNC_CMD_SUCCESS) {
+      _mongoc_topology_update_cluster_time (client->topology, bson);
+      if (op->parts.assembled.session) {
+         _mongoc_client_session_handle_reply (
+            op->parts.assembled.session, true, bson);
+      }
+
+      /* the connection is idle again */
+      _mongoc_client_async_put_node (client, op->server_id, op->node);
+
+      if (_mongoc_cmd_check_ok (bson, client->error_api_version, &error)) {
+         op->cb (bson, NULL, op->data);
+      } else {
+         op->cb (bson, &error, op->data);
+      }
+   } else {
+      /* the stream is in an unknown state after a timeout */
+      memcpy (&error, &acmd->error, sizeof (bson_error_t));
+      if (result == MONGOC_ASYNC_CMD_ERROR) {
+         mongoc_topology_invalidate_server (
+            client->topology, op->server_id, &error);
+      }
+
+      _mongoc_cluster_node_destroy (op->node);
+      op->cb (&empty, &error, op->data);
+   }
+
+   _mongoc_client_async_op_destroy (op);
+   bson_destroy (&empty);
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_client_command_async --
+ *
+ *       Select a server for @optype and send @command to it on an idle
+ *       or new connection. Connecting and authenticating block; sending
+ *       the command and awaiting its reply happen in
+ *       mongoc_client_async_run.
+ *
+ * Returns:
+ *       True if the command was started. @cb is then called exactly once.
+ *       False and sets @error if it couldn't be started, and @cb is not
+ *       called.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_client_command_async (mongoc_client_t *client,
+                              const char *db_name,
+                              const bson_t *command,
+                              mongoc_ss_optype_t optype,
+                              const mongoc_read_prefs_t *read_prefs,
+                              mongoc_client_command_async_cb_t cb,
+                              void *data,
+                              bson_error_t *error)
+{
+   mongoc_client_async_op_t *op;
+   mongoc_server_stream_t *server_stream;
+   mongoc_cluster_node_t *node;
+   uint32_t server_id;
+   int64_t timeout_msec;
+
+   ENTRY;
+
+   BSON_ASSERT (client);
+   BSON_ASSERT (db_name);
+   BSON_ASSERT (command);
+   BSON_ASSERT (cb);
+
+   _mongoc_client_async_init (client);
+
+   server_id = mongoc_topology_select_server_id (
+      client->topology, optype, read_prefs, error);
+   if (!server_id) {
+      RETURN (false);
+   }
+
+   node = _mongoc_client_async_take_node (client, server_id);
+   if (!node) {
+      node = _mongoc_cluster_node_connect (&client->cluster, server_id, error);
+      if (!node) {
+         mongoc_topology_invalidate_server (
+            client->topology, server_id, error);
+         RETURN (false);
+      }
+   }
+
+   server_stream = _mongoc_cluster_create_server_stream (
+      client->topology, server_id, node->stream, error);
+   if (!server_stream) {
+      _mongoc_cluster_node_destroy (node);
+      RETURN (false);
+   }
+
+   op = (mongoc_client_async_op_t *) bson_malloc0 (sizeof (*op));
+   op->client = client;
+   op->server_id = server_id;
+   op->node = node;
+   op->server_stream = server_stream;
+   op->cb = cb;
+   op->data = data;
+
+   mongoc_cmd_parts_init (
+      &op->parts, client, db_name, MONGOC_QUERY_NONE, command);
+   op->parts.read_prefs = read_prefs;
+   op->parts.is_read_command = (optype == MONGOC_SS_READ);
+   op->parts.is_write_command = (optype == MONGOC_SS_WRITE);
+
+   if (!mongoc_cmd_parts_assemble (&op->parts, server_stream, error)) {
+      _mongoc_client_async_put_node (client, server_id, node);
+      _mongoc_client_async_op_destroy (op);
+      RETURN (false);
+   }
+
+   /* sockettimeoutms=0 means no timeout */
+   timeout_msec = client->cluster.sockettimeoutms
+                     ? (int64_t) client->cluster.sockettimeoutms
+                     : (int64_t) INT32_MAX - 1;
+
+   if (server_stream->sd->max_wire_version >= WIRE_VERSION_OP_MSG) {
+      mongoc_async_cmd_new_opmsg (client->async,
+                                  node->stream,
+                                  op->parts.assembled.command,
+                                  _mongoc_client_async_op_cb,
+                                  op,
+                                  timeout_msec);
+   } else {
+      mongoc_async_cmd_new (client->async,
+                            node->stream,
+                            true,
+                            NULL,
+                            NULL,
+                            0,
+                            NULL,
+                            NULL,
+                            db_name,
+                            op->parts.assembled.command,
+                            _mongoc_client_async_op_cb,
+                            op,
+                            timeout_msec);
+   }
+
+   RETURN (true);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_command_async --
+ *
+ *       Start running @command on a server selected with @read_prefs,
+ *       or the client's read preference if NULL. Call
+ *       mongoc_client_async_run to drive it to completion.
+ *
+ *       Unlike mongoc_client_command_simple, no read or write concern
+ *       is applied; include them in @command if desired.
+ *
+ * Returns:
+ *       True if the command was started, in which case @cb is called
+ *       once from mongoc_client_async_run. Otherwise false and @error
+ *       is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_client_command_async (mongoc_client_t *client,
+                             const char *db_name,
+                             const bson_t *command,
+                             const mongoc_read_prefs_t *read_prefs,
+                             mongoc_client_command_async_cb_t cb,
+                             void *data,
+                             bson_error_t *error)
+{
+   BSON_ASSERT (client);
+
+   if (!read_prefs) {
+      read_prefs = client->read_prefs;
+   }
+
+   return _mongoc_client_command_async (
+      client, db_name, command, MONGOC_SS_READ, read_prefs, cb, data, error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_run --
+ *
+ *       Send the commands started on @client and wait for their
+ *       replies, calling each one's callback as it completes. Returns
+ *       once every command has completed; callbacks may start more.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_client_async_run (mongoc_client_t *client)
+{
+   ENTRY;
+
+   BSON_ASSERT (client);
+
+   if (client->async) {
+      mongoc_async_run (client->async);
+   }
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_get_fds --
+ *
+ *       Report the socket, awaited events, and deadline of up to @n_fds
+ *       pending async commands, for an application that polls in its own
+ *       event loop instead of calling mongoc_client_async_run. Commands
+ *       on streams without a socket are not reported.
+ *
+ *       The set changes whenever a command is started or makes
+ *       progress, so call this again after each call to
+ *       mongoc_client_async_process_ready or _process_timeouts.
+ *
+ * Returns:
+ *       The number of commands that can be reported, which may exceed
+ *       @n_fds.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+size_t
+mongoc_client_async_get_fds (mongoc_client_t *client,
+                             mongoc_client_async_fd_t *fds,
+                             size_t n_fds)
+{
+   mongoc_async_cmd_t *acmd;
+   mongoc_socket_fd_t fd;
+   size_t n = 0;
+
+   BSON_ASSERT (client);
+   BSON_ASSERT (fds || !n_fds);
+
+   if (!client->async) {
+      return 0;
+   }
+
+   for (acmd = client->async->cmds; acmd; acmd = acmd->next) {
+      if (!_mongoc_stream_get_socket_fd (acmd->stream, &fd)) {
+         continue;
+      }
+
+      if (n < n_fds) {
+         fds[n].fd = fd;
+         fds[n].events = acmd->events;
+         fds[n].deadline = mongoc_async_cmd_deadline (acmd);
+      }
+
+      n++;
+   }
+
+   return n;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_process_ready --
+ *
+ *       Advance the async command waiting on @fd, after the
+ *       application's event loop found @revents (POLLIN, POLLOUT,
+ *       POLLERR, POLLHUP) on it. Never blocks. The command's callback
+ *       is called here if this completes it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_client_async_process_ready (mongoc_client_t *client,
+                                   mongoc_socket_fd_t fd,
+                                   int revents)
+{
+   mongoc_async_cmd_t *acmd;
+   mongoc_socket_fd_t acmd_fd;
+
+   ENTRY;
+
+   BSON_ASSERT (client);
+
+   if (!client->async) {
+      EXIT;
+   }
+
+   for (acmd = client->async->cmds; acmd; acmd = acmd->next) {
+      if (_mongoc_stream_get_socket_fd (acmd->stream, &acmd_fd) &&
+          acmd_fd == fd) {
+         (void) mongoc_async_cmd_process_revents (acmd, revents);
+         EXIT;
+      }
+   }
+
+   EXIT;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_async_process_timeouts --
+ *
+ *       Fail the async commands whose deadline has passed, calling their
+ *       callbacks with a timeout error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_client_async_process_timeouts (mongoc_client_t *client)
+{
+   BSON_ASSERT (client);
+
+   if (client->async) {
+      mongoc_async_process_timers (client->async, bson_get_monotonic_time ());
+   }
+}
+
+
+/* free the async state of a client that is being destroyed. commands still
+ * pending are abandoned without calling their callbacks */
+void
+_mongoc_client_async_destroy (mongoc_client_t *client)
+{
+   mongoc_async_cmd_t *acmd;
+   mongoc_client_async_op_t *op;
+   bson_error_t error;
+   bson_t empty = BSON_INITIALIZER;
+   size_t i;
+
+   if (!client->async) {
+      return;
+   }
+
+   /* each started command's callback is called exactly once */
+   for (acmd = client->async->cmds; acmd; acmd = acmd->next) {
+      op = (mongoc_client_async_op_t *) acmd->data;
+      _mongoc_cluster_node_destroy (op->node);
+      bson_set_error (&error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "client destroyed before the command completed");
+      op->cb (&empty, &error, op->data);
+      _mongoc_client_async_op_destroy (op);
+   }
+
+   bson_destroy (&empty);
+
+   mongoc_async_destroy (client->async);
+
+   for (i = 0; i < client->async_idle.len; i++) {
+      _mongoc_cluster_node_destroy (
+         _mongoc_array_index (
+            &client->async_idle, mongoc_client_async_conn_t, i)
+            .node);
+   }
+
+   _mongoc_array_destroy (&client->async_idle);
+   _mongoc_array_destroy (&client->async_wanted);
+   client->async = NULL;
+}
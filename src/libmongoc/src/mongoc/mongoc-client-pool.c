@@ -30,18 +30,52 @@
 #include "mongoc-ssl-private.h"
 #endif
 
-struct _mongoc_client_pool_t {
+/* Idle clients are spread over several independently locked stacks, so that
+ * threads checking clients in and out rarely contend for the same lock.
+ * pool->mutex is only taken to change settings and by threads waiting for a
+ * client. */
+#define MONGOC_CLIENT_POOL_SHARDS 8
+
+typedef struct {
    bson_mutex_t mutex;
+   mongoc_queue_t queue; /* most recently pushed client first */
+} mongoc_client_pool_shard_t;
+
+/* A thread blocked in mongoc_client_pool_pop. Waiters are served in arrival
+ * order: a push hands its client straight to the oldest waiter, so threads
+ * that arrive later cannot take it first. Lives on the waiting thread's stack
+ * and is protected by pool->mutex. */
+typedef struct _mongoc_client_pool_waiter_t {
    mongoc_cond_t cond;
-   mongoc_queue_t queue;
+   mongoc_client_t *client; /* handed over by a push */
+   bool slot;               /* or permission to create a client */
+   struct _mongoc_client_pool_waiter_t *next;
+} mongoc_client_pool_waiter_t;
+
+struct _mongoc_client_pool_t {
+   bson_mutex_t mutex;
+   mongoc_client_pool_shard_t shards[MONGOC_CLIENT_POOL_SHARDS];
+   volatile int32_t idle;       /* clients in all shards */
+   volatile int32_t waiters;    /* threads blocked in pop */
+   mongoc_client_pool_waiter_t *wait_head;
+   mongoc_client_pool_waiter_t *wait_tail;
+   int32_t wait_queue_timeout_msec; /* 0 waits forever */
+   volatile int32_t scanner_started;
    mongoc_topology_t *topology;
    mongoc_uri_t *uri;
    uint32_t min_pool_size;
    uint32_t max_pool_size;
-   uint32_t size;
+   int32_t warm_pool_size; /* idle clients kept connected, 0 for none */
+   bool warm_hedge_nodes;  /* "hedgedReads": connect idle clients to hedge */
+   bson_thread_t warm_thread; /* if either, creates warm clients */
+   mongoc_cond_t warm_cond;   /* signaled after each scan, with pool->mutex */
+   bool warm_requested;
+   bool warm_shutdown;
+   volatile int32_t size; /* clients created and not destroyed */
 #ifdef MONGOC_ENABLE_SSL
    bool ssl_opts_set;
    mongoc_ssl_opt_t ssl_opts;
+   mongoc_tls_cache_t *tls_cache;
 #endif
    bool apm_callbacks_set;
    mongoc_apm_callbacks_t apm_callbacks;
@@ -65,19 +99,39 @@ mongoc_client_pool_set_ssl_opts (mongoc_client_pool_t *pool,
    memset (&pool->ssl_opts, 0, sizeof pool->ssl_opts);
    pool->ssl_opts_set = false;
 
+   /* ssl opts are set before the first client is popped, so nothing borrows
+    * the previous cache yet */
+   _mongoc_tls_cache_destroy (pool->tls_cache);
+   pool->tls_cache = NULL;
+
    if (opts) {
       _mongoc_ssl_opts_copy_to (opts, &pool->ssl_opts);
       pool->ssl_opts_set = true;
+      pool->tls_cache = _mongoc_tls_cache_new ();
    }
 
    mongoc_topology_scanner_set_ssl_opts (pool->topology->scanner,
                                          &pool->ssl_opts);
+   pool->topology->scanner->tls_cache = pool->tls_cache;
 
    bson_mutex_unlock (&pool->mutex);
 }
 #endif
 
 
+static void
+_maintain_pool (void *data);
+
+static bool
+_warm_thread_needed (const mongoc_client_pool_t *pool);
+
+static void *
+_warm_pool_run (void *data);
+
+static void
+_serve_waiters (mongoc_client_pool_t *pool);
+
+
 mongoc_client_pool_t *
 mongoc_client_pool_new (const mongoc_uri_t *uri)
 {
@@ -86,6 +140,8 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
    const bson_t *b;
    bson_iter_t iter;
    const char *appname;
+   int i;
+   int r;
 
 
    ENTRY;
@@ -102,7 +158,10 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
 
    pool = (mongoc_client_pool_t *) bson_malloc0 (sizeof *pool);
    bson_mutex_init (&pool->mutex);
-   _mongoc_queue_init (&pool->queue);
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS; i++) {
+      bson_mutex_init (&pool->shards[i].mutex);
+      _mongoc_queue_init (&pool->shards[i].queue);
+   }
    pool->uri = mongoc_uri_copy (uri);
    pool->min_pool_size = 0;
    pool->max_pool_size = 100;
@@ -131,6 +190,31 @@ mongoc_client_pool_new (const mongoc_uri_t *uri)
       }
    }
 
+   pool->warm_pool_size = BSON_MAX (
+      0,
+      mongoc_uri_get_option_as_int32 (pool->uri, MONGOC_URI_WARMPOOLSIZE, 0));
+
+   pool->warm_hedge_nodes =
+      mongoc_uri_get_option_as_bool (pool->uri, MONGOC_URI_HEDGEDREADS, false);
+
+   topology->after_scan_cb = _maintain_pool;
+   topology->after_scan_context = pool;
+
+   if (_warm_thread_needed (pool)) {
+      mongoc_cond_init (&pool->warm_cond);
+      r = bson_thread_create (&pool->warm_thread, _warm_pool_run, pool);
+      if (r != 0) {
+         MONGOC_ERROR ("could not start pool warming thread: %s",
+                       strerror (r));
+         abort ();
+      }
+   }
+
+   pool->wait_queue_timeout_msec = BSON_MAX (
+      0,
+      mongoc_uri_get_option_as_int32 (
+         pool->uri, MONGOC_URI_WAITQUEUETIMEOUTMS, 0));
+
    appname =
       mongoc_uri_get_option_as_utf8 (pool->uri, MONGOC_URI_APPNAME, NULL);
    if (appname) {
@@ -157,6 +241,7 @@ void
 mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
 {
    mongoc_client_t *client;
+   int i;
 
    ENTRY;
 
@@ -165,24 +250,46 @@ mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
    }
 
    if (pool->topology->session_pool) {
+      /* NULL if every client is checked out and waitQueueTimeoutMS passed */
       client = mongoc_client_pool_pop (pool);
-      _mongoc_client_end_sessions (client);
-      mongoc_client_pool_push (pool, client);
+      if (client) {
+         _mongoc_client_end_sessions (client);
+         mongoc_client_pool_push (pool, client);
+      }
+   }
+
+   /* the warming thread may be connecting a client, let it finish */
+   if (_warm_thread_needed (pool)) {
+      bson_mutex_lock (&pool->mutex);
+      pool->warm_shutdown = true;
+      mongoc_cond_signal (&pool->warm_cond);
+      bson_mutex_unlock (&pool->mutex);
+      bson_thread_join (pool->warm_thread);
    }
 
-   while (
-      (client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
-      mongoc_client_destroy (client);
+   _mongoc_topology_background_thread_stop (pool->topology);
+
+   if (_warm_thread_needed (pool)) {
+      mongoc_cond_destroy (&pool->warm_cond);
+   }
+
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS; i++) {
+      while ((client = (mongoc_client_t *) _mongoc_queue_pop_head (
+                 &pool->shards[i].queue))) {
+         mongoc_client_destroy (client);
+      }
+
+      bson_mutex_destroy (&pool->shards[i].mutex);
    }
 
    mongoc_topology_destroy (pool->topology);
 
    mongoc_uri_destroy (pool->uri);
    bson_mutex_destroy (&pool->mutex);
-   mongoc_cond_destroy (&pool->cond);
 
 #ifdef MONGOC_ENABLE_SSL
    _mongoc_ssl_opts_cleanup (&pool->ssl_opts);
+   _mongoc_tls_cache_destroy (pool->tls_cache);
 #endif
 
    bson_free (pool);
@@ -195,59 +302,540 @@ mongoc_client_pool_destroy (mongoc_client_pool_t *pool)
 
 
 /*
- * Start the background topology scanner.
- *
- * This function assumes the pool's mutex is locked
+ * Start the background topology scanner, once. Safe to call without the
+ * pool's mutex.
  */
 static void
 _start_scanner_if_needed (mongoc_client_pool_t *pool)
 {
+   if (pool->scanner_started) {
+      return;
+   }
+
+   /* starting an already running scanner is a no-op */
    if (!_mongoc_topology_start_background_scanner (pool->topology)) {
       MONGOC_ERROR ("Background scanner did not start!");
       abort ();
    }
+
+   bson_memory_barrier ();
+   pool->scanner_started = 1;
 }
 
-mongoc_client_t *
-mongoc_client_pool_pop (mongoc_client_pool_t *pool)
+
+/* the calling thread's home shard. a thread pushes to and pops from its own
+ * shard first, so its clients are reused most-recent-first and threads on
+ * different shards do not contend */
+static uint32_t
+_thread_shard (void)
+{
+   uint64_t id;
+
+#ifdef _WIN32
+   id = (uint64_t) GetCurrentThreadId ();
+#else
+   id = (uint64_t) (uintptr_t) pthread_self ();
+#endif
+
+   /* thread ids are often aligned addresses, mix in the high bits */
+   return (uint32_t) ((id * UINT64_C (0x9E3779B97F4A7C15)) >> 32) %
+          MONGOC_CLIENT_POOL_SHARDS;
+}
+
+
+/* take the most recently pushed client from the home shard, or else from the
+ * first non-empty one */
+static mongoc_client_t *
+_take_idle_client (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_shard_t *shard;
+   mongoc_client_t *client = NULL;
+   uint32_t start;
+   uint32_t i;
+
+   if (pool->idle <= 0) {
+      return NULL;
+   }
+
+   start = _thread_shard ();
+
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS && !client; i++) {
+      shard = &pool->shards[(start + i) % MONGOC_CLIENT_POOL_SHARDS];
+      bson_mutex_lock (&shard->mutex);
+      client = (mongoc_client_t *) _mongoc_queue_pop_head (&shard->queue);
+      if (client) {
+         bson_atomic_int_add (&pool->idle, -1);
+      }
+      bson_mutex_unlock (&shard->mutex);
+   }
+
+   return client;
+}
+
+
+/* claim a slot for a new client if the pool is below max_pool_size. several
+ * threads may race past the limit briefly; each of them gives its slot back.
+ * requires pool->mutex, else use _reserve_client_slot_unlocked */
+static bool
+_reserve_client_slot (mongoc_client_pool_t *pool)
+{
+   int64_t max_pool_size = (int64_t) pool->max_pool_size;
+
+   if ((int64_t) bson_atomic_int_add (&pool->size, 1) <= max_pool_size) {
+      return true;
+   }
+
+   bson_atomic_int_add (&pool->size, -1);
+   return false;
+}
+
+
+/* _reserve_client_slot for callers without pool->mutex. while our attempt
+ * had the pool over its limit, a waiter may have failed to reserve the slot
+ * we just gave back, and no push may come to serve it: serve it ourselves */
+static bool
+_reserve_client_slot_unlocked (mongoc_client_pool_t *pool)
+{
+   if (_reserve_client_slot (pool)) {
+      return true;
+   }
+
+   /* the atomic add in _reserve_client_slot is a full barrier, so we see a
+    * waiter that served itself during our attempt */
+   if (pool->waiters > 0) {
+      bson_mutex_lock (&pool->mutex);
+      _serve_waiters (pool);
+      bson_mutex_unlock (&pool->mutex);
+   }
+
+   return false;
+}
+
+
+/* create a client for a reserved slot, without holding any pool lock */
+static mongoc_client_t *
+_new_client (mongoc_client_pool_t *pool)
 {
    mongoc_client_t *client;
 
+   client = _mongoc_client_new_from_uri (pool->topology);
+
+   /* for tests */
+   mongoc_client_set_stream_initiator (
+      client,
+      pool->topology->scanner->initiator,
+      pool->topology->scanner->initiator_context);
+
+   client->error_api_version = pool->error_api_version;
+   _mongoc_client_set_apm_callbacks_private (
+      client, &pool->apm_callbacks, pool->apm_context);
+#ifdef MONGOC_ENABLE_SSL
+   if (pool->ssl_opts_set) {
+      mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
+      client->tls_cache = pool->tls_cache;
+   }
+#endif
+
+   return client;
+}
+
+
+/* the ids of servers that a warm client connects to: every data-bearing
+ * server the topology has discovered */
+static void
+_warm_server_ids (mongoc_client_pool_t *pool, mongoc_array_t *server_ids)
+{
+   mongoc_topology_t *topology = pool->topology;
+   mongoc_set_t *servers;
+   mongoc_server_description_t *sd;
+   size_t i;
+
+   bson_mutex_lock (&topology->mutex);
+
+   servers = topology->description.servers;
+   for (i = 0; i < servers->items_len; i++) {
+      sd = (mongoc_server_description_t *) mongoc_set_get_item (servers, i);
+
+      switch (sd->type) {
+      case MONGOC_SERVER_STANDALONE:
+      case MONGOC_SERVER_MONGOS:
+      case MONGOC_SERVER_RS_PRIMARY:
+      case MONGOC_SERVER_RS_SECONDARY:
+         _mongoc_array_append_val (server_ids, sd->id);
+         break;
+      default:
+         break;
+      }
+   }
+
+   bson_mutex_unlock (&topology->mutex);
+}
+
+
+/* close idle clients' connections that are stale or idle longer than
+ * "maxIdleTimeMS", instead of waiting for their next use */
+static void
+_prune_idle_clients (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_shard_t *shard;
+   mongoc_queue_item_t *item;
+   int i;
+
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS; i++) {
+      shard = &pool->shards[i];
+
+      bson_mutex_lock (&shard->mutex);
+      for (item = shard->queue.head; item; item = item->next) {
+         _mongoc_cluster_prune_nodes (
+            &((mongoc_client_t *) item->data)->cluster);
+      }
+      bson_mutex_unlock (&shard->mutex);
+   }
+}
+
+
+/*
+ * Keep "warmPoolSize" idle clients, creating new ones connected and
+ * authenticated to every data-bearing server, so that threads popping them
+ * skip the handshake. A client is warmed before it is pushed, so idle
+ * clients are never taken away from threads that want one. Runs on the
+ * pool's warming thread, not the scanner's: connecting may take a while.
+ */
+static void
+_warm_pool (mongoc_client_pool_t *pool)
+{
+   mongoc_array_t server_ids;
+   mongoc_client_t *client;
+   bson_error_t error;
+   int32_t target;
+   int32_t n;
+   size_t j;
+
    ENTRY;
 
-   BSON_ASSERT (pool);
+   target = BSON_MIN (pool->warm_pool_size, (int32_t) pool->max_pool_size);
 
-   bson_mutex_lock (&pool->mutex);
+   /* threads waiting for a client need a slot more than we do */
+   if (target <= 0 || pool->waiters > 0) {
+      EXIT;
+   }
 
-again:
-   if (!(client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
-      if (pool->size < pool->max_pool_size) {
-         client = _mongoc_client_new_from_uri (pool->topology);
+   _mongoc_array_init (&server_ids, sizeof (uint32_t));
+   _warm_server_ids (pool, &server_ids);
 
-         /* for tests */
-         mongoc_client_set_stream_initiator (
-            client,
-            pool->topology->scanner->initiator,
-            pool->topology->scanner->initiator_context);
+   if (!server_ids.len) {
+      _mongoc_array_destroy (&server_ids);
+      EXIT;
+   }
 
-         client->error_api_version = pool->error_api_version;
-         _mongoc_client_set_apm_callbacks_private (
-            client, &pool->apm_callbacks, pool->apm_context);
-#ifdef MONGOC_ENABLE_SSL
-         if (pool->ssl_opts_set) {
-            mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
+   /* at most target clients per scan, in case a low "minPoolSize" makes
+    * push destroy them */
+   for (n = 0; n < target && pool->idle < target && !pool->warm_shutdown;
+        n++) {
+      if (!_reserve_client_slot_unlocked (pool)) {
+         break;
+      }
+
+      client = _new_client (pool);
+
+      for (j = 0; j < server_ids.len; j++) {
+         if (!_mongoc_cluster_warm_node (
+                &client->cluster,
+                _mongoc_array_index (&server_ids, uint32_t, j),
+                &error)) {
+            MONGOC_DEBUG ("could not warm pooled client: %s", error.message);
          }
-#endif
-         pool->size++;
+      }
+
+      mongoc_counter_client_pool_warmed_inc ();
+      mongoc_client_pool_push (pool, client);
+   }
+
+   _mongoc_array_destroy (&server_ids);
+
+   EXIT;
+}
+
+
+/* make the hedge connections that idle clients' hedged reads asked for, see
+ * _mongoc_client_async_want_node. such a client leaves the pool while its
+ * connections are made, so no other thread uses it meanwhile */
+static void
+_connect_hedge_nodes (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_shard_t *shard;
+   mongoc_queue_t keep;
+   mongoc_array_t clients;
+   mongoc_client_t *client;
+   size_t i;
+
+   ENTRY;
+
+   if (!pool->warm_hedge_nodes) {
+      EXIT;
+   }
+
+   _mongoc_array_init (&clients, sizeof (mongoc_client_t *));
+
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS; i++) {
+      shard = &pool->shards[i];
+      _mongoc_queue_init (&keep);
+
+      bson_mutex_lock (&shard->mutex);
+      while ((client =
+                 (mongoc_client_t *) _mongoc_queue_pop_head (&shard->queue))) {
+         if (_mongoc_client_async_wants_nodes (client)) {
+            _mongoc_array_append_val (&clients, client);
+            bson_atomic_int_add (&pool->idle, -1);
+         } else {
+            _mongoc_queue_push_tail (&keep, client);
+         }
+      }
+
+      shard->queue = keep;
+      bson_mutex_unlock (&shard->mutex);
+   }
+
+   for (i = 0; i < clients.len; i++) {
+      client = _mongoc_array_index (&clients, mongoc_client_t *, i);
+      if (!pool->warm_shutdown) {
+         _mongoc_client_async_connect_wanted (client);
+      }
+
+      mongoc_client_pool_push (pool, client);
+   }
+
+   _mongoc_array_destroy (&clients);
+
+   EXIT;
+}
+
+
+/* the pool's warming thread: warm clients after each scan */
+static void *
+_warm_pool_run (void *data)
+{
+   mongoc_client_pool_t *pool = (mongoc_client_pool_t *) data;
+
+   bson_mutex_lock (&pool->mutex);
+
+   for (;;) {
+      if (pool->warm_shutdown) {
+         break;
+      }
+
+      if (!pool->warm_requested) {
+         mongoc_cond_wait (&pool->warm_cond, &pool->mutex);
+         continue;
+      }
+
+      pool->warm_requested = false;
+      bson_mutex_unlock (&pool->mutex);
+
+      _warm_pool (pool);
+      _connect_hedge_nodes (pool);
+
+      bson_mutex_lock (&pool->mutex);
+   }
+
+   bson_mutex_unlock (&pool->mutex);
+
+   return NULL;
+}
+
+
+/* wake the warming thread */
+static void
+_request_warming (mongoc_client_pool_t *pool)
+{
+   bson_mutex_lock (&pool->mutex);
+   pool->warm_requested = true;
+   mongoc_cond_signal (&pool->warm_cond);
+   bson_mutex_unlock (&pool->mutex);
+}
+
+
+/* called by the topology's background thread after each scan */
+static void
+_maintain_pool (void *data)
+{
+   mongoc_client_pool_t *pool = (mongoc_client_pool_t *) data;
+
+   _prune_idle_clients (pool);
+
+   if (_warm_thread_needed (pool)) {
+      _request_warming (pool);
+   }
+}
+
+
+static bool
+_warm_thread_needed (const mongoc_client_pool_t *pool)
+{
+   return pool->warm_pool_size || pool->warm_hedge_nodes;
+}
+
+
+/* hand idle clients, or slots for new clients, to waiters in arrival order.
+ * requires pool->mutex */
+static void
+_serve_waiters (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_waiter_t *waiter;
+   mongoc_client_t *client;
+
+   while ((waiter = pool->wait_head)) {
+      if ((client = _take_idle_client (pool))) {
+         waiter->client = client;
+      } else if (_reserve_client_slot (pool)) {
+         waiter->slot = true;
       } else {
-         mongoc_cond_wait (&pool->cond, &pool->mutex);
-         GOTO (again);
+         return;
       }
+
+      pool->wait_head = waiter->next;
+      if (!pool->wait_head) {
+         pool->wait_tail = NULL;
+      }
+
+      mongoc_cond_signal (&waiter->cond);
    }
+}
 
-   _start_scanner_if_needed (pool);
+
+/* remove a waiter that timed out before being served. requires pool->mutex */
+static void
+_remove_waiter (mongoc_client_pool_t *pool,
+                mongoc_client_pool_waiter_t *waiter)
+{
+   mongoc_client_pool_waiter_t *prev = NULL;
+   mongoc_client_pool_waiter_t *iter;
+
+   for (iter = pool->wait_head; iter; prev = iter, iter = iter->next) {
+      if (iter == waiter) {
+         if (prev) {
+            prev->next = iter->next;
+         } else {
+            pool->wait_head = iter->next;
+         }
+
+         if (pool->wait_tail == iter) {
+            pool->wait_tail = prev;
+         }
+
+         return;
+      }
+   }
+}
+
+
+/* queue up behind earlier waiters until a push serves us, or until
+ * @timeout_msec passes if it is positive. returns false on timeout */
+static bool
+_wait_for_client (mongoc_client_pool_t *pool,
+                  int32_t timeout_msec,
+                  mongoc_client_t **client /* OUT */,
+                  bool *reserved /* OUT */)
+{
+   mongoc_client_pool_waiter_t waiter = {0};
+   int64_t start;
+   int64_t expire_at = 0;
+   int64_t remaining_msec;
+   int64_t waited_msec;
+   bool timed_out = false;
+
+   start = bson_get_monotonic_time ();
+   if (timeout_msec > 0) {
+      expire_at = start + (int64_t) timeout_msec * 1000;
+   }
+
+   mongoc_cond_init (&waiter.cond);
+
+   bson_mutex_lock (&pool->mutex);
+
+   if (pool->wait_tail) {
+      pool->wait_tail->next = &waiter;
+   } else {
+      pool->wait_head = &waiter;
+   }
+   pool->wait_tail = &waiter;
+
+   /* announce ourselves before checking again, so that a concurrent push
+    * either leaves a client we find now or sees us waiting and serves us */
+   bson_atomic_int_add (&pool->waiters, 1);
+   mongoc_counter_client_pool_waiting_inc ();
+
+   _serve_waiters (pool);
+
+   while (!waiter.client && !waiter.slot) {
+      if (!expire_at) {
+         mongoc_cond_wait (&waiter.cond, &pool->mutex);
+         continue;
+      }
+
+      remaining_msec = (expire_at - bson_get_monotonic_time ()) / 1000;
+      if (remaining_msec <= 0) {
+         _remove_waiter (pool, &waiter);
+         timed_out = true;
+         break;
+      }
+
+      mongoc_cond_timedwait (&waiter.cond, &pool->mutex, remaining_msec);
+   }
+
+   bson_atomic_int_add (&pool->waiters, -1);
    bson_mutex_unlock (&pool->mutex);
 
+   mongoc_cond_destroy (&waiter.cond);
+
+   waited_msec = (bson_get_monotonic_time () - start) / 1000;
+   mongoc_counter_client_pool_waiting_dec ();
+   mongoc_counter_client_pool_waits_inc ();
+   mongoc_counter_client_pool_wait_msec_add (waited_msec);
+
+   if (timed_out) {
+      mongoc_counter_client_pool_wait_timeouts_inc ();
+      return false;
+   }
+
+   *client = waiter.client;
+   *reserved = waiter.slot;
+
+   return true;
+}
+
+
+mongoc_client_t *
+mongoc_client_pool_pop (mongoc_client_pool_t *pool)
+{
+   mongoc_client_t *client = NULL;
+   bool reserved = false;
+
+   ENTRY;
+
+   BSON_ASSERT (pool);
+
+   /* don't overtake threads that are already waiting */
+   if (pool->waiters <= 0) {
+      client = _take_idle_client (pool);
+
+      if (!client) {
+         reserved = _reserve_client_slot_unlocked (pool);
+      }
+   }
+
+   if (!client && !reserved &&
+       !_wait_for_client (
+          pool, pool->wait_queue_timeout_msec, &client, &reserved)) {
+      RETURN (NULL);
+   }
+
+   if (reserved) {
+      client = _new_client (pool);
+   }
+
+   _start_scanner_if_needed (pool);
+
    RETURN (client);
 }
 
@@ -261,52 +849,109 @@ mongoc_client_pool_try_pop (mongoc_client_pool_t *pool)
 
    BSON_ASSERT (pool);
 
-   bson_mutex_lock (&pool->mutex);
+   client = _take_idle_client (pool);
 
-   if (!(client = (mongoc_client_t *) _mongoc_queue_pop_head (&pool->queue))) {
-      if (pool->size < pool->max_pool_size) {
-         client = _mongoc_client_new_from_uri (pool->topology);
-#ifdef MONGOC_ENABLE_SSL
-         if (pool->ssl_opts_set) {
-            mongoc_client_set_ssl_opts (client, &pool->ssl_opts);
-         }
-#endif
-         pool->size++;
-      }
+   if (!client && _reserve_client_slot_unlocked (pool)) {
+      client = _new_client (pool);
    }
 
    if (client) {
       _start_scanner_if_needed (pool);
    }
-   bson_mutex_unlock (&pool->mutex);
 
    RETURN (client);
 }
 
 
+/* take the least recently pushed idle client of all shards. each shard's
+ * oldest client is its tail */
+static mongoc_client_t *
+_take_oldest_idle_client (mongoc_client_pool_t *pool)
+{
+   mongoc_client_pool_shard_t *shard;
+   mongoc_client_t *client;
+   mongoc_client_t *oldest = NULL;
+   uint32_t oldest_shard = 0;
+   uint32_t i;
+
+   for (i = 0; i < MONGOC_CLIENT_POOL_SHARDS; i++) {
+      shard = &pool->shards[i];
+      bson_mutex_lock (&shard->mutex);
+      if (shard->queue.tail) {
+         client = (mongoc_client_t *) shard->queue.tail->data;
+         if (!oldest || client->pushed_at < oldest->pushed_at) {
+            oldest = client;
+            oldest_shard = i;
+         }
+      }
+      bson_mutex_unlock (&shard->mutex);
+   }
+
+   if (!oldest) {
+      return NULL;
+   }
+
+   /* if another thread took it meanwhile, leave trimming to the next push */
+   shard = &pool->shards[oldest_shard];
+   bson_mutex_lock (&shard->mutex);
+   if (shard->queue.tail && shard->queue.tail->data == oldest) {
+      _mongoc_queue_pop_tail (&shard->queue);
+      bson_atomic_int_add (&pool->idle, -1);
+   } else {
+      oldest = NULL;
+   }
+   bson_mutex_unlock (&shard->mutex);
+
+   return oldest;
+}
+
+
 void
 mongoc_client_pool_push (mongoc_client_pool_t *pool, mongoc_client_t *client)
 {
+   mongoc_client_pool_shard_t *shard;
+   mongoc_client_t *old_client = NULL;
+   int32_t idle;
+   bool wants_nodes;
+
    ENTRY;
 
    BSON_ASSERT (pool);
    BSON_ASSERT (client);
 
-   bson_mutex_lock (&pool->mutex);
-   _mongoc_queue_push_head (&pool->queue, client);
-
-   if (pool->min_pool_size &&
-       _mongoc_queue_get_length (&pool->queue) > pool->min_pool_size) {
-      mongoc_client_t *old_client;
-      old_client = (mongoc_client_t *) _mongoc_queue_pop_tail (&pool->queue);
-      if (old_client) {
-         mongoc_client_destroy (old_client);
-         pool->size--;
-      }
+   shard = &pool->shards[_thread_shard ()];
+   client->pushed_at = bson_get_monotonic_time ();
+
+   /* read before another thread can pop the client */
+   wants_nodes =
+      pool->warm_hedge_nodes && _mongoc_client_async_wants_nodes (client);
+
+   bson_mutex_lock (&shard->mutex);
+   _mongoc_queue_push_head (&shard->queue, client);
+   idle = bson_atomic_int_add (&pool->idle, 1);
+   bson_mutex_unlock (&shard->mutex);
+
+   if (pool->min_pool_size && idle > (int32_t) pool->min_pool_size) {
+      old_client = _take_oldest_idle_client (pool);
    }
 
-   mongoc_cond_signal (&pool->cond);
-   bson_mutex_unlock (&pool->mutex);
+   if (old_client) {
+      mongoc_client_destroy (old_client);
+      bson_atomic_int_add (&pool->size, -1);
+   }
+
+   /* connect it to hedge while it's idle, not at the next scan */
+   if (wants_nodes) {
+      _request_warming (pool);
+   }
+
+   /* the atomic add above is a full barrier, so either a waiter registered
+    * before it and we serve it, or the waiter checks the shards after it */
+   if (pool->waiters > 0) {
+      bson_mutex_lock (&pool->mutex);
+      _serve_waiters (pool);
+      bson_mutex_unlock (&pool->mutex);
+   }
 
    EXIT;
 }
@@ -329,9 +974,7 @@ mongoc_client_pool_get_size (mongoc_client_pool_t *pool)
 
    ENTRY;
 
-   bson_mutex_lock (&pool->mutex);
-   size = pool->size;
-   bson_mutex_unlock (&pool->mutex);
+   size = (size_t) BSON_MAX (pool->size, 0);
 
    RETURN (size);
 }
@@ -344,14 +987,20 @@ mongoc_client_pool_num_pushed (mongoc_client_pool_t *pool)
 
    ENTRY;
 
-   bson_mutex_lock (&pool->mutex);
-   num_pushed = pool->queue.length;
-   bson_mutex_unlock (&pool->mutex);
+   num_pushed = (size_t) BSON_MAX (pool->idle, 0);
 
    RETURN (num_pushed);
 }
 
 
+/* for tests */
+size_t
+_mongoc_client_pool_num_waiters (mongoc_client_pool_t *pool)
+{
+   return (size_t) BSON_MAX (pool->waiters, 0);
+}
+
+
 mongoc_topology_t *
 _mongoc_client_pool_get_topology (mongoc_client_pool_t *pool)
 {
@@ -359,6 +1008,19 @@ _mongoc_client_pool_get_topology (mongoc_client_pool_t *pool)
 }
 
 
+uint32_t
+_mongoc_client_pool_get_max_size (mongoc_client_pool_t *pool)
+{
+   uint32_t max_pool_size;
+
+   bson_mutex_lock (&pool->mutex);
+   max_pool_size = pool->max_pool_size;
+   bson_mutex_unlock (&pool->mutex);
+
+   return max_pool_size;
+}
+
+
 void
 mongoc_client_pool_max_size (mongoc_client_pool_t *pool, uint32_t max_pool_size)
 {
@@ -366,6 +1028,8 @@ mongoc_client_pool_max_size (mongoc_client_pool_t *pool, uint32_t max_pool_size)
 
    bson_mutex_lock (&pool->mutex);
    pool->max_pool_size = max_pool_size;
+   /* a larger pool may have room for waiters now */
+   _serve_waiters (pool);
    bson_mutex_unlock (&pool->mutex);
 
    EXIT;
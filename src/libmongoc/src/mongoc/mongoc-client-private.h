@@ -24,6 +24,7 @@
 #include <bson.h>
 
 #include "mongoc-apm-private.h"
+#include "mongoc-async-private.h"
 #include "mongoc-buffer-private.h"
 #include "mongoc-client.h"
 #include "mongoc-cluster-private.h"
@@ -34,6 +35,7 @@
 #include "mongoc-opcode.h"
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-ssl.h"
+#include "mongoc-stream-tls-private.h"
 #endif
 #include "mongoc-stream.h"
 #include "mongoc-topology-private.h"
@@ -78,6 +80,8 @@ struct _mongoc_client_t {
 #ifdef MONGOC_ENABLE_SSL
    bool use_ssl;
    mongoc_ssl_opt_t ssl_opts;
+   /* owned by a single-threaded client, borrowed from the pool otherwise */
+   mongoc_tls_cache_t *tls_cache;
 #endif
 
    mongoc_topology_t *topology;
@@ -95,8 +99,29 @@ struct _mongoc_client_t {
    /* mongoc_client_session_t's in use, to look up lsids and clusterTimes */
    mongoc_set_t *client_sessions;
    unsigned int csid_rand_seed;
+
+   /* commands started with mongoc_client_command_async, created on first use,
+    * and the connections they left idle (mongoc_client_async_conn_t) */
+   mongoc_async_t *async;
+   mongoc_array_t async_idle;
+   /* ids of servers that hedged reads found no idle connection to */
+   mongoc_array_t async_wanted;
+
+   /* when a pooled client was last pushed, so the pool can trim the oldest */
+   int64_t pushed_at;
 };
 
+/* a connection owned by the async API, not by the cluster */
+typedef struct {
+   uint32_t server_id;
+   mongoc_cluster_node_t *node;
+   /* if discard_reply, the reply to discard_request_id must be dropped
+    * before reuse. it's abandoned at discard_expire, if not 0 */
+   bool discard_reply;
+   uint32_t discard_request_id;
+   int64_t discard_expire;
+} mongoc_client_async_conn_t;
+
 
 /* Defines whether _mongoc_client_command_with_opts() is acting as a read
  * command helper for a command like "distinct", or a write command helper for
@@ -187,6 +212,48 @@ _mongoc_client_push_server_session (mongoc_client_t *client,
                                     mongoc_server_session_t *server_session);
 void
 _mongoc_client_end_sessions (mongoc_client_t *client);
+
+bool
+_mongoc_client_command_async (mongoc_client_t *client,
+                              const char *db_name,
+                              const bson_t *command,
+                              mongoc_ss_optype_t optype,
+                              const mongoc_read_prefs_t *read_prefs,
+                              mongoc_client_command_async_cb_t cb,
+                              void *data,
+                              bson_error_t *error);
+
+mongoc_cluster_node_t *
+_mongoc_client_async_checkout_node (mongoc_client_t *client,
+                                    uint32_t server_id);
+
+void
+_mongoc_client_async_connect_node (mongoc_client_t *client,
+                                   uint32_t server_id);
+
+void
+_mongoc_client_async_want_node (mongoc_client_t *client, uint32_t server_id);
+
+bool
+_mongoc_client_async_wants_nodes (const mongoc_client_t *client);
+
+void
+_mongoc_client_async_connect_wanted (mongoc_client_t *client);
+
+void
+_mongoc_client_async_checkin_node (mongoc_client_t *client,
+                                   uint32_t server_id,
+                                   mongoc_cluster_node_t *node);
+
+void
+_mongoc_client_async_checkin_node_discarding (mongoc_client_t *client,
+                                              uint32_t server_id,
+                                              mongoc_cluster_node_t *node,
+                                              uint32_t request_id,
+                                              int64_t expire_at);
+
+void
+_mongoc_client_async_destroy (mongoc_client_t *client);
 BSON_END_DECLS
 
 
@@ -44,6 +44,8 @@
 #include "mongoc-socket.h"
 #include "mongoc-stream-buffered.h"
 #include "mongoc-stream-socket.h"
+#include "mongoc-stream-io-uring-private.h"
+#include "mongoc-stream-private.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-uri-private.h"
@@ -505,6 +507,21 @@ _mongoc_client_get_rr (const char *service,
 
 #undef DNS_ERROR
 
+static mongoc_stream_t *
+_mongoc_client_socket_stream_new (mongoc_socket_t *sock, bool io_uring)
+{
+#ifdef MONGOC_ENABLE_IO_URING
+   mongoc_stream_t *stream;
+
+   if (io_uring && (stream = _mongoc_stream_io_uring_new (sock))) {
+      return stream;
+   }
+#endif
+
+   return mongoc_stream_socket_new (sock);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -528,6 +545,7 @@ _mongoc_client_get_rr (const char *service,
 static mongoc_stream_t *
 mongoc_client_connect_tcp (const mongoc_uri_t *uri,
                            const mongoc_host_list_t *host,
+                           bool io_uring,
                            bson_error_t *error)
 {
    mongoc_socket_t *sock = NULL;
@@ -606,7 +624,7 @@ mongoc_client_connect_tcp (const mongoc_uri_t *uri,
 
    freeaddrinfo (result);
 
-   return mongoc_stream_socket_new (sock);
+   return _mongoc_client_socket_stream_new (sock, io_uring);
 }
 
 
@@ -630,6 +648,7 @@ mongoc_client_connect_tcp (const mongoc_uri_t *uri,
 static mongoc_stream_t *
 mongoc_client_connect_unix (const mongoc_uri_t *uri,
                             const mongoc_host_list_t *host,
+                            bool io_uring,
                             bson_error_t *error)
 {
 #ifdef _WIN32
@@ -673,40 +692,22 @@ mongoc_client_connect_unix (const mongoc_uri_t *uri,
       RETURN (NULL);
    }
 
-   ret = mongoc_stream_socket_new (sock);
+   ret = _mongoc_client_socket_stream_new (sock, io_uring);
 
    RETURN (ret);
 #endif
 }
 
 
-/*
- *--------------------------------------------------------------------------
- *
- * mongoc_client_default_stream_initiator --
- *
- *       A mongoc_stream_initiator_t that will handle the various type
- *       of supported sockets by MongoDB including TCP and UNIX.
- *
- *       Language binding authors may want to implement an alternate
- *       version of this method to use their native stream format.
- *
- * Returns:
- *       A mongoc_stream_t if successful; otherwise NULL and @error is set.
- *
- * Side effects:
- *       @error is set if return value is NULL.
- *
- *--------------------------------------------------------------------------
- */
-
-mongoc_stream_t *
-mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
-                                        const mongoc_host_list_t *host,
-                                        void *user_data,
-                                        bson_error_t *error)
+static mongoc_stream_t *
+_mongoc_client_stream_initiator (const mongoc_uri_t *uri,
+                                 const mongoc_host_list_t *host,
+                                 void *user_data,
+                                 bool io_uring,
+                                 bson_error_t *error)
 {
    mongoc_stream_t *base_stream = NULL;
+   bool tls = false;
 #ifdef MONGOC_ENABLE_SSL
    mongoc_client_t *client = (mongoc_client_t *) user_data;
    const char *mechanism;
@@ -733,10 +734,10 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
    case AF_INET6:
 #endif
    case AF_INET:
-      base_stream = mongoc_client_connect_tcp (uri, host, error);
+      base_stream = mongoc_client_connect_tcp (uri, host, io_uring, error);
       break;
    case AF_UNIX:
-      base_stream = mongoc_client_connect_unix (uri, host, error);
+      base_stream = mongoc_client_connect_unix (uri, host, io_uring, error);
       break;
    default:
       bson_set_error (error,
@@ -755,8 +756,13 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
           (mechanism && (0 == strcmp (mechanism, "MONGODB-X509")))) {
          mongoc_stream_t *original = base_stream;
 
-         base_stream = mongoc_stream_tls_new_with_hostname (
-            base_stream, host->host, &client->ssl_opts, true);
+         tls = true;
+         base_stream = _mongoc_stream_tls_new_with_cache (base_stream,
+                                                          host->host,
+                                                          host->port,
+                                                          &client->ssl_opts,
+                                                          true,
+                                                          client->tls_cache);
 
          if (!base_stream) {
             mongoc_stream_destroy (original);
@@ -779,7 +785,77 @@ mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
    }
 #endif
 
-   return base_stream ? mongoc_stream_buffered_new (base_stream, 1024) : NULL;
+   if (!base_stream) {
+      return NULL;
+   }
+
+   /* an io_uring stream already reads ahead into its own buffer */
+   if (io_uring && !tls &&
+       mongoc_stream_get_root_stream (base_stream)->type ==
+          MONGOC_STREAM_IO_URING) {
+      return base_stream;
+   }
+
+   return mongoc_stream_buffered_new (base_stream, 1024);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_default_stream_initiator --
+ *
+ *       A mongoc_stream_initiator_t that will handle the various type
+ *       of supported sockets by MongoDB including TCP and UNIX.
+ *
+ *       Language binding authors may want to implement an alternate
+ *       version of this method to use their native stream format.
+ *
+ * Returns:
+ *       A mongoc_stream_t if successful; otherwise NULL and @error is set.
+ *
+ * Side effects:
+ *       @error is set if return value is NULL.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+mongoc_client_default_stream_initiator (const mongoc_uri_t *uri,
+                                        const mongoc_host_list_t *host,
+                                        void *user_data,
+                                        bson_error_t *error)
+{
+   return _mongoc_client_stream_initiator (uri, host, user_data, false, error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_client_io_uring_stream_initiator --
+ *
+ *       Like mongoc_client_default_stream_initiator, but the sockets do
+ *       their I/O through io_uring where the driver was built with it
+ *       and the kernel supports it; otherwise this makes the same
+ *       streams as the default initiator.
+ *
+ * Returns:
+ *       A mongoc_stream_t if successful; otherwise NULL and @error is set.
+ *
+ * Side effects:
+ *       @error is set if return value is NULL.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+mongoc_client_io_uring_stream_initiator (const mongoc_uri_t *uri,
+                                         const mongoc_host_list_t *host,
+                                         void *user_data,
+                                         bson_error_t *error)
+{
+   return _mongoc_client_stream_initiator (uri, host, user_data, true, error);
 }
 
 
@@ -934,8 +1010,17 @@ mongoc_client_set_ssl_opts (mongoc_client_t *client,
    _mongoc_ssl_opts_copy_to (opts, &client->ssl_opts);
 
    if (client->topology->single_threaded) {
+      /* the cached context was built from the old options. open streams
+       * still borrow the cache, so empty it rather than replace it */
+      if (client->tls_cache) {
+         _mongoc_tls_cache_reset (client->tls_cache);
+      } else {
+         client->tls_cache = _mongoc_tls_cache_new ();
+      }
+
       mongoc_topology_scanner_set_ssl_opts (client->topology->scanner,
                                             &client->ssl_opts);
+      client->topology->scanner->tls_cache = client->tls_cache;
    }
 }
 #endif
@@ -971,6 +1056,15 @@ mongoc_client_new_from_uri (const mongoc_uri_t *uri)
    return _mongoc_client_new_from_uri (topology);
 }
 
+/* a single-threaded client makes the hedge connections its reads asked for
+ * after each scan, which already blocks for handshakes */
+static void
+_mongoc_client_after_scan (void *data)
+{
+   _mongoc_client_async_connect_wanted ((mongoc_client_t *) data);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1033,6 +1127,11 @@ _mongoc_client_new_from_uri (mongoc_topology_t *topology)
 
    mongoc_cluster_init (&client->cluster, client->uri, client);
 
+   if (client->topology->single_threaded) {
+      client->topology->after_scan_cb = _mongoc_client_after_scan;
+      client->topology->after_scan_context = client;
+   }
+
 #ifdef MONGOC_ENABLE_SSL
    client->use_ssl = false;
    if (mongoc_uri_get_ssl (client->uri)) {
@@ -1070,9 +1169,18 @@ void
 mongoc_client_destroy (mongoc_client_t *client)
 {
    if (client) {
+#ifdef MONGOC_ENABLE_SSL
+      mongoc_tls_cache_t *tls_cache = NULL;
+#endif
+
+      _mongoc_client_async_destroy (client);
+
       if (client->topology->single_threaded) {
          _mongoc_client_end_sessions (client);
          mongoc_topology_destroy (client->topology);
+#ifdef MONGOC_ENABLE_SSL
+         tls_cache = client->tls_cache;
+#endif
       }
 
       mongoc_write_concern_destroy (client->write_concern);
@@ -1084,6 +1192,7 @@ mongoc_client_destroy (mongoc_client_t *client)
 
 #ifdef MONGOC_ENABLE_SSL
       _mongoc_ssl_opts_cleanup (&client->ssl_opts);
+      _mongoc_tls_cache_destroy (tls_cache);
 #endif
 
       bson_free (client);
@@ -101,6 +101,23 @@ typedef mongoc_stream_t *(*mongoc_stream_initiator_t) (
    bson_error_t *error);
 
 
+/**
+ * mongoc_client_async_fd_t:
+ * @fd: The socket an async command is waiting on.
+ * @events: POLLIN or POLLOUT, whichever the command is waiting for.
+ * @deadline: When the command times out, in bson_get_monotonic_time ()
+ *            microseconds.
+ *
+ * Reported by mongoc_client_async_get_fds, for applications that poll for
+ * async commands in their own event loop.
+ */
+typedef struct {
+   mongoc_socket_fd_t fd;
+   int events;
+   int64_t deadline;
+} mongoc_client_async_fd_t;
+
+
 MONGOC_EXPORT (mongoc_client_t *)
 mongoc_client_new (const char *uri_string);
 MONGOC_EXPORT (mongoc_client_t *)
@@ -111,6 +128,11 @@ MONGOC_EXPORT (void)
 mongoc_client_set_stream_initiator (mongoc_client_t *client,
                                     mongoc_stream_initiator_t initiator,
                                     void *user_data);
+MONGOC_EXPORT (mongoc_stream_t *)
+mongoc_client_io_uring_stream_initiator (const mongoc_uri_t *uri,
+                                         const mongoc_host_list_t *host,
+                                         void *user_data,
+                                         bson_error_t *error);
 MONGOC_EXPORT (mongoc_cursor_t *)
 mongoc_client_command (mongoc_client_t *client,
                        const char *db_name,
@@ -260,6 +282,26 @@ MONGOC_EXPORT (mongoc_change_stream_t *)
 mongoc_client_watch (mongoc_client_t *client,
                      const bson_t *pipeline,
                      const bson_t *opts);
+MONGOC_EXPORT (bool)
+mongoc_client_command_async (mongoc_client_t *client,
+                             const char *db_name,
+                             const bson_t *command,
+                             const mongoc_read_prefs_t *read_prefs,
+                             mongoc_client_command_async_cb_t cb,
+                             void *data,
+                             bson_error_t *error);
+MONGOC_EXPORT (void)
+mongoc_client_async_run (mongoc_client_t *client);
+MONGOC_EXPORT (size_t)
+mongoc_client_async_get_fds (mongoc_client_t *client,
+                             mongoc_client_async_fd_t *fds,
+                             size_t n_fds);
+MONGOC_EXPORT (void)
+mongoc_client_async_process_ready (mongoc_client_t *client,
+                                   mongoc_socket_fd_t fd,
+                                   int revents);
+MONGOC_EXPORT (void)
+mongoc_client_async_process_timeouts (mongoc_client_t *client);
 BSON_END_DECLS
 
 
@@ -27,6 +27,7 @@
 #include "mongoc-buffer-private.h"
 #include "mongoc-config.h"
 #include "mongoc-client.h"
+#include "mongoc-compression-private.h"
 #include "mongoc-list-private.h"
 #include "mongoc-opcode.h"
 #include "mongoc-rpc-private.h"
@@ -42,8 +43,17 @@
 BSON_BEGIN_DECLS
 
 
+/* a connection's receive buffer starts large enough for a typical reply, so
+ * most replies are read with one call to recv (). if a larger reply makes it
+ * grow, it is handed to the reply or freed, rather than kept. */
+#define MONGOC_CLUSTER_RECV_BUFFER_SIZE (16 * 1024)
+
+#define MONGOC_DEFAULT_HEDGED_READ_PERCENTILE 95
+
+
 typedef struct _mongoc_cluster_node_t {
    mongoc_stream_t *stream;
+   mongoc_buffer_t buffer; /* see MONGOC_CLUSTER_RECV_BUFFER_SIZE */
    char *connection_address;
 
    int32_t max_wire_version;
@@ -53,6 +63,8 @@ typedef struct _mongoc_cluster_node_t {
    int32_t max_msg_size;
 
    int64_t timestamp;
+   uint32_t generation; /* the server's connection generation at connect */
+   int64_t last_used;   /* monotonic time the stream was last fetched */
 } mongoc_cluster_node_t;
 
 typedef struct _mongoc_cluster_t {
@@ -60,6 +72,14 @@ typedef struct _mongoc_cluster_t {
    uint32_t request_id;
    uint32_t sockettimeoutms;
    uint32_t socketcheckintervalms;
+   uint32_t maxidletimems; /* 0 keeps idle connections open */
+   /* hedge reads after this percentile of the first server's latency, or
+    * 0 not to hedge */
+   int32_t hedged_read_percentile;
+   /* unordered bulk write batches sent before the first reply is read */
+   int32_t max_write_batches_in_flight;
+   /* the scanner's generation when stale nodes were last dropped */
+   int32_t generation;
    mongoc_uri_t *uri;
    unsigned requires_auth : 1;
 
@@ -68,9 +88,28 @@ typedef struct _mongoc_cluster_t {
    mongoc_set_t *nodes;
    mongoc_array_t iov;
 
-   mongoc_scram_cache_t *scram_cache;
+   mongoc_compressor_ctx_t *compressor; /* created on first use */
 } mongoc_cluster_t;
 
+/* OP_MSGs written to one server stream whose replies are not yet read.
+ * Replies are matched to requests by "responseTo"; a reply that arrives
+ * while waiting for another is stashed until it is asked for. */
+typedef struct _mongoc_cluster_pipeline_t {
+   mongoc_cluster_t *cluster;
+   mongoc_server_stream_t *server_stream;
+   mongoc_array_t in_flight; /* uint32_t request ids */
+   mongoc_array_t stashed;   /* mongoc_buffer_t, whole messages */
+   bool failed;
+   bson_error_t error;
+} mongoc_cluster_pipeline_t;
+
+/* a command sent with mongoc_cluster_pipeline_send_monitored */
+typedef struct _mongoc_cluster_pipeline_op_t {
+   uint32_t request_id;     /* the OP_MSG's */
+   uint32_t apm_request_id; /* the one command monitoring reports */
+   int64_t started;
+} mongoc_cluster_pipeline_op_t;
+
 
 void
 mongoc_cluster_init (mongoc_cluster_t *cluster,
@@ -128,6 +167,28 @@ mongoc_cluster_stream_for_writes (mongoc_cluster_t *cluster,
                                   bson_t *reply,
                                   bson_error_t *error);
 
+mongoc_cluster_node_t *
+_mongoc_cluster_node_connect (mongoc_cluster_t *cluster,
+                              uint32_t server_id,
+                              bson_error_t *error);
+
+void
+_mongoc_cluster_node_destroy (mongoc_cluster_node_t *node);
+
+bool
+_mongoc_cluster_node_discard_reply (mongoc_cluster_t *cluster,
+                                    mongoc_cluster_node_t *node,
+                                    uint32_t request_id,
+                                    bool *discarded);
+
+void
+_mongoc_cluster_prune_nodes (mongoc_cluster_t *cluster);
+
+bool
+_mongoc_cluster_warm_node (mongoc_cluster_t *cluster,
+                           uint32_t server_id,
+                           bson_error_t *error);
+
 mongoc_server_stream_t *
 mongoc_cluster_stream_for_server (mongoc_cluster_t *cluster,
                                   uint32_t server_id,
@@ -155,6 +216,40 @@ mongoc_cluster_run_command_private (mongoc_cluster_t *cluster,
                                     bson_t *reply,
                                     bson_error_t *error);
 
+void
+mongoc_cluster_pipeline_init (mongoc_cluster_pipeline_t *pipeline,
+                               mongoc_cluster_t *cluster,
+                               mongoc_server_stream_t *server_stream);
+
+bool
+mongoc_cluster_pipeline_send (mongoc_cluster_pipeline_t *pipeline,
+                              mongoc_cmd_t *cmd,
+                              uint32_t *request_id,
+                              bson_error_t *error);
+
+bool
+mongoc_cluster_pipeline_recv (mongoc_cluster_pipeline_t *pipeline,
+                              mongoc_cmd_t *cmd,
+                              uint32_t request_id,
+                              bson_t *reply,
+                              bson_error_t *error);
+
+bool
+mongoc_cluster_pipeline_send_monitored (mongoc_cluster_pipeline_t *pipeline,
+                                        mongoc_cmd_t *cmd,
+                                        mongoc_cluster_pipeline_op_t *op,
+                                        bson_error_t *error);
+
+bool
+mongoc_cluster_pipeline_recv_monitored (mongoc_cluster_pipeline_t *pipeline,
+                                        mongoc_cmd_t *cmd,
+                                        const mongoc_cluster_pipeline_op_t *op,
+                                        bson_t *reply,
+                                        bson_error_t *error);
+
+void
+mongoc_cluster_pipeline_destroy (mongoc_cluster_pipeline_t *pipeline);
+
 void
 _mongoc_cluster_build_sasl_start (bson_t *cmd,
                                   const char *mechanism,
@@ -104,6 +104,17 @@ mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
                           bson_t *reply,
                           bson_error_t *error);
 
+static int32_t
+_mongoc_cluster_hedge_delay_msec (mongoc_cluster_t *cluster,
+                                  const mongoc_cmd_t *cmd);
+
+static bool
+_mongoc_cluster_run_opmsg_hedged (mongoc_cluster_t *cluster,
+                                  mongoc_cmd_t *cmd,
+                                  int32_t delay_msec,
+                                  bson_t *reply,
+                                  bson_error_t *error);
+
 static void
 _bson_error_message_printf (bson_error_t *error, const char *format, ...)
    BSON_GNUC_PRINTF (2, 3);
@@ -216,7 +227,6 @@ mongoc_cluster_run_command_opquery (mongoc_cluster_t *cluster,
    int32_t msg_len;
    size_t doc_len;
    bool ret = false;
-   char *output = NULL;
    uint32_t server_id;
 
    ENTRY;
@@ -254,8 +264,8 @@ mongoc_cluster_run_command_opquery (mongoc_cluster_t *cluster,
        IS_NOT_COMMAND ("createuser") && IS_NOT_COMMAND ("updateuser") &&
        IS_NOT_COMMAND ("copydbsaslstart") &&
        IS_NOT_COMMAND ("copydbgetnonce") && IS_NOT_COMMAND ("copydb")) {
-      output = _mongoc_rpc_compress (cluster, compressor_id, &rpc, error);
-      if (output == NULL) {
+      if (!_mongoc_rpc_compress (
+             cluster, compressor_id, server_id, &rpc, error)) {
          GOTO (done);
       }
    }
@@ -399,7 +409,6 @@ done:
    if (reply_ptr == &reply_local) {
       bson_destroy (reply_ptr);
    }
-   bson_free (output);
 
    RETURN (ret);
 }
@@ -492,54 +501,15 @@ handle_not_master_error (mongoc_cluster_t *cluster,
    }
 }
 
-/*
- *--------------------------------------------------------------------------
- *
- * mongoc_cluster_run_command_monitored --
- *
- *       Internal function to run a command on a given stream.
- *       @error and @reply are optional out-pointers.
- *
- * Returns:
- *       true if successful; otherwise false and @error is set.
- *
- * Side effects:
- *       If the client's APM callbacks are set, they are executed.
- *       @reply is set and should ALWAYS be released with bson_destroy().
- *
- *--------------------------------------------------------------------------
- */
-
-bool
-mongoc_cluster_run_command_monitored (mongoc_cluster_t *cluster,
-                                      mongoc_cmd_t *cmd,
-                                      bson_t *reply,
-                                      bson_error_t *error)
+/* publish the command started event for @cmd if the client monitors
+ * commands, and count the command as in flight on its server */
+static void
+_mongoc_cluster_command_started (mongoc_cluster_t *cluster,
+                                 mongoc_cmd_t *cmd,
+                                 uint32_t request_id)
 {
-   bool retval;
-   uint32_t request_id = ++cluster->request_id;
-   uint32_t server_id;
-   mongoc_apm_callbacks_t *callbacks;
+   mongoc_apm_callbacks_t *callbacks = &cluster->client->apm_callbacks;
    mongoc_apm_command_started_t started_event;
-   mongoc_apm_command_succeeded_t succeeded_event;
-   mongoc_apm_command_failed_t failed_event;
-   int64_t started = bson_get_monotonic_time ();
-   const mongoc_server_stream_t *server_stream;
-   bson_t reply_local;
-   bson_error_t error_local;
-   int32_t compressor_id;
-
-   server_stream = cmd->server_stream;
-   server_id = server_stream->sd->id;
-   compressor_id = mongoc_server_description_compressor_id (server_stream->sd);
-
-   callbacks = &cluster->client->apm_callbacks;
-   if (!reply) {
-      reply = &reply_local;
-   }
-   if (!error) {
-      error = &error_local;
-   }
 
    if (callbacks->started) {
       mongoc_apm_command_started_init_with_cmd (
@@ -549,12 +519,28 @@ mongoc_cluster_run_command_monitored (mongoc_cluster_t *cluster,
       mongoc_apm_command_started_cleanup (&started_event);
    }
 
-   if (server_stream->sd->max_wire_version >= WIRE_VERSION_OP_MSG) {
-      retval = mongoc_cluster_run_opmsg (cluster, cmd, reply, error);
-   } else {
-      retval = mongoc_cluster_run_command_opquery (
-         cluster, cmd, server_stream->stream, compressor_id, reply, error);
-   }
+   mongoc_server_description_op_started (cmd->server_stream->sd);
+}
+
+
+/* record the outcome of @cmd, started at @started: the command succeeded or
+ * failed event, and a "not master" error. the caller records its server's
+ * latency */
+static void
+_mongoc_cluster_command_finished (mongoc_cluster_t *cluster,
+                                  const mongoc_cmd_t *cmd,
+                                  uint32_t request_id,
+                                  int64_t started,
+                                  bool retval,
+                                  const bson_t *reply,
+                                  const bson_error_t *error)
+{
+   mongoc_apm_callbacks_t *callbacks = &cluster->client->apm_callbacks;
+   mongoc_apm_command_succeeded_t succeeded_event;
+   mongoc_apm_command_failed_t failed_event;
+   const mongoc_server_stream_t *server_stream = cmd->server_stream;
+   uint32_t server_id = server_stream->sd->id;
+
    if (retval && callbacks->succeeded) {
       bson_t fake_reply = BSON_INITIALIZER;
       /*
@@ -596,14 +582,88 @@ mongoc_cluster_run_command_monitored (mongoc_cluster_t *cluster,
       mongoc_apm_command_failed_cleanup (&failed_event);
    }
 
-   handle_not_master_error (cluster, server_id, reply);
+   handle_not_master_error (cluster, cmd->reply_server_id, reply);
+
+   _mongoc_topology_update_last_used (cluster->client->topology, server_id);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_run_command_monitored --
+ *
+ *       Internal function to run a command on a given stream.
+ *       @error and @reply are optional out-pointers.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       If the client's APM callbacks are set, they are executed.
+ *       @reply is set and should ALWAYS be released with bson_destroy().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_run_command_monitored (mongoc_cluster_t *cluster,
+                                      mongoc_cmd_t *cmd,
+                                      bson_t *reply,
+                                      bson_error_t *error)
+{
+   bool retval;
+   uint32_t request_id = ++cluster->request_id;
+   int64_t started = bson_get_monotonic_time ();
+   const mongoc_server_stream_t *server_stream;
+   bson_t reply_local;
+   bson_error_t error_local;
+   int32_t compressor_id;
+   int32_t hedge_delay_msec;
+   int64_t duration;
+
+   server_stream = cmd->server_stream;
+   compressor_id = mongoc_server_description_compressor_id (server_stream->sd);
+   cmd->reply_server_id = server_stream->sd->id;
+
+   if (!reply) {
+      reply = &reply_local;
+   }
+   if (!error) {
+      error = &error_local;
+   }
+
+   _mongoc_cluster_command_started (cluster, cmd, request_id);
+   if (server_stream->sd->max_wire_version >= WIRE_VERSION_OP_MSG) {
+      hedge_delay_msec = _mongoc_cluster_hedge_delay_msec (cluster, cmd);
+      if (hedge_delay_msec >= 0) {
+         retval = _mongoc_cluster_run_opmsg_hedged (
+            cluster, cmd, hedge_delay_msec, reply, error);
+      } else {
+         retval = mongoc_cluster_run_opmsg (cluster, cmd, reply, error);
+      }
+   } else {
+      retval = mongoc_cluster_run_command_opquery (
+         cluster, cmd, server_stream->stream, compressor_id, reply, error);
+   }
+
+   duration = bson_get_monotonic_time () - started;
+
+   /* unless a hedged read used another server's reply, and this one's was
+    * never read */
+   if (cmd->reply_server_id == server_stream->sd->id) {
+      mongoc_server_description_op_finished (server_stream->sd, duration);
+   } else {
+      mongoc_server_description_op_abandoned (server_stream->sd);
+   }
+
+   _mongoc_cluster_command_finished (
+      cluster, cmd, request_id, started, retval, reply, error);
 
    if (reply == &reply_local) {
       bson_destroy (&reply_local);
    }
 
-   _mongoc_topology_update_last_used (cluster->client->topology, server_id);
-
    return retval;
 }
 
@@ -787,6 +847,7 @@ _mongoc_stream_run_ismaster (mongoc_cluster_t *cluster,
       sizeof (mongoc_server_description_t));
 
    mongoc_server_description_init (sd, address, server_id);
+   _mongoc_topology_share_server_load (cluster->client->topology, sd);
    /* send the error from run_command IN to handle_ismaster */
    mongoc_server_description_handle_ismaster (sd, &reply, rtt_msec, error);
 
@@ -1257,10 +1318,8 @@ _mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
    _mongoc_scram_set_pass (&scram, mongoc_uri_get_password (cluster->uri));
    _mongoc_scram_set_user (&scram, mongoc_uri_get_username (cluster->uri));
 
-   /* Apply previously cached SCRAM secrets if available */
-   if (cluster->scram_cache) {
-      _mongoc_scram_set_cache (&scram, cluster->scram_cache);
-   }
+   /* Reuse SCRAM secrets cached by any client of this topology */
+   _mongoc_scram_set_cache (&scram, cluster->client->topology->scram_cache);
 
    for (;;) {
       if (!_mongoc_scram_step (
@@ -1361,13 +1420,6 @@ _mongoc_cluster_auth_node_scram (mongoc_cluster_t *cluster,
 
    ret = true;
 
-   /* Save cached SCRAM secrets for future use */
-   if (cluster->scram_cache) {
-      _mongoc_scram_cache_destroy (cluster->scram_cache);
-   }
-
-   cluster->scram_cache = _mongoc_scram_get_cache (&scram);
-
 failure:
    _mongoc_scram_destroy (&scram);
 
@@ -1548,11 +1600,12 @@ mongoc_cluster_disconnect_node (mongoc_cluster_t *cluster,
    EXIT;
 }
 
-static void
+void
 _mongoc_cluster_node_destroy (mongoc_cluster_node_t *node)
 {
    /* Failure, or Replica Set reconfigure without this node */
    mongoc_stream_failed (node->stream);
+   _mongoc_buffer_destroy (&node->buffer);
    bson_free (node->connection_address);
 
    bson_free (node);
@@ -1581,6 +1634,7 @@ _mongoc_cluster_node_new (mongoc_stream_t *stream,
    node->stream = stream;
    node->connection_address = bson_strdup (connection_address);
    node->timestamp = bson_get_monotonic_time ();
+   node->last_used = node->timestamp;
 
    node->max_wire_version = MONGOC_DEFAULT_WIRE_VERSION;
    node->min_wire_version = MONGOC_DEFAULT_WIRE_VERSION;
@@ -1595,35 +1649,35 @@ _mongoc_cluster_node_new (mongoc_stream_t *stream,
 /*
  *--------------------------------------------------------------------------
  *
- * mongoc_cluster_add_node --
- *
- *       Add a new node to this cluster for the given server description.
+ * _mongoc_cluster_node_connect --
  *
- *       NOTE: does NOT check if this server is already in the cluster.
+ *       Open a connection to the given server, run the handshake and
+ *       authenticate, without adding it to @cluster.
  *
  * Returns:
- *       A stream connected to the server, or NULL on failure.
+ *       A new node, or NULL on failure. Free it with
+ *       _mongoc_cluster_node_destroy.
  *
  * Side effects:
- *       Adds a cluster node, or sets error on failure.
+ *       Sets error on failure.
  *
  *--------------------------------------------------------------------------
  */
-static mongoc_stream_t *
-_mongoc_cluster_add_node (mongoc_cluster_t *cluster,
-                          uint32_t server_id,
-                          bson_error_t *error /* OUT */)
+mongoc_cluster_node_t *
+_mongoc_cluster_node_connect (mongoc_cluster_t *cluster,
+                              uint32_t server_id,
+                              bson_error_t *error /* OUT */)
 {
    mongoc_host_list_t *host = NULL;
    mongoc_cluster_node_t *cluster_node = NULL;
    mongoc_stream_t *stream;
    mongoc_server_description_t *sd;
    mongoc_handshake_sasl_supported_mechs_t sasl_supported_mechs;
+   int64_t generation;
 
    ENTRY;
 
    BSON_ASSERT (cluster);
-   BSON_ASSERT (!cluster->client->topology->single_threaded);
 
    host =
       _mongoc_topology_host_by_id (cluster->client->topology, server_id, error);
@@ -1632,6 +1686,11 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
       GOTO (error);
    }
 
+   /* read before connecting: if the server is invalidated meanwhile, the
+    * new node is already stale */
+   generation =
+      mongoc_topology_server_generation (cluster->client->topology, server_id);
+
    TRACE ("Adding new server to cluster: %s", host->host_and_port);
 
    stream = _mongoc_client_create_stream (cluster->client, host, error);
@@ -1644,6 +1703,7 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
 
    /* take critical fields from a fresh ismaster */
    cluster_node = _mongoc_cluster_node_new (stream, host->host_and_port);
+   cluster_node->generation = (uint32_t) generation;
 
    sd = _mongoc_cluster_run_ismaster (cluster, cluster_node, server_id, error);
    if (!sd) {
@@ -1665,10 +1725,9 @@ _mongoc_cluster_add_node (mongoc_cluster_t *cluster,
    }
    mongoc_server_description_destroy (sd);
 
-   mongoc_set_add (cluster->nodes, server_id, cluster_node);
    _mongoc_host_list_destroy_all (host);
 
-   RETURN (stream);
+   RETURN (cluster_node);
 
 error:
    _mongoc_host_list_destroy_all (host); /* null ok */
@@ -1680,6 +1739,46 @@ error:
    RETURN (NULL);
 }
 
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_add_node --
+ *
+ *       Add a new node to this cluster for the given server description.
+ *
+ *       NOTE: does NOT check if this server is already in the cluster.
+ *
+ * Returns:
+ *       A stream connected to the server, or NULL on failure.
+ *
+ * Side effects:
+ *       Adds a cluster node, or sets error on failure.
+ *
+ *--------------------------------------------------------------------------
+ */
+static mongoc_stream_t *
+_mongoc_cluster_add_node (mongoc_cluster_t *cluster,
+                          uint32_t server_id,
+                          bson_error_t *error /* OUT */)
+{
+   mongoc_cluster_node_t *cluster_node;
+
+   ENTRY;
+
+   BSON_ASSERT (cluster);
+   BSON_ASSERT (!cluster->client->topology->single_threaded);
+
+   cluster_node = _mongoc_cluster_node_connect (cluster, server_id, error);
+   if (!cluster_node) {
+      RETURN (NULL);
+   }
+
+   mongoc_set_add (cluster->nodes, server_id, cluster_node);
+
+   RETURN (cluster_node->stream);
+}
+
 static void
 node_not_found (mongoc_topology_t *topology,
                 uint32_t server_id,
@@ -1835,68 +1934,189 @@ mongoc_cluster_stream_for_server (mongoc_cluster_t *cluster,
 }
 
 
-static mongoc_server_stream_t *
-mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
-                                    uint32_t server_id,
-                                    bool reconnect_ok,
-                                    bson_error_t *error /* OUT */)
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_prune_nodes --
+ *
+ *       Drop pooled connections that are stale: opened before their
+ *       server's current connection generation, to a server no longer in
+ *       the topology, or idle for longer than maxIdleTimeMS. Only takes
+ *       the topology mutex if some server's generation changed since the
+ *       last call.
+ *
+ * Side effects:
+ *       Closes and removes stale nodes.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_cluster_prune_nodes (mongoc_cluster_t *cluster)
 {
    mongoc_topology_t *topology;
-   mongoc_server_description_t *sd;
-   mongoc_topology_scanner_node_t *scanner_node;
-   char *address;
+   mongoc_cluster_node_t *cluster_node;
+   int32_t generation;
+   int64_t server_generation;
+   int64_t idle_since = 0;
+   uint32_t server_id;
+   bool check_generation;
+   int i;
 
    topology = cluster->client->topology;
-   scanner_node =
-      mongoc_topology_scanner_get_node (topology->scanner, server_id);
-   BSON_ASSERT (scanner_node && !scanner_node->retired);
 
-   if (scanner_node->stream) {
-      sd = mongoc_topology_server_by_id (topology, server_id, error);
+   if (topology->single_threaded) {
+      return;
+   }
 
-      if (!sd) {
-         return NULL;
-      }
-   } else {
-      if (!reconnect_ok) {
-         stream_not_found (
-            topology, server_id, scanner_node->host.host_and_port, error);
-         return NULL;
-      }
+   /* cheap unless some server's generation changed since the last check */
+   generation = topology->scanner->generation;
+   check_generation = generation != cluster->generation;
 
-      /* save the scanner node address in case it is removed during the scan. */
-      address = bson_strdup (scanner_node->host.host_and_port);
-      _mongoc_topology_do_blocking_scan (topology, error);
-      if (error->code) {
-         bson_free (address);
-         return NULL;
-      }
+   if (cluster->maxidletimems) {
+      idle_since = bson_get_monotonic_time () -
+                   (int64_t) cluster->maxidletimems * 1000;
+   }
 
-      scanner_node =
-         mongoc_topology_scanner_get_node (topology->scanner, server_id);
+   if (!check_generation && !idle_since) {
+      return;
+   }
 
-      if (!scanner_node || !scanner_node->stream) {
-         stream_not_found (topology, server_id, address, error);
-         bson_free (address);
-         return NULL;
+   /* backwards, since removing a node shifts the ones after it */
+   for (i = (int) cluster->nodes->items_len - 1; i >= 0; i--) {
+      cluster_node = (mongoc_cluster_node_t *) mongoc_set_get_item_and_id (
+         cluster->nodes, i, &server_id);
+
+      if (check_generation) {
+         server_generation =
+            mongoc_topology_server_generation (topology, server_id);
+
+         if (server_generation != (int64_t) cluster_node->generation) {
+            mongoc_cluster_disconnect_node (
+               cluster, server_id, false /* invalidate */, NULL);
+            continue;
+         }
       }
-      bson_free (address);
 
-      sd = mongoc_topology_server_by_id (topology, server_id, error);
-      if (!sd) {
-         return NULL;
+      if (cluster_node->last_used < idle_since) {
+         mongoc_cluster_disconnect_node (
+            cluster, server_id, false /* invalidate */, NULL);
       }
    }
 
-   if (sd->type == MONGOC_SERVER_UNKNOWN) {
-      memcpy (error, &sd->error, sizeof *error);
-      mongoc_server_description_destroy (sd);
-      return NULL;
-   }
+   cluster->generation = generation;
+}
 
-   /* stream open but not auth'ed: first use since connect or reconnect */
-   if (cluster->requires_auth && !scanner_node->has_auth) {
-      if (!_mongoc_cluster_auth_node (cluster,
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_warm_node --
+ *
+ *       Connect and authenticate a pooled @cluster to @server_id ahead of
+ *       any operation, so that the next one can use the connection right
+ *       away. Unlike connecting for an operation, a failure does not mark
+ *       the server Unknown: no application operation depended on it, and
+ *       the scanner will notice if the server is down.
+ *
+ * Returns:
+ *       True if @cluster has a connection to @server_id on return.
+ *
+ * Side effects:
+ *       Sets @error on failure.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_cluster_warm_node (mongoc_cluster_t *cluster,
+                           uint32_t server_id,
+                           bson_error_t *error)
+{
+   mongoc_cluster_node_t *cluster_node;
+
+   ENTRY;
+
+   BSON_ASSERT (!cluster->client->topology->single_threaded);
+
+   if (mongoc_set_get (cluster->nodes, server_id)) {
+      RETURN (true);
+   }
+
+   cluster_node = _mongoc_cluster_node_connect (cluster, server_id, error);
+   if (!cluster_node) {
+      RETURN (false);
+   }
+
+   mongoc_set_add (cluster->nodes, server_id, cluster_node);
+
+   RETURN (true);
+}
+
+
+static mongoc_server_stream_t *
+mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
+                                    uint32_t server_id,
+                                    bool reconnect_ok,
+                                    bson_error_t *error /* OUT */)
+{
+   mongoc_topology_t *topology;
+   mongoc_server_description_t *sd;
+   mongoc_topology_scanner_node_t *scanner_node;
+   mongoc_server_stream_t *server_stream;
+   char *address;
+
+   topology = cluster->client->topology;
+   scanner_node =
+      mongoc_topology_scanner_get_node (topology->scanner, server_id);
+   BSON_ASSERT (scanner_node && !scanner_node->retired);
+
+   if (scanner_node->stream) {
+      sd = mongoc_topology_server_by_id (topology, server_id, error);
+
+      if (!sd) {
+         return NULL;
+      }
+   } else {
+      if (!reconnect_ok) {
+         stream_not_found (
+            topology, server_id, scanner_node->host.host_and_port, error);
+         return NULL;
+      }
+
+      /* save the scanner node address in case it is removed during the scan. */
+      address = bson_strdup (scanner_node->host.host_and_port);
+      _mongoc_topology_do_blocking_scan (topology, error);
+      if (error->code) {
+         bson_free (address);
+         return NULL;
+      }
+
+      scanner_node =
+         mongoc_topology_scanner_get_node (topology->scanner, server_id);
+
+      if (!scanner_node || !scanner_node->stream) {
+         stream_not_found (topology, server_id, address, error);
+         bson_free (address);
+         return NULL;
+      }
+      bson_free (address);
+
+      sd = mongoc_topology_server_by_id (topology, server_id, error);
+      if (!sd) {
+         return NULL;
+      }
+   }
+
+   if (sd->type == MONGOC_SERVER_UNKNOWN) {
+      memcpy (error, &sd->error, sizeof *error);
+      mongoc_server_description_destroy (sd);
+      return NULL;
+   }
+
+   /* stream open but not auth'ed: first use since connect or reconnect */
+   if (cluster->requires_auth && !scanner_node->has_auth) {
+      if (!_mongoc_cluster_auth_node (cluster,
                                       scanner_node->stream,
                                       sd,
                                       &scanner_node->sasl_supported_mechs,
@@ -1909,8 +2129,11 @@ mongoc_cluster_fetch_stream_single (mongoc_cluster_t *cluster,
       scanner_node->has_auth = true;
    }
 
-   return mongoc_server_stream_new (
-      &topology->description, sd, scanner_node->stream);
+   server_stream =
+      mongoc_server_stream_new (&topology->description, sd, scanner_node->stream);
+   server_stream->buffer = &scanner_node->buffer;
+
+   return server_stream;
 }
 
 
@@ -1949,43 +2172,41 @@ mongoc_cluster_fetch_stream_pooled (mongoc_cluster_t *cluster,
                                     bson_error_t *error /* OUT */)
 {
    mongoc_topology_t *topology;
-   mongoc_stream_t *stream;
    mongoc_cluster_node_t *cluster_node;
-   int64_t timestamp;
+   mongoc_server_stream_t *server_stream;
+
+   /* topology change, net error, or invalidation since a node's birth, or the
+    * node was idle too long: destroy it */
+   _mongoc_cluster_prune_nodes (cluster);
 
    cluster_node =
       (mongoc_cluster_node_t *) mongoc_set_get (cluster->nodes, server_id);
 
    topology = cluster->client->topology;
 
-   if (cluster_node) {
-      BSON_ASSERT (cluster_node->stream);
+   if (!cluster_node) {
+      /* no node, or out of date */
+      if (!reconnect_ok) {
+         node_not_found (topology, server_id, error);
+         return NULL;
+      }
 
-      timestamp = mongoc_topology_server_timestamp (topology, server_id);
-      if (timestamp == -1 || cluster_node->timestamp < timestamp) {
-         /* topology change or net error during background scan made us remove
-          * or replace server description since node's birth. destroy node. */
-         mongoc_cluster_disconnect_node (
-            cluster, server_id, false /* invalidate */, NULL);
-      } else {
-         return _mongoc_cluster_create_server_stream (
-            topology, server_id, cluster_node->stream, error);
+      if (!_mongoc_cluster_add_node (cluster, server_id, error)) {
+         return NULL;
       }
-   }
 
-   /* no node, or out of date */
-   if (!reconnect_ok) {
-      node_not_found (topology, server_id, error);
-      return NULL;
+      cluster_node =
+         (mongoc_cluster_node_t *) mongoc_set_get (cluster->nodes, server_id);
    }
 
-   stream = _mongoc_cluster_add_node (cluster, server_id, error);
-   if (stream) {
-      return _mongoc_cluster_create_server_stream (
-         topology, server_id, stream, error);
-   } else {
-      return NULL;
+   server_stream = _mongoc_cluster_create_server_stream (
+      topology, server_id, cluster_node->stream, error);
+   if (server_stream) {
+      server_stream->buffer = &cluster_node->buffer;
+      cluster_node->last_used = bson_get_monotonic_time ();
    }
+
+   return server_stream;
 }
 
 /*
@@ -2032,6 +2253,23 @@ mongoc_cluster_init (mongoc_cluster_t *cluster,
                                       MONGOC_URI_SOCKETCHECKINTERVALMS,
                                       MONGOC_TOPOLOGY_SOCKET_CHECK_INTERVAL_MS);
 
+   cluster->maxidletimems = (uint32_t) BSON_MAX (
+      0, mongoc_uri_get_option_as_int32 (uri, MONGOC_URI_MAXIDLETIMEMS, 0));
+
+   if (mongoc_uri_get_option_as_bool (uri, MONGOC_URI_HEDGEDREADS, false)) {
+      cluster->hedged_read_percentile = mongoc_uri_get_option_as_int32 (
+         uri,
+         MONGOC_URI_HEDGEDREADPERCENTILE,
+         MONGOC_DEFAULT_HEDGED_READ_PERCENTILE);
+      cluster->hedged_read_percentile =
+         BSON_MIN (BSON_MAX (cluster->hedged_read_percentile, 1), 100);
+   }
+
+   cluster->max_write_batches_in_flight = BSON_MAX (
+      1,
+      mongoc_uri_get_option_as_int32 (
+         uri, MONGOC_URI_MAXWRITEBATCHESINFLIGHT, 1));
+
    /* TODO for single-threaded case we don't need this */
    cluster->nodes = mongoc_set_new (8, _mongoc_cluster_node_dtor, NULL);
 
@@ -2072,11 +2310,7 @@ mongoc_cluster_destroy (mongoc_cluster_t *cluster) /* INOUT */
 
    _mongoc_array_destroy (&cluster->iov);
 
-#ifdef MONGOC_ENABLE_CRYPTO
-   if (cluster->scram_cache) {
-      _mongoc_scram_cache_destroy (cluster->scram_cache);
-   }
-#endif
+   mongoc_compressor_ctx_destroy (cluster->compressor);
 
    EXIT;
 }
@@ -2457,7 +2691,6 @@ mongoc_cluster_legacy_rpc_sendv_to_server (
    int32_t max_msg_size;
    bool ret = false;
    int32_t compressor_id = 0;
-   char *output = NULL;
 
    ENTRY;
 
@@ -2482,8 +2715,8 @@ mongoc_cluster_legacy_rpc_sendv_to_server (
    _mongoc_rpc_swab_to_le (rpc);
 
    if (compressor_id != -1) {
-      output = _mongoc_rpc_compress (cluster, compressor_id, rpc, error);
-      if (output == NULL) {
+      if (!_mongoc_rpc_compress (
+             cluster, compressor_id, server_id, rpc, error)) {
          GOTO (done);
       }
    }
@@ -2515,10 +2748,6 @@ mongoc_cluster_legacy_rpc_sendv_to_server (
 
 done:
 
-   if (compressor_id) {
-      bson_free (output);
-   }
-
    RETURN (ret);
 }
 
@@ -2686,18 +2915,33 @@ network_error_reply (bson_t *reply, mongoc_cmd_t *cmd)
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_send_opmsg --
+ *
+ *       Write @cmd to its server stream as an OP_MSG without waiting for
+ *       the reply. The new message's request id is stored in @request_id.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set. On failure
+ *       @reply, if not NULL, is initialized.
+ *
+ * Side effects:
+ *       On a network error the cluster disconnects from the server.
+ *
+ *--------------------------------------------------------------------------
+ */
+
 static bool
-mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
-                          mongoc_cmd_t *cmd,
-                          bson_t *reply,
-                          bson_error_t *error)
+_mongoc_cluster_send_opmsg (mongoc_cluster_t *cluster,
+                            mongoc_cmd_t *cmd,
+                            uint32_t *request_id,
+                            bson_t *reply,
+                            bson_error_t *error)
 {
    mongoc_rpc_section_t section[2];
-   mongoc_buffer_t buffer;
-   bson_t reply_local; /* only statically initialized */
-   char *output = NULL;
    mongoc_rpc_t rpc;
-   int32_t msg_len;
    bool ok;
    const mongoc_server_stream_t *server_stream;
 
@@ -2720,10 +2964,9 @@ mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
    }
 
    _mongoc_array_clear (&cluster->iov);
-   _mongoc_buffer_init (&buffer, NULL, 0, NULL, NULL);
 
    rpc.header.msg_len = 0;
-   rpc.header.request_id = ++cluster->request_id;
+   rpc.header.request_id = *request_id = ++cluster->request_id;
    rpc.header.response_to = 0;
    rpc.header.opcode = MONGOC_OPCODE_MSG;
 
@@ -2739,13 +2982,15 @@ mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
    section[0].payload.bson_document = bson_get_data (cmd->command);
    rpc.msg.sections[0] = section[0];
 
-   if (cmd->payload) {
+   if (cmd->payload || cmd->payload_iovcnt) {
       section[1].payload_type = 1;
       section[1].payload.sequence.size = cmd->payload_size +
                                          strlen (cmd->payload_identifier) + 1 +
                                          sizeof (int32_t);
       section[1].payload.sequence.identifier = cmd->payload_identifier;
       section[1].payload.sequence.bson_documents = cmd->payload;
+      section[1].payload.sequence.bson_documents_iov = cmd->payload_iov;
+      section[1].payload.sequence.bson_documents_iovcnt = cmd->payload_iovcnt;
       rpc.msg.sections[1] = section[1];
       rpc.msg.n_sections++;
    }
@@ -2760,10 +3005,12 @@ mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
       TRACE (
          "Function '%s' is compressible: %d", cmd->command_name, compressor_id);
       if (compressor_id != -1) {
-         output = _mongoc_rpc_compress (cluster, compressor_id, &rpc, error);
-         if (output == NULL) {
+         if (!_mongoc_rpc_compress (cluster,
+                                    compressor_id,
+                                    server_stream->sd->id,
+                                    &rpc,
+                                    error)) {
             _mongoc_bson_init_if_set (reply);
-            _mongoc_buffer_destroy (&buffer);
             return false;
          }
       }
@@ -2773,117 +3020,1244 @@ mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
                                     cluster->iov.len,
                                     cluster->sockettimeoutms,
                                     error);
+
    if (!ok) {
       /* add info about the command to writev_full's error message */
       RUN_CMD_ERR_DECORATE;
       mongoc_cluster_disconnect_node (
          cluster, server_stream->sd->id, true, error);
-      bson_free (output);
       network_error_reply (reply, cmd);
-      _mongoc_buffer_destroy (&buffer);
       return false;
    }
 
-   /* If acknowledged, wait for a server response. Otherwise, exit early */
-   if (cmd->is_acknowledged) {
-      ok = _mongoc_buffer_append_from_stream (
-         &buffer, server_stream->stream, 4, cluster->sockettimeoutms, error);
-      if (!ok) {
-         RUN_CMD_ERR_DECORATE;
-         mongoc_cluster_disconnect_node (
-            cluster, server_stream->sd->id, true, error);
-         bson_free (output);
-         network_error_reply (reply, cmd);
-         _mongoc_buffer_destroy (&buffer);
-         return false;
-      }
+   return true;
+}
 
-      BSON_ASSERT (buffer.len == 4);
-      memcpy (&msg_len, buffer.data, 4);
-      msg_len = BSON_UINT32_FROM_LE (msg_len);
-      if ((msg_len < 16) || (msg_len > server_stream->sd->max_msg_size)) {
-         RUN_CMD_ERR (
-            MONGOC_ERROR_PROTOCOL,
-            MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
-            "Message size %d is not within expected range 16-%d bytes",
-            msg_len,
-            server_stream->sd->max_msg_size);
-         mongoc_cluster_disconnect_node (
-            cluster, server_stream->sd->id, true, error);
-         bson_free (output);
-         network_error_reply (reply, cmd);
-         _mongoc_buffer_destroy (&buffer);
-         return false;
-      }
 
-      ok = _mongoc_buffer_append_from_stream (&buffer,
-                                              server_stream->stream,
-                                              (size_t) msg_len - 4,
-                                              cluster->sockettimeoutms,
-                                              error);
-      if (!ok) {
-         RUN_CMD_ERR_DECORATE;
-         mongoc_cluster_disconnect_node (
-            cluster, server_stream->sd->id, true, error);
-         bson_free (output);
-         network_error_reply (reply, cmd);
-         _mongoc_buffer_destroy (&buffer);
-         return false;
-      }
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_read_opmsg --
+ *
+ *       Read the next whole message from @cmd's server stream into the
+ *       start of @buffer, which must be initialized and hold nothing but
+ *       the start of that message, if any. Every read asks for as many
+ *       bytes as fit in @buffer, so a small reply usually arrives in one
+ *       call to recv (), and bytes of the message after it may follow
+ *       it in @buffer. The message's length is stored in @msg_len.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       On failure the cluster disconnects from the server.
+ *
+ *--------------------------------------------------------------------------
+ */
 
-      ok = _mongoc_rpc_scatter (&rpc, buffer.data, buffer.len);
-      if (!ok) {
-         RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
-                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
-                      "Malformed message from server");
-         bson_free (output);
-         network_error_reply (reply, cmd);
-         _mongoc_buffer_destroy (&buffer);
-         return false;
-      }
-      if (BSON_UINT32_FROM_LE (rpc.header.opcode) == MONGOC_OPCODE_COMPRESSED) {
-         size_t len = BSON_UINT32_FROM_LE (rpc.compressed.uncompressed_size) +
-                      sizeof (mongoc_rpc_header_t);
+static bool
+_mongoc_cluster_read_opmsg (mongoc_cluster_t *cluster,
+                            mongoc_cmd_t *cmd,
+                            mongoc_buffer_t *buffer,
+                            int32_t *msg_len,
+                            bson_error_t *error)
+{
+   const mongoc_server_stream_t *server_stream;
 
-         output = bson_realloc (output, len);
-         if (!_mongoc_rpc_decompress (&rpc, (uint8_t *) output, len)) {
-            RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
-                         MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
-                         "Could not decompress message from server");
-            mongoc_cluster_disconnect_node (
-               cluster, server_stream->sd->id, true, error);
-            bson_free (output);
-            network_error_reply (reply, cmd);
-            _mongoc_buffer_destroy (&buffer);
-            return false;
-         }
-      }
-      _mongoc_rpc_swab_from_le (&rpc);
+   server_stream = cmd->server_stream;
+
+   if (_mongoc_buffer_fill (buffer,
+                            server_stream->stream,
+                            4,
+                            cluster->sockettimeoutms,
+                            error) == -1) {
+      RUN_CMD_ERR (MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_SOCKET,
+                   "Failed to read 4 bytes: socket error or timeout");
+      mongoc_cluster_disconnect_node (
+         cluster, server_stream->sd->id, true, error);
+      return false;
+   }
+
+   memcpy (msg_len, buffer->data, 4);
+   *msg_len = BSON_UINT32_FROM_LE (*msg_len);
+   if ((*msg_len < 16) || (*msg_len > server_stream->sd->max_msg_size)) {
+      RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                   MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                   "Message size %d is not within expected range 16-%d bytes",
+                   *msg_len,
+                   server_stream->sd->max_msg_size);
+      mongoc_cluster_disconnect_node (
+         cluster, server_stream->sd->id, true, error);
+      return false;
+   }
 
-      memcpy (&msg_len, rpc.msg.sections[0].payload.bson_document, 4);
-      msg_len = BSON_UINT32_FROM_LE (msg_len);
-      bson_init_static (
-         &reply_local, rpc.msg.sections[0].payload.bson_document, msg_len);
+   if (_mongoc_buffer_fill (buffer,
+                            server_stream->stream,
+                            (size_t) *msg_len,
+                            cluster->sockettimeoutms,
+                            error) == -1) {
+      RUN_CMD_ERR (MONGOC_ERROR_STREAM,
+                   MONGOC_ERROR_STREAM_SOCKET,
+                   "Failed to read %d bytes: socket error or timeout",
+                   *msg_len - 4);
+      mongoc_cluster_disconnect_node (
+         cluster, server_stream->sd->id, true, error);
+      return false;
+   }
 
-      _mongoc_topology_update_cluster_time (cluster->client->topology,
-                                            &reply_local);
-      ok = _mongoc_cmd_check_ok (
-         &reply_local, cluster->client->error_api_version, error);
+   return true;
+}
 
-      if (cmd->session) {
-         _mongoc_client_session_handle_reply (
-            cmd->session, cmd->is_acknowledged, &reply_local);
-      }
 
-      if (reply) {
-         bson_copy_to (&reply_local, reply);
-      }
-   } else {
-      _mongoc_bson_init_if_set (reply);
+/* drop the @msg_len byte message at the start of a connection's receive
+ * buffer, keeping any bytes read after it */
+static void
+_mongoc_cluster_consume_recv_buffer (mongoc_buffer_t *buffer, size_t msg_len)
+{
+   BSON_ASSERT (buffer->len >= msg_len);
+   buffer->len -= msg_len;
+
+   if (buffer->len) {
+      memmove (buffer->data, buffer->data + msg_len, buffer->len);
+   } else if (buffer->datalen > MONGOC_CLUSTER_RECV_BUFFER_SIZE) {
+      _mongoc_buffer_destroy (buffer);
    }
+}
 
-   _mongoc_buffer_destroy (&buffer);
-   bson_free (output);
 
-   return ok;
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_release_recv_buffer --
+ *
+ *       Done with the @msg_len byte message at the start of @buffer. If
+ *       @buffer is the connection's receive buffer, keep any bytes read
+ *       after the message, and free the buffer if it grew beyond the
+ *       default size. Otherwise free @buffer.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_cluster_release_recv_buffer (
+   const mongoc_server_stream_t *server_stream,
+   mongoc_buffer_t *buffer,
+   size_t msg_len)
+{
+   if (buffer != server_stream->buffer || !buffer->data) {
+      _mongoc_buffer_destroy (buffer);
+      return;
+   }
+
+   _mongoc_cluster_consume_recv_buffer (buffer, msg_len);
+}
+
+
+/* the "responseTo" field of a whole message read by
+ * _mongoc_cluster_read_opmsg */
+static uint32_t
+_mongoc_cluster_response_to (const uint8_t *msg)
+{
+   uint32_t response_to;
+
+   memcpy (&response_to, msg + 8, 4);
+
+   return BSON_UINT32_FROM_LE (response_to);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_node_discard_reply --
+ *
+ *       Read and drop the reply to @request_id on @node, the slower of
+ *       a hedged read's two, if it has begun to arrive. Never waits for
+ *       it to begin, but waits up to "socketTimeoutMS" for the rest.
+ *
+ * Returns:
+ *       false if @node can't be used again: reading failed, or a reply
+ *       to another request arrived. Otherwise true, and sets @discarded
+ *       to whether the reply was read.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+_mongoc_cluster_node_discard_reply (mongoc_cluster_t *cluster,
+                                    mongoc_cluster_node_t *node,
+                                    uint32_t request_id,
+                                    bool *discarded)
+{
+   mongoc_buffer_t *buffer = &node->buffer;
+   mongoc_stream_poll_t poller;
+   bson_error_t error;
+   int32_t msg_len;
+
+   *discarded = false;
+
+   /* bytes already buffered belong to the reply, else ask the socket */
+   if (!buffer->data || !buffer->len) {
+      poller.stream = node->stream;
+      poller.events = POLLIN;
+      poller.revents = 0;
+      if (mongoc_stream_poll (&poller, 1, 0) < 0) {
+         return false;
+      }
+
+      if (!poller.revents) {
+         return true;
+      }
+   }
+
+   if (!buffer->data) {
+      _mongoc_buffer_init (
+         buffer, NULL, MONGOC_CLUSTER_RECV_BUFFER_SIZE, NULL, NULL);
+   }
+
+   if (_mongoc_buffer_fill (
+          buffer, node->stream, 4, cluster->sockettimeoutms, &error) == -1) {
+      return false;
+   }
+
+   memcpy (&msg_len, buffer->data, 4);
+   msg_len = BSON_UINT32_FROM_LE (msg_len);
+   if (msg_len < 16 || msg_len > node->max_msg_size) {
+      return false;
+   }
+
+   if (_mongoc_buffer_fill (buffer,
+                            node->stream,
+                            (size_t) msg_len,
+                            cluster->sockettimeoutms,
+                            &error) == -1 ||
+       _mongoc_cluster_response_to (buffer->data) != request_id) {
+      return false;
+   }
+
+   _mongoc_cluster_consume_recv_buffer (buffer, (size_t) msg_len);
+   *discarded = true;
+
+   return true;
+}
+
+
+static bool
+_mongoc_cluster_pipeline_is_in_flight (mongoc_cluster_pipeline_t *pipeline,
+                                       uint32_t request_id)
+{
+   size_t i;
+
+   for (i = 0; i < pipeline->in_flight.len; i++) {
+      if (_mongoc_array_index (&pipeline->in_flight, uint32_t, i) ==
+          request_id) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+static void
+_mongoc_cluster_pipeline_remove_in_flight (
+   mongoc_cluster_pipeline_t *pipeline, uint32_t request_id)
+{
+   uint32_t *ids;
+   size_t i;
+
+   ids = (uint32_t *) pipeline->in_flight.data;
+
+   for (i = 0; i < pipeline->in_flight.len; i++) {
+      if (ids[i] == request_id) {
+         memmove (&ids[i],
+                  &ids[i + 1],
+                  (pipeline->in_flight.len - i - 1) * sizeof (uint32_t));
+         pipeline->in_flight.len--;
+         return;
+      }
+   }
+}
+
+
+/* after the connection is lost, fail all later operations with @error */
+static void
+_mongoc_cluster_pipeline_fail (mongoc_cluster_pipeline_t *pipeline,
+                               const bson_error_t *error)
+{
+   if (pipeline && !pipeline->failed) {
+      pipeline->failed = true;
+      memcpy (&pipeline->error, error, sizeof *error);
+   }
+}
+
+
+/* if a reply to @request_id was read earlier, move it into @buffer */
+static bool
+_mongoc_cluster_pipeline_unstash (mongoc_cluster_pipeline_t *pipeline,
+                                  uint32_t request_id,
+                                  mongoc_buffer_t *buffer)
+{
+   mongoc_buffer_t *stashed;
+   size_t i;
+
+   stashed = (mongoc_buffer_t *) pipeline->stashed.data;
+
+   for (i = 0; i < pipeline->stashed.len; i++) {
+      if (_mongoc_cluster_response_to (stashed[i].data) == request_id) {
+         *buffer = stashed[i];
+         memmove (&stashed[i],
+                  &stashed[i + 1],
+                  (pipeline->stashed.len - i - 1) * sizeof (mongoc_buffer_t));
+         pipeline->stashed.len--;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+/* keep a copy of the reply at the start of @buffer, the connection's
+ * receive buffer, for when it is asked for */
+static void
+_mongoc_cluster_pipeline_stash (mongoc_cluster_pipeline_t *pipeline,
+                                const mongoc_server_stream_t *server_stream,
+                                mongoc_buffer_t *buffer,
+                                int32_t msg_len)
+{
+   mongoc_buffer_t stashed;
+
+   TRACE ("Stashing reply to pipelined request %u",
+          _mongoc_cluster_response_to (buffer->data));
+   _mongoc_buffer_init (&stashed, NULL, (size_t) msg_len, NULL, NULL);
+   _mongoc_buffer_append (&stashed, buffer->data, (size_t) msg_len);
+   _mongoc_array_append_val (&pipeline->stashed, stashed);
+   _mongoc_cluster_release_recv_buffer (
+      server_stream, buffer, (size_t) msg_len);
+   if (!buffer->data) {
+      _mongoc_buffer_init (
+         buffer, NULL, MONGOC_CLUSTER_RECV_BUFFER_SIZE, NULL, NULL);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_pipeline_stash_ready --
+ *
+ *       Read and stash the replies to @pipeline's requests that have
+ *       already begun to arrive, without waiting for others. The server
+ *       writes a reply before it reads the next request, so a reply left
+ *       unread while we write a large request can block both sides.
+ *
+ * Returns:
+ *       true if successful; otherwise false, @error is set and the
+ *       pipeline has failed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cluster_pipeline_stash_ready (mongoc_cluster_pipeline_t *pipeline,
+                                      mongoc_cmd_t *cmd,
+                                      bson_error_t *error)
+{
+   mongoc_cluster_t *cluster = pipeline->cluster;
+   const mongoc_server_stream_t *server_stream = cmd->server_stream;
+   mongoc_buffer_t *buffer = server_stream->buffer;
+   mongoc_stream_poll_t poller;
+   uint32_t response_to;
+   int32_t msg_len;
+
+   if (!buffer) {
+      return true;
+   }
+
+   while (pipeline->in_flight.len > pipeline->stashed.len) {
+      /* bytes already buffered belong to a reply, else ask the socket */
+      if (!buffer->data || !buffer->len) {
+         poller.stream = server_stream->stream;
+         poller.events = POLLIN;
+         poller.revents = 0;
+         if (mongoc_stream_poll (&poller, 1, 0) <= 0 || !poller.revents) {
+            break;
+         }
+      }
+
+      if (!buffer->data) {
+         _mongoc_buffer_init (
+            buffer, NULL, MONGOC_CLUSTER_RECV_BUFFER_SIZE, NULL, NULL);
+      }
+
+      if (!_mongoc_cluster_read_opmsg (cluster, cmd, buffer, &msg_len, error)) {
+         _mongoc_cluster_pipeline_fail (pipeline, error);
+         return false;
+      }
+
+      response_to = _mongoc_cluster_response_to (buffer->data);
+      if (!_mongoc_cluster_pipeline_is_in_flight (pipeline, response_to)) {
+         RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Invalid responseTo %u for a pipelined request",
+                      response_to);
+         mongoc_cluster_disconnect_node (
+            cluster, server_stream->sd->id, true, error);
+         _mongoc_cluster_pipeline_fail (pipeline, error);
+         return false;
+      }
+
+      _mongoc_cluster_pipeline_stash (pipeline, server_stream, buffer, msg_len);
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_recv_opmsg --
+ *
+ *       Read the reply to the OP_MSG @request_id, which was sent for
+ *       @cmd with _mongoc_cluster_send_opmsg.
+ *
+ *       If @pipeline is not NULL, replies to its other in-flight requests
+ *       that arrive first are stashed in it. Otherwise, a reply to any
+ *       other request is a protocol error.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       @reply is set and should ALWAYS be released with bson_destroy().
+ *       On a network or protocol error the cluster disconnects from the
+ *       server.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cluster_recv_opmsg (mongoc_cluster_t *cluster,
+                            mongoc_cmd_t *cmd,
+                            uint32_t request_id,
+                            mongoc_cluster_pipeline_t *pipeline,
+                            bson_t *reply,
+                            bson_error_t *error)
+{
+   mongoc_buffer_t buffer_local;
+   mongoc_buffer_t stashed;
+   mongoc_buffer_t *buffer;
+   bson_t reply_local; /* only statically initialized */
+   uint8_t *output = NULL;
+   size_t output_len = 0;
+   uint8_t *doc;
+   mongoc_rpc_t rpc;
+   int32_t msg_len;
+   int32_t doc_len;
+   uint32_t response_to;
+   bool ok;
+   const mongoc_server_stream_t *server_stream;
+
+   server_stream = cmd->server_stream;
+
+   if (pipeline &&
+       _mongoc_cluster_pipeline_unstash (pipeline, request_id, &stashed)) {
+      buffer = &stashed;
+      msg_len = (int32_t) stashed.len;
+   } else {
+      /* streams used only for a handshake have no receive buffer */
+      buffer = server_stream->buffer ? server_stream->buffer : &buffer_local;
+      if (buffer == &buffer_local || !buffer->data) {
+         _mongoc_buffer_init (
+            buffer, NULL, MONGOC_CLUSTER_RECV_BUFFER_SIZE, NULL, NULL);
+      }
+
+      for (;;) {
+         if (!_mongoc_cluster_read_opmsg (
+                cluster, cmd, buffer, &msg_len, error)) {
+            _mongoc_cluster_pipeline_fail (pipeline, error);
+            network_error_reply (reply, cmd);
+            if (buffer == &buffer_local) {
+               _mongoc_buffer_destroy (buffer);
+            }
+
+            return false;
+         }
+
+         response_to = _mongoc_cluster_response_to (buffer->data);
+         if (response_to == request_id) {
+            break;
+         }
+
+         if (pipeline &&
+             _mongoc_cluster_pipeline_is_in_flight (pipeline, response_to)) {
+            _mongoc_cluster_pipeline_stash (
+               pipeline, server_stream, buffer, msg_len);
+            continue;
+         }
+
+         RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Invalid responseTo. Expected %u, got %u",
+                      request_id,
+                      response_to);
+         mongoc_cluster_disconnect_node (
+            cluster, server_stream->sd->id, true, error);
+         _mongoc_cluster_pipeline_fail (pipeline, error);
+         network_error_reply (reply, cmd);
+         if (buffer == &buffer_local) {
+            _mongoc_buffer_destroy (buffer);
+         }
+
+         return false;
+      }
+   }
+
+   if (pipeline) {
+      _mongoc_cluster_pipeline_remove_in_flight (pipeline, request_id);
+   }
+
+   ok = _mongoc_rpc_scatter (&rpc, buffer->data, (size_t) msg_len);
+   if (!ok) {
+      RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                   MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                   "Malformed message from server");
+      network_error_reply (reply, cmd);
+      _mongoc_cluster_release_recv_buffer (
+         server_stream, buffer, (size_t) msg_len);
+      return false;
+   }
+   if (BSON_UINT32_FROM_LE (rpc.header.opcode) == MONGOC_OPCODE_COMPRESSED) {
+      output_len = BSON_UINT32_FROM_LE (rpc.compressed.uncompressed_size) +
+                   sizeof (mongoc_rpc_header_t);
+
+      output = bson_malloc (output_len);
+      if (!_mongoc_rpc_decompress (&rpc, output, output_len)) {
+         RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                      MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                      "Could not decompress message from server");
+         mongoc_cluster_disconnect_node (
+            cluster, server_stream->sd->id, true, error);
+         _mongoc_cluster_pipeline_fail (pipeline, error);
+         bson_free (output);
+         network_error_reply (reply, cmd);
+         if (buffer != server_stream->buffer) {
+            _mongoc_buffer_destroy (buffer);
+         }
+
+         return false;
+      }
+   }
+   _mongoc_rpc_swab_from_le (&rpc);
+
+   doc = (uint8_t *) rpc.msg.sections[0].payload.bson_document;
+   memcpy (&doc_len, doc, 4);
+   doc_len = BSON_UINT32_FROM_LE (doc_len);
+   if (!bson_init_static (&reply_local, doc, (size_t) doc_len)) {
+      RUN_CMD_ERR (MONGOC_ERROR_PROTOCOL,
+                   MONGOC_ERROR_PROTOCOL_INVALID_REPLY,
+                   "Malformed message from server");
+      bson_free (output);
+      network_error_reply (reply, cmd);
+      _mongoc_cluster_release_recv_buffer (
+         server_stream, buffer, (size_t) msg_len);
+      return false;
+   }
+
+   _mongoc_topology_update_cluster_time (cluster->client->topology,
+                                         &reply_local);
+   ok = _mongoc_cmd_check_ok (
+      &reply_local, cluster->client->error_api_version, error);
+
+   if (cmd->session) {
+      _mongoc_client_session_handle_reply (
+         cmd->session, cmd->is_acknowledged, &reply_local);
+   }
+
+   /* hand the memory holding the reply to the caller instead of copying
+    * it, so cursors iterate batches directly in the bytes we received. The
+    * connection's receive buffer is only handed over if this reply made it
+    * grow and nothing was read after it, otherwise we keep it for reuse. */
+   if (reply) {
+      if (output) {
+         BSON_ASSERT (bson_init_with_buffer (
+            reply, output, output_len, (size_t) (doc - output)));
+         output = NULL;
+      } else if (buffer != server_stream->buffer ||
+                 (buffer->datalen > MONGOC_CLUSTER_RECV_BUFFER_SIZE &&
+                  buffer->len == (size_t) msg_len)) {
+         BSON_ASSERT (bson_init_with_buffer (reply,
+                                             buffer->data,
+                                             buffer->datalen,
+                                             (size_t) (doc - buffer->data)));
+         buffer->data = NULL;
+      } else {
+         bson_copy_to (&reply_local, reply);
+      }
+   }
+
+   _mongoc_cluster_release_recv_buffer (
+      server_stream, buffer, (size_t) msg_len);
+   bson_free (output);
+
+   return ok;
+}
+
+
+static bool
+mongoc_cluster_run_opmsg (mongoc_cluster_t *cluster,
+                          mongoc_cmd_t *cmd,
+                          bson_t *reply,
+                          bson_error_t *error)
+{
+   uint32_t request_id;
+
+   if (!_mongoc_cluster_send_opmsg (cluster, cmd, &request_id, reply, error)) {
+      return false;
+   }
+
+   /* If acknowledged, wait for a server response. Otherwise, exit early */
+   if (!cmd->is_acknowledged) {
+      _mongoc_bson_init_if_set (reply);
+      return true;
+   }
+
+   return _mongoc_cluster_recv_opmsg (
+      cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+}
+
+
+/* whether @cmd is a find that returns all its results in its reply, and so
+ * leaves no cursor open on a server whose reply is abandoned */
+static bool
+_mongoc_cluster_cmd_is_single_batch_find (const mongoc_cmd_t *cmd)
+{
+   bson_iter_t iter;
+
+   return !strcmp (cmd->command_name, "find") &&
+          bson_iter_init_find (&iter, cmd->command, "singleBatch") &&
+          bson_iter_as_bool (&iter);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_hedge_delay_msec --
+ *
+ *       If hedged reads are enabled and @cmd is a read that may be hedged,
+ *       how long to wait for a reply from its server before also sending
+ *       it to another: "hedgedReadPercentile" of the server's recent
+ *       operation latencies.
+ *
+ *       Only single-batch finds are hedged: the server whose reply isn't
+ *       used would otherwise keep a cursor open that no one kills. Nor
+ *       are reads that must follow an operation of a causally consistent
+ *       session, since the hedge is sent without the session.
+ *
+ * Returns:
+ *       The delay, or -1 not to hedge @cmd.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static int32_t
+_mongoc_cluster_hedge_delay_msec (mongoc_cluster_t *cluster,
+                                  const mongoc_cmd_t *cmd)
+{
+   const mongoc_server_stream_t *server_stream = cmd->server_stream;
+   mongoc_read_mode_t mode;
+   int64_t delay_usec;
+   bson_iter_t iter;
+   bson_iter_t child;
+
+   if (!cluster->hedged_read_percentile || !cmd->hedge_read_prefs ||
+       !cmd->is_acknowledged || cmd->payload || cmd->payload_iovcnt ||
+       _mongoc_client_session_in_txn (cmd->session) ||
+       !_mongoc_cluster_cmd_is_single_batch_find (cmd)) {
+      return -1;
+   }
+
+   if (bson_iter_init (&iter, cmd->command) &&
+       bson_iter_find_descendant (
+          &iter, "readConcern.afterClusterTime", &child)) {
+      return -1;
+   }
+
+   /* a reply to a pipelined request is already waiting */
+   if (server_stream->buffer && server_stream->buffer->len) {
+      return -1;
+   }
+
+   mode = mongoc_read_prefs_get_mode (cmd->hedge_read_prefs);
+   if (mode != MONGOC_READ_SECONDARY_PREFERRED && mode != MONGOC_READ_NEAREST) {
+      return -1;
+   }
+
+   delay_usec = mongoc_server_description_latency_percentile (
+      server_stream->sd, cluster->hedged_read_percentile);
+   if (delay_usec < 0) {
+      /* too few operations yet to tell what's slow for this server */
+      return -1;
+   }
+
+   return (int32_t) BSON_MIN ((delay_usec + 999) / 1000, INT32_MAX);
+}
+
+
+/* whether a failed read left the connection unusable */
+static bool
+_mongoc_cluster_is_connection_error (const bson_error_t *error)
+{
+   return error->domain == MONGOC_ERROR_STREAM ||
+          error->domain == MONGOC_ERROR_PROTOCOL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_cluster_run_opmsg_hedged --
+ *
+ *       Like mongoc_cluster_run_opmsg, but if no reply arrives within
+ *       @delay_msec, also send @cmd to another server suitable for its
+ *       read preference, on an idle second connection, and use whichever
+ *       reply arrives first. If the first server's reply wins, the hedge
+ *       connection stays idle and drops the other reply when it arrives;
+ *       if the hedge wins, the first server's connection is closed. If
+ *       the first reply is a network error, wait for the other. Waits no
+ *       longer than "socketTimeoutMS" in all.
+ *
+ *       The hedge is sent without @cmd's session, which must not be used
+ *       on two servers at once. If there is no idle connection to hedge
+ *       on, @cmd is not hedged, and one is requested for the next slow
+ *       read; see _mongoc_client_async_want_node.
+ *
+ * Side effects:
+ *       Sets @cmd->reply_server_id to the server whose reply is used.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_cluster_run_opmsg_hedged (mongoc_cluster_t *cluster,
+                                  mongoc_cmd_t *cmd,
+                                  int32_t delay_msec,
+                                  bson_t *reply,
+                                  bson_error_t *error)
+{
+   mongoc_client_t *client = cluster->client;
+   mongoc_cluster_node_t *node = NULL;
+   mongoc_server_stream_t *hedge_stream = NULL;
+   mongoc_stream_poll_t poller[2];
+   mongoc_cmd_t hedge_cmd;
+   bson_t hedge_command;
+   uint32_t server_id;
+   uint32_t hedge_server_id;
+   uint32_t request_id;
+   uint32_t hedge_request_id;
+   int64_t started;
+   int64_t hedge_started;
+   int64_t timeout_msec = -1;
+   bson_error_t hedge_error;
+   ssize_t n_ready;
+   bool hedge_first;
+   bool hedge_conn_ok = false;
+   bool hedge_pending = false;
+   bool ret;
+
+   server_id = cmd->server_stream->sd->id;
+   started = bson_get_monotonic_time ();
+
+   if (!_mongoc_cluster_send_opmsg (cluster, cmd, &request_id, reply, error)) {
+      return false;
+   }
+
+   poller[0].stream = cmd->server_stream->stream;
+   poller[0].events = POLLIN;
+   poller[0].revents = 0;
+
+   /* if polling fails, just wait for the reply */
+   if (mongoc_stream_poll (poller, 1, delay_msec) != 0) {
+      return _mongoc_cluster_recv_opmsg (
+         cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+   }
+
+   hedge_server_id = _mongoc_topology_select_hedge_server_id (
+      client->topology, cmd->hedge_read_prefs, server_id);
+   if (!hedge_server_id) {
+      return _mongoc_cluster_recv_opmsg (
+         cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+   }
+
+   node = _mongoc_client_async_checkout_node (client, hedge_server_id);
+   if (!node) {
+      _mongoc_client_async_want_node (client, hedge_server_id);
+      return _mongoc_cluster_recv_opmsg (
+         cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+   }
+
+   hedge_stream = _mongoc_cluster_create_server_stream (
+      client->topology, hedge_server_id, node->stream, &hedge_error);
+
+   if (hedge_stream) {
+      hedge_stream->buffer = &node->buffer;
+
+      bson_init (&hedge_command);
+      bson_copy_to_excluding_noinit (
+         cmd->command, &hedge_command, "lsid", "$clusterTime", NULL);
+
+      hedge_cmd = *cmd;
+      hedge_cmd.command = &hedge_command;
+      hedge_cmd.session = NULL;
+      hedge_cmd.server_stream = hedge_stream;
+
+      if (!_mongoc_cluster_send_opmsg (
+             cluster, &hedge_cmd, &hedge_request_id, NULL, &hedge_error)) {
+         bson_destroy (&hedge_command);
+         mongoc_server_stream_cleanup (hedge_stream);
+         hedge_stream = NULL;
+      }
+   }
+
+   if (!hedge_stream) {
+      _mongoc_cluster_node_destroy (node);
+
+      return _mongoc_cluster_recv_opmsg (
+         cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+   }
+
+   TRACE ("hedging read after %" PRId32 "ms: server %" PRIu32 " then %" PRIu32,
+          delay_msec,
+          server_id,
+          hedge_server_id);
+
+   mongoc_server_description_op_started (hedge_stream->sd);
+   hedge_started = bson_get_monotonic_time ();
+
+   poller[1].stream = node->stream;
+   poller[1].events = POLLIN;
+   poller[1].revents = 0;
+
+   /* sockettimeoutms=0 means no timeout */
+   if (cluster->sockettimeoutms) {
+      timeout_msec = BSON_MAX (
+         (int64_t) cluster->sockettimeoutms -
+            (bson_get_monotonic_time () - started) / 1000,
+         0);
+   }
+
+   n_ready = mongoc_stream_poll (
+      poller, 2, (int32_t) BSON_MIN (timeout_msec, INT32_MAX));
+
+   if (n_ready == 0) {
+      bson_set_error (error,
+                      MONGOC_ERROR_STREAM,
+                      MONGOC_ERROR_STREAM_SOCKET,
+                      "socket timeout awaiting hedged read from servers "
+                      "%" PRIu32 " and %" PRIu32,
+                      server_id,
+                      hedge_server_id);
+      mongoc_cluster_disconnect_node (cluster, server_id, true, error);
+      network_error_reply (reply, cmd);
+      ret = false;
+      GOTO (done);
+   }
+
+   /* the first server wins ties, and reports errors */
+   hedge_first = n_ready > 0 && !poller[0].revents && poller[1].revents;
+
+   if (hedge_first) {
+      ret = _mongoc_cluster_recv_opmsg (
+         cluster, &hedge_cmd, hedge_request_id, NULL, reply, error);
+
+      if (ret || !_mongoc_cluster_is_connection_error (error)) {
+         cmd->reply_server_id = hedge_server_id;
+         hedge_conn_ok = true;
+
+         /* the session still learns the cluster and operation time */
+         if (cmd->session) {
+            _mongoc_client_session_handle_reply (cmd->session, true, reply);
+         }
+      } else {
+         bson_destroy (reply);
+         ret = _mongoc_cluster_recv_opmsg (
+            cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+      }
+   } else {
+      ret = _mongoc_cluster_recv_opmsg (
+         cluster, cmd, request_id, NULL /* pipeline */, reply, error);
+
+      if (!ret && _mongoc_cluster_is_connection_error (error)) {
+         bson_destroy (reply);
+         ret = _mongoc_cluster_recv_opmsg (
+            cluster, &hedge_cmd, hedge_request_id, NULL, reply, error);
+         cmd->reply_server_id = hedge_server_id;
+         hedge_conn_ok = ret || !_mongoc_cluster_is_connection_error (error);
+
+         if (cmd->session && hedge_conn_ok) {
+            _mongoc_client_session_handle_reply (cmd->session, true, reply);
+         }
+      } else {
+         hedge_pending = true;
+      }
+   }
+
+   if (cmd->reply_server_id == hedge_server_id) {
+      /* the first server's reply would be read by its connection's next
+       * operation, cancel it */
+      mongoc_cluster_disconnect_node (cluster, server_id, false, NULL);
+   }
+
+done:
+   /* a latency sample only if the hedge's reply was read */
+   if (hedge_conn_ok) {
+      mongoc_server_description_op_finished (
+         hedge_stream->sd, bson_get_monotonic_time () - hedge_started);
+   } else {
+      mongoc_server_description_op_abandoned (hedge_stream->sd);
+   }
+
+   if (hedge_conn_ok) {
+      _mongoc_client_async_checkin_node (client, hedge_server_id, node);
+   } else if (hedge_pending) {
+      /* its reply is dropped when it arrives, by the node's next checkout */
+      _mongoc_client_async_checkin_node_discarding (
+         client,
+         hedge_server_id,
+         node,
+         hedge_request_id,
+         cluster->sockettimeoutms
+            ? hedge_started + (int64_t) cluster->sockettimeoutms * 1000
+            : 0);
+   } else {
+      /* cancels the hedged read if it's still in flight */
+      _mongoc_cluster_node_destroy (node);
+   }
+
+   bson_destroy (&hedge_command);
+   mongoc_server_stream_cleanup (hedge_stream);
+
+   return ret;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_init --
+ *
+ *       Prepare to send several OP_MSGs on @server_stream before reading
+ *       any of their replies. The caller must keep @server_stream alive
+ *       until the pipeline is destroyed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_cluster_pipeline_init (mongoc_cluster_pipeline_t *pipeline,
+                               mongoc_cluster_t *cluster,
+                               mongoc_server_stream_t *server_stream)
+{
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (cluster);
+   BSON_ASSERT (server_stream);
+
+   pipeline->cluster = cluster;
+   pipeline->server_stream = server_stream;
+   pipeline->failed = false;
+   memset (&pipeline->error, 0, sizeof pipeline->error);
+   _mongoc_array_init (&pipeline->in_flight, sizeof (uint32_t));
+   _mongoc_array_init (&pipeline->stashed, sizeof (mongoc_buffer_t));
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_send --
+ *
+ *       Write @cmd to the pipeline's server stream as an OP_MSG without
+ *       waiting for the reply. @cmd must have been created for the
+ *       pipeline's server stream. If @cmd is acknowledged, its reply
+ *       must later be read with mongoc_cluster_pipeline_recv, passing
+ *       the @request_id set here. Replies to earlier requests that have
+ *       begun to arrive are read and stashed first.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set. Once an
+ *       operation on a pipeline fails, all later operations on it fail
+ *       with the same error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_pipeline_send (mongoc_cluster_pipeline_t *pipeline,
+                              mongoc_cmd_t *cmd,
+                              uint32_t *request_id,
+                              bson_error_t *error)
+{
+   bson_error_t err_local;
+
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (cmd);
+   BSON_ASSERT (request_id);
+   BSON_ASSERT (cmd->server_stream == pipeline->server_stream);
+
+   if (pipeline->failed) {
+      if (error) {
+         memcpy (error, &pipeline->error, sizeof *error);
+      }
+
+      return false;
+   }
+
+   if (!error) {
+      error = &err_local;
+   }
+
+   if (!_mongoc_cluster_pipeline_stash_ready (pipeline, cmd, error)) {
+      return false;
+   }
+
+   if (!_mongoc_cluster_send_opmsg (
+          pipeline->cluster, cmd, request_id, NULL, error)) {
+      _mongoc_cluster_pipeline_fail (pipeline, error);
+      return false;
+   }
+
+   if (cmd->is_acknowledged) {
+      _mongoc_array_append_val (&pipeline->in_flight, *request_id);
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_recv --
+ *
+ *       Read the reply to @cmd, sent earlier with
+ *       mongoc_cluster_pipeline_send as @request_id. Replies may be read
+ *       in any order.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       @reply is set and should ALWAYS be released with bson_destroy().
+ *       A network or protocol error fails the whole pipeline.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_pipeline_recv (mongoc_cluster_pipeline_t *pipeline,
+                              mongoc_cmd_t *cmd,
+                              uint32_t request_id,
+                              bson_t *reply,
+                              bson_error_t *error)
+{
+   bson_error_t err_local;
+
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (cmd);
+   BSON_ASSERT (cmd->server_stream == pipeline->server_stream);
+
+   if (!cmd->is_acknowledged) {
+      _mongoc_bson_init_if_set (reply);
+      return true;
+   }
+
+   if (pipeline->failed) {
+      if (error) {
+         memcpy (error, &pipeline->error, sizeof *error);
+      }
+
+      network_error_reply (reply, cmd);
+      return false;
+   }
+
+   if (!error) {
+      error = &err_local;
+   }
+
+   if (!_mongoc_cluster_pipeline_is_in_flight (pipeline, request_id)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_COMMAND,
+                      MONGOC_ERROR_COMMAND_INVALID_ARG,
+                      "No pipelined request with id %u",
+                      request_id);
+      _mongoc_bson_init_if_set (reply);
+      return false;
+   }
+
+   return _mongoc_cluster_recv_opmsg (
+      pipeline->cluster, cmd, request_id, pipeline, reply, error);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_send_monitored --
+ *
+ *       Like mongoc_cluster_pipeline_send, but also does what
+ *       mongoc_cluster_run_command_monitored does before sending a
+ *       command: it publishes the command started event and counts the
+ *       command as in flight on its server. @op is filled in for
+ *       mongoc_cluster_pipeline_recv_monitored.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set, the
+ *       command failed event has been published, and there is no reply
+ *       to receive.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_pipeline_send_monitored (mongoc_cluster_pipeline_t *pipeline,
+                                        mongoc_cmd_t *cmd,
+                                        mongoc_cluster_pipeline_op_t *op,
+                                        bson_error_t *error)
+{
+   bson_t reply;
+   bson_error_t error_local;
+
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (cmd);
+   BSON_ASSERT (op);
+
+   if (!error) {
+      error = &error_local;
+   }
+
+   op->apm_request_id = ++pipeline->cluster->request_id;
+   op->started = bson_get_monotonic_time ();
+   cmd->reply_server_id = cmd->server_stream->sd->id;
+
+   _mongoc_cluster_command_started (pipeline->cluster, cmd, op->apm_request_id);
+
+   if (!mongoc_cluster_pipeline_send (pipeline, cmd, &op->request_id, error)) {
+      network_error_reply (&reply, cmd);
+      mongoc_server_description_op_finished (
+         cmd->server_stream->sd, bson_get_monotonic_time () - op->started);
+      _mongoc_cluster_command_finished (pipeline->cluster,
+                                        cmd,
+                                        op->apm_request_id,
+                                        op->started,
+                                        false,
+                                        &reply,
+                                        error);
+      bson_destroy (&reply);
+      return false;
+   }
+
+   return true;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_recv_monitored --
+ *
+ *       Read the reply to @cmd, sent earlier with
+ *       mongoc_cluster_pipeline_send_monitored as @op, like
+ *       mongoc_cluster_pipeline_recv. Then publish the command succeeded
+ *       or failed event and record the command's latency, like
+ *       mongoc_cluster_run_command_monitored.
+ *
+ * Returns:
+ *       true if successful; otherwise false and @error is set.
+ *
+ * Side effects:
+ *       @reply is set and should ALWAYS be released with bson_destroy().
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_cluster_pipeline_recv_monitored (mongoc_cluster_pipeline_t *pipeline,
+                                        mongoc_cmd_t *cmd,
+                                        const mongoc_cluster_pipeline_op_t *op,
+                                        bson_t *reply,
+                                        bson_error_t *error)
+{
+   bson_t reply_local;
+   bson_error_t error_local;
+   bool retval;
+
+   BSON_ASSERT (pipeline);
+   BSON_ASSERT (cmd);
+   BSON_ASSERT (op);
+
+   if (!reply) {
+      reply = &reply_local;
+   }
+   if (!error) {
+      error = &error_local;
+   }
+
+   retval =
+      mongoc_cluster_pipeline_recv (pipeline, cmd, op->request_id, reply, error);
+   mongoc_server_description_op_finished (
+      cmd->server_stream->sd, bson_get_monotonic_time () - op->started);
+   _mongoc_cluster_command_finished (pipeline->cluster,
+                                     cmd,
+                                     op->apm_request_id,
+                                     op->started,
+                                     retval,
+                                     reply,
+                                     error);
+
+   if (reply == &reply_local) {
+      bson_destroy (&reply_local);
+   }
+
+   return retval;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_cluster_pipeline_destroy --
+ *
+ *       Free a pipeline's resources. Replies that were never read are
+ *       discarded; if any requests are still in flight, the connection is
+ *       closed, since their replies would otherwise be read by the next
+ *       operation on it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_cluster_pipeline_destroy (mongoc_cluster_pipeline_t *pipeline)
+{
+   size_t i;
+
+   if (!pipeline) {
+      return;
+   }
+
+   for (i = 0; i < pipeline->stashed.len; i++) {
+      _mongoc_buffer_destroy (
+         &_mongoc_array_index (&pipeline->stashed, mongoc_buffer_t, i));
+   }
+
+   if (!pipeline->failed && pipeline->in_flight.len > pipeline->stashed.len) {
+      mongoc_cluster_disconnect_node (
+         pipeline->cluster, pipeline->server_stream->sd->id, false, NULL);
+   }
+
+   _mongoc_array_destroy (&pipeline->stashed);
+   _mongoc_array_destroy (&pipeline->in_flight);
 }
@@ -50,6 +50,10 @@ typedef struct _mongoc_cmd_t {
    const bson_t *command;
    const char *command_name;
    const uint8_t *payload;
+   /* instead of payload, the document sequence may be split into segments,
+    * for example to send documents without copying them together */
+   const mongoc_iovec_t *payload_iov;
+   size_t payload_iovcnt;
    int32_t payload_size;
    const char *payload_identifier;
    const mongoc_server_stream_t *server_stream;
@@ -57,6 +61,11 @@ typedef struct _mongoc_cmd_t {
    mongoc_client_session_t *session;
    bool is_acknowledged;
    bool is_txn_finish;
+   /* if set, a read that may also be sent to another server suitable for
+    * these read prefs if server_stream's is slow to reply */
+   const mongoc_read_prefs_t *hedge_read_prefs;
+   /* set when the command runs: the server whose reply was used */
+   uint32_t reply_server_id;
 } mongoc_cmd_t;
 
 
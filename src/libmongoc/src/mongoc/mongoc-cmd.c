@@ -52,9 +52,13 @@ mongoc_cmd_parts_init (mongoc_cmd_parts_t *parts,
    parts->assembled.query_flags = MONGOC_QUERY_NONE;
    parts->assembled.payload_identifier = NULL;
    parts->assembled.payload = NULL;
+   parts->assembled.payload_iov = NULL;
+   parts->assembled.payload_iovcnt = 0;
    parts->assembled.session = NULL;
    parts->assembled.is_acknowledged = true;
    parts->assembled.is_txn_finish = false;
+   parts->assembled.hedge_read_prefs = NULL;
+   parts->assembled.reply_server_id = 0;
 }
 
 
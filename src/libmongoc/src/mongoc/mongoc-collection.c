@@ -35,6 +35,7 @@
 #include "mongoc-read-prefs-private.h"
 #include "mongoc-util-private.h"
 #include "mongoc-write-command-private.h"
+#include "mongoc-write-coalescer-private.h"
 #include "mongoc-opts-private.h"
 
 #undef MONGOC_LOG_DOMAIN
@@ -1762,6 +1763,74 @@ mongoc_collection_insert (mongoc_collection_t *collection,
 }
 
 
+/* inserts from a pooled client may be sent together with other threads'
+ * inserts into the collection, if the URI option "writeCoalescingMS" is set.
+ * not with a session, which belongs to one thread, nor with options that
+ * the other inserts may not share, nor unacknowledged, since the caller
+ * would wait for the others */
+static bool
+_mongoc_collection_can_coalesce_insert (const mongoc_collection_t *collection,
+                                        const mongoc_insert_one_opts_t *opts)
+{
+   return collection->client->topology->write_coalescer &&
+          !opts->crud.client_session && bson_empty (&opts->extra) &&
+          mongoc_write_concern_is_acknowledged (
+             COALESCE (opts->crud.writeConcern, collection->write_concern));
+}
+
+
+/* insert @document in one "insert" command with the concurrent inserts of
+ * other threads, and set @result to the outcome for @document alone */
+static void
+_mongoc_collection_insert_one_coalesced (mongoc_collection_t *collection,
+                                         const bson_t *document,
+                                         mongoc_insert_one_opts_t *opts,
+                                         mongoc_write_result_t *result)
+{
+   mongoc_write_coalescer_t *coalescer;
+   mongoc_write_coalescer_group_t *group;
+   mongoc_write_concern_t *wc;
+   mongoc_write_command_t command;
+   uint32_t index;
+   size_t i;
+
+   coalescer = collection->client->topology->write_coalescer;
+   wc = COALESCE (opts->crud.writeConcern, collection->write_concern);
+   group = _mongoc_write_coalescer_join (coalescer,
+                                         collection->ns,
+                                         _mongoc_write_concern_get_bson (wc),
+                                         opts->bypass,
+                                         document,
+                                         &index);
+
+   /* the thread that started the group sends it */
+   if (index == 0) {
+      _mongoc_write_command_init_insert_idl (
+         &command,
+         NULL,
+         NULL,
+         ++collection->client->cluster.operation_id,
+         false);
+
+      for (i = 0; i < group->documents.len; i++) {
+         _mongoc_write_command_insert_append_ref (
+            &command,
+            _mongoc_array_index (&group->documents, const bson_t *, i));
+      }
+
+      /* one caller's write error must not stop the others' inserts */
+      command.flags.ordered = false;
+      command.flags.bypass_document_validation = opts->bypass;
+      _mongoc_collection_write_command_execute_idl (
+         &command, collection, &opts->crud, &group->result);
+      _mongoc_write_command_destroy (&command);
+      _mongoc_write_coalescer_complete (coalescer, group);
+   }
+
+   _mongoc_write_coalescer_leave (coalescer, group, index, result);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1816,16 +1885,23 @@ mongoc_collection_insert_one (mongoc_collection_t *collection,
    }
 
    _mongoc_write_result_init (&result);
-   _mongoc_write_command_init_insert_idl (
-      &command,
-      document,
-      &insert_one_opts.extra,
-      ++collection->client->cluster.operation_id,
-      false);
 
-   command.flags.bypass_document_validation = insert_one_opts.bypass;
-   _mongoc_collection_write_command_execute_idl (
-      &command, collection, &insert_one_opts.crud, &result);
+   if (_mongoc_collection_can_coalesce_insert (collection, &insert_one_opts)) {
+      _mongoc_collection_insert_one_coalesced (
+         collection, document, &insert_one_opts, &result);
+   } else {
+      _mongoc_write_command_init_insert_idl (
+         &command,
+         document,
+         &insert_one_opts.extra,
+         ++collection->client->cluster.operation_id,
+         false);
+
+      command.flags.bypass_document_validation = insert_one_opts.bypass;
+      _mongoc_collection_write_command_execute_idl (
+         &command, collection, &insert_one_opts.crud, &result);
+      _mongoc_write_command_destroy (&command);
+   }
 
    ret = MONGOC_WRITE_RESULT_COMPLETE (&result,
                                        collection->client->error_api_version,
@@ -1837,7 +1913,6 @@ mongoc_collection_insert_one (mongoc_collection_t *collection,
                                        "insertedCount");
 
    _mongoc_write_result_destroy (&result);
-   _mongoc_write_command_destroy (&command);
 
 done:
    _mongoc_insert_one_opts_cleanup (&insert_one_opts);
@@ -1845,6 +1920,140 @@ done:
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_insert_one_async --
+ *
+ *       Start inserting @document with the collection's write concern,
+ *       generating an "_id" if it has none. Call
+ *       mongoc_client_async_run to drive it to completion.
+ *
+ * Returns:
+ *       True if the insert was started, in which case @cb is called once
+ *       with the "insert" command's reply. Otherwise false and @error is
+ *       set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_collection_insert_one_async (mongoc_collection_t *collection,
+                                    const bson_t *document,
+                                    mongoc_client_command_async_cb_t cb,
+                                    void *data,
+                                    bson_error_t *error)
+{
+   bson_t cmd = BSON_INITIALIZER;
+   bson_t documents;
+   bson_t doc;
+   bson_oid_t oid;
+   bool ret = false;
+
+   ENTRY;
+
+   BSON_ASSERT (collection);
+   BSON_ASSERT (document);
+
+   if (!_mongoc_validate_new_document (
+          document, _mongoc_default_insert_vflags, error)) {
+      GOTO (done);
+   }
+
+   BSON_APPEND_UTF8 (&cmd, "insert", collection->collection);
+   BSON_APPEND_ARRAY_BEGIN (&cmd, "documents", &documents);
+   BSON_APPEND_DOCUMENT_BEGIN (&documents, "0", &doc);
+   if (!bson_has_field (document, "_id")) {
+      bson_oid_init (&oid, NULL);
+      BSON_APPEND_OID (&doc, "_id", &oid);
+   }
+   bson_concat (&doc, document);
+   bson_append_document_end (&documents, &doc);
+   bson_append_array_end (&cmd, &documents);
+
+   if (!mongoc_write_concern_is_default (collection->write_concern)) {
+      BSON_APPEND_DOCUMENT (
+         &cmd,
+         "writeConcern",
+         _mongoc_write_concern_get_bson (collection->write_concern));
+   }
+
+   ret = _mongoc_client_command_async (collection->client,
+                                       collection->db,
+                                       &cmd,
+                                       MONGOC_SS_WRITE,
+                                       NULL,
+                                       cb,
+                                       data,
+                                       error);
+
+done:
+   bson_destroy (&cmd);
+   RETURN (ret);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_collection_find_async --
+ *
+ *       Start a "find" command for @filter, with the collection's read
+ *       preference and read concern, and "find" options from @opts.
+ *       Call mongoc_client_async_run to drive it to completion.
+ *
+ * Returns:
+ *       True if the find was started, in which case @cb is called once
+ *       with the command's reply, whose "cursor.firstBatch" holds the
+ *       first batch of results. Otherwise false and @error is set.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_collection_find_async (mongoc_collection_t *collection,
+                              const bson_t *filter,
+                              const bson_t *opts,
+                              mongoc_client_command_async_cb_t cb,
+                              void *data,
+                              bson_error_t *error)
+{
+   bson_t cmd = BSON_INITIALIZER;
+   bool ret;
+
+   ENTRY;
+
+   BSON_ASSERT (collection);
+   BSON_ASSERT (filter);
+
+   BSON_APPEND_UTF8 (&cmd, "find", collection->collection);
+   BSON_APPEND_DOCUMENT (&cmd, "filter", filter);
+   if (opts) {
+      bson_concat (&cmd, opts);
+   }
+
+   if (!mongoc_read_concern_is_default (collection->read_concern) &&
+       !(opts && bson_has_field (opts, "readConcern"))) {
+      BSON_APPEND_DOCUMENT (
+         &cmd,
+         "readConcern",
+         _mongoc_read_concern_get_bson (collection->read_concern));
+   }
+
+   ret = _mongoc_client_command_async (collection->client,
+                                       collection->db,
+                                       &cmd,
+                                       MONGOC_SS_READ,
+                                       collection->read_prefs,
+                                       cb,
+                                       data,
+                                       error);
+
+   bson_destroy (&cmd);
+   RETURN (ret);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1916,7 +2125,7 @@ mongoc_collection_insert_many (mongoc_collection_t *collection,
          GOTO (done);
       }
 
-      _mongoc_write_command_insert_append (&command, documents[i]);
+      _mongoc_write_command_insert_append_ref (&command, documents[i]);
    }
 
    _mongoc_collection_write_command_execute_idl (
@@ -3133,6 +3342,7 @@ mongoc_collection_create_bulk_operation_with_opts (
                                       wc);
 
    bulk->session = bulk_opts.client_session;
+   bulk->zero_copy = bulk_opts.zero_copy;
    if (err.domain) {
       /* _mongoc_bulk_opts_parse failed, above */
       memcpy (&bulk->result.error, &err, sizeof (bson_error_t));
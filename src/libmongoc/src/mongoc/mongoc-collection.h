@@ -39,6 +39,20 @@ BSON_BEGIN_DECLS
 
 typedef struct _mongoc_collection_t mongoc_collection_t;
 
+/**
+ * mongoc_client_command_async_cb_t:
+ * @reply: The server reply, or an empty document on a network error.
+ * @error: NULL if the command succeeded, otherwise the error.
+ * @data: The data passed to the function that started the command.
+ *
+ * Called from mongoc_client_async_run when a command started with
+ * mongoc_client_command_async or an async collection helper completes.
+ * @reply and @error are valid only during the call.
+ */
+typedef void (*mongoc_client_command_async_cb_t) (const bson_t *reply,
+                                                  const bson_error_t *error,
+                                                  void *data);
+
 MONGOC_EXPORT (mongoc_cursor_t *)
 mongoc_collection_aggregate (mongoc_collection_t *collection,
                              mongoc_query_flags_t flags,
@@ -185,6 +199,19 @@ mongoc_collection_insert_one (mongoc_collection_t *collection,
                               bson_t *reply,
                               bson_error_t *error);
 MONGOC_EXPORT (bool)
+mongoc_collection_insert_one_async (mongoc_collection_t *collection,
+                                    const bson_t *document,
+                                    mongoc_client_command_async_cb_t cb,
+                                    void *data,
+                                    bson_error_t *error);
+MONGOC_EXPORT (bool)
+mongoc_collection_find_async (mongoc_collection_t *collection,
+                              const bson_t *filter,
+                              const bson_t *opts,
+                              mongoc_client_command_async_cb_t cb,
+                              void *data,
+                              bson_error_t *error);
+MONGOC_EXPORT (bool)
 mongoc_collection_insert_many (mongoc_collection_t *collection,
                                const bson_t **documents,
                                size_t n_documents,
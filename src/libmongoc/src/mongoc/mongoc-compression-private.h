@@ -23,6 +23,8 @@
 #endif
 #include <bson.h>
 
+#include "mongoc-iovec.h"
+
 
 /* Compressor IDs */
 #define MONGOC_COMPRESSOR_NOOP_ID 0
@@ -34,9 +36,31 @@
 #define MONGOC_COMPRESSOR_ZLIB_ID 2
 #define MONGOC_COMPRESSOR_ZLIB_STR "zlib"
 
+#define MONGOC_COMPRESSOR_ZSTD_ID 3
+#define MONGOC_COMPRESSOR_ZSTD_STR "zstd"
+
+/* OP_COMPRESSED adds the original opcode, uncompressed size and compressor
+ * id to the compressed message */
+#define MONGOC_COMPRESSED_HEADER_EXTRA 9
+
+/* Messages smaller than this are not compressed, unless the
+ * compressionMinSize URI option says otherwise. */
+#define MONGOC_COMPRESSION_MIN_SIZE_DEFAULT 512
+
+/* A server whose recent messages compress to more than this fraction of
+ * their size is sent uncompressed messages, with one compressed probe
+ * every MONGOC_COMPRESSION_BACKOFF messages to notice if that changes. */
+#define MONGOC_COMPRESSION_POOR_RATIO 0.9
+#define MONGOC_COMPRESSION_BACKOFF 32
+
 
 BSON_BEGIN_DECLS
 
+/* Compressor state reused across messages: zlib and zstd streams, the
+ * scratch and output buffers, and each server's recent compression ratio.
+ * Not thread safe, owned by one cluster. */
+typedef struct _mongoc_compressor_ctx_t mongoc_compressor_ctx_t;
+
 
 size_t
 mongoc_compressor_max_compressed_length (int32_t compressor_id, size_t size);
@@ -57,13 +81,33 @@ mongoc_uncompress (int32_t compressor_id,
                    uint8_t *uncompressed,
                    size_t *uncompressed_size);
 
+mongoc_compressor_ctx_t *
+mongoc_compressor_ctx_new (void);
+
+void
+mongoc_compressor_ctx_destroy (mongoc_compressor_ctx_t *ctx);
+
+bool
+mongoc_compressor_ctx_should_compress (mongoc_compressor_ctx_t *ctx,
+                                       uint32_t server_id,
+                                       size_t len,
+                                       int32_t min_size);
+
+void
+mongoc_compressor_ctx_record (mongoc_compressor_ctx_t *ctx,
+                              uint32_t server_id,
+                              size_t len,
+                              size_t compressed_len);
+
 bool
-mongoc_compress (int32_t compressor_id,
-                 int32_t compression_level,
-                 char *uncompressed,
-                 size_t uncompressed_len,
-                 char *compressed,
-                 size_t *compressed_len);
+mongoc_compress_iovec (mongoc_compressor_ctx_t *ctx,
+                       int32_t compressor_id,
+                       int32_t compression_level,
+                       const mongoc_iovec_t *iov,
+                       size_t iovcnt,
+                       size_t skip,
+                       const uint8_t **compressed,
+                       size_t *compressed_len);
 
 BSON_END_DECLS
 
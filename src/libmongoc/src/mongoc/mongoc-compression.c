@@ -18,6 +18,7 @@
 #include "mongoc-config.h"
 
 #include "mongoc-compression-private.h"
+#include "mongoc-set-private.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-util-private.h"
 
@@ -28,7 +29,31 @@
 #ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
 #include <snappy-c.h>
 #endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+#include <zstd.h>
 #endif
+#endif
+
+struct _mongoc_compressor_ctx_t {
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   z_stream zstream;
+   bool zstream_ready;
+   int32_t zlib_level;
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   ZSTD_CCtx *zstd;
+#endif
+   uint8_t *scratch; /* flattened input for compressors without iovec input */
+   size_t scratch_len;
+   uint8_t *output;
+   size_t output_len;
+   mongoc_set_t *servers; /* mongoc_compressor_server_t by server id */
+};
+
+typedef struct {
+   double ratio;   /* moving average of compressed size / size */
+   int32_t skip;   /* messages left to send uncompressed */
+} mongoc_compressor_server_t;
 
 size_t
 mongoc_compressor_max_compressed_length (int32_t compressor_id, size_t len)
@@ -49,6 +74,12 @@ mongoc_compressor_max_compressed_length (int32_t compressor_id, size_t len)
       break;
 #endif
 
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   case MONGOC_COMPRESSOR_ZSTD_ID:
+      return ZSTD_compressBound (len);
+      break;
+#endif
+
    case MONGOC_COMPRESSOR_NOOP_ID:
       return len;
       break;
@@ -72,6 +103,12 @@ mongoc_compressor_supported (const char *compressor)
    }
 #endif
 
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   if (!strcasecmp (compressor, MONGOC_COMPRESSOR_ZSTD_STR)) {
+      return true;
+   }
+#endif
+
    if (!strcasecmp (compressor, MONGOC_COMPRESSOR_NOOP_STR)) {
       return true;
    }
@@ -89,6 +126,9 @@ mongoc_compressor_id_to_name (int32_t compressor_id)
    case MONGOC_COMPRESSOR_ZLIB_ID:
       return MONGOC_COMPRESSOR_ZLIB_STR;
 
+   case MONGOC_COMPRESSOR_ZSTD_ID:
+      return MONGOC_COMPRESSOR_ZSTD_STR;
+
    case MONGOC_COMPRESSOR_NOOP_ID:
       return MONGOC_COMPRESSOR_NOOP_STR;
 
@@ -112,6 +152,12 @@ mongoc_compressor_name_to_id (const char *compressor)
    }
 #endif
 
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   if (strcasecmp (MONGOC_COMPRESSOR_ZSTD_STR, compressor) == 0) {
+      return MONGOC_COMPRESSOR_ZSTD_ID;
+   }
+#endif
+
    if (strcasecmp (MONGOC_COMPRESSOR_NOOP_STR, compressor) == 0) {
       return MONGOC_COMPRESSOR_NOOP_ID;
    }
@@ -164,6 +210,27 @@ mongoc_uncompress (int32_t compressor_id,
 #endif
       break;
    }
+
+   case MONGOC_COMPRESSOR_ZSTD_ID: {
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+      size_t ret;
+
+      ret = ZSTD_decompress (
+         uncompressed, *uncompressed_len, compressed, compressed_len);
+
+      if (ZSTD_isError (ret)) {
+         return false;
+      }
+
+      *uncompressed_len = ret;
+      return true;
+#else
+      MONGOC_WARNING ("Received zstd compressed opcode, but zstd "
+                      "compression is not compiled in");
+      return false;
+#endif
+      break;
+   }
    case MONGOC_COMPRESSOR_NOOP_ID:
       memcpy (uncompressed, compressed, compressed_len);
       *uncompressed_len = compressed_len;
@@ -176,24 +243,354 @@ mongoc_uncompress (int32_t compressor_id,
    return false;
 }
 
+static void
+_mongoc_compressor_server_dtor (void *item, void *ctx)
+{
+   bson_free (item);
+}
+
+mongoc_compressor_ctx_t *
+mongoc_compressor_ctx_new (void)
+{
+   mongoc_compressor_ctx_t *ctx;
+
+   ctx = (mongoc_compressor_ctx_t *) bson_malloc0 (sizeof *ctx);
+   ctx->servers = mongoc_set_new (4, _mongoc_compressor_server_dtor, NULL);
+
+   return ctx;
+}
+
+void
+mongoc_compressor_ctx_destroy (mongoc_compressor_ctx_t *ctx)
+{
+   if (!ctx) {
+      return;
+   }
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   if (ctx->zstream_ready) {
+      deflateEnd (&ctx->zstream);
+   }
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   ZSTD_freeCCtx (ctx->zstd);
+#endif
+
+   mongoc_set_destroy (ctx->servers);
+   bson_free (ctx->scratch);
+   bson_free (ctx->output);
+   bson_free (ctx);
+}
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_compressor_ctx_should_compress --
+ *
+ *       Decide whether a compressible message of @len bytes to the server
+ *       with @server_id is worth compressing: it must be at least
+ *       @min_size bytes, and the server's recent messages must not have
+ *       compressed poorly. A @min_size of -1 compresses everything.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_compressor_ctx_should_compress (mongoc_compressor_ctx_t *ctx,
+                                       uint32_t server_id,
+                                       size_t len,
+                                       int32_t min_size)
+{
+   mongoc_compressor_server_t *server;
+
+   BSON_ASSERT (ctx);
+
+   if (min_size < 0) {
+      return true;
+   }
+
+   if (len < (size_t) min_size) {
+      return false;
+   }
+
+   server = (mongoc_compressor_server_t *) mongoc_set_get (ctx->servers,
+                                                           server_id);
+   if (server && server->skip > 0) {
+      server->skip--;
+      return false;
+   }
+
+   return true;
+}
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_compressor_ctx_record --
+ *
+ *       Add a message of @len bytes that compressed to @compressed_len
+ *       to the server's moving average. If the average is poor, the next
+ *       MONGOC_COMPRESSION_BACKOFF messages are not compressed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+mongoc_compressor_ctx_record (mongoc_compressor_ctx_t *ctx,
+                              uint32_t server_id,
+                              size_t len,
+                              size_t compressed_len)
+{
+   mongoc_compressor_server_t *server;
+   double ratio;
+
+   BSON_ASSERT (ctx);
+   BSON_ASSERT (len);
+
+   ratio = (double) (compressed_len + MONGOC_COMPRESSED_HEADER_EXTRA) /
+           (double) len;
+
+   server = (mongoc_compressor_server_t *) mongoc_set_get (ctx->servers,
+                                                           server_id);
+   if (!server) {
+      server = (mongoc_compressor_server_t *) bson_malloc0 (sizeof *server);
+      server->ratio = ratio;
+      mongoc_set_add (ctx->servers, server_id, server);
+   } else {
+      server->ratio = 0.8 * server->ratio + 0.2 * ratio;
+   }
+
+   if (server->ratio > MONGOC_COMPRESSION_POOR_RATIO) {
+      server->skip = MONGOC_COMPRESSION_BACKOFF;
+   }
+}
+
+static uint8_t *
+_mongoc_compressor_reserve (uint8_t **buf, size_t *buf_len, size_t size)
+{
+   if (*buf_len < size) {
+      *buf_len = bson_next_power_of_two (size);
+      *buf = (uint8_t *) bson_realloc (*buf, *buf_len);
+   }
+
+   return *buf;
+}
+
+/* copy the iovecs, less the first "skip" bytes, into dst */
+static void
+_mongoc_compressor_flatten (const mongoc_iovec_t *iov,
+                            size_t iovcnt,
+                            size_t skip,
+                            uint8_t *dst)
+{
+   size_t i;
+
+   for (i = 0; i < iovcnt; i++) {
+      if (iov[i].iov_len <= skip) {
+         skip -= iov[i].iov_len;
+         continue;
+      }
+
+      memcpy (dst, (uint8_t *) iov[i].iov_base + skip, iov[i].iov_len - skip);
+      dst += iov[i].iov_len - skip;
+      skip = 0;
+   }
+}
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+static bool
+_mongoc_compress_zlib_iovec (mongoc_compressor_ctx_t *ctx,
+                             int32_t compression_level,
+                             const mongoc_iovec_t *iov,
+                             size_t iovcnt,
+                             size_t skip,
+                             size_t len,
+                             size_t *compressed_len)
+{
+   z_stream *zs = &ctx->zstream;
+   size_t bound;
+   size_t i;
+   int r;
+
+   if (ctx->zstream_ready && ctx->zlib_level != compression_level) {
+      deflateEnd (zs);
+      ctx->zstream_ready = false;
+   }
+
+   if (!ctx->zstream_ready) {
+      memset (zs, 0, sizeof *zs);
+      if (deflateInit (zs, compression_level) != Z_OK) {
+         return false;
+      }
+
+      ctx->zstream_ready = true;
+      ctx->zlib_level = compression_level;
+   } else if (deflateReset (zs) != Z_OK) {
+      return false;
+   }
+
+   bound = deflateBound (zs, (uLong) len);
+   zs->next_out =
+      _mongoc_compressor_reserve (&ctx->output, &ctx->output_len, bound);
+   zs->avail_out = (uInt) bound;
+
+   /* deflate each segment in place, the output is sized for all of them */
+   for (i = 0; i < iovcnt; i++) {
+      if (iov[i].iov_len <= skip) {
+         skip -= iov[i].iov_len;
+         continue;
+      }
+
+      zs->next_in = (Bytef *) iov[i].iov_base + skip;
+      zs->avail_in = (uInt) (iov[i].iov_len - skip);
+      skip = 0;
+
+      if (deflate (zs, Z_NO_FLUSH) != Z_OK || zs->avail_in) {
+         return false;
+      }
+   }
+
+   r = deflate (zs, Z_FINISH);
+   if (r != Z_STREAM_END) {
+      return false;
+   }
+
+   *compressed_len = (size_t) zs->total_out;
+
+   return true;
+}
+#endif
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+static bool
+_mongoc_compress_zstd_iovec (mongoc_compressor_ctx_t *ctx,
+                             int32_t compression_level,
+                             const mongoc_iovec_t *iov,
+                             size_t iovcnt,
+                             size_t skip,
+                             size_t len,
+                             size_t *compressed_len)
+{
+   ZSTD_inBuffer in;
+   ZSTD_outBuffer out;
+   size_t bound;
+   size_t i;
+   size_t r;
+
+   if (!ctx->zstd) {
+      ctx->zstd = ZSTD_createCCtx ();
+      if (!ctx->zstd) {
+         return false;
+      }
+   }
+
+   /* keeps the context's tables, drops the previous message */
+   ZSTD_CCtx_reset (ctx->zstd, ZSTD_reset_session_only);
+   if (ZSTD_isError (ZSTD_CCtx_setParameter (
+          ctx->zstd, ZSTD_c_compressionLevel, compression_level)) ||
+       ZSTD_isError (ZSTD_CCtx_setPledgedSrcSize (ctx->zstd, len))) {
+      return false;
+   }
+
+   bound = ZSTD_compressBound (len);
+   out.dst = _mongoc_compressor_reserve (&ctx->output, &ctx->output_len, bound);
+   out.size = bound;
+   out.pos = 0;
+
+   for (i = 0; i < iovcnt; i++) {
+      if (iov[i].iov_len <= skip) {
+         skip -= iov[i].iov_len;
+         continue;
+      }
+
+      in.src = (uint8_t *) iov[i].iov_base + skip;
+      in.size = iov[i].iov_len - skip;
+      in.pos = 0;
+      skip = 0;
+
+      while (in.pos < in.size) {
+         r = ZSTD_compressStream2 (ctx->zstd, &out, &in, ZSTD_e_continue);
+         if (ZSTD_isError (r)) {
+            return false;
+         }
+      }
+   }
+
+   in.src = NULL;
+   in.size = 0;
+   in.pos = 0;
+
+   /* the output is sized for the whole frame, so this ends it in one go */
+   r = ZSTD_compressStream2 (ctx->zstd, &out, &in, ZSTD_e_end);
+   if (r != 0) {
+      return false;
+   }
+
+   *compressed_len = out.pos;
+
+   return true;
+}
+#endif
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_compress_iovec --
+ *
+ *       Compress the iovecs, less their first @skip bytes, with the
+ *       compressor's state in @ctx. zlib and zstd compress straight from
+ *       the iovecs; snappy has no such interface so the input is gathered
+ *       into reused scratch space first.
+ *
+ * Returns:
+ *       true and sets @compressed to memory owned by @ctx, which is valid
+ *       until the next call. false if the data could not be compressed.
+ *
+ *--------------------------------------------------------------------------
+ */
+
 bool
-mongoc_compress (int32_t compressor_id,
-                 int32_t compression_level,
-                 char *uncompressed,
-                 size_t uncompressed_len,
-                 char *compressed,
-                 size_t *compressed_len)
+mongoc_compress_iovec (mongoc_compressor_ctx_t *ctx,
+                       int32_t compressor_id,
+                       int32_t compression_level,
+                       const mongoc_iovec_t *iov,
+                       size_t iovcnt,
+                       size_t skip,
+                       const uint8_t **compressed,
+                       size_t *compressed_len)
 {
+   size_t len = 0;
+   size_t i;
+
+   BSON_ASSERT (ctx);
+
    TRACE ("Compressing with '%s' (%d)",
           mongoc_compressor_id_to_name (compressor_id),
           compressor_id);
+
+   for (i = 0; i < iovcnt; i++) {
+      len += iov[i].iov_len;
+   }
+
+   BSON_ASSERT (len >= skip);
+   len -= skip;
+
    switch (compressor_id) {
    case MONGOC_COMPRESSOR_SNAPPY_ID:
 #ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
-      /* No compression_level option for snappy */
-      return snappy_compress (
-                uncompressed, uncompressed_len, compressed, compressed_len) ==
-             SNAPPY_OK;
+      _mongoc_compressor_reserve (&ctx->scratch, &ctx->scratch_len, len);
+      _mongoc_compressor_flatten (iov, iovcnt, skip, ctx->scratch);
+      *compressed_len = snappy_max_compressed_length (len);
+      _mongoc_compressor_reserve (
+         &ctx->output, &ctx->output_len, *compressed_len);
+      if (snappy_compress ((const char *) ctx->scratch,
+                           len,
+                           (char *) ctx->output,
+                           compressed_len) != SNAPPY_OK) {
+         return false;
+      }
+
       break;
 #else
       MONGOC_ERROR ("Client attempting to use compress with snappy, but snappy "
@@ -203,23 +600,43 @@ mongoc_compress (int32_t compressor_id,
 
    case MONGOC_COMPRESSOR_ZLIB_ID:
 #ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
-      return compress2 ((unsigned char *) compressed,
-                        (unsigned long *) compressed_len,
-                        (unsigned char *) uncompressed,
-                        uncompressed_len,
-                        compression_level) == Z_OK;
+      if (!_mongoc_compress_zlib_iovec (
+             ctx, compression_level, iov, iovcnt, skip, len, compressed_len)) {
+         return false;
+      }
+
       break;
 #else
       MONGOC_ERROR ("Client attempting to use compress with zlib, but zlib "
                     "compression is not compiled in");
       return false;
 #endif
+
+   case MONGOC_COMPRESSOR_ZSTD_ID:
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+      if (!_mongoc_compress_zstd_iovec (
+             ctx, compression_level, iov, iovcnt, skip, len, compressed_len)) {
+         return false;
+      }
+
+      break;
+#else
+      MONGOC_ERROR ("Client attempting to use compress with zstd, but zstd "
+                    "compression is not compiled in");
+      return false;
+#endif
+
    case MONGOC_COMPRESSOR_NOOP_ID:
-      memcpy (compressed, uncompressed, uncompressed_len);
-      *compressed_len = uncompressed_len;
-      return true;
+      _mongoc_compressor_reserve (&ctx->output, &ctx->output_len, len);
+      _mongoc_compressor_flatten (iov, iovcnt, skip, ctx->output);
+      *compressed_len = len;
+      break;
 
    default:
       return false;
    }
+
+   *compressed = ctx->output;
+
+   return true;
 }
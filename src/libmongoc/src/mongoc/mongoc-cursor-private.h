@@ -121,6 +121,8 @@ struct _mongoc_cursor_t {
    mongoc_client_t *client;
 
    uint32_t server_id;
+   /* the server was chosen by the caller, not by the read preference */
+   bool server_id_hinted;
    bool slave_ok;
 
    mongoc_cursor_state_t state;
@@ -1018,9 +1018,18 @@ _mongoc_cursor_run_command (mongoc_cursor_t *cursor,
       GOTO (done);
    }
 
+   /* the first command may be hedged, then the cursor uses whichever server
+    * replied. not if it writes, like aggregate with $out */
+   if (!cursor->server_id_hinted && !cursor->write_concern &&
+       strcmp (cmd_name, "getMore") != 0) {
+      parts.assembled.hedge_read_prefs = cursor->read_prefs;
+   }
+
    ret = mongoc_cluster_run_command_monitored (
       cluster, &parts.assembled, reply, &cursor->error);
 
+   cursor->server_id = parts.assembled.reply_server_id;
+
    if (cursor->error.domain) {
       bson_destroy (&cursor->error_doc);
       bson_copy_to (reply, &cursor->error_doc);
@@ -1425,6 +1434,7 @@ mongoc_cursor_set_hint (mongoc_cursor_t *cursor, uint32_t server_id)
    }
 
    cursor->server_id = server_id;
+   cursor->server_id_hinted = true;
 
    return true;
 }
@@ -75,6 +75,7 @@ typedef enum {
    MONGOC_MD_FLAG_ENABLE_SHM_COUNTERS,
    MONGOC_MD_FLAG_TRACE,
    MONGOC_MD_FLAG_ENABLE_ICU,
+   MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZSTD,
    /* Add additional config flags here, above LAST_MONGOC_MD_FLAG. */
    LAST_MONGOC_MD_FLAG
 } mongoc_handshake_config_flag_bit_t;
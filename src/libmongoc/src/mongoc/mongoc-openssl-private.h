@@ -27,6 +27,7 @@
 #include <openssl/err.h>
 
 #include "mongoc-ssl.h"
+#include "mongoc-stream-tls-private.h"
 
 
 BSON_BEGIN_DECLS
@@ -40,6 +41,21 @@ SSL_CTX *
 _mongoc_openssl_ctx_new (mongoc_ssl_opt_t *opt);
 char *
 _mongoc_openssl_extract_subject (const char *filename, const char *passphrase);
+mongoc_tls_cache_t *
+_mongoc_openssl_cache_new (void);
+void
+_mongoc_openssl_cache_destroy (mongoc_tls_cache_t *cache);
+void
+_mongoc_openssl_cache_reset (mongoc_tls_cache_t *cache);
+SSL_CTX *
+_mongoc_openssl_cache_get_ctx (mongoc_tls_cache_t *cache,
+                               mongoc_ssl_opt_t *opt);
+bool
+_mongoc_openssl_cache_resume (mongoc_tls_cache_t *cache,
+                              const char *key,
+                              SSL *ssl);
+size_t
+_mongoc_openssl_cache_session_count (mongoc_tls_cache_t *cache);
 void
 _mongoc_openssl_init (void);
 void
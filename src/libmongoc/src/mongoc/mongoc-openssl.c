@@ -31,7 +31,9 @@
 #include "mongoc-init.h"
 #include "mongoc-socket.h"
 #include "mongoc-ssl.h"
+#include "mongoc-array-private.h"
 #include "mongoc-openssl-private.h"
+#include "mongoc-stream-tls-openssl-private.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-util-private.h"
@@ -544,6 +546,226 @@ _mongoc_openssl_ctx_new (mongoc_ssl_opt_t *opt)
 }
 
 
+/**
+ * mongoc_tls_cache_t:
+ *
+ * An SSL_CTX shared by every client stream created with the same
+ * mongoc_ssl_opt_t, plus the most recent TLS session per server so that
+ * reconnects can skip the full handshake. Protected by @mutex, since a
+ * client pool shares one cache between all its clients and its scanner.
+ */
+typedef struct {
+   char *key; /* "host:port" */
+   SSL_SESSION *session;
+} mongoc_openssl_cached_session_t;
+
+struct _mongoc_tls_cache_t {
+   bson_mutex_t mutex;
+   SSL_CTX *ctx;
+   mongoc_array_t sessions;
+};
+
+
+mongoc_tls_cache_t *
+_mongoc_openssl_cache_new (void)
+{
+   mongoc_tls_cache_t *cache;
+
+   cache = (mongoc_tls_cache_t *) bson_malloc0 (sizeof *cache);
+   bson_mutex_init (&cache->mutex);
+   _mongoc_array_init (&cache->sessions,
+                       sizeof (mongoc_openssl_cached_session_t));
+
+   return cache;
+}
+
+
+/* free the cache's context and sessions. requires cache->mutex, or no other
+ * user of the cache */
+static void
+_mongoc_openssl_cache_clear (mongoc_tls_cache_t *cache)
+{
+   mongoc_openssl_cached_session_t *cached;
+   size_t i;
+
+   for (i = 0; i < cache->sessions.len; i++) {
+      cached = &_mongoc_array_index (
+         &cache->sessions, mongoc_openssl_cached_session_t, i);
+      bson_free (cached->key);
+      SSL_SESSION_free (cached->session);
+   }
+
+   cache->sessions.len = 0;
+   SSL_CTX_free (cache->ctx);
+   cache->ctx = NULL;
+}
+
+
+void
+_mongoc_openssl_cache_destroy (mongoc_tls_cache_t *cache)
+{
+   if (!cache) {
+      return;
+   }
+
+   _mongoc_openssl_cache_clear (cache);
+   _mongoc_array_destroy (&cache->sessions);
+   bson_mutex_destroy (&cache->mutex);
+   bson_free (cache);
+}
+
+
+/**
+ * _mongoc_openssl_cache_reset:
+ *
+ * Drop the context and sessions built from old TLS options, keeping @cache
+ * itself: streams already open still point to it. Each of their SSLs holds
+ * its own reference to the old context.
+ */
+void
+_mongoc_openssl_cache_reset (mongoc_tls_cache_t *cache)
+{
+   bson_mutex_lock (&cache->mutex);
+   _mongoc_openssl_cache_clear (cache);
+   bson_mutex_unlock (&cache->mutex);
+}
+
+
+static mongoc_openssl_cached_session_t *
+_mongoc_openssl_cache_find (mongoc_tls_cache_t *cache, const char *key)
+{
+   mongoc_openssl_cached_session_t *cached;
+   size_t i;
+
+   for (i = 0; i < cache->sessions.len; i++) {
+      cached = &_mongoc_array_index (
+         &cache->sessions, mongoc_openssl_cached_session_t, i);
+      if (!strcasecmp (cached->key, key)) {
+         return cached;
+      }
+   }
+
+   return NULL;
+}
+
+
+/* called by OpenSSL once a handshake produced a resumable session. the SSL's
+ * app data is the mongoc_stream_tls_openssl_t that owns it. returning 1 keeps
+ * the reference OpenSSL handed us */
+static int
+_mongoc_openssl_cache_new_session_cb (SSL *ssl, SSL_SESSION *session)
+{
+   mongoc_stream_tls_openssl_t *openssl;
+   mongoc_openssl_cached_session_t *cached;
+   mongoc_openssl_cached_session_t new_cached;
+   mongoc_tls_cache_t *cache;
+
+   openssl = (mongoc_stream_tls_openssl_t *) SSL_get_app_data (ssl);
+   if (!openssl || !openssl->cache || !openssl->session_key) {
+      return 0;
+   }
+
+   cache = openssl->cache;
+
+   bson_mutex_lock (&cache->mutex);
+
+   /* a stream opened before the cache was reset, with the old options */
+   if (SSL_get_SSL_CTX (ssl) != cache->ctx) {
+      bson_mutex_unlock (&cache->mutex);
+      return 0;
+   }
+
+   cached = _mongoc_openssl_cache_find (cache, openssl->session_key);
+   if (cached) {
+      SSL_SESSION_free (cached->session);
+      cached->session = session;
+   } else {
+      new_cached.key = bson_strdup (openssl->session_key);
+      new_cached.session = session;
+      _mongoc_array_append_val (&cache->sessions, new_cached);
+   }
+   bson_mutex_unlock (&cache->mutex);
+
+   return 1;
+}
+
+
+/**
+ * _mongoc_openssl_cache_get_ctx:
+ *
+ * Return the cache's SSL_CTX, creating it from @opt on first use. The
+ * context is configured for client streams only; the caller must not free
+ * it, each SSL created from it takes its own reference.
+ */
+SSL_CTX *
+_mongoc_openssl_cache_get_ctx (mongoc_tls_cache_t *cache,
+                               mongoc_ssl_opt_t *opt)
+{
+   SSL_CTX *ctx;
+
+   bson_mutex_lock (&cache->mutex);
+   if (!cache->ctx) {
+      cache->ctx = _mongoc_openssl_ctx_new (opt);
+      if (cache->ctx) {
+         SSL_CTX_set_verify (cache->ctx,
+                             opt->weak_cert_validation ? SSL_VERIFY_NONE
+                                                       : SSL_VERIFY_PEER,
+                             NULL);
+         SSL_CTX_set_session_cache_mode (
+            cache->ctx,
+            SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+         SSL_CTX_sess_set_new_cb (cache->ctx,
+                                  _mongoc_openssl_cache_new_session_cb);
+      }
+   }
+   ctx = cache->ctx;
+   bson_mutex_unlock (&cache->mutex);
+
+   return ctx;
+}
+
+
+/**
+ * _mongoc_openssl_cache_resume:
+ *
+ * Offer the last session negotiated with the server @key, "host:port", if
+ * any, on @ssl before its handshake starts. Returns true if a session was
+ * set.
+ */
+bool
+_mongoc_openssl_cache_resume (mongoc_tls_cache_t *cache,
+                              const char *key,
+                              SSL *ssl)
+{
+   mongoc_openssl_cached_session_t *cached;
+   bool ret = false;
+
+   bson_mutex_lock (&cache->mutex);
+   cached = _mongoc_openssl_cache_find (cache, key);
+   if (cached) {
+      /* SSL_set_session takes its own reference */
+      ret = SSL_set_session (ssl, cached->session) == 1;
+   }
+   bson_mutex_unlock (&cache->mutex);
+
+   return ret;
+}
+
+
+/* for testing */
+size_t
+_mongoc_openssl_cache_session_count (mongoc_tls_cache_t *cache)
+{
+   size_t n;
+
+   bson_mutex_lock (&cache->mutex);
+   n = cache->sessions.len;
+   bson_mutex_unlock (&cache->mutex);
+
+   return n;
+}
+
+
 char *
 _mongoc_openssl_extract_subject (const char *filename, const char *passphrase)
 {
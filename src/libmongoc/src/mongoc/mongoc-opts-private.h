@@ -76,9 +76,21 @@ typedef struct _mongoc_bulk_opts_t {
    bool write_concern_owned;
    bool ordered;
    mongoc_client_session_t *client_session;
+   bool zero_copy;
    bson_t extra;
 } mongoc_bulk_opts_t;
 
+typedef struct _mongoc_bulk_writer_opts_t {
+   mongoc_write_concern_t *writeConcern;
+   bool write_concern_owned;
+   bool bypass;
+   int64_t max_batch_documents;
+   int64_t max_batch_bytes;
+   int64_t flush_interval_ms;
+   int64_t max_buffered_bytes;
+   bson_t extra;
+} mongoc_bulk_writer_opts_t;
+
 typedef struct _mongoc_bulk_insert_opts_t {
    bson_validate_flags_t validate;
    bson_t extra;
@@ -220,6 +232,16 @@ _mongoc_bulk_opts_parse (
 void
 _mongoc_bulk_opts_cleanup (mongoc_bulk_opts_t *mongoc_bulk_opts);
 
+bool
+_mongoc_bulk_writer_opts_parse (
+   mongoc_client_t *client,
+   const bson_t *opts,
+   mongoc_bulk_writer_opts_t *mongoc_bulk_writer_opts,
+   bson_error_t *error);
+
+void
+_mongoc_bulk_writer_opts_cleanup (mongoc_bulk_writer_opts_t *mongoc_bulk_writer_opts);
+
 bool
 _mongoc_bulk_insert_opts_parse (
    mongoc_client_t *client,
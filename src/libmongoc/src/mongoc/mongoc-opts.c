@@ -782,6 +782,7 @@ _mongoc_bulk_opts_parse (
    mongoc_bulk_opts->write_concern_owned = false;
    mongoc_bulk_opts->ordered = true;
    mongoc_bulk_opts->client_session = NULL;
+   mongoc_bulk_opts->zero_copy = false;
    bson_init (&mongoc_bulk_opts->extra);
 
    if (!opts) {
@@ -826,6 +827,15 @@ _mongoc_bulk_opts_parse (
             return false;
          }
       }
+      else if (!strcmp (bson_iter_key (&iter), "zeroCopy")) {
+         if (!_mongoc_convert_bool (
+               client,
+               &iter,
+               &mongoc_bulk_opts->zero_copy,
+               error)) {
+            return false;
+         }
+      }
       else {
          bson_set_error (error,
                          MONGOC_ERROR_COMMAND,
@@ -848,6 +858,115 @@ _mongoc_bulk_opts_cleanup (mongoc_bulk_opts_t *mongoc_bulk_opts)
    bson_destroy (&mongoc_bulk_opts->extra);
 }
 
+bool
+_mongoc_bulk_writer_opts_parse (
+   mongoc_client_t *client,
+   const bson_t *opts,
+   mongoc_bulk_writer_opts_t *mongoc_bulk_writer_opts,
+   bson_error_t *error)
+{
+   bson_iter_t iter;
+
+   mongoc_bulk_writer_opts->writeConcern = NULL;
+   mongoc_bulk_writer_opts->write_concern_owned = false;
+   mongoc_bulk_writer_opts->bypass = false;
+   mongoc_bulk_writer_opts->max_batch_documents = 1000;
+   mongoc_bulk_writer_opts->max_batch_bytes = (16 * 1024 * 1024);
+   mongoc_bulk_writer_opts->flush_interval_ms = 100;
+   mongoc_bulk_writer_opts->max_buffered_bytes = (64 * 1024 * 1024);
+   bson_init (&mongoc_bulk_writer_opts->extra);
+
+   if (!opts) {
+      return true;
+   }
+
+   if (!bson_iter_init (&iter, opts)) {
+      bson_set_error (error,
+                      MONGOC_ERROR_BSON,
+                      MONGOC_ERROR_BSON_INVALID,
+                      "Invalid 'opts' parameter.");
+      return false;
+   }
+
+   while (bson_iter_next (&iter)) {
+      if (!strcmp (bson_iter_key (&iter), "writeConcern")) {
+         if (!_mongoc_convert_write_concern (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->writeConcern,
+               error)) {
+            return false;
+         }
+
+         mongoc_bulk_writer_opts->write_concern_owned = true;
+      }
+      else if (!strcmp (bson_iter_key (&iter), "bypassDocumentValidation")) {
+         if (!_mongoc_convert_bool (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->bypass,
+               error)) {
+            return false;
+         }
+      }
+      else if (!strcmp (bson_iter_key (&iter), "maxBatchDocuments")) {
+         if (!_mongoc_convert_int64_positive (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->max_batch_documents,
+               error)) {
+            return false;
+         }
+      }
+      else if (!strcmp (bson_iter_key (&iter), "maxBatchBytes")) {
+         if (!_mongoc_convert_int64_positive (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->max_batch_bytes,
+               error)) {
+            return false;
+         }
+      }
+      else if (!strcmp (bson_iter_key (&iter), "flushIntervalMS")) {
+         if (!_mongoc_convert_int64_positive (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->flush_interval_ms,
+               error)) {
+            return false;
+         }
+      }
+      else if (!strcmp (bson_iter_key (&iter), "maxBufferedBytes")) {
+         if (!_mongoc_convert_int64_positive (
+               client,
+               &iter,
+               &mongoc_bulk_writer_opts->max_buffered_bytes,
+               error)) {
+            return false;
+         }
+      }
+      else {
+         bson_set_error (error,
+                         MONGOC_ERROR_COMMAND,
+                         MONGOC_ERROR_COMMAND_INVALID_ARG,
+                         "Invalid option '%s'",
+                         bson_iter_key (&iter));
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void
+_mongoc_bulk_writer_opts_cleanup (mongoc_bulk_writer_opts_t *mongoc_bulk_writer_opts)
+{
+   if (mongoc_bulk_writer_opts->write_concern_owned) {
+      mongoc_write_concern_destroy (mongoc_bulk_writer_opts->writeConcern);
+   }
+   bson_destroy (&mongoc_bulk_writer_opts->extra);
+}
+
 bool
 _mongoc_bulk_insert_opts_parse (
    mongoc_client_t *client,
@@ -68,6 +68,13 @@ _mongoc_read_prefs_validate (const mongoc_read_prefs_t *read_prefs,
 #define IS_PREF_PRIMARY(_pref) \
    (!(_pref) || ((_pref)->mode == MONGOC_READ_PRIMARY))
 
+uint32_t
+_mongoc_read_prefs_hash (const mongoc_read_prefs_t *read_prefs);
+
+bool
+_mongoc_read_prefs_equal (const mongoc_read_prefs_t *a,
+                          const mongoc_read_prefs_t *b);
+
 BSON_END_DECLS
 
 
@@ -381,3 +381,52 @@ _mongoc_read_prefs_validate (const mongoc_read_prefs_t *read_prefs,
    }
    return true;
 }
+
+
+static uint32_t
+_fnv1a (uint32_t hash, const void *data, size_t len)
+{
+   const uint8_t *p = (const uint8_t *) data;
+   size_t i;
+
+   for (i = 0; i < len; i++) {
+      hash ^= p[i];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+
+/* NULL and mode primary are the same read preference */
+uint32_t
+_mongoc_read_prefs_hash (const mongoc_read_prefs_t *read_prefs)
+{
+   uint32_t hash = 2166136261u;
+
+   if (IS_PREF_PRIMARY (read_prefs)) {
+      return hash;
+   }
+
+   hash = _fnv1a (hash, &read_prefs->mode, sizeof read_prefs->mode);
+   hash = _fnv1a (hash,
+                  &read_prefs->max_staleness_seconds,
+                  sizeof read_prefs->max_staleness_seconds);
+
+   return _fnv1a (
+      hash, bson_get_data (&read_prefs->tags), read_prefs->tags.len);
+}
+
+
+bool
+_mongoc_read_prefs_equal (const mongoc_read_prefs_t *a,
+                          const mongoc_read_prefs_t *b)
+{
+   if (IS_PREF_PRIMARY (a) || IS_PREF_PRIMARY (b)) {
+      return IS_PREF_PRIMARY (a) && IS_PREF_PRIMARY (b);
+   }
+
+   return a->mode == b->mode &&
+          a->max_staleness_seconds == b->max_staleness_seconds &&
+          bson_equal (&a->tags, &b->tags);
+}
@@ -45,6 +45,10 @@ typedef struct _mongoc_rpc_section_t {
          uint32_t size_le;
          const char *identifier;
          const uint8_t *bson_documents;
+         /* if set, the documents are gathered from these segments instead
+          * of from bson_documents */
+         const mongoc_iovec_t *bson_documents_iov;
+         size_t bson_documents_iovcnt;
       } sequence;
    } payload;
 } mongoc_rpc_section_t;
@@ -174,9 +178,10 @@ _mongoc_cmd_check_ok_no_wce (const bson_t *doc,
 bool
 _mongoc_rpc_decompress (mongoc_rpc_t *rpc_le, uint8_t *buf, size_t buflen);
 
-char *
+bool
 _mongoc_rpc_compress (struct _mongoc_cluster_t *cluster,
                       int32_t compressor_id,
+                      uint32_t server_id,
                       mongoc_rpc_t *rpc_le,
                       bson_error_t *error);
 
@@ -24,6 +24,7 @@
 #include "mongoc-util-private.h"
 #include "mongoc-compression-private.h"
 #include "mongoc-cluster-private.h"
+#include "mongoc-uri-private.h"
 
 
 #define RPC(_name, _code)                                               \
@@ -125,6 +126,18 @@
                strlen (rpc->_name[_i].payload.sequence.identifier) + 1;       \
             header->msg_len += (int32_t) iov.iov_len;                         \
             _mongoc_array_append_val (array, iov);                            \
+            if (rpc->_name[_i].payload.sequence.bson_documents_iovcnt) {      \
+               const mongoc_iovec_t *__seg =                                  \
+                  rpc->_name[_i].payload.sequence.bson_documents_iov;         \
+               size_t __n =                                                   \
+                  rpc->_name[_i].payload.sequence.bson_documents_iovcnt;      \
+               for (; __n > 1; __n--, __seg++) {                              \
+                  header->msg_len += (int32_t) __seg->iov_len;                \
+                  _mongoc_array_append_val (array, *__seg);                   \
+               }                                                              \
+               iov = *__seg;                                                  \
+               break;                                                         \
+            }                                                                 \
             iov.iov_base =                                                    \
                (void *) rpc->_name[_i].payload.sequence.bson_documents;       \
             iov.iov_len =                                                     \
@@ -347,7 +360,8 @@
                bson_free (s);                                               \
                bson_destroy (&b);                                           \
             } while (0);                                                    \
-         } else if (rpc->_name[_i].payload_type == 1) {                     \
+         } else if (rpc->_name[_i].payload_type == 1 &&                     \
+                    rpc->_name[_i].payload.sequence.bson_documents) {       \
             bson_reader_t *__r;                                             \
             int max = rpc->_name[_i].payload.sequence.size -                \
                       strlen (rpc->_name[_i].payload.sequence.identifier) - \
@@ -539,6 +553,8 @@
          section->payload.sequence.identifier = (const char *) section_buf; \
          section_buf += strlen ((const char *) section_buf) + 1;            \
          section->payload.sequence.bson_documents = section_buf;            \
+         section->payload.sequence.bson_documents_iov = NULL;               \
+         section->payload.sequence.bson_documents_iovcnt = 0;               \
       }                                                                     \
       buf += __l;                                                           \
       buflen -= __l;                                                        \
@@ -834,84 +850,120 @@ _mongoc_rpc_decompress (mongoc_rpc_t *rpc_le, uint8_t *buf, size_t buflen)
  *       compressed opcode based on the provided compressor_id.
  *       The in-place updated rpc struct remains little endian.
  *
+ *       The message is compressed straight from the cluster's iovecs with
+ *       the cluster's compressor state, see mongoc_compress_iovec.
+ *
+ *       Unless the compressionMinSize URI option is -1, the message is
+ *       left as it is if it's small, if recent messages to @server_id
+ *       compressed poorly, or if compressing it saved nothing.
+ *
+ * Returns:
+ *       true on success, whether or not the message was compressed.
+ *       false and logs a warning or sets @error if the data could not be
+ *       compressed.
+ *
  * Side effects:
- *       Overwrites the RPC, and clears and overwrites the cluster buffer
- *       with the compressed results.
+ *       If compressed, overwrites the RPC, and clears and overwrites the
+ *       cluster buffer with the compressed results. These point into the
+ *       cluster's compressor output, which is valid until the next
+ *       compression.
  *
  *--------------------------------------------------------------------------
  */
 
-char *
+bool
 _mongoc_rpc_compress (struct _mongoc_cluster_t *cluster,
                       int32_t compressor_id,
+                      uint32_t server_id,
                       mongoc_rpc_t *rpc_le,
                       bson_error_t *error)
 {
-   char *output;
+   const uint8_t *output;
    size_t output_length = 0;
-   size_t allocate = BSON_UINT32_FROM_LE (rpc_le->header.msg_len) - 16;
-   char *data;
-   int size;
+   size_t size = BSON_UINT32_FROM_LE (rpc_le->header.msg_len) - 16;
    int32_t compression_level = -1;
+   int32_t min_size;
 
    if (compressor_id == MONGOC_COMPRESSOR_ZLIB_ID) {
       compression_level = mongoc_uri_get_option_as_int32 (
          cluster->uri, MONGOC_URI_ZLIBCOMPRESSIONLEVEL, -1);
+   } else if (compressor_id == MONGOC_COMPRESSOR_ZSTD_ID) {
+      compression_level = mongoc_uri_get_option_as_int32 (
+         cluster->uri, MONGOC_URI_ZSTDCOMPRESSIONLEVEL, 0);
    }
 
-   BSON_ASSERT (allocate > 0);
-   data = bson_malloc0 (allocate);
-   size = _mongoc_cluster_buffer_iovec (
-      cluster->iov.data, cluster->iov.len, 16, data);
-   BSON_ASSERT (size);
+   BSON_ASSERT (size > 0);
 
-   output_length =
-      mongoc_compressor_max_compressed_length (compressor_id, size);
-   if (!output_length) {
+   if (!mongoc_compressor_max_compressed_length (compressor_id, size)) {
       bson_set_error (error,
                       MONGOC_ERROR_COMMAND,
                       MONGOC_ERROR_COMMAND_INVALID_ARG,
                       "Could not determine compression bounds for %s",
                       mongoc_compressor_id_to_name (compressor_id));
-      bson_free (data);
-      return NULL;
+      return false;
    }
 
-   output = (char *) bson_malloc0 (output_length);
-   if (mongoc_compress (compressor_id,
-                        compression_level,
-                        data,
-                        size,
-                        output,
-                        &output_length)) {
-      rpc_le->header.msg_len = 0;
-      rpc_le->compressed.original_opcode =
-         BSON_UINT32_FROM_LE (rpc_le->header.opcode);
-      rpc_le->header.opcode = MONGOC_OPCODE_COMPRESSED;
-      rpc_le->header.request_id =
-         BSON_UINT32_FROM_LE (rpc_le->header.request_id);
-      rpc_le->header.response_to =
-         BSON_UINT32_FROM_LE (rpc_le->header.response_to);
-
-      rpc_le->compressed.uncompressed_size = size;
-      rpc_le->compressed.compressor_id = compressor_id;
-      rpc_le->compressed.compressed_message = (const uint8_t *) output;
-      rpc_le->compressed.compressed_message_len = output_length;
-      bson_free (data);
-
-
-      _mongoc_array_destroy (&cluster->iov);
-      _mongoc_array_init (&cluster->iov, sizeof (mongoc_iovec_t));
-      _mongoc_rpc_gather (rpc_le, &cluster->iov);
-      _mongoc_rpc_swab_to_le (rpc_le);
-      return output;
+   if (!cluster->compressor) {
+      cluster->compressor = mongoc_compressor_ctx_new ();
+   }
+
+   /* the getter treats 0 as unset, but 0 is a valid minimum */
+   if (mongoc_uri_has_option (cluster->uri, MONGOC_URI_COMPRESSIONMINSIZE)) {
+      min_size = mongoc_uri_get_option_as_int32 (
+         cluster->uri, MONGOC_URI_COMPRESSIONMINSIZE, 0);
    } else {
+      min_size = MONGOC_COMPRESSION_MIN_SIZE_DEFAULT;
+   }
+
+   if (!mongoc_compressor_ctx_should_compress (
+          cluster->compressor, server_id, size + 16, min_size)) {
+      mongoc_counter_compression_skipped_inc ();
+      return true;
+   }
+
+   if (!mongoc_compress_iovec (cluster->compressor,
+                               compressor_id,
+                               compression_level,
+                               (mongoc_iovec_t *) cluster->iov.data,
+                               cluster->iov.len,
+                               16,
+                               &output,
+                               &output_length)) {
       MONGOC_WARNING ("Could not compress data with %s",
                       mongoc_compressor_id_to_name (compressor_id));
+      return false;
    }
-   bson_free (data);
-   bson_free (output);
-   return NULL;
+
+   mongoc_counter_compression_bytes_in_add ((int64_t) size);
+   mongoc_counter_compression_bytes_out_add ((int64_t) output_length);
+   mongoc_compressor_ctx_record (
+      cluster->compressor, server_id, size, output_length);
+
+   /* the compressed message is no smaller, send the original */
+   if (min_size >= 0 &&
+       output_length + MONGOC_COMPRESSED_HEADER_EXTRA >= size) {
+      mongoc_counter_compression_skipped_inc ();
+      return true;
+   }
+
+   rpc_le->header.msg_len = 0;
+   rpc_le->compressed.original_opcode =
+      BSON_UINT32_FROM_LE (rpc_le->header.opcode);
+   rpc_le->header.opcode = MONGOC_OPCODE_COMPRESSED;
+   rpc_le->header.request_id = BSON_UINT32_FROM_LE (rpc_le->header.request_id);
+   rpc_le->header.response_to =
+      BSON_UINT32_FROM_LE (rpc_le->header.response_to);
+
+   rpc_le->compressed.uncompressed_size = (int32_t) size;
+   rpc_le->compressed.compressor_id = compressor_id;
+   rpc_le->compressed.compressed_message = output;
+   rpc_le->compressed.compressed_message_len = output_length;
+
+   _mongoc_array_clear (&cluster->iov);
+   _mongoc_rpc_gather (rpc_le, &cluster->iov);
+   _mongoc_rpc_swab_to_le (rpc_le);
+
+   return true;
 }
 
 /*
@@ -1000,11 +1052,23 @@ _mongoc_rpc_scatter_reply_header_only (mongoc_rpc_t *rpc,
 bool
 _mongoc_rpc_get_first_document (mongoc_rpc_t *rpc, bson_t *reply)
 {
+   int32_t len;
+
    if (rpc->header.opcode == MONGOC_OPCODE_REPLY &&
        _mongoc_rpc_reply_get_first (&rpc->reply, reply)) {
       return true;
    }
 
+   /* an OP_MSG reply's body is its first section */
+   if (rpc->header.opcode == MONGOC_OPCODE_MSG && rpc->msg.n_sections > 0 &&
+       rpc->msg.sections[0].payload_type == 0) {
+      memcpy (&len, rpc->msg.sections[0].payload.bson_document, 4);
+      len = BSON_UINT32_FROM_LE (len);
+
+      return bson_init_static (
+         reply, rpc->msg.sections[0].payload.bson_document, (size_t) len);
+   }
+
    return false;
 }
 
@@ -25,7 +25,9 @@
 
 
 #include <bson.h>
+#include "mongoc-array-private.h"
 #include "mongoc-crypto-private.h"
+#include "mongoc-thread-private.h"
 
 
 BSON_BEGIN_DECLS
@@ -41,7 +43,11 @@ BSON_BEGIN_DECLS
 #define MONGOC_SCRAM_B64_HASH_MAX_SIZE \
    MONGOC_SCRAM_B64_ENCODED_SIZE (MONGOC_SCRAM_HASH_MAX_SIZE)
 
-typedef struct _mongoc_scram_cache_t {
+typedef struct _mongoc_scram_cache_entry_t {
+   char *user;
+#ifdef MONGOC_ENABLE_CRYPTO
+   mongoc_crypto_hash_algorithm_t algorithm;
+#endif
    /* pre-secrets */
    char *hashed_password;
    uint8_t decoded_salt[MONGOC_SCRAM_B64_HASH_MAX_SIZE];
@@ -50,6 +56,15 @@ typedef struct _mongoc_scram_cache_t {
    uint8_t client_key[MONGOC_SCRAM_HASH_MAX_SIZE];
    uint8_t server_key[MONGOC_SCRAM_HASH_MAX_SIZE];
    uint8_t salted_password[MONGOC_SCRAM_HASH_MAX_SIZE];
+} mongoc_scram_cache_entry_t;
+
+/* Secrets from successful SCRAM conversations, one entry per user and
+ * mechanism. Owned by the topology and shared by all of its clients, so it
+ * is locked on every access. An entry is only used if the server sends the
+ * same salt and iteration count and the password is unchanged. */
+typedef struct _mongoc_scram_cache_t {
+   bson_mutex_t mutex;
+   mongoc_array_t entries; /* of mongoc_scram_cache_entry_t */
 } mongoc_scram_cache_t;
 
 typedef struct _mongoc_scram_t {
@@ -71,7 +86,7 @@ typedef struct _mongoc_scram_t {
 #ifdef MONGOC_ENABLE_CRYPTO
    mongoc_crypto_t crypto;
 #endif
-   mongoc_scram_cache_t *cache;
+   mongoc_scram_cache_t *cache; /* borrowed, may be NULL */
 } mongoc_scram_t;
 
 #ifdef MONGOC_ENABLE_CRYPTO
@@ -79,9 +94,6 @@ void
 _mongoc_scram_init (mongoc_scram_t *scram, mongoc_crypto_hash_algorithm_t algo);
 #endif
 
-mongoc_scram_cache_t *
-_mongoc_scram_get_cache (mongoc_scram_t *scram);
-
 void
 _mongoc_scram_set_cache (mongoc_scram_t *scram, mongoc_scram_cache_t *cache);
 
@@ -113,6 +125,12 @@ _mongoc_scram_step (mongoc_scram_t *scram,
                     uint32_t *outbuflen,
                     bson_error_t *error);
 
+void
+_mongoc_scram_update_cache (mongoc_scram_t *scram);
+
+mongoc_scram_cache_t *
+_mongoc_scram_cache_new (void);
+
 void
 _mongoc_scram_cache_destroy (mongoc_scram_cache_t *cache);
 
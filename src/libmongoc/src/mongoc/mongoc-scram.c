@@ -44,85 +44,116 @@ _scram_hash_size (mongoc_scram_t *scram)
    return 0;
 }
 
-/* Copies the cache's secrets to scram */
-static void
-_mongoc_scram_cache_apply_secrets (mongoc_scram_cache_t *cache,
-                                   mongoc_scram_t *scram)
-{
-   BSON_ASSERT (cache);
-   BSON_ASSERT (scram);
-
-   memcpy (scram->client_key, cache->client_key, sizeof (scram->client_key));
-   memcpy (scram->server_key, cache->server_key, sizeof (scram->server_key));
-   memcpy (scram->salted_password,
-           cache->salted_password,
-           sizeof (scram->salted_password));
-}
+#ifdef MONGOC_ENABLE_ICU
+#include <unicode/usprep.h>
+#include <unicode/ustring.h>
+#endif
 
 
-static mongoc_scram_cache_t *
-_mongoc_scram_cache_copy (const mongoc_scram_cache_t *cache)
+mongoc_scram_cache_t *
+_mongoc_scram_cache_new (void)
 {
-   mongoc_scram_cache_t *ret = NULL;
+   mongoc_scram_cache_t *cache;
 
-   if (cache) {
-      ret = (mongoc_scram_cache_t *) bson_malloc0 (sizeof (*ret));
-      ret->hashed_password = bson_strdup (cache->hashed_password);
-      memcpy (
-         ret->decoded_salt, cache->decoded_salt, sizeof (ret->decoded_salt));
-      ret->iterations = cache->iterations;
-      memcpy (ret->client_key, cache->client_key, sizeof (ret->client_key));
-      memcpy (ret->server_key, cache->server_key, sizeof (ret->server_key));
-      memcpy (ret->salted_password,
-              cache->salted_password,
-              sizeof (ret->salted_password));
-   }
+   cache = (mongoc_scram_cache_t *) bson_malloc0 (sizeof (*cache));
+   bson_mutex_init (&cache->mutex);
+   _mongoc_array_init (&cache->entries, sizeof (mongoc_scram_cache_entry_t));
 
-   return ret;
+   return cache;
 }
 
-#ifdef MONGOC_ENABLE_ICU
-#include <unicode/usprep.h>
-#include <unicode/ustring.h>
-#endif
-
 
 void
 _mongoc_scram_cache_destroy (mongoc_scram_cache_t *cache)
 {
+   mongoc_scram_cache_entry_t *entry;
+   size_t i;
+
    BSON_ASSERT (cache);
 
-   if (cache->hashed_password) {
-      bson_zero_free (cache->hashed_password, strlen (cache->hashed_password));
+   for (i = 0; i < cache->entries.len; i++) {
+      entry =
+         &_mongoc_array_index (&cache->entries, mongoc_scram_cache_entry_t, i);
+      bson_free (entry->user);
+      if (entry->hashed_password) {
+         bson_zero_free (entry->hashed_password,
+                         strlen (entry->hashed_password));
+      }
    }
 
+   _mongoc_array_destroy (&cache->entries);
+   bson_mutex_destroy (&cache->mutex);
    bson_free (cache);
 }
 
 
-/* Checks whether the cache contains scram's pre-secrets */
+/* Returns the entry for scram's user and mechanism. Requires the lock */
+static mongoc_scram_cache_entry_t *
+_mongoc_scram_cache_find (mongoc_scram_cache_t *cache, mongoc_scram_t *scram)
+{
+   mongoc_scram_cache_entry_t *entry;
+   size_t i;
+
+   for (i = 0; i < cache->entries.len; i++) {
+      entry =
+         &_mongoc_array_index (&cache->entries, mongoc_scram_cache_entry_t, i);
+      if (entry->algorithm == scram->crypto.algorithm &&
+          !strcmp (entry->user, scram->user)) {
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+
+/* Checks whether the entry contains scram's pre-secrets */
 static bool
-_mongoc_scram_cache_has_presecrets (mongoc_scram_cache_t *cache,
+_mongoc_scram_cache_has_presecrets (mongoc_scram_cache_entry_t *entry,
                                     mongoc_scram_t *scram)
 {
-   BSON_ASSERT (cache);
+   BSON_ASSERT (entry);
    BSON_ASSERT (scram);
 
-   return cache->hashed_password && scram->hashed_password &&
-          !strcmp (cache->hashed_password, scram->hashed_password) &&
-          cache->iterations == scram->iterations &&
-          !memcmp (cache->decoded_salt,
+   return entry->hashed_password && scram->hashed_password &&
+          !strcmp (entry->hashed_password, scram->hashed_password) &&
+          entry->iterations == scram->iterations &&
+          !memcmp (entry->decoded_salt,
                    scram->decoded_salt,
-                   sizeof (cache->decoded_salt));
+                   sizeof (entry->decoded_salt));
 }
 
 
-mongoc_scram_cache_t *
-_mongoc_scram_get_cache (mongoc_scram_t *scram)
+/* Copies the cached secrets to scram if its pre-secrets are cached */
+static bool
+_mongoc_scram_cache_apply_secrets (mongoc_scram_cache_t *cache,
+                                   mongoc_scram_t *scram)
 {
+   mongoc_scram_cache_entry_t *entry;
+   bool found = false;
+
+   BSON_ASSERT (cache);
    BSON_ASSERT (scram);
 
-   return _mongoc_scram_cache_copy (scram->cache);
+   if (!scram->user) {
+      return false;
+   }
+
+   bson_mutex_lock (&cache->mutex);
+   entry = _mongoc_scram_cache_find (cache, scram);
+   if (entry && _mongoc_scram_cache_has_presecrets (entry, scram)) {
+      memcpy (
+         scram->client_key, entry->client_key, sizeof (scram->client_key));
+      memcpy (
+         scram->server_key, entry->server_key, sizeof (scram->server_key));
+      memcpy (scram->salted_password,
+              entry->salted_password,
+              sizeof (scram->salted_password));
+      found = true;
+   }
+   bson_mutex_unlock (&cache->mutex);
+
+   return found;
 }
 
 
@@ -131,11 +162,7 @@ _mongoc_scram_set_cache (mongoc_scram_t *scram, mongoc_scram_cache_t *cache)
 {
    BSON_ASSERT (scram);
 
-   if (scram->cache) {
-      _mongoc_scram_cache_destroy (scram->cache);
-   }
-
-   scram->cache = _mongoc_scram_cache_copy (cache);
+   scram->cache = cache;
 }
 
 
@@ -189,37 +216,49 @@ _mongoc_scram_destroy (mongoc_scram_t *scram)
    }
 
    bson_free (scram->auth_message);
-
-   if (scram->cache) {
-      _mongoc_scram_cache_destroy (scram->cache);
-   }
 }
 
 
-/* Updates the cache with scram's last-used pre-secrets and secrets */
-static void
+/* Updates the cache with scram's last-used pre-secrets and secrets,
+ * replacing any entry for the same user and mechanism */
+void
 _mongoc_scram_update_cache (mongoc_scram_t *scram)
 {
    mongoc_scram_cache_t *cache;
+   mongoc_scram_cache_entry_t *entry;
+   mongoc_scram_cache_entry_t new_entry = {0};
 
    BSON_ASSERT (scram);
 
-   if (scram->cache) {
-      _mongoc_scram_cache_destroy (scram->cache);
+   cache = scram->cache;
+   if (!cache || !scram->user || !scram->hashed_password) {
+      return;
    }
 
-   cache = (mongoc_scram_cache_t *) bson_malloc0 (sizeof (*cache));
-   cache->hashed_password = bson_strdup (scram->hashed_password);
+   bson_mutex_lock (&cache->mutex);
+   entry = _mongoc_scram_cache_find (cache, scram);
+   if (!entry) {
+      new_entry.user = bson_strdup (scram->user);
+      new_entry.algorithm = scram->crypto.algorithm;
+      _mongoc_array_append_val (&cache->entries, new_entry);
+      entry = &_mongoc_array_index (&cache->entries,
+                                    mongoc_scram_cache_entry_t,
+                                    cache->entries.len - 1);
+   } else if (entry->hashed_password) {
+      bson_zero_free (entry->hashed_password,
+                      strlen (entry->hashed_password));
+   }
+
+   entry->hashed_password = bson_strdup (scram->hashed_password);
    memcpy (
-      cache->decoded_salt, scram->decoded_salt, sizeof (cache->decoded_salt));
-   cache->iterations = scram->iterations;
-   memcpy (cache->client_key, scram->client_key, sizeof (cache->client_key));
-   memcpy (cache->server_key, scram->server_key, sizeof (cache->server_key));
-   memcpy (cache->salted_password,
+      entry->decoded_salt, scram->decoded_salt, sizeof (entry->decoded_salt));
+   entry->iterations = scram->iterations;
+   memcpy (entry->client_key, scram->client_key, sizeof (entry->client_key));
+   memcpy (entry->server_key, scram->server_key, sizeof (entry->server_key));
+   memcpy (entry->salted_password,
            scram->salted_password,
-           sizeof (cache->salted_password));
-
-   scram->cache = cache;
+           sizeof (entry->salted_password));
+   bson_mutex_unlock (&cache->mutex);
 }
 
 
@@ -757,8 +796,7 @@ _mongoc_scram_step2 (mongoc_scram_t *scram,
    scram->iterations = iterations;
    memcpy (scram->decoded_salt, decoded_salt, sizeof (scram->decoded_salt));
 
-   if (scram->cache &&
-       _mongoc_scram_cache_has_presecrets (scram->cache, scram)) {
+   if (scram->cache) {
       _mongoc_scram_cache_apply_secrets (scram->cache, scram);
    }
 
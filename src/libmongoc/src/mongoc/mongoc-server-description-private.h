@@ -43,6 +43,22 @@ typedef enum {
    MONGOC_SERVER_DESCRIPTION_TYPES,
 } mongoc_server_description_type_t;
 
+/* latency histogram buckets: four per power of two microseconds */
+#define MONGOC_SERVER_LOAD_BUCKETS 128
+
+/* a server's load as seen by this client or pool, shared by all copies of
+ * its server description */
+typedef struct _mongoc_server_load_t {
+   volatile int32_t refcount;
+   /* operations sent to the server and not yet answered */
+   volatile int32_t in_flight;
+   /* moving average of operation latency in microseconds, -1 if none yet */
+   volatile int32_t latency_usec;
+   /* recent operation latencies, halved now and then to forget old ones */
+   volatile int32_t latency_counts[MONGOC_SERVER_LOAD_BUCKETS];
+   volatile int32_t latency_total;
+} mongoc_server_load_t;
+
 struct _mongoc_server_description_t {
    uint32_t id;
    mongoc_host_list_t host;
@@ -78,6 +94,8 @@ struct _mongoc_server_description_t {
    int64_t last_write_date_ms;
 
    bson_t compressors;
+
+   mongoc_server_load_t *load;
 };
 
 void
@@ -116,6 +134,27 @@ void
 mongoc_server_description_update_rtt (mongoc_server_description_t *server,
                                       int64_t rtt_msec);
 
+void
+mongoc_server_description_op_started (mongoc_server_description_t *sd);
+
+void
+mongoc_server_description_op_finished (mongoc_server_description_t *sd,
+                                       int64_t duration_usec);
+
+void
+mongoc_server_description_op_abandoned (mongoc_server_description_t *sd);
+
+void
+mongoc_server_description_share_load (mongoc_server_description_t *sd,
+                                      const mongoc_server_description_t *from);
+
+int64_t
+mongoc_server_description_load_score (const mongoc_server_description_t *sd);
+
+int64_t
+mongoc_server_description_latency_percentile (
+   const mongoc_server_description_t *sd, int32_t percentile);
+
 void
 mongoc_server_description_handle_ismaster (mongoc_server_description_t *sd,
                                            const bson_t *reply,
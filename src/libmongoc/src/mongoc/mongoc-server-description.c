@@ -29,6 +29,11 @@
 
 #define ALPHA 0.2
 
+/* latencies counted before the histogram is halved */
+#define LATENCY_WINDOW 1000
+/* latencies needed to estimate a percentile */
+#define LATENCY_MIN_SAMPLES 16
+
 static bson_oid_t kObjectIdZero = {{0}};
 
 static bool
@@ -47,6 +52,10 @@ mongoc_server_description_cleanup (mongoc_server_description_t *sd)
    bson_destroy (&sd->arbiters);
    bson_destroy (&sd->tags);
    bson_destroy (&sd->compressors);
+
+   if (sd->load && bson_atomic_int_add (&sd->load->refcount, -1) == 0) {
+      bson_free (sd->load);
+   }
 }
 
 /* Reset fields inside this sd, but keep same id, host information, and RTT,
@@ -120,6 +129,9 @@ mongoc_server_description_init (mongoc_server_description_t *sd,
    sd->id = id;
    sd->type = MONGOC_SERVER_UNKNOWN;
    sd->round_trip_time_msec = -1;
+   sd->load = (mongoc_server_load_t *) bson_malloc0 (sizeof *sd->load);
+   sd->load->refcount = 1;
+   sd->load->latency_usec = -1;
 
    if (!_mongoc_host_list_from_string (&sd->host, address)) {
       MONGOC_WARNING ("Failed to parse uri for %s", address);
@@ -463,6 +475,210 @@ mongoc_server_description_update_rtt (mongoc_server_description_t *server,
 }
 
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_op_started --
+ * mongoc_server_description_op_finished --
+ *
+ *       Track an operation sent to this server: the number in flight, and
+ *       an exponentially-weighted moving average of their latency. Unlike
+ *       the RTT, which only measures ismaster, this sees the server slow
+ *       down under load as soon as its replies do.
+ *
+ * Side effects:
+ *       Updates the load shared by all copies of @sd. Concurrent updates
+ *       of the average may overwrite each other, which only loses samples.
+ *
+ *-------------------------------------------------------------------------
+ */
+void
+mongoc_server_description_op_started (mongoc_server_description_t *sd)
+{
+   if (sd->load) {
+      bson_atomic_int_add (&sd->load->in_flight, 1);
+   }
+}
+
+
+/* the latency histogram bucket for @usec: exact below 4us, then four
+ * buckets for each power of two */
+static int
+_latency_bucket (int64_t usec)
+{
+   int bits = 0;
+
+   if (usec < 4) {
+      return (int) BSON_MAX (usec, 0);
+   }
+
+   while ((usec >> bits) >= 8) {
+      bits++;
+   }
+
+   /* usec >> bits is 4 to 7 */
+   return 4 * (bits + 1) + (int) ((usec >> bits) - 4);
+}
+
+
+/* the least latency above all of @bucket's */
+static int64_t
+_latency_bucket_limit (int bucket)
+{
+   if (bucket < 4) {
+      return bucket + 1;
+   }
+
+   return (int64_t) (bucket % 4 + 5) << (bucket / 4 - 1);
+}
+
+
+void
+mongoc_server_description_op_finished (mongoc_server_description_t *sd,
+                                       int64_t duration_usec)
+{
+   mongoc_server_load_t *load = sd->load;
+   int32_t latency_usec;
+   int i;
+
+   if (!load) {
+      return;
+   }
+
+   bson_atomic_int_add (&load->in_flight, -1);
+
+   duration_usec = BSON_MIN (duration_usec, INT32_MAX);
+   latency_usec = load->latency_usec;
+   if (latency_usec == -1) {
+      load->latency_usec = (int32_t) duration_usec;
+   } else {
+      load->latency_usec =
+         (int32_t) (ALPHA * duration_usec + (1 - ALPHA) * latency_usec);
+   }
+
+   bson_atomic_int_add (&load->latency_counts[_latency_bucket (duration_usec)],
+                        1);
+
+   if (bson_atomic_int_add (&load->latency_total, 1) == LATENCY_WINDOW) {
+      /* only the thread that filled the window halves it */
+      for (i = 0; i < MONGOC_SERVER_LOAD_BUCKETS; i++) {
+         bson_atomic_int_add (&load->latency_counts[i],
+                              -(load->latency_counts[i] / 2));
+      }
+
+      bson_atomic_int_add (&load->latency_total, -LATENCY_WINDOW / 2);
+   }
+}
+
+
+/* an operation whose reply was never read, like the slower of a hedged
+ * read's two: it's no longer in flight, but its duration isn't a latency */
+void
+mongoc_server_description_op_abandoned (mongoc_server_description_t *sd)
+{
+   if (sd->load) {
+      bson_atomic_int_add (&sd->load->in_flight, -1);
+   }
+}
+
+
+/* track @sd's operations in @from's load record, like a copy of @from */
+void
+mongoc_server_description_share_load (mongoc_server_description_t *sd,
+                                      const mongoc_server_description_t *from)
+{
+   if (sd->load == from->load) {
+      return;
+   }
+
+   if (sd->load && bson_atomic_int_add (&sd->load->refcount, -1) == 0) {
+      bson_free (sd->load);
+   }
+
+   sd->load = from->load;
+   if (sd->load) {
+      bson_atomic_int_add (&sd->load->refcount, 1);
+   }
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_latency_percentile --
+ *
+ *       Estimate the latency in microseconds that @percentile percent of
+ *       recent operations on this server finished within. The estimate is
+ *       rounded up, by at most a quarter.
+ *
+ * Returns:
+ *       The latency, or -1 if too few operations have finished.
+ *
+ *-------------------------------------------------------------------------
+ */
+int64_t
+mongoc_server_description_latency_percentile (
+   const mongoc_server_description_t *sd, int32_t percentile)
+{
+   int32_t counts[MONGOC_SERVER_LOAD_BUCKETS];
+   int64_t total = 0;
+   int64_t seen = 0;
+   int i;
+
+   if (!sd->load) {
+      return -1;
+   }
+
+   for (i = 0; i < MONGOC_SERVER_LOAD_BUCKETS; i++) {
+      counts[i] = BSON_MAX (sd->load->latency_counts[i], 0);
+      total += counts[i];
+   }
+
+   if (total < LATENCY_MIN_SAMPLES) {
+      return -1;
+   }
+
+   for (i = 0; i < MONGOC_SERVER_LOAD_BUCKETS; i++) {
+      seen += counts[i];
+      if (seen * 100 >= total * percentile) {
+         break;
+      }
+   }
+
+   return _latency_bucket_limit (BSON_MIN (i, MONGOC_SERVER_LOAD_BUCKETS - 1));
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * mongoc_server_description_load_score --
+ *
+ *       The expected wait for an operation on this server: its operation
+ *       latency, or its RTT until an operation has finished, times the
+ *       number of operations in flight plus one. Lower is better.
+ *
+ *-------------------------------------------------------------------------
+ */
+int64_t
+mongoc_server_description_load_score (const mongoc_server_description_t *sd)
+{
+   int64_t latency_usec = -1;
+   int32_t in_flight = 0;
+
+   if (sd->load) {
+      latency_usec = sd->load->latency_usec;
+      in_flight = BSON_MAX (sd->load->in_flight, 0);
+   }
+
+   if (latency_usec == -1) {
+      latency_usec = BSON_MAX (sd->round_trip_time_msec, 0) * 1000;
+   }
+
+   return (latency_usec + 1) * (in_flight + 1);
+}
+
+
 static void
 _mongoc_server_description_set_error (mongoc_server_description_t *sd,
                                       const bson_error_t *error)
@@ -720,6 +936,12 @@ mongoc_server_description_new_copy (
    memcpy (&copy->host, &description->host, sizeof (copy->host));
    copy->round_trip_time_msec = -1;
 
+   /* all copies track the same server's load */
+   copy->load = description->load;
+   if (copy->load) {
+      bson_atomic_int_add (&copy->load->refcount, 1);
+   }
+
    copy->connection_address = copy->host.host_and_port;
    bson_init (&copy->last_is_master);
    bson_init (&copy->hosts);
@@ -25,6 +25,7 @@
 
 #include <bson.h>
 
+#include "mongoc-buffer-private.h"
 #include "mongoc-topology-description-private.h"
 #include "mongoc-server-description-private.h"
 #include "mongoc-stream.h"
@@ -36,6 +37,7 @@ typedef struct _mongoc_server_stream_t {
    mongoc_server_description_t *sd; /* owned */
    bson_t cluster_time;             /* owned */
    mongoc_stream_t *stream;         /* borrowed */
+   mongoc_buffer_t *buffer;         /* borrowed, the stream's receive buffer */
 } mongoc_server_stream_t;
 
 
@@ -50,6 +50,13 @@ typedef MONGOC_SOCKET_ARG3 mongoc_socklen_t;
 
 typedef struct _mongoc_socket_t mongoc_socket_t;
 
+/* the operating system's handle for a socket */
+#ifdef _WIN32
+typedef SOCKET mongoc_socket_fd_t;
+#else
+typedef int mongoc_socket_fd_t;
+#endif
+
 typedef struct {
    mongoc_socket_t *socket;
    int events;
@@ -197,9 +197,11 @@ mongoc_stream_buffered_writev (mongoc_stream_t *stream, /* IN */
  *       Read from the underlying stream. The data will be buffered based
  *       on the buffered streams target buffer size.
  *
- *       When reading from the underlying stream, we read at least the
- *       requested number of bytes, but try to also fill the stream to
- *       the size of the underlying buffer.
+ *       When reading from the underlying stream, we read at least
+ *       @min_bytes, but try to also fill the stream to the size of the
+ *       underlying buffer. As many buffered bytes as fit in @iov are
+ *       returned. Reads at least as large as the underlying buffer
+ *       bypass it when it is empty.
  *
  * Note:
  *       This isn't actually a huge savings since we never have more than
@@ -226,6 +228,8 @@ mongoc_stream_buffered_readv (mongoc_stream_t *stream, /* IN */
    mongoc_stream_buffered_t *buffered = (mongoc_stream_buffered_t *) stream;
    bson_error_t error = {0};
    size_t total_bytes = 0;
+   size_t n_bytes;
+   size_t n;
    size_t i;
    size_t off = 0;
 
@@ -237,27 +241,40 @@ mongoc_stream_buffered_readv (mongoc_stream_t *stream, /* IN */
       total_bytes += iov[i].iov_len;
    }
 
+   /* the caller's buffers are at least as big as ours, copying through
+    * ours would only add a memcpy */
+   if (!buffered->buffer.len && total_bytes >= buffered->buffer.datalen) {
+      RETURN (mongoc_stream_readv (
+         buffered->base_stream, iov, iovcnt, min_bytes, timeout_msec));
+   }
+
+   /* a poll-driven caller passes min_bytes 0 and expects whatever is
+    * available, so don't return early with an empty buffer */
    if (-1 == _mongoc_buffer_fill (&buffered->buffer,
                                   buffered->base_stream,
-                                  total_bytes,
+                                  BSON_MAX (min_bytes, 1),
                                   timeout_msec,
                                   &error)) {
       MONGOC_WARNING ("%s", error.message);
       RETURN (-1);
    }
 
-   BSON_ASSERT (buffered->buffer.len >= total_bytes);
+   BSON_ASSERT (buffered->buffer.len >= min_bytes);
 
-   for (i = 0; i < iovcnt; i++) {
-      memcpy (iov[i].iov_base, buffered->buffer.data + off, iov[i].iov_len);
-      off += iov[i].iov_len;
-      buffered->buffer.len -= iov[i].iov_len;
+   n_bytes = BSON_MIN (total_bytes, buffered->buffer.len);
+
+   for (i = 0; i < iovcnt && off < n_bytes; i++) {
+      n = BSON_MIN (iov[i].iov_len, n_bytes - off);
+      memcpy (iov[i].iov_base, buffered->buffer.data + off, n);
+      off += n;
    }
 
-   memmove (
-      buffered->buffer.data, buffered->buffer.data + off, buffered->buffer.len);
+   buffered->buffer.len -= n_bytes;
+   memmove (buffered->buffer.data,
+            buffered->buffer.data + n_bytes,
+            buffered->buffer.len);
 
-   RETURN (total_bytes);
+   RETURN ((ssize_t) n_bytes);
 }
 
 
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_STREAM_IO_URING_PRIVATE_H
+#define MONGOC_STREAM_IO_URING_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include "mongoc-config.h"
+
+#ifdef MONGOC_ENABLE_IO_URING
+
+#include "mongoc-socket.h"
+#include "mongoc-stream.h"
+
+
+BSON_BEGIN_DECLS
+
+
+mongoc_stream_t *
+_mongoc_stream_io_uring_new (mongoc_socket_t *sock);
+
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_ENABLE_IO_URING */
+
+#endif /* MONGOC_STREAM_IO_URING_PRIVATE_H */
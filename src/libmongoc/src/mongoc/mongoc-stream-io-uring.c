@@ -0,0 +1,731 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mongoc-config.h"
+
+#ifdef MONGOC_ENABLE_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+#include "mongoc-counters-private.h"
+#include "mongoc-errno-private.h"
+#include "mongoc-socket-private.h"
+#include "mongoc-stream-io-uring-private.h"
+#include "mongoc-stream-private.h"
+#include "mongoc-trace-private.h"
+
+#undef MONGOC_LOG_DOMAIN
+#define MONGOC_LOG_DOMAIN "stream"
+
+
+/* at most one operation and its linked timeout are ever in flight */
+#define MONGOC_IO_URING_ENTRIES 4
+#define MONGOC_IO_URING_BUF_SIZE (16 * 1024)
+
+#define MONGOC_IO_URING_OP 1
+#define MONGOC_IO_URING_TIMEOUT 2
+
+
+/*
+ * A socket stream that does its I/O through a small io_uring of its own.
+ * Each read or write is one submission, linked to a timeout that cancels
+ * it, so a blocking operation costs a single io_uring_enter instead of
+ * a poll () plus a recv () or send (). Small reads land in a read-ahead
+ * buffer registered with the ring; reads as large as that buffer go
+ * straight into the caller's memory.
+ */
+typedef struct _mongoc_stream_io_uring_t {
+   mongoc_stream_t vtable;
+   mongoc_socket_t *sock;
+   int ring_fd;
+   void *sq_ring;
+   size_t sq_ring_size;
+   void *cq_ring;
+   size_t cq_ring_size;
+   struct io_uring_sqe *sqes;
+   size_t sqes_size;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_cqe *cqes;
+   unsigned sq_pending;
+   uint8_t *buf;
+   bool buf_registered;
+   size_t buf_pos;
+   size_t buf_len;
+   int errno_;
+} mongoc_stream_io_uring_t;
+
+
+static BSON_INLINE int64_t
+get_expiration (int32_t timeout_msec)
+{
+   if (timeout_msec < 0) {
+      return -1;
+   } else if (timeout_msec == 0) {
+      return 0;
+   } else {
+      return (bson_get_monotonic_time () + ((int64_t) timeout_msec * 1000L));
+   }
+}
+
+
+static void
+_mongoc_stream_io_uring_ring_destroy (mongoc_stream_io_uring_t *us)
+{
+   if (us->sqes) {
+      munmap (us->sqes, us->sqes_size);
+   }
+
+   if (us->cq_ring && us->cq_ring != us->sq_ring) {
+      munmap (us->cq_ring, us->cq_ring_size);
+   }
+
+   if (us->sq_ring) {
+      munmap (us->sq_ring, us->sq_ring_size);
+   }
+
+   /* also unregisters the read-ahead buffer */
+   if (us->ring_fd != -1) {
+      close (us->ring_fd);
+   }
+}
+
+
+static void *
+_mongoc_stream_io_uring_mmap (int ring_fd, size_t size, off_t offset)
+{
+   void *ptr;
+
+   ptr = mmap (NULL,
+               size,
+               PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE,
+               ring_fd,
+               offset);
+
+   return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+
+static bool
+_mongoc_stream_io_uring_ring_init (mongoc_stream_io_uring_t *us)
+{
+   struct io_uring_params params;
+   struct iovec reg;
+
+   memset (&params, 0, sizeof params);
+   us->ring_fd =
+      (int) syscall (__NR_io_uring_setup, MONGOC_IO_URING_ENTRIES, &params);
+
+   /* fast poll (Linux 5.7) lets socket operations wait without a worker */
+   if (us->ring_fd == -1 || !(params.features & IORING_FEAT_FAST_POLL)) {
+      return false;
+   }
+
+   us->sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof (unsigned);
+   us->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+
+   if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      us->sq_ring_size = BSON_MAX (us->sq_ring_size, us->cq_ring_size);
+   }
+
+   us->sq_ring = _mongoc_stream_io_uring_mmap (
+      us->ring_fd, us->sq_ring_size, IORING_OFF_SQ_RING);
+
+   if (!us->sq_ring) {
+      return false;
+   }
+
+   if (params.features & IORING_FEAT_SINGLE_MMAP) {
+      us->cq_ring = us->sq_ring;
+   } else {
+      us->cq_ring = _mongoc_stream_io_uring_mmap (
+         us->ring_fd, us->cq_ring_size, IORING_OFF_CQ_RING);
+
+      if (!us->cq_ring) {
+         return false;
+      }
+   }
+
+   us->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+   us->sqes = _mongoc_stream_io_uring_mmap (
+      us->ring_fd, us->sqes_size, IORING_OFF_SQES);
+
+   if (!us->sqes) {
+      return false;
+   }
+
+   us->sq_tail = (unsigned *) ((char *) us->sq_ring + params.sq_off.tail);
+   us->sq_mask = (unsigned *) ((char *) us->sq_ring + params.sq_off.ring_mask);
+   us->sq_array = (unsigned *) ((char *) us->sq_ring + params.sq_off.array);
+   us->cq_head = (unsigned *) ((char *) us->cq_ring + params.cq_off.head);
+   us->cq_tail = (unsigned *) ((char *) us->cq_ring + params.cq_off.tail);
+   us->cq_mask = (unsigned *) ((char *) us->cq_ring + params.cq_off.ring_mask);
+   us->cqes =
+      (struct io_uring_cqe *) ((char *) us->cq_ring + params.cq_off.cqes);
+
+   /* registering pins the buffer, which RLIMIT_MEMLOCK may refuse; then
+    * reads into it simply aren't "fixed" */
+   reg.iov_base = us->buf;
+   reg.iov_len = MONGOC_IO_URING_BUF_SIZE;
+   us->buf_registered = 0 == syscall (__NR_io_uring_register,
+                                      us->ring_fd,
+                                      IORING_REGISTER_BUFFERS,
+                                      &reg,
+                                      1);
+
+   return true;
+}
+
+
+static struct io_uring_sqe *
+_mongoc_stream_io_uring_prep (mongoc_stream_io_uring_t *us,
+                              uint8_t opcode,
+                              const void *addr,
+                              uint32_t len,
+                              uint64_t user_data)
+{
+   struct io_uring_sqe *sqe;
+   unsigned index;
+
+   BSON_ASSERT (us->sq_pending < MONGOC_IO_URING_ENTRIES);
+
+   index = (*us->sq_tail + us->sq_pending++) & *us->sq_mask;
+   sqe = &us->sqes[index];
+   memset (sqe, 0, sizeof *sqe);
+   sqe->opcode = opcode;
+   sqe->fd = us->sock->sd;
+   sqe->addr = (uint64_t) (uintptr_t) addr;
+   sqe->len = len;
+   sqe->user_data = user_data;
+   us->sq_array[index] = index;
+
+   return sqe;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_io_uring_submit --
+ *
+ *       Submit the operation @sqe, linked to a timeout that cancels it at
+ *       @expire_at unless that is 0 or -1, and wait for the whole chain
+ *       with a single io_uring_enter.
+ *
+ * Returns:
+ *       The operation's result: a byte count, or a negative errno;
+ *       -ETIMEDOUT if it was canceled by the timeout.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static int
+_mongoc_stream_io_uring_submit (mongoc_stream_io_uring_t *us,
+                                struct io_uring_sqe *sqe,
+                                int64_t expire_at)
+{
+   struct __kernel_timespec ts;
+   struct io_uring_sqe *timeout;
+   struct io_uring_cqe *cqe;
+   unsigned to_submit;
+   unsigned to_complete;
+   unsigned head;
+   int64_t remaining;
+   int op_res = -ECANCELED;
+   int timeout_res = 0;
+   int r;
+
+   if (expire_at > 0) {
+      remaining = expire_at - bson_get_monotonic_time ();
+
+      if (remaining <= 0) {
+         us->sq_pending = 0;
+         mongoc_counter_streams_timeout_inc ();
+         return -ETIMEDOUT;
+      }
+
+      ts.tv_sec = remaining / 1000000;
+      ts.tv_nsec = (remaining % 1000000) * 1000;
+      sqe->flags |= IOSQE_IO_LINK;
+      timeout = _mongoc_stream_io_uring_prep (
+         us, IORING_OP_LINK_TIMEOUT, &ts, 1, MONGOC_IO_URING_TIMEOUT);
+      timeout->fd = -1;
+   }
+
+   to_submit = to_complete = us->sq_pending;
+   us->sq_pending = 0;
+   __atomic_store_n (us->sq_tail, *us->sq_tail + to_submit, __ATOMIC_RELEASE);
+
+   while (to_complete) {
+      r = (int) syscall (__NR_io_uring_enter,
+                         us->ring_fd,
+                         to_submit,
+                         to_complete,
+                         IORING_ENTER_GETEVENTS,
+                         NULL,
+                         0);
+
+      if (r == -1) {
+         if (to_submit) {
+            /* nothing was consumed, take the entries back */
+            r = errno;
+            __atomic_store_n (
+               us->sq_tail, *us->sq_tail - to_submit, __ATOMIC_RELEASE);
+            return -r;
+         }
+
+         /* waiting is only ever interrupted; the kernel still owns the
+          * caller's memory, so keep waiting */
+         continue;
+      }
+
+      to_submit -= (unsigned) r;
+      head = *us->cq_head;
+
+      while (head != __atomic_load_n (us->cq_tail, __ATOMIC_ACQUIRE)) {
+         cqe = &us->cqes[head & *us->cq_mask];
+
+         if (cqe->user_data == MONGOC_IO_URING_OP) {
+            op_res = cqe->res;
+         } else {
+            timeout_res = cqe->res;
+         }
+
+         head++;
+         to_complete--;
+      }
+
+      __atomic_store_n (us->cq_head, head, __ATOMIC_RELEASE);
+   }
+
+   if (op_res == -ECANCELED && timeout_res == -ETIME) {
+      mongoc_counter_streams_timeout_inc ();
+      return -ETIMEDOUT;
+   }
+
+   return op_res;
+}
+
+
+static int
+_mongoc_stream_io_uring_close (mongoc_stream_t *stream)
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+   int ret;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   ret = mongoc_socket_close (us->sock);
+
+   RETURN (ret);
+}
+
+
+static void
+_mongoc_stream_io_uring_destroy (mongoc_stream_t *stream)
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   _mongoc_stream_io_uring_ring_destroy (us);
+   mongoc_socket_destroy (us->sock);
+   bson_free (us->buf);
+   bson_free (us);
+
+   mongoc_counter_streams_active_dec ();
+   mongoc_counter_streams_disposed_inc ();
+
+   EXIT;
+}
+
+
+static void
+_mongoc_stream_io_uring_failed (mongoc_stream_t *stream)
+{
+   ENTRY;
+
+   _mongoc_stream_io_uring_destroy (stream);
+
+   EXIT;
+}
+
+
+static int
+_mongoc_stream_io_uring_setsockopt (mongoc_stream_t *stream,
+                                    int level,
+                                    int optname,
+                                    void *optval,
+                                    mongoc_socklen_t optlen)
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+   int ret;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   ret = mongoc_socket_setsockopt (us->sock, level, optname, optval, optlen);
+
+   RETURN (ret);
+}
+
+
+static int
+_mongoc_stream_io_uring_flush (mongoc_stream_t *stream)
+{
+   ENTRY;
+   RETURN (0);
+}
+
+
+static ssize_t
+_mongoc_stream_io_uring_readv (mongoc_stream_t *stream,
+                               mongoc_iovec_t *iov,
+                               size_t iovcnt,
+                               size_t min_bytes,
+                               int32_t timeout_msec)
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+   struct io_uring_sqe *sqe;
+   int64_t expire_at;
+   ssize_t ret = 0;
+   size_t cur = 0;
+   size_t off = 0;
+   size_t n;
+   bool direct;
+   int nread;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   expire_at = get_expiration (timeout_msec);
+   us->errno_ = 0;
+
+   for (;;) {
+      /* first hand out what the last read left in the buffer */
+      while (cur < iovcnt && us->buf_pos < us->buf_len) {
+         n = BSON_MIN (iov[cur].iov_len - off, us->buf_len - us->buf_pos);
+         memcpy ((char *) iov[cur].iov_base + off, us->buf + us->buf_pos, n);
+         us->buf_pos += n;
+         off += n;
+         ret += n;
+
+         if (off == iov[cur].iov_len) {
+            cur++;
+            off = 0;
+         }
+      }
+
+      while (cur < iovcnt && off == iov[cur].iov_len) {
+         cur++;
+         off = 0;
+      }
+
+      if (cur == iovcnt || (ret > 0 && ret >= (ssize_t) min_bytes)) {
+         RETURN (ret);
+      }
+
+      direct = iov[cur].iov_len - off >= MONGOC_IO_URING_BUF_SIZE;
+
+      if (direct) {
+         sqe = _mongoc_stream_io_uring_prep (us,
+                                             IORING_OP_RECV,
+                                             (char *) iov[cur].iov_base + off,
+                                             (uint32_t) BSON_MIN (
+                                                iov[cur].iov_len - off,
+                                                INT32_MAX),
+                                             MONGOC_IO_URING_OP);
+      } else if (us->buf_registered && expire_at != 0) {
+         sqe = _mongoc_stream_io_uring_prep (us,
+                                             IORING_OP_READ_FIXED,
+                                             us->buf,
+                                             MONGOC_IO_URING_BUF_SIZE,
+                                             MONGOC_IO_URING_OP);
+         sqe->buf_index = 0;
+      } else {
+         sqe = _mongoc_stream_io_uring_prep (us,
+                                             IORING_OP_RECV,
+                                             us->buf,
+                                             MONGOC_IO_URING_BUF_SIZE,
+                                             MONGOC_IO_URING_OP);
+      }
+
+      if (expire_at == 0) {
+         sqe->msg_flags = MSG_DONTWAIT;
+      }
+
+      nread = _mongoc_stream_io_uring_submit (us, sqe, expire_at);
+
+      if (nread <= 0) {
+         us->errno_ = -nread;
+
+         if (ret >= (ssize_t) min_bytes) {
+            RETURN (ret);
+         }
+
+         errno = us->errno_;
+         RETURN (-1);
+      }
+
+      mongoc_counter_streams_ingress_add (nread);
+
+      if (direct) {
+         off += nread;
+         ret += nread;
+      } else {
+         us->buf_pos = 0;
+         us->buf_len = (size_t) nread;
+      }
+   }
+}
+
+
+static ssize_t
+_mongoc_stream_io_uring_writev (mongoc_stream_t *stream,
+                                mongoc_iovec_t *in_iov,
+                                size_t iovcnt,
+                                int32_t timeout_msec)
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+   struct io_uring_sqe *sqe;
+   struct msghdr msg;
+   mongoc_iovec_t *iov;
+   int64_t expire_at;
+   ssize_t ret = 0;
+   size_t cur = 0;
+   int sent;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+   BSON_ASSERT (in_iov);
+   BSON_ASSERT (iovcnt);
+
+   expire_at = get_expiration (timeout_msec);
+   us->errno_ = 0;
+
+   iov = bson_malloc (sizeof (*iov) * iovcnt);
+   memcpy (iov, in_iov, sizeof (*iov) * iovcnt);
+
+   while (cur < iovcnt) {
+      memset (&msg, 0, sizeof msg);
+      msg.msg_iov = (struct iovec *) &iov[cur];
+      msg.msg_iovlen = iovcnt - cur;
+
+      sqe = _mongoc_stream_io_uring_prep (
+         us, IORING_OP_SENDMSG, &msg, 1, MONGOC_IO_URING_OP);
+      sqe->msg_flags = MSG_NOSIGNAL | (expire_at == 0 ? MSG_DONTWAIT : 0);
+
+      sent = _mongoc_stream_io_uring_submit (us, sqe, expire_at);
+
+      if (sent < 0) {
+         us->errno_ = -sent;
+
+         /* like a socket stream, a timeout returns the partial count */
+         if (!MONGOC_ERRNO_IS_AGAIN (us->errno_) &&
+             !MONGOC_ERRNO_IS_TIMEDOUT (us->errno_)) {
+            ret = -1;
+         }
+
+         break;
+      }
+
+      if (sent == 0) {
+         break;
+      }
+
+      ret += sent;
+      mongoc_counter_streams_egress_add (sent);
+
+      while (cur < iovcnt && sent >= (ssize_t) iov[cur].iov_len) {
+         sent -= (int) iov[cur++].iov_len;
+      }
+
+      if (cur < iovcnt) {
+         iov[cur].iov_base = ((char *) iov[cur].iov_base) + sent;
+         iov[cur].iov_len -= sent;
+      }
+   }
+
+   bson_free (iov);
+   errno = us->errno_;
+
+   RETURN (ret);
+}
+
+
+static ssize_t
+_mongoc_stream_io_uring_poll (mongoc_stream_poll_t *streams,
+                              size_t nstreams,
+                              int32_t timeout_msec)
+{
+   mongoc_stream_io_uring_t *us;
+   mongoc_socket_poll_t *sds;
+   size_t nbuffered = 0;
+   ssize_t ret;
+   size_t i;
+
+   ENTRY;
+
+   sds = (mongoc_socket_poll_t *) bson_malloc (sizeof (*sds) * nstreams);
+
+   for (i = 0; i < nstreams; i++) {
+      us = (mongoc_stream_io_uring_t *) streams[i].stream;
+      sds[i].socket = us->sock;
+      sds[i].events = streams[i].events;
+
+      if ((streams[i].events & POLLIN) && us->buf_pos < us->buf_len) {
+         nbuffered++;
+      }
+   }
+
+   /* a stream with read-ahead bytes is readable whatever the socket says */
+   ret = mongoc_socket_poll (sds, nstreams, nbuffered ? 0 : timeout_msec);
+
+   if (ret >= 0) {
+      ret = 0;
+
+      for (i = 0; i < nstreams; i++) {
+         us = (mongoc_stream_io_uring_t *) streams[i].stream;
+         streams[i].revents = sds[i].revents;
+
+         if ((streams[i].events & POLLIN) && us->buf_pos < us->buf_len) {
+            streams[i].revents |= POLLIN;
+         }
+
+         if (streams[i].revents) {
+            ret++;
+         }
+      }
+   }
+
+   bson_free (sds);
+
+   RETURN (ret);
+}
+
+
+static bool
+_mongoc_stream_io_uring_check_closed (mongoc_stream_t *stream) /* IN */
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   if (us->buf_pos < us->buf_len) {
+      RETURN (false);
+   }
+
+   RETURN (mongoc_socket_check_closed (us->sock));
+}
+
+
+static bool
+_mongoc_stream_io_uring_timed_out (mongoc_stream_t *stream) /* IN */
+{
+   mongoc_stream_io_uring_t *us = (mongoc_stream_io_uring_t *) stream;
+
+   ENTRY;
+
+   BSON_ASSERT (us);
+
+   RETURN (MONGOC_ERRNO_IS_TIMEDOUT (us->errno_));
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_io_uring_new --
+ *
+ *       Create a new mongoc_stream_t doing I/O on @sock through io_uring.
+ *       @sock is switched to blocking mode: the ring does all the waiting.
+ *
+ * Returns:
+ *       A stream that takes ownership of @sock, or NULL if io_uring is
+ *       unavailable at runtime; then @sock is untouched.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+_mongoc_stream_io_uring_new (mongoc_socket_t *sock) /* IN */
+{
+   mongoc_stream_io_uring_t *us;
+   int flags;
+
+   BSON_ASSERT (sock);
+
+   us = (mongoc_stream_io_uring_t *) bson_malloc0 (sizeof *us);
+   us->ring_fd = -1;
+   us->buf = (uint8_t *) bson_malloc (MONGOC_IO_URING_BUF_SIZE);
+
+   if (!_mongoc_stream_io_uring_ring_init (us)) {
+      TRACE ("io_uring unavailable: %s", strerror (errno));
+      goto FAIL;
+   }
+
+   flags = fcntl (sock->sd, F_GETFL);
+   if (flags == -1 || -1 == fcntl (sock->sd, F_SETFL, flags & ~O_NONBLOCK)) {
+      goto FAIL;
+   }
+
+   us->vtable.type = MONGOC_STREAM_IO_URING;
+   us->vtable.close = _mongoc_stream_io_uring_close;
+   us->vtable.destroy = _mongoc_stream_io_uring_destroy;
+   us->vtable.failed = _mongoc_stream_io_uring_failed;
+   us->vtable.flush = _mongoc_stream_io_uring_flush;
+   us->vtable.readv = _mongoc_stream_io_uring_readv;
+   us->vtable.writev = _mongoc_stream_io_uring_writev;
+   us->vtable.setsockopt = _mongoc_stream_io_uring_setsockopt;
+   us->vtable.check_closed = _mongoc_stream_io_uring_check_closed;
+   us->vtable.timed_out = _mongoc_stream_io_uring_timed_out;
+   us->vtable.poll = _mongoc_stream_io_uring_poll;
+   us->sock = sock;
+
+   mongoc_counter_streams_active_inc ();
+   return (mongoc_stream_t *) us;
+
+FAIL:
+   _mongoc_stream_io_uring_ring_destroy (us);
+   bson_free (us->buf);
+   bson_free (us);
+
+   return NULL;
+}
+
+#endif /* MONGOC_ENABLE_IO_URING */
@@ -33,6 +33,7 @@ BSON_BEGIN_DECLS
 #define MONGOC_STREAM_BUFFERED 3
 #define MONGOC_STREAM_GRIDFS 4
 #define MONGOC_STREAM_TLS 5
+#define MONGOC_STREAM_IO_URING 6
 
 bool
 mongoc_stream_wait (mongoc_stream_t *stream, int64_t expire_at);
@@ -47,6 +48,9 @@ _mongoc_stream_writev_full (mongoc_stream_t *stream,
 mongoc_stream_t *
 mongoc_stream_get_root_stream (mongoc_stream_t *stream);
 
+bool
+_mongoc_stream_get_socket_fd (mongoc_stream_t *stream, mongoc_socket_fd_t *fd);
+
 BSON_END_DECLS
 
 
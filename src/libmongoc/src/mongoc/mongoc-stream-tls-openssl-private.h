@@ -23,6 +23,10 @@
 
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
 #include <bson.h>
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#include "mongoc-stream-tls-private.h"
 
 BSON_BEGIN_DECLS
 
@@ -35,10 +39,21 @@ BSON_BEGIN_DECLS
 typedef struct {
    BIO *bio;
    BIO_METHOD *meth;
-   SSL_CTX *ctx;
+   SSL_CTX *ctx;           /* NULL if the context is shared via @cache */
+   mongoc_tls_cache_t *cache; /* borrowed, may be NULL */
+   char *session_key;         /* "host:port", its sessions' key in @cache */
 } mongoc_stream_tls_openssl_t;
 
 
+mongoc_stream_t *
+_mongoc_stream_tls_openssl_new_with_cache (mongoc_stream_t *base_stream,
+                                           const char *host,
+                                           uint16_t port,
+                                           mongoc_ssl_opt_t *opt,
+                                           int client,
+                                           mongoc_tls_cache_t *cache);
+
+
 BSON_END_DECLS
 
 #endif /* MONGOC_ENABLE_SSL_OPENSSL */
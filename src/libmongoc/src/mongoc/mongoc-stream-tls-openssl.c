@@ -93,6 +93,7 @@ _mongoc_stream_tls_openssl_destroy (mongoc_stream_t *stream)
    SSL_CTX_free (openssl->ctx);
    openssl->ctx = NULL;
 
+   bson_free (openssl->session_key);
    bson_free (openssl);
    bson_free (stream);
 
@@ -655,10 +656,38 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
                                const char *host,
                                mongoc_ssl_opt_t *opt,
                                int client)
+{
+   return _mongoc_stream_tls_openssl_new_with_cache (
+      base_stream, host, 0, opt, client, NULL);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_tls_openssl_new_with_cache --
+ *
+ *       Like mongoc_stream_tls_openssl_new, but a client stream with a
+ *       @cache uses the cache's shared SSL_CTX instead of building one, and
+ *       offers the last session negotiated with @host and @port for
+ *       resumption.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+_mongoc_stream_tls_openssl_new_with_cache (mongoc_stream_t *base_stream,
+                                           const char *host,
+                                           uint16_t port,
+                                           mongoc_ssl_opt_t *opt,
+                                           int client,
+                                           mongoc_tls_cache_t *cache)
 {
    mongoc_stream_tls_t *tls;
    mongoc_stream_tls_openssl_t *openssl;
    SSL_CTX *ssl_ctx = NULL;
+   SSL_CTX *owned_ctx = NULL;
+   SSL *ssl;
    BIO *bio_ssl = NULL;
    BIO *bio_mongoc_shim = NULL;
    BIO_METHOD *meth;
@@ -667,46 +696,38 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
    BSON_ASSERT (opt);
    ENTRY;
 
-   ssl_ctx = _mongoc_openssl_ctx_new (opt);
+   if (!client) {
+      cache = NULL;
+   }
+
+   if (cache) {
+      ssl_ctx = _mongoc_openssl_cache_get_ctx (cache, opt);
+   } else {
+      ssl_ctx = owned_ctx = _mongoc_openssl_ctx_new (opt);
+   }
 
    if (!ssl_ctx) {
       RETURN (NULL);
    }
 
-#if OPENSSL_VERSION_NUMBER >= 0x10002000L && !defined(LIBRESSL_VERSION_NUMBER)
-   if (!opt->allow_invalid_hostname) {
-      struct in_addr addr;
-      X509_VERIFY_PARAM *param = X509_VERIFY_PARAM_new ();
+   if (owned_ctx) {
+      if (!client) {
+         /* Only used by the Mock Server.
+          * Set a callback to get the SNI, if provided */
+         SSL_CTX_set_tlsext_servername_callback (
+            ssl_ctx, _mongoc_stream_tls_openssl_sni);
+      }
 
-      X509_VERIFY_PARAM_set_hostflags (param,
-                                       X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
-      if (inet_pton (AF_INET, host, &addr) ||
-          inet_pton (AF_INET6, host, &addr)) {
-         X509_VERIFY_PARAM_set1_ip_asc (param, host);
+      if (opt->weak_cert_validation) {
+         SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_NONE, NULL);
       } else {
-         X509_VERIFY_PARAM_set1_host (param, host, 0);
+         SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_PEER, NULL);
       }
-      SSL_CTX_set1_param (ssl_ctx, param);
-      X509_VERIFY_PARAM_free (param);
-   }
-#endif
-
-   if (!client) {
-      /* Only used by the Mock Server.
-       * Set a callback to get the SNI, if provided */
-      SSL_CTX_set_tlsext_servername_callback (ssl_ctx,
-                                              _mongoc_stream_tls_openssl_sni);
-   }
-
-   if (opt->weak_cert_validation) {
-      SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_NONE, NULL);
-   } else {
-      SSL_CTX_set_verify (ssl_ctx, SSL_VERIFY_PEER, NULL);
    }
 
    bio_ssl = BIO_new_ssl (ssl_ctx, client);
    if (!bio_ssl) {
-      SSL_CTX_free (ssl_ctx);
+      SSL_CTX_free (owned_ctx);
       RETURN (NULL);
    }
    meth = mongoc_stream_tls_openssl_bio_meth_new ();
@@ -714,15 +735,34 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
    if (!bio_mongoc_shim) {
       BIO_free_all (bio_ssl);
       BIO_meth_free (meth);
+      SSL_CTX_free (owned_ctx);
       RETURN (NULL);
    }
 
+   BIO_get_ssl (bio_ssl, &ssl);
+
+/* the hostname is checked per SSL, not per SSL_CTX, since the context may be
+ * shared by streams to every host in the topology */
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L && !defined(LIBRESSL_VERSION_NUMBER)
+   if (!opt->allow_invalid_hostname) {
+      struct in_addr addr;
+      X509_VERIFY_PARAM *param = SSL_get0_param (ssl);
+
+      X509_VERIFY_PARAM_set_hostflags (param,
+                                       X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+      if (inet_pton (AF_INET, host, &addr) ||
+          inet_pton (AF_INET6, host, &addr)) {
+         X509_VERIFY_PARAM_set1_ip_asc (param, host);
+      } else {
+         X509_VERIFY_PARAM_set1_host (param, host, 0);
+      }
+   }
+#endif
+
 /* Added in OpenSSL 0.9.8f, as a build time option */
 #ifdef SSL_CTRL_SET_TLSEXT_HOSTNAME
    if (client) {
-      SSL *ssl;
       /* Set the SNI hostname we are expecting certificate for */
-      BIO_get_ssl (bio_ssl, &ssl);
       SSL_set_tlsext_host_name (ssl, host);
 #endif
    }
@@ -733,7 +773,15 @@ mongoc_stream_tls_openssl_new (mongoc_stream_t *base_stream,
    openssl = (mongoc_stream_tls_openssl_t *) bson_malloc0 (sizeof *openssl);
    openssl->bio = bio_ssl;
    openssl->meth = meth;
-   openssl->ctx = ssl_ctx;
+   openssl->ctx = owned_ctx;
+
+   if (cache && host) {
+      openssl->cache = cache;
+      /* servers on one host are distinct TLS endpoints */
+      openssl->session_key = bson_strdup_printf ("%s:%hu", host, port);
+      SSL_set_app_data (ssl, openssl);
+      _mongoc_openssl_cache_resume (cache, openssl->session_key, ssl);
+   }
 
    tls = (mongoc_stream_tls_t *) bson_malloc0 (sizeof *tls);
    tls->parent.type = MONGOC_STREAM_TLS;
@@ -48,6 +48,28 @@ struct _mongoc_stream_tls_t {
 };
 
 
+/* an SSL context and TLS session cache shared by the streams of one client or
+ * client pool. opaque, only the OpenSSL backend implements it */
+typedef struct _mongoc_tls_cache_t mongoc_tls_cache_t;
+
+mongoc_tls_cache_t *
+_mongoc_tls_cache_new (void);
+
+void
+_mongoc_tls_cache_destroy (mongoc_tls_cache_t *cache);
+
+void
+_mongoc_tls_cache_reset (mongoc_tls_cache_t *cache);
+
+mongoc_stream_t *
+_mongoc_stream_tls_new_with_cache (mongoc_stream_t *base_stream,
+                                   const char *host,
+                                   uint16_t port,
+                                   mongoc_ssl_opt_t *opt,
+                                   int client,
+                                   mongoc_tls_cache_t *cache);
+
+
 BSON_END_DECLS
 
 #endif /* MONGOC_STREAM_TLS_PRIVATE_H */
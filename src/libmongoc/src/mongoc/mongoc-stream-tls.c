@@ -30,6 +30,7 @@
 #include "mongoc-stream-private.h"
 #if defined(MONGOC_ENABLE_SSL_OPENSSL)
 #include "mongoc-stream-tls-openssl.h"
+#include "mongoc-stream-tls-openssl-private.h"
 #include "mongoc-openssl-private.h"
 #elif defined(MONGOC_ENABLE_SSL_LIBRESSL)
 #include "mongoc-libressl-private.h"
@@ -200,6 +201,32 @@ mongoc_stream_tls_new_with_hostname (mongoc_stream_t *base_stream,
                                      const char *host,
                                      mongoc_ssl_opt_t *opt,
                                      int client)
+{
+   return _mongoc_stream_tls_new_with_cache (
+      base_stream, host, 0, opt, client, NULL);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_stream_tls_new_with_cache --
+ *
+ *       Like mongoc_stream_tls_new_with_hostname, but client streams share
+ *       the SSL context and resumable sessions kept in @cache, which may be
+ *       NULL. Sessions are kept per @host and @port. Backends other than
+ *       OpenSSL ignore @cache.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_stream_t *
+_mongoc_stream_tls_new_with_cache (mongoc_stream_t *base_stream,
+                                   const char *host,
+                                   uint16_t port,
+                                   mongoc_ssl_opt_t *opt,
+                                   int client,
+                                   mongoc_tls_cache_t *cache)
 {
    BSON_ASSERT (base_stream);
 
@@ -217,7 +244,8 @@ mongoc_stream_tls_new_with_hostname (mongoc_stream_t *base_stream,
 #endif
 
 #if defined(MONGOC_ENABLE_SSL_OPENSSL)
-   return mongoc_stream_tls_openssl_new (base_stream, host, opt, client);
+   return _mongoc_stream_tls_openssl_new_with_cache (
+      base_stream, host, port, opt, client, cache);
 #elif defined(MONGOC_ENABLE_SSL_LIBRESSL)
    return mongoc_stream_tls_libressl_new (base_stream, host, opt, client);
 #elif defined(MONGOC_ENABLE_SSL_SECURE_TRANSPORT)
@@ -230,6 +258,39 @@ mongoc_stream_tls_new_with_hostname (mongoc_stream_t *base_stream,
 #endif
 }
 
+
+mongoc_tls_cache_t *
+_mongoc_tls_cache_new (void)
+{
+#if defined(MONGOC_ENABLE_SSL_OPENSSL)
+   return _mongoc_openssl_cache_new ();
+#else
+   return NULL;
+#endif
+}
+
+
+void
+_mongoc_tls_cache_destroy (mongoc_tls_cache_t *cache)
+{
+#if defined(MONGOC_ENABLE_SSL_OPENSSL)
+   _mongoc_openssl_cache_destroy (cache);
+#endif
+}
+
+
+/* forget the context and sessions of old TLS options. streams may still
+ * borrow @cache, so it is reset in place rather than replaced */
+void
+_mongoc_tls_cache_reset (mongoc_tls_cache_t *cache)
+{
+#if defined(MONGOC_ENABLE_SSL_OPENSSL)
+   if (cache) {
+      _mongoc_openssl_cache_reset (cache);
+   }
+#endif
+}
+
 mongoc_stream_t *
 mongoc_stream_tls_new (mongoc_stream_t *base_stream,
                        mongoc_ssl_opt_t *opt,
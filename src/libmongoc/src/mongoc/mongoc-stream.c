@@ -25,8 +25,10 @@
 #include "mongoc-log.h"
 #include "mongoc-opcode.h"
 #include "mongoc-rpc-private.h"
+#include "mongoc-socket-private.h"
 #include "mongoc-stream.h"
 #include "mongoc-stream-private.h"
+#include "mongoc-stream-socket.h"
 #include "mongoc-trace-private.h"
 #include "mongoc-util-private.h"
 
@@ -326,6 +328,24 @@ mongoc_stream_get_root_stream (mongoc_stream_t *stream)
    return stream;
 }
 
+/* the socket under @stream, if it is a socket stream or wraps one */
+bool
+_mongoc_stream_get_socket_fd (mongoc_stream_t *stream, mongoc_socket_fd_t *fd)
+{
+   mongoc_stream_t *root;
+   mongoc_socket_t *sock;
+
+   root = mongoc_stream_get_root_stream (stream);
+   if (root->type != MONGOC_STREAM_SOCKET) {
+      return false;
+   }
+
+   sock = mongoc_stream_socket_get_socket ((mongoc_stream_socket_t *) root);
+   *fd = sock->sd;
+
+   return true;
+}
+
 mongoc_stream_t *
 mongoc_stream_get_tls_stream (mongoc_stream_t *stream) /* IN */
 {
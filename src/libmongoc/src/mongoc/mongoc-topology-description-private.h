@@ -87,6 +87,18 @@ mongoc_topology_description_select (mongoc_topology_description_t *description,
                                     const mongoc_read_prefs_t *read_pref,
                                     int64_t local_threshold_ms);
 
+mongoc_server_description_t *
+_mongoc_topology_description_select_r (
+   mongoc_topology_description_t *description,
+   mongoc_ss_optype_t optype,
+   const mongoc_read_prefs_t *read_pref,
+   int64_t local_threshold_ms,
+   unsigned int *rand_seed);
+
+mongoc_server_description_t *
+_mongoc_topology_description_pick_server (mongoc_array_t *suitable_servers,
+                                          unsigned int *rand_seed);
+
 mongoc_server_description_t *
 mongoc_topology_description_server_by_id (
    mongoc_topology_description_t *description,
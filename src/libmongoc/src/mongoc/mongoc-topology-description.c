@@ -790,10 +790,92 @@ mongoc_topology_description_select (mongoc_topology_description_t *topology,
                                     mongoc_ss_optype_t optype,
                                     const mongoc_read_prefs_t *read_pref,
                                     int64_t local_threshold_ms)
+{
+   return _mongoc_topology_description_select_r (topology,
+                                                 optype,
+                                                 read_pref,
+                                                 local_threshold_ms,
+                                                 &topology->rand_seed);
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_topology_description_pick_server --
+ *
+ *      Pick one of @suitable_servers, all within the latency window:
+ *      choose two at random and take the one with the lower load score,
+ *      so that operations drain away from servers that are slow or busy
+ *      right now without all piling onto the single least loaded one.
+ *
+ * Returns:
+ *      A server description, or NULL if @suitable_servers is empty.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+mongoc_server_description_t *
+_mongoc_topology_description_pick_server (mongoc_array_t *suitable_servers,
+                                          unsigned int *rand_seed)
+{
+   mongoc_server_description_t *a;
+   mongoc_server_description_t *b;
+   size_t i;
+   size_t j;
+
+   if (suitable_servers->len == 0) {
+      return NULL;
+   }
+
+   i = _mongoc_rand_simple (rand_seed) % suitable_servers->len;
+   a = _mongoc_array_index (
+      suitable_servers, mongoc_server_description_t *, i);
+
+   if (suitable_servers->len == 1) {
+      return a;
+   }
+
+   /* a second, different server */
+   j = _mongoc_rand_simple (rand_seed) % (suitable_servers->len - 1);
+   if (j >= i) {
+      j++;
+   }
+
+   b = _mongoc_array_index (
+      suitable_servers, mongoc_server_description_t *, j);
+
+   if (mongoc_server_description_load_score (b) <
+       mongoc_server_description_load_score (a)) {
+      return b;
+   }
+
+   return a;
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_topology_description_select_r --
+ *
+ *      Like mongoc_topology_description_select, but picks among suitable
+ *      servers with the caller's @rand_seed, so that several
+ *      threads can select from one published snapshot without writing to
+ *      it.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+mongoc_server_description_t *
+_mongoc_topology_description_select_r (mongoc_topology_description_t *topology,
+                                       mongoc_ss_optype_t optype,
+                                       const mongoc_read_prefs_t *read_pref,
+                                       int64_t local_threshold_ms,
+                                       unsigned int *rand_seed)
 {
    mongoc_array_t suitable_servers;
    mongoc_server_description_t *sd = NULL;
-   int rand_n;
 
    ENTRY;
 
@@ -814,12 +896,8 @@ mongoc_topology_description_select (mongoc_topology_description_t *topology,
 
    mongoc_topology_description_suitable_servers (
       &suitable_servers, optype, topology, read_pref, local_threshold_ms);
-   if (suitable_servers.len != 0) {
-      rand_n = _mongoc_rand_simple (&topology->rand_seed);
-      sd = _mongoc_array_index (&suitable_servers,
-                                mongoc_server_description_t *,
-                                rand_n % suitable_servers.len);
-   }
+   sd = _mongoc_topology_description_pick_server (&suitable_servers,
+                                                  rand_seed);
 
    _mongoc_array_destroy (&suitable_servers);
 
@@ -17,12 +17,15 @@
 #ifndef MONGOC_TOPOLOGY_PRIVATE_H
 #define MONGOC_TOPOLOGY_PRIVATE_H
 
+#include "mongoc-array-private.h"
 #include "mongoc-topology-scanner-private.h"
 #include "mongoc-server-description-private.h"
 #include "mongoc-topology-description-private.h"
 #include "mongoc-thread-private.h"
 #include "mongoc-uri.h"
 #include "mongoc-client-session-private.h"
+#include "mongoc-scram-private.h"
+#include "mongoc-write-coalescer-private.h"
 
 #define MONGOC_TOPOLOGY_MIN_HEARTBEAT_FREQUENCY_MS 500
 #define MONGOC_TOPOLOGY_SOCKET_CHECK_INTERVAL_MS 5000
@@ -39,6 +42,35 @@ typedef enum {
    MONGOC_TOPOLOGY_SCANNER_SINGLE_THREADED,
 } mongoc_topology_scanner_state_t;
 
+#define MONGOC_TOPOLOGY_SS_CACHE_SIZE 16
+
+/* the suitable servers for an operation type and read preference */
+typedef struct _mongoc_topology_ss_cache_entry_t {
+   mongoc_ss_optype_t optype;
+   uint32_t read_prefs_hash;
+   mongoc_read_prefs_t *read_prefs;
+   /* mongoc_server_description_t pointers into the snapshot */
+   mongoc_array_t servers;
+} mongoc_topology_ss_cache_entry_t;
+
+/* A copy of the topology description published for server selection in
+ * multi-threaded mode. Never modified once published: each change to the
+ * description publishes a new snapshot, and the old one is freed when its
+ * last reader releases it. */
+typedef struct _mongoc_topology_snapshot_t {
+   volatile int32_t refcount;
+   mongoc_topology_description_t td;
+   /* the scanner's state when the snapshot was published */
+   bool scanner_valid;
+   bson_error_t scanner_error;
+   /* server selection results, computed on first use. entries are only
+    * appended, under ss_cache_mutex; readers scan the first ss_cache_len
+    * entries without locking */
+   mongoc_topology_ss_cache_entry_t *ss_cache[MONGOC_TOPOLOGY_SS_CACHE_SIZE];
+   volatile int32_t ss_cache_len;
+   bson_mutex_t ss_cache_mutex;
+} mongoc_topology_snapshot_t;
+
 typedef struct _mongoc_topology_t {
    mongoc_topology_description_t description;
    mongoc_uri_t *uri;
@@ -64,6 +96,24 @@ typedef struct _mongoc_topology_t {
    bool stale;
 
    mongoc_server_session_t *session_pool;
+
+   /* the latest snapshot of "description", NULL if single-threaded.
+    * replaced while holding "mutex", but readers only take the short-lived
+    * "snapshot_mutex" to acquire a reference, never "mutex" */
+   mongoc_topology_snapshot_t *snapshot;
+   bson_mutex_t snapshot_mutex;
+
+   /* SCRAM secrets shared by all clients, NULL without crypto support */
+   mongoc_scram_cache_t *scram_cache;
+
+   /* groups concurrent inserts, NULL unless pooled with "writeCoalescingMS" */
+   mongoc_write_coalescer_t *write_coalescer;
+
+   /* run after each scan without the mutex: by the background thread, or
+    * by a single-threaded client's server selection. set by the owning pool
+    * or client before the first scan */
+   void (*after_scan_cb) (void *context);
+   void *after_scan_context;
 } mongoc_topology_t;
 
 mongoc_topology_t *
@@ -116,12 +166,16 @@ bool
 _mongoc_topology_update_from_handshake (mongoc_topology_t *topology,
                                         const mongoc_server_description_t *sd);
 
+void
+_mongoc_topology_share_server_load (mongoc_topology_t *topology,
+                                    mongoc_server_description_t *sd);
+
 void
 _mongoc_topology_update_last_used (mongoc_topology_t *topology,
                                    uint32_t server_id);
 
 int64_t
-mongoc_topology_server_timestamp (mongoc_topology_t *topology, uint32_t id);
+mongoc_topology_server_generation (mongoc_topology_t *topology, uint32_t id);
 
 mongoc_topology_description_type_t
 _mongoc_topology_get_type (mongoc_topology_t *topology);
@@ -129,6 +183,9 @@ _mongoc_topology_get_type (mongoc_topology_t *topology);
 bool
 _mongoc_topology_start_background_scanner (mongoc_topology_t *topology);
 
+void
+_mongoc_topology_background_thread_stop (mongoc_topology_t *topology);
+
 bool
 _mongoc_topology_set_appname (mongoc_topology_t *topology, const char *appname);
 
@@ -154,4 +211,25 @@ const bson_t *
 _mongoc_topology_get_ismaster (mongoc_topology_t *topology);
 void
 _mongoc_topology_request_scan (mongoc_topology_t *topology);
+
+void
+_mongoc_topology_publish (mongoc_topology_t *topology);
+
+mongoc_topology_snapshot_t *
+_mongoc_topology_snapshot_acquire (mongoc_topology_t *topology);
+
+void
+_mongoc_topology_snapshot_release (mongoc_topology_snapshot_t *snapshot);
+
+uint32_t
+_mongoc_topology_select_hedge_server_id (mongoc_topology_t *topology,
+                                         const mongoc_read_prefs_t *read_prefs,
+                                         uint32_t first_server_id);
+
+mongoc_server_description_t *
+_mongoc_topology_snapshot_select (mongoc_topology_snapshot_t *snapshot,
+                                  mongoc_ss_optype_t optype,
+                                  const mongoc_read_prefs_t *read_prefs,
+                                  int64_t local_threshold_ms,
+                                  unsigned int *rand_seed);
 #endif
@@ -32,6 +32,7 @@
 
 #ifdef MONGOC_ENABLE_SSL
 #include "mongoc-ssl.h"
+#include "mongoc-stream-tls-private.h"
 #endif
 
 BSON_BEGIN_DECLS
@@ -53,8 +54,13 @@ typedef struct mongoc_topology_scanner_node {
    uint32_t id;
    /* after scanning, this is set to the successful stream if one exists. */
    mongoc_stream_t *stream;
+   /* single-threaded clients' receive buffer for the stream. */
+   mongoc_buffer_t buffer;
 
    int64_t timestamp;
+   /* bumped when the node reconnects or the server is invalidated. pooled
+    * clients drop connections made in an earlier generation */
+   uint32_t generation;
    int64_t last_used;
    int64_t last_failed;
    bool has_auth;
@@ -94,6 +100,8 @@ typedef struct mongoc_topology_scanner {
    mongoc_topology_scanner_setup_err_cb_t setup_err_cb;
    mongoc_topology_scanner_cb_t cb;
    void *cb_data;
+   /* bumped with any node's generation, read without the topology mutex */
+   volatile int32_t generation;
    const mongoc_uri_t *uri;
    mongoc_async_cmd_setup_t setup;
    mongoc_stream_initiator_t initiator;
@@ -102,6 +110,7 @@ typedef struct mongoc_topology_scanner {
 
 #ifdef MONGOC_ENABLE_SSL
    mongoc_ssl_opt_t *ssl_opts;
+   mongoc_tls_cache_t *tls_cache; /* borrowed from the client or pool */
 #endif
 
    mongoc_apm_callbacks_t apm_callbacks;
@@ -144,6 +153,10 @@ void
 mongoc_topology_scanner_node_destroy (mongoc_topology_scanner_node_t *node,
                                       bool failed);
 
+void
+_mongoc_topology_scanner_node_bump_generation (
+   mongoc_topology_scanner_node_t *node);
+
 bool
 mongoc_topology_scanner_in_cooldown (mongoc_topology_scanner_t *ts,
                                      int64_t when);
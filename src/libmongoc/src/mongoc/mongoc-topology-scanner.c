@@ -353,6 +353,18 @@ mongoc_topology_scanner_node_disconnect (mongoc_topology_scanner_node_t *node,
          &node->sasl_supported_mechs, 0, sizeof (node->sasl_supported_mechs));
       node->negotiated_sasl_supported_mechs = false;
    }
+
+   _mongoc_buffer_destroy (&node->buffer);
+}
+
+/* start a new connection generation for @node's server, so that pooled
+ * clients drop their older connections to it. requires the topology mutex */
+void
+_mongoc_topology_scanner_node_bump_generation (
+   mongoc_topology_scanner_node_t *node)
+{
+   node->generation++;
+   bson_atomic_int_add (&node->ts->generation, 1);
 }
 
 void
@@ -360,6 +372,8 @@ mongoc_topology_scanner_node_destroy (mongoc_topology_scanner_node_t *node,
                                       bool failed)
 {
    DL_DELETE (node->ts->nodes, node);
+   /* pooled clients drop their connections to a removed server */
+   bson_atomic_int_add (&node->ts->generation, 1);
    mongoc_topology_scanner_node_disconnect (node, failed);
    if (node->dns_results) {
       freeaddrinfo (node->dns_results);
@@ -577,8 +591,12 @@ _mongoc_topology_scanner_node_setup_stream_for_tls (
    }
 #ifdef MONGOC_ENABLE_SSL
    if (node->ts->ssl_opts) {
-      tls_stream = mongoc_stream_tls_new_with_hostname (
-         stream, node->host.host, node->ts->ssl_opts, 1);
+      tls_stream = _mongoc_stream_tls_new_with_cache (stream,
+                                                      node->host.host,
+                                                      node->host.port,
+                                                      node->ts->ssl_opts,
+                                                      1,
+                                                      node->ts->tls_cache);
       if (!tls_stream) {
          mongoc_stream_destroy (stream);
          return NULL;
@@ -781,6 +799,7 @@ mongoc_topology_scanner_node_setup (mongoc_topology_scanner_node_t *node,
       _begin_ismaster_cmd (
          node, node->stream, true /* is_setup_done */, NULL, 0);
       node->stream = NULL;
+      _mongoc_buffer_destroy (&node->buffer);
       return;
    }
 
@@ -811,6 +830,7 @@ mongoc_topology_scanner_node_setup (mongoc_topology_scanner_node_t *node,
 
    node->has_auth = false;
    node->timestamp = bson_get_monotonic_time ();
+   _mongoc_topology_scanner_node_bump_generation (node);
 }
 
 /*
@@ -1112,6 +1132,7 @@ _cancel_commands_excluding (mongoc_topology_scanner_node_t *node,
       if ((mongoc_topology_scanner_node_t *) iter->data == node &&
           iter != acmd) {
          iter->state = MONGOC_ASYNC_CMD_CANCELED_STATE;
+         mongoc_async_update (iter->async, iter);
       }
    }
 }
@@ -1141,6 +1162,7 @@ _jumpstart_other_acmds (mongoc_topology_scanner_node_t *node,
           iter != acmd && acmd->initiate_delay_ms < iter->initiate_delay_ms) {
          iter->initiate_delay_ms =
             BSON_MAX (iter->initiate_delay_ms - HAPPY_EYEBALLS_DELAY_MS, 0);
+         mongoc_async_update (iter->async, iter);
       }
    }
 }
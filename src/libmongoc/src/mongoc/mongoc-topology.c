@@ -22,6 +22,7 @@
 #include "mongoc-error.h"
 #include "mongoc-log.h"
 #include "mongoc-topology-private.h"
+#include "mongoc-read-prefs-private.h"
 #include "mongoc-topology-description-apm-private.h"
 #include "mongoc-client-private.h"
 #include "mongoc-uri-private.h"
@@ -30,9 +31,6 @@
 
 #include "utlist.h"
 
-static void
-_mongoc_topology_background_thread_stop (mongoc_topology_t *topology);
-
 static bool
 _mongoc_topology_reconcile_add_nodes (mongoc_server_description_t *sd,
                                       mongoc_topology_t *topology)
@@ -123,6 +121,8 @@ _mongoc_topology_scanner_setup_err_cb (uint32_t id,
                                                 NULL /* ismaster reply */,
                                                 -1 /* rtt_msec */,
                                                 error);
+
+   _mongoc_topology_publish (topology);
 }
 
 
@@ -180,6 +180,7 @@ _mongoc_topology_scanner_cb (uint32_t id,
       mongoc_cond_broadcast (&topology->cond_client);
    }
 
+   _mongoc_topology_publish (topology);
    bson_mutex_unlock (&topology->mutex);
 }
 
@@ -210,6 +211,7 @@ mongoc_topology_new (const mongoc_uri_t *uri, bool single_threaded)
    char *prefixed_service;
    uint32_t id;
    const mongoc_host_list_t *hl;
+   int32_t write_coalescing_msec;
 
    BSON_ASSERT (uri);
 
@@ -279,9 +281,21 @@ mongoc_topology_new (const mongoc_uri_t *uri, bool single_threaded)
                                    topology->connect_timeout_msec);
 
    bson_mutex_init (&topology->mutex);
+   bson_mutex_init (&topology->snapshot_mutex);
    mongoc_cond_init (&topology->cond_client);
    mongoc_cond_init (&topology->cond_server);
 
+#ifdef MONGOC_ENABLE_CRYPTO
+   topology->scram_cache = _mongoc_scram_cache_new ();
+#endif
+
+   write_coalescing_msec = mongoc_uri_get_option_as_int32 (
+      topology->uri, MONGOC_URI_WRITECOALESCINGMS, 0);
+   if (!single_threaded && write_coalescing_msec > 0) {
+      topology->write_coalescer =
+         _mongoc_write_coalescer_new (write_coalescing_msec);
+   }
+
    if (single_threaded) {
       /* single threaded clients negotiate sasl supported mechanisms during
        * a topology scan. */
@@ -330,6 +344,7 @@ mongoc_topology_new (const mongoc_uri_t *uri, bool single_threaded)
 
    if (!topology_valid) {
       /* add no nodes */
+      _mongoc_topology_publish (topology);
       return topology;
    }
 
@@ -341,6 +356,8 @@ mongoc_topology_new (const mongoc_uri_t *uri, bool single_threaded)
       hl = hl->next;
    }
 
+   _mongoc_topology_publish (topology);
+
    return topology;
 }
 /*
@@ -404,6 +421,7 @@ mongoc_topology_destroy (mongoc_topology_t *topology)
    _mongoc_topology_description_monitor_closed (&topology->description);
 
    mongoc_uri_destroy (topology->uri);
+   _mongoc_topology_snapshot_release (topology->snapshot);
    mongoc_topology_description_destroy (&topology->description);
    mongoc_topology_scanner_destroy (topology->scanner);
 
@@ -416,6 +434,13 @@ mongoc_topology_destroy (mongoc_topology_t *topology)
    mongoc_cond_destroy (&topology->cond_client);
    mongoc_cond_destroy (&topology->cond_server);
    bson_mutex_destroy (&topology->mutex);
+   bson_mutex_destroy (&topology->snapshot_mutex);
+
+#ifdef MONGOC_ENABLE_CRYPTO
+   _mongoc_scram_cache_destroy (topology->scram_cache);
+#endif
+
+   _mongoc_write_coalescer_destroy (topology->write_coalescer);
 
    bson_free (topology);
 }
@@ -452,6 +477,9 @@ mongoc_topology_scan_once (mongoc_topology_t *topology, bool obey_cooldown)
 
    _mongoc_topology_scanner_finish (topology->scanner);
 
+   /* the scanner's nodes and error may have changed */
+   _mongoc_topology_publish (topology);
+
    topology->last_scan = bson_get_monotonic_time ();
    topology->stale = false;
 }
@@ -633,6 +661,8 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
    bson_error_t scanner_error = {0};
    int64_t heartbeat_msec;
    uint32_t server_id;
+   mongoc_topology_snapshot_t *snapshot;
+   unsigned int rand_seed;
 
    /* These names come from the Server Selection Spec pseudocode */
    int64_t loop_start;  /* when we entered this function */
@@ -644,19 +674,14 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
    BSON_ASSERT (topology);
    ts = topology->scanner;
 
-   bson_mutex_lock (&topology->mutex);
-   /* It isn't strictly necessary to lock here, because if the topology
-    * is invalid, it will never become valid. Lock anyway for consistency. */
-   if (!mongoc_topology_scanner_valid (ts)) {
+   if (topology->single_threaded && !mongoc_topology_scanner_valid (ts)) {
       if (error) {
          mongoc_topology_scanner_get_error (ts, error);
          error->domain = MONGOC_ERROR_SERVER_SELECTION;
          error->code = MONGOC_ERROR_SERVER_SELECTION_FAILURE;
       }
-      bson_mutex_unlock (&topology->mutex);
       return 0;
    }
-   bson_mutex_unlock (&topology->mutex);
 
    heartbeat_msec = topology->description.heartbeat_msec;
    local_threshold_ms = topology->local_threshold_msec;
@@ -710,6 +735,10 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
 
             /* takes up to connectTimeoutMS. sets "last_scan", clears "stale" */
             _mongoc_topology_do_blocking_scan (topology, &scanner_error);
+            if (topology->after_scan_cb) {
+               topology->after_scan_cb (topology->after_scan_context);
+            }
+
             loop_end = topology->last_scan;
             tried_once = true;
          }
@@ -751,29 +780,50 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
       }
    }
 
-   /* With background thread */
+   /* With background thread: select from the latest snapshot, and only
+    * take the mutex to wait for a scan if no server is suitable */
+   rand_seed = (unsigned int) loop_start;
+
    /* we break out when we've found a server or timed out */
    for (;;) {
-      bson_mutex_lock (&topology->mutex);
+      snapshot = _mongoc_topology_snapshot_acquire (topology);
+
+      if (!snapshot->scanner_valid) {
+         /* an invalid topology never becomes valid */
+         if (error) {
+            memcpy (error, &snapshot->scanner_error, sizeof *error);
+            error->domain = MONGOC_ERROR_SERVER_SELECTION;
+            error->code = MONGOC_ERROR_SERVER_SELECTION_FAILURE;
+         }
+         _mongoc_topology_snapshot_release (snapshot);
+         return 0;
+      }
 
-      if (!mongoc_topology_compatible (
-             &topology->description, read_prefs, error)) {
-         bson_mutex_unlock (&topology->mutex);
+      if (!mongoc_topology_compatible (&snapshot->td, read_prefs, error)) {
+         _mongoc_topology_snapshot_release (snapshot);
          return 0;
       }
 
-      selected_server = mongoc_topology_description_select (
-         &topology->description, optype, read_prefs, local_threshold_ms);
+      selected_server = _mongoc_topology_snapshot_select (
+         snapshot, optype, read_prefs, local_threshold_ms, &rand_seed);
 
       if (!selected_server) {
-         _mongoc_topology_request_scan (topology);
+         bson_mutex_lock (&topology->mutex);
 
-         r = mongoc_cond_timedwait (&topology->cond_client,
-                                    &topology->mutex,
-                                    (expire_at - loop_start) / 1000);
+         /* don't wait if a scan published a new snapshot meanwhile */
+         if (topology->snapshot == snapshot) {
+            _mongoc_topology_request_scan (topology);
+
+            r = mongoc_cond_timedwait (&topology->cond_client,
+                                       &topology->mutex,
+                                       (expire_at - loop_start) / 1000);
+         } else {
+            r = 0;
+         }
 
          mongoc_topology_scanner_get_error (ts, &scanner_error);
          bson_mutex_unlock (&topology->mutex);
+         _mongoc_topology_snapshot_release (snapshot);
 
 #ifdef _WIN32
          if (r == WSAETIMEDOUT) {
@@ -803,7 +853,7 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
          }
       } else {
          server_id = selected_server->id;
-         bson_mutex_unlock (&topology->mutex);
+         _mongoc_topology_snapshot_release (snapshot);
          return server_id;
       }
    }
@@ -821,7 +871,8 @@ mongoc_topology_select_server_id (mongoc_topology_t *topology,
  *      NOTE: this method returns a copy of the original server
  *      description. Callers must own and clean up this copy.
  *
- *      NOTE: this method locks and unlocks @topology's mutex.
+ *      NOTE: this method locks and unlocks @topology's mutex if
+ *      single-threaded, otherwise it reads the latest snapshot.
  *
  * Returns:
  *      A mongoc_server_description_t, or NULL.
@@ -837,8 +888,18 @@ mongoc_topology_server_by_id (mongoc_topology_t *topology,
                               uint32_t id,
                               bson_error_t *error)
 {
+   mongoc_topology_snapshot_t *snapshot;
    mongoc_server_description_t *sd;
 
+   if (!topology->single_threaded) {
+      snapshot = _mongoc_topology_snapshot_acquire (topology);
+      sd = mongoc_server_description_new_copy (
+         mongoc_topology_description_server_by_id (&snapshot->td, id, error));
+      _mongoc_topology_snapshot_release (snapshot);
+
+      return sd;
+   }
+
    bson_mutex_lock (&topology->mutex);
 
    sd = mongoc_server_description_new_copy (
@@ -862,7 +923,8 @@ mongoc_topology_server_by_id (mongoc_topology_t *topology,
  *      NOTE: this method returns a copy of the original mongoc_host_list_t.
  *      Callers must own and clean up this copy.
  *
- *      NOTE: this method locks and unlocks @topology's mutex.
+ *      NOTE: this method locks and unlocks @topology's mutex if
+ *      single-threaded, otherwise it reads the latest snapshot.
  *
  * Returns:
  *      A mongoc_host_list_t, or NULL.
@@ -878,21 +940,32 @@ _mongoc_topology_host_by_id (mongoc_topology_t *topology,
                              uint32_t id,
                              bson_error_t *error)
 {
+   mongoc_topology_snapshot_t *snapshot = NULL;
+   mongoc_topology_description_t *td;
    mongoc_server_description_t *sd;
    mongoc_host_list_t *host = NULL;
 
-   bson_mutex_lock (&topology->mutex);
+   if (topology->single_threaded) {
+      bson_mutex_lock (&topology->mutex);
+      td = &topology->description;
+   } else {
+      snapshot = _mongoc_topology_snapshot_acquire (topology);
+      td = &snapshot->td;
+   }
 
    /* not a copy - direct pointer into topology description data */
-   sd = mongoc_topology_description_server_by_id (
-      &topology->description, id, error);
+   sd = mongoc_topology_description_server_by_id (td, id, error);
 
    if (sd) {
       host = bson_malloc0 (sizeof (mongoc_host_list_t));
       memcpy (host, &sd->host, sizeof (mongoc_host_list_t));
    }
 
-   bson_mutex_unlock (&topology->mutex);
+   if (snapshot) {
+      _mongoc_topology_snapshot_release (snapshot);
+   } else {
+      bson_mutex_unlock (&topology->mutex);
+   }
 
    return host;
 }
@@ -921,7 +994,8 @@ _mongoc_topology_request_scan (mongoc_topology_t *topology)
  * mongoc_topology_invalidate_server --
  *
  *      Invalidate the given server after receiving a network error in
- *      another part of the client.
+ *      another part of the client. Starts a new connection generation for
+ *      the server, so pooled clients drop their connections to it.
  *
  *      NOTE: this method uses @topology's mutex.
  *
@@ -932,11 +1006,20 @@ mongoc_topology_invalidate_server (mongoc_topology_t *topology,
                                    uint32_t id,
                                    const bson_error_t *error)
 {
+   mongoc_topology_scanner_node_t *node;
+
    BSON_ASSERT (error);
 
    bson_mutex_lock (&topology->mutex);
    mongoc_topology_description_invalidate_server (
       &topology->description, id, error);
+
+   node = mongoc_topology_scanner_get_node (topology->scanner, id);
+   if (node) {
+      _mongoc_topology_scanner_node_bump_generation (node);
+   }
+
+   _mongoc_topology_publish (topology);
    bson_mutex_unlock (&topology->mutex);
 }
 
@@ -971,6 +1054,8 @@ _mongoc_topology_update_from_handshake (mongoc_topology_t *topology,
    has_server = _mongoc_topology_update_no_lock (
       sd->id, &sd->last_is_master, sd->round_trip_time_msec, topology, NULL);
 
+   _mongoc_topology_publish (topology);
+
    /* if pooled, wake threads waiting in mongoc_topology_server_by_id */
    mongoc_cond_broadcast (&topology->cond_client);
    bson_mutex_unlock (&topology->mutex);
@@ -978,6 +1063,35 @@ _mongoc_topology_update_from_handshake (mongoc_topology_t *topology,
    return has_server;
 }
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_share_server_load --
+ *
+ *      Make @sd, a description a client made from a handshake, track its
+ *      load in the same record as the topology's description of the
+ *      server, so that operations on the new connection count toward it.
+ *
+ *      NOTE: this method uses @topology's mutex.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_topology_share_server_load (mongoc_topology_t *topology,
+                                    mongoc_server_description_t *sd)
+{
+   mongoc_server_description_t *topology_sd;
+
+   bson_mutex_lock (&topology->mutex);
+   topology_sd = mongoc_topology_description_server_by_id (
+      &topology->description, sd->id, NULL);
+   if (topology_sd) {
+      mongoc_server_description_share_load (sd, topology_sd);
+   }
+   bson_mutex_unlock (&topology->mutex);
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -1009,34 +1123,36 @@ _mongoc_topology_update_last_used (mongoc_topology_t *topology,
 /*
  *--------------------------------------------------------------------------
  *
- * mongoc_topology_server_timestamp --
+ * mongoc_topology_server_generation --
  *
- *      Return the topology's scanner's timestamp for the given server,
- *      or -1 if there is no scanner node for the given server.
+ *      Return the connection generation of the given server, or -1 if
+ *      there is no scanner node for the given server. The generation is
+ *      bumped each time the server is invalidated or its monitoring
+ *      connection is reestablished.
  *
  *      NOTE: this method uses @topology's mutex.
  *
  * Returns:
- *      Timestamp, or -1
+ *      Generation, or -1
  *
  *--------------------------------------------------------------------------
  */
 int64_t
-mongoc_topology_server_timestamp (mongoc_topology_t *topology, uint32_t id)
+mongoc_topology_server_generation (mongoc_topology_t *topology, uint32_t id)
 {
    mongoc_topology_scanner_node_t *node;
-   int64_t timestamp = -1;
+   int64_t generation = -1;
 
    bson_mutex_lock (&topology->mutex);
 
    node = mongoc_topology_scanner_get_node (topology->scanner, id);
    if (node) {
-      timestamp = node->timestamp;
+      generation = (int64_t) node->generation;
    }
 
    bson_mutex_unlock (&topology->mutex);
 
-   return timestamp;
+   return generation;
 }
 
 /*
@@ -1046,7 +1162,8 @@ mongoc_topology_server_timestamp (mongoc_topology_t *topology, uint32_t id)
  *
  *      Return the topology's description's type.
  *
- *      NOTE: this method uses @topology's mutex.
+ *      NOTE: this method uses @topology's mutex if single-threaded,
+ *      otherwise it reads the latest snapshot.
  *
  * Returns:
  *      The topology description type.
@@ -1056,8 +1173,17 @@ mongoc_topology_server_timestamp (mongoc_topology_t *topology, uint32_t id)
 mongoc_topology_description_type_t
 _mongoc_topology_get_type (mongoc_topology_t *topology)
 {
+   mongoc_topology_snapshot_t *snapshot;
    mongoc_topology_description_type_t td_type;
 
+   if (!topology->single_threaded) {
+      snapshot = _mongoc_topology_snapshot_acquire (topology);
+      td_type = snapshot->td.type;
+      _mongoc_topology_snapshot_release (snapshot);
+
+      return td_type;
+   }
+
    bson_mutex_lock (&topology->mutex);
 
    td_type = topology->description.type;
@@ -1161,6 +1287,10 @@ _mongoc_topology_run_background (void *data)
       mongoc_topology_scan_once (topology, false /* obey cooldown */);
       bson_mutex_unlock (&topology->mutex);
 
+      if (topology->after_scan_cb) {
+         topology->after_scan_cb (topology->after_scan_context);
+      }
+
       last_scan = bson_get_monotonic_time ();
    }
 
@@ -1220,14 +1350,14 @@ _mongoc_topology_start_background_scanner (mongoc_topology_t *topology)
  * mongoc_topology_background_thread_stop --
  *
  *       Stop the topology background thread. Called by the owning pool at
- *       its destruction.
+ *       its destruction. Safe to call more than once.
  *
  *       NOTE: this method uses @topology's mutex.
  *
  *--------------------------------------------------------------------------
  */
 
-static void
+void
 _mongoc_topology_background_thread_stop (mongoc_topology_t *topology)
 {
    bool join_thread = false;
@@ -1260,6 +1390,11 @@ _mongoc_topology_background_thread_stop (mongoc_topology_t *topology)
       /* if we're joining the thread, wait for it to come back and broadcast
        * all listeners */
       bson_thread_join (topology->thread);
+
+      bson_mutex_lock (&topology->mutex);
+      topology->scanner_state = MONGOC_TOPOLOGY_SCANNER_OFF;
+      bson_mutex_unlock (&topology->mutex);
+
       mongoc_cond_broadcast (&topology->cond_client);
    }
 }
@@ -1496,3 +1631,269 @@ _mongoc_topology_get_ismaster (mongoc_topology_t *topology)
    bson_mutex_unlock (&topology->mutex);
    return cmd;
 }
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_publish --
+ *
+ *       Replace the snapshot that multi-threaded server selection reads
+ *       with a copy of @topology's current description. Call after each
+ *       change to the description; does nothing if single-threaded.
+ *
+ *       NOTE: call this while holding @topology's mutex.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_topology_publish (mongoc_topology_t *topology)
+{
+   mongoc_topology_snapshot_t *snapshot;
+   mongoc_topology_snapshot_t *old;
+
+   if (topology->single_threaded) {
+      return;
+   }
+
+   snapshot = (mongoc_topology_snapshot_t *) bson_malloc0 (sizeof *snapshot);
+   snapshot->refcount = 1;
+   _mongoc_topology_description_copy_to (&topology->description,
+                                         &snapshot->td);
+   snapshot->td.rand_seed = topology->description.rand_seed;
+   snapshot->scanner_valid = mongoc_topology_scanner_valid (topology->scanner);
+   mongoc_topology_scanner_get_error (topology->scanner,
+                                      &snapshot->scanner_error);
+   bson_mutex_init (&snapshot->ss_cache_mutex);
+
+   /* readers wait at most for this swap, never for the copy above */
+   bson_mutex_lock (&topology->snapshot_mutex);
+   old = topology->snapshot;
+   topology->snapshot = snapshot;
+   bson_mutex_unlock (&topology->snapshot_mutex);
+
+   _mongoc_topology_snapshot_release (old);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_snapshot_acquire --
+ *
+ *       Get a reference to the latest snapshot of @topology's description.
+ *       It stays valid, and unchanged, until released with
+ *       _mongoc_topology_snapshot_release.
+ *
+ *       NOTE: only for multi-threaded topologies.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_topology_snapshot_t *
+_mongoc_topology_snapshot_acquire (mongoc_topology_t *topology)
+{
+   mongoc_topology_snapshot_t *snapshot;
+
+   BSON_ASSERT (!topology->single_threaded);
+
+   bson_mutex_lock (&topology->snapshot_mutex);
+   snapshot = topology->snapshot;
+   bson_atomic_int_add (&snapshot->refcount, 1);
+   bson_mutex_unlock (&topology->snapshot_mutex);
+
+   return snapshot;
+}
+
+
+void
+_mongoc_topology_snapshot_release (mongoc_topology_snapshot_t *snapshot)
+{
+   mongoc_topology_ss_cache_entry_t *entry;
+   int32_t i;
+
+   if (snapshot && bson_atomic_int_add (&snapshot->refcount, -1) == 0) {
+      for (i = 0; i < snapshot->ss_cache_len; i++) {
+         entry = snapshot->ss_cache[i];
+         mongoc_read_prefs_destroy (entry->read_prefs);
+         _mongoc_array_destroy (&entry->servers);
+         bson_free (entry);
+      }
+
+      bson_mutex_destroy (&snapshot->ss_cache_mutex);
+      mongoc_topology_description_destroy (&snapshot->td);
+      bson_free (snapshot);
+   }
+}
+
+
+static mongoc_topology_ss_cache_entry_t *
+_mongoc_topology_ss_cache_find (mongoc_topology_snapshot_t *snapshot,
+                                mongoc_ss_optype_t optype,
+                                uint32_t read_prefs_hash,
+                                const mongoc_read_prefs_t *read_prefs)
+{
+   mongoc_topology_ss_cache_entry_t *entry;
+   int32_t len;
+   int32_t i;
+
+   len = snapshot->ss_cache_len;
+   /* pairs with the barrier before the length is incremented */
+   bson_memory_barrier ();
+
+   for (i = 0; i < len; i++) {
+      entry = snapshot->ss_cache[i];
+
+      if (entry->optype == optype &&
+          entry->read_prefs_hash == read_prefs_hash &&
+          _mongoc_read_prefs_equal (entry->read_prefs, read_prefs)) {
+         return entry;
+      }
+   }
+
+   return NULL;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_snapshot_select --
+ *
+ *       Like mongoc_topology_description_select on @snapshot's
+ *       description, but the suitable servers for each @optype and
+ *       @read_prefs are only computed once per snapshot. A snapshot never
+ *       changes, so its results stay valid until a topology change
+ *       publishes a new snapshot. @local_threshold_ms must be the same
+ *       for each call on a snapshot.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_server_description_t *
+_mongoc_topology_snapshot_select (mongoc_topology_snapshot_t *snapshot,
+                                  mongoc_ss_optype_t optype,
+                                  const mongoc_read_prefs_t *read_prefs,
+                                  int64_t local_threshold_ms,
+                                  unsigned int *rand_seed)
+{
+   mongoc_topology_ss_cache_entry_t *entry;
+   uint32_t hash;
+
+   if (snapshot->td.type == MONGOC_TOPOLOGY_SINGLE) {
+      /* selection is a lookup already */
+      return _mongoc_topology_description_select_r (
+         &snapshot->td, optype, read_prefs, local_threshold_ms, rand_seed);
+   }
+
+   hash = _mongoc_read_prefs_hash (read_prefs);
+   entry = _mongoc_topology_ss_cache_find (snapshot, optype, hash, read_prefs);
+
+   if (!entry) {
+      bson_mutex_lock (&snapshot->ss_cache_mutex);
+
+      /* another thread may have added it meanwhile */
+      entry =
+         _mongoc_topology_ss_cache_find (snapshot, optype, hash, read_prefs);
+
+      if (!entry && snapshot->ss_cache_len < MONGOC_TOPOLOGY_SS_CACHE_SIZE) {
+         entry = (mongoc_topology_ss_cache_entry_t *) bson_malloc0 (
+            sizeof *entry);
+         entry->optype = optype;
+         entry->read_prefs_hash = hash;
+         entry->read_prefs = mongoc_read_prefs_copy (read_prefs);
+         _mongoc_array_init (&entry->servers,
+                             sizeof (mongoc_server_description_t *));
+         mongoc_topology_description_suitable_servers (&entry->servers,
+                                                       optype,
+                                                       &snapshot->td,
+                                                       read_prefs,
+                                                       local_threshold_ms);
+
+         snapshot->ss_cache[snapshot->ss_cache_len] = entry;
+         /* readers must see the entry before the new length */
+         bson_memory_barrier ();
+         snapshot->ss_cache_len++;
+      }
+
+      bson_mutex_unlock (&snapshot->ss_cache_mutex);
+   }
+
+   if (!entry) {
+      /* the cache is full, e.g. many different tag sets */
+      return _mongoc_topology_description_select_r (
+         &snapshot->td, optype, read_prefs, local_threshold_ms, rand_seed);
+   }
+
+   return _mongoc_topology_description_pick_server (&entry->servers,
+                                                    rand_seed);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_topology_select_hedge_server_id --
+ *
+ *       Select a server for a hedged read: one suitable for @read_prefs,
+ *       other than @first_server_id, which the read was first sent to.
+ *       Does not wait or scan.
+ *
+ * Returns:
+ *       A server id, or 0 if no other server is suitable.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+uint32_t
+_mongoc_topology_select_hedge_server_id (mongoc_topology_t *topology,
+                                         const mongoc_read_prefs_t *read_prefs,
+                                         uint32_t first_server_id)
+{
+   mongoc_topology_snapshot_t *snapshot = NULL;
+   mongoc_topology_description_t *td;
+   mongoc_server_description_t *sd;
+   mongoc_array_t suitable;
+   unsigned int rand_seed;
+   int64_t local_threshold_ms = topology->local_threshold_msec;
+   uint32_t server_id = 0;
+   size_t i;
+
+   if (topology->single_threaded) {
+      td = &topology->description;
+   } else {
+      snapshot = _mongoc_topology_snapshot_acquire (topology);
+      td = &snapshot->td;
+   }
+
+   if (td->type != MONGOC_TOPOLOGY_SINGLE) {
+      _mongoc_array_init (&suitable, sizeof (mongoc_server_description_t *));
+      mongoc_topology_description_suitable_servers (
+         &suitable, MONGOC_SS_READ, td, read_prefs, local_threshold_ms);
+
+      for (i = 0; i < suitable.len; i++) {
+         sd = _mongoc_array_index (&suitable, mongoc_server_description_t *, i);
+         if (sd->id == first_server_id) {
+            _mongoc_array_index (&suitable, mongoc_server_description_t *, i) =
+               _mongoc_array_index (&suitable,
+                                    mongoc_server_description_t *,
+                                    suitable.len - 1);
+            suitable.len--;
+            break;
+         }
+      }
+
+      rand_seed = (unsigned int) bson_get_monotonic_time ();
+      sd = _mongoc_topology_description_pick_server (&suitable, &rand_seed);
+      if (sd) {
+         server_id = sd->id;
+      }
+
+      _mongoc_array_destroy (&suitable);
+   }
+
+   _mongoc_topology_snapshot_release (snapshot);
+
+   return server_id;
+}
@@ -683,26 +683,33 @@ mongoc_uri_bson_append_or_replace_key (bson_t *options,
 bool
 mongoc_uri_option_is_int32 (const char *key)
 {
-   return !strcasecmp (key, MONGOC_URI_CONNECTTIMEOUTMS) ||
+   return !strcasecmp (key, MONGOC_URI_COMPRESSIONMINSIZE) ||
+          !strcasecmp (key, MONGOC_URI_CONNECTTIMEOUTMS) ||
           !strcasecmp (key, MONGOC_URI_HEARTBEATFREQUENCYMS) ||
+          !strcasecmp (key, MONGOC_URI_HEDGEDREADPERCENTILE) ||
           !strcasecmp (key, MONGOC_URI_SERVERSELECTIONTIMEOUTMS) ||
           !strcasecmp (key, MONGOC_URI_SOCKETCHECKINTERVALMS) ||
           !strcasecmp (key, MONGOC_URI_SOCKETTIMEOUTMS) ||
           !strcasecmp (key, MONGOC_URI_LOCALTHRESHOLDMS) ||
           !strcasecmp (key, MONGOC_URI_MAXPOOLSIZE) ||
           !strcasecmp (key, MONGOC_URI_MAXSTALENESSSECONDS) ||
+          !strcasecmp (key, MONGOC_URI_MAXWRITEBATCHESINFLIGHT) ||
           !strcasecmp (key, MONGOC_URI_MINPOOLSIZE) ||
           !strcasecmp (key, MONGOC_URI_MAXIDLETIMEMS) ||
           !strcasecmp (key, MONGOC_URI_WAITQUEUEMULTIPLE) ||
           !strcasecmp (key, MONGOC_URI_WAITQUEUETIMEOUTMS) ||
+          !strcasecmp (key, MONGOC_URI_WARMPOOLSIZE) ||
+          !strcasecmp (key, MONGOC_URI_WRITECOALESCINGMS) ||
           !strcasecmp (key, MONGOC_URI_WTIMEOUTMS) ||
-          !strcasecmp (key, MONGOC_URI_ZLIBCOMPRESSIONLEVEL);
+          !strcasecmp (key, MONGOC_URI_ZLIBCOMPRESSIONLEVEL) ||
+          !strcasecmp (key, MONGOC_URI_ZSTDCOMPRESSIONLEVEL);
 }
 
 bool
 mongoc_uri_option_is_bool (const char *key)
 {
    return !strcasecmp (key, MONGOC_URI_CANONICALIZEHOSTNAME) ||
+          !strcasecmp (key, MONGOC_URI_HEDGEDREADS) ||
           !strcasecmp (key, MONGOC_URI_JOURNAL) ||
           !strcasecmp (key, MONGOC_URI_RETRYWRITES) ||
           !strcasecmp (key, MONGOC_URI_SAFE) ||
@@ -2008,6 +2015,29 @@ mongoc_uri_get_ssl (const mongoc_uri_t *uri) /* IN */
    return false;
 }
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * mongoc_uri_has_option --
+ *
+ *       Whether 'option' is set, whatever its value. Unlike the getters,
+ *       this tells an explicit 0 from an unset option.
+ *
+ *       NOTE: 'option' is case*in*sensitive.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+bool
+mongoc_uri_has_option (const mongoc_uri_t *uri, const char *option)
+{
+   const bson_t *options;
+   bson_iter_t iter;
+
+   return (options = mongoc_uri_get_options (uri)) &&
+          bson_iter_init_find_case (&iter, options, option);
+}
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -2098,6 +2128,14 @@ mongoc_uri_set_option_as_int32 (mongoc_uri_t *uri,
       return false;
    }
 
+   /* -1 compresses every message, 0 any message that shrinks */
+   if (!bson_strcasecmp (option, MONGOC_URI_COMPRESSIONMINSIZE) &&
+       value < -1) {
+      MONGOC_WARNING (
+         "Invalid \"%s\" of %d: must be at least -1", option, value);
+      return false;
+   }
+
    /* zlib levels are from -1 (default) through 9 (best compression) */
    if (!bson_strcasecmp (option, MONGOC_URI_ZLIBCOMPRESSIONLEVEL) &&
        (value < -1 || value > 9)) {
@@ -2106,6 +2144,15 @@ mongoc_uri_set_option_as_int32 (mongoc_uri_t *uri,
       return false;
    }
 
+   /* zstd levels are from 1 through 22 (best compression), 0 is zstd's
+    * default */
+   if (!bson_strcasecmp (option, MONGOC_URI_ZSTDCOMPRESSIONLEVEL) &&
+       (value < 0 || value > 22)) {
+      MONGOC_WARNING (
+         "Invalid \"%s\" of %d: must be between 0 and 22", option, value);
+      return false;
+   }
+
    return _mongoc_uri_set_option_as_int32 (uri, option, value);
 }
 
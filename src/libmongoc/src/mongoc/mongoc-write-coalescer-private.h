@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGOC_WRITE_COALESCER_PRIVATE_H
+#define MONGOC_WRITE_COALESCER_PRIVATE_H
+
+#if !defined(MONGOC_COMPILATION)
+#error "Only <mongoc.h> can be included directly."
+#endif
+
+#include <bson.h>
+
+#include "mongoc-array-private.h"
+#include "mongoc-thread-private.h"
+#include "mongoc-write-command-private.h"
+
+
+BSON_BEGIN_DECLS
+
+/* a group is closed once it has this many documents, or before it would
+ * exceed this many bytes, so that one batch of one command carries it on
+ * any server */
+#define MONGOC_WRITE_COALESCER_MAX_DOCUMENTS 1000
+#define MONGOC_WRITE_COALESCER_MAX_BYTES (16 * 1024 * 1024)
+
+
+/* concurrent inserts into one namespace with one write concern, sent as
+ * one "insert" command by the thread that started the group */
+typedef struct _mongoc_write_coalescer_group_t {
+   char *ns;
+   bson_t write_concern;
+   bool bypass;
+   mongoc_array_t documents; /* array of const bson_t pointers */
+   int64_t n_bytes;
+   bool closed;
+   bool done;
+   int n_members; /* callers that have not yet taken their result */
+   mongoc_write_result_t result;
+   mongoc_cond_t cond;
+   struct _mongoc_write_coalescer_group_t *next;
+} mongoc_write_coalescer_group_t;
+
+
+typedef struct _mongoc_write_coalescer_t {
+   int32_t window_msec;
+   bson_mutex_t mutex;
+   mongoc_write_coalescer_group_t *open; /* groups accepting documents */
+} mongoc_write_coalescer_t;
+
+
+mongoc_write_coalescer_t *
+_mongoc_write_coalescer_new (int32_t window_msec);
+
+void
+_mongoc_write_coalescer_destroy (mongoc_write_coalescer_t *coalescer);
+
+mongoc_write_coalescer_group_t *
+_mongoc_write_coalescer_join (mongoc_write_coalescer_t *coalescer,
+                              const char *ns,
+                              const bson_t *write_concern,
+                              bool bypass,
+                              const bson_t *document,
+                              uint32_t *index);
+
+void
+_mongoc_write_coalescer_complete (mongoc_write_coalescer_t *coalescer,
+                                  mongoc_write_coalescer_group_t *group);
+
+void
+_mongoc_write_coalescer_leave (mongoc_write_coalescer_t *coalescer,
+                               mongoc_write_coalescer_group_t *group,
+                               uint32_t index,
+                               mongoc_write_result_t *result);
+
+BSON_END_DECLS
+
+
+#endif /* MONGOC_WRITE_COALESCER_PRIVATE_H */
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2019-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mongoc-write-coalescer-private.h"
+#include "mongoc-trace-private.h"
+
+
+mongoc_write_coalescer_t *
+_mongoc_write_coalescer_new (int32_t window_msec)
+{
+   mongoc_write_coalescer_t *coalescer;
+
+   BSON_ASSERT (window_msec > 0);
+
+   coalescer = (mongoc_write_coalescer_t *) bson_malloc0 (sizeof *coalescer);
+   coalescer->window_msec = window_msec;
+   bson_mutex_init (&coalescer->mutex);
+
+   return coalescer;
+}
+
+
+void
+_mongoc_write_coalescer_destroy (mongoc_write_coalescer_t *coalescer)
+{
+   if (!coalescer) {
+      return;
+   }
+
+   /* every insert that joined a group has returned */
+   BSON_ASSERT (!coalescer->open);
+
+   bson_mutex_destroy (&coalescer->mutex);
+   bson_free (coalescer);
+}
+
+
+static mongoc_write_coalescer_group_t *
+_mongoc_write_coalescer_group_new (const char *ns,
+                                   const bson_t *write_concern,
+                                   bool bypass)
+{
+   mongoc_write_coalescer_group_t *group;
+
+   group = (mongoc_write_coalescer_group_t *) bson_malloc0 (sizeof *group);
+   group->ns = bson_strdup (ns);
+   bson_copy_to (write_concern, &group->write_concern);
+   group->bypass = bypass;
+   _mongoc_array_init (&group->documents, sizeof (const bson_t *));
+   _mongoc_write_result_init (&group->result);
+   mongoc_cond_init (&group->cond);
+
+   return group;
+}
+
+
+static void
+_mongoc_write_coalescer_group_destroy (mongoc_write_coalescer_group_t *group)
+{
+   bson_free (group->ns);
+   bson_destroy (&group->write_concern);
+   _mongoc_array_destroy (&group->documents);
+   _mongoc_write_result_destroy (&group->result);
+   mongoc_cond_destroy (&group->cond);
+   bson_free (group);
+}
+
+
+/* stop @group accepting documents and wake its first caller. call with the
+ * coalescer's mutex held */
+static void
+_mongoc_write_coalescer_close (mongoc_write_coalescer_t *coalescer,
+                               mongoc_write_coalescer_group_t *group)
+{
+   mongoc_write_coalescer_group_t **link;
+
+   for (link = &coalescer->open; *link; link = &(*link)->next) {
+      if (*link == group) {
+         *link = group->next;
+         break;
+      }
+   }
+
+   group->next = NULL;
+   group->closed = true;
+   mongoc_cond_broadcast (&group->cond);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_coalescer_join --
+ *
+ *       Add @document to the open group for @ns, @write_concern, and
+ *       @bypass, or start a group if there is none or it has no room.
+ *       @document must stay valid until _mongoc_write_coalescer_leave.
+ *
+ *       The caller that starts a group waits up to the coalescer's
+ *       window for others to join, then returns with the group closed
+ *       and *@index set to 0: it must send the group's documents as one
+ *       unordered "insert" command, store the outcome in the group's
+ *       "result", and call _mongoc_write_coalescer_complete. Any other
+ *       caller returns once that is done.
+ *
+ * Returns:
+ *       The group. *@index is set to @document's position in it.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+mongoc_write_coalescer_group_t *
+_mongoc_write_coalescer_join (mongoc_write_coalescer_t *coalescer,
+                              const char *ns,
+                              const bson_t *write_concern,
+                              bool bypass,
+                              const bson_t *document,
+                              uint32_t *index)
+{
+   mongoc_write_coalescer_group_t *group;
+   int64_t expire_at;
+   int64_t remaining_msec;
+
+   ENTRY;
+
+   BSON_ASSERT (coalescer);
+   BSON_ASSERT (ns);
+   BSON_ASSERT (write_concern);
+   BSON_ASSERT (document);
+   BSON_ASSERT (index);
+
+   bson_mutex_lock (&coalescer->mutex);
+
+   for (group = coalescer->open; group; group = group->next) {
+      if (group->bypass == bypass && !strcmp (group->ns, ns) &&
+          bson_equal (&group->write_concern, write_concern)) {
+         break;
+      }
+   }
+
+   if (group && group->n_bytes + document->len >
+                   MONGOC_WRITE_COALESCER_MAX_BYTES) {
+      _mongoc_write_coalescer_close (coalescer, group);
+      group = NULL;
+   }
+
+   if (group) {
+      *index = (uint32_t) group->documents.len;
+      _mongoc_array_append_val (&group->documents, document);
+      group->n_bytes += document->len;
+      group->n_members++;
+
+      if (group->documents.len == MONGOC_WRITE_COALESCER_MAX_DOCUMENTS) {
+         _mongoc_write_coalescer_close (coalescer, group);
+      }
+
+      while (!group->done) {
+         mongoc_cond_wait (&group->cond, &coalescer->mutex);
+      }
+
+      bson_mutex_unlock (&coalescer->mutex);
+      RETURN (group);
+   }
+
+   group = _mongoc_write_coalescer_group_new (ns, write_concern, bypass);
+   *index = 0;
+   _mongoc_array_append_val (&group->documents, document);
+   group->n_bytes = document->len;
+   group->n_members = 1;
+   group->next = coalescer->open;
+   coalescer->open = group;
+
+   expire_at = bson_get_monotonic_time () + coalescer->window_msec * 1000;
+
+   while (!group->closed) {
+      remaining_msec = (expire_at - bson_get_monotonic_time ()) / 1000;
+      if (remaining_msec <= 0) {
+         _mongoc_write_coalescer_close (coalescer, group);
+         break;
+      }
+
+      mongoc_cond_timedwait (&group->cond, &coalescer->mutex, remaining_msec);
+   }
+
+   bson_mutex_unlock (&coalescer->mutex);
+   RETURN (group);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_coalescer_complete --
+ *
+ *       Called by the caller that started @group once its "result" is
+ *       set: wake the group's other callers.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_coalescer_complete (mongoc_write_coalescer_t *coalescer,
+                                  mongoc_write_coalescer_group_t *group)
+{
+   bson_mutex_lock (&coalescer->mutex);
+   BSON_ASSERT (group->closed);
+   group->done = true;
+   mongoc_cond_broadcast (&group->cond);
+   bson_mutex_unlock (&coalescer->mutex);
+}
+
+
+/* the part of the group's result @src that concerns the document at
+ * @index, as if it had been inserted alone */
+static void
+_mongoc_write_coalescer_slice (const mongoc_write_result_t *src,
+                               uint32_t index,
+                               mongoc_write_result_t *result)
+{
+   bson_iter_t iter;
+   bson_iter_t child;
+   bson_t write_error;
+   bson_t doc;
+   const uint8_t *data;
+   uint32_t len;
+   bool has_write_error = false;
+
+   if (bson_iter_init (&iter, &src->writeErrors)) {
+      while (!has_write_error && bson_iter_next (&iter)) {
+         if (!BSON_ITER_HOLDS_DOCUMENT (&iter) ||
+             !bson_iter_recurse (&iter, &child) ||
+             !bson_iter_find (&child, "index") ||
+             !BSON_ITER_HOLDS_INT32 (&child) ||
+             bson_iter_int32 (&child) != (int32_t) index) {
+            continue;
+         }
+
+         bson_iter_document (&iter, &len, &data);
+         BSON_ASSERT (bson_init_static (&doc, data, len));
+         BSON_APPEND_DOCUMENT_BEGIN (&result->writeErrors, "0", &write_error);
+         BSON_APPEND_INT32 (&write_error, "index", 0);
+         bson_copy_to_excluding_noinit (&doc, &write_error, "index", NULL);
+         bson_append_document_end (&result->writeErrors, &write_error);
+         has_write_error = true;
+      }
+   }
+
+   /* a command error is every document's error; another document's write
+    * error is not */
+   if (src->error.code) {
+      memcpy (&result->error, &src->error, sizeof result->error);
+      result->failed = true;
+   } else if (has_write_error) {
+      result->failed = true;
+   } else {
+      result->nInserted = 1;
+   }
+
+   result->must_stop = src->must_stop;
+
+   bson_destroy (&result->writeConcernErrors);
+   bson_copy_to (&src->writeConcernErrors, &result->writeConcernErrors);
+   result->n_writeConcernErrors = src->n_writeConcernErrors;
+
+   bson_destroy (&result->errorLabels);
+   bson_copy_to (&src->errorLabels, &result->errorLabels);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * _mongoc_write_coalescer_leave --
+ *
+ *       Fill out the initialized @result with the outcome of inserting
+ *       the document at @index of @group, and release the caller's
+ *       reference to @group.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_coalescer_leave (mongoc_write_coalescer_t *coalescer,
+                               mongoc_write_coalescer_group_t *group,
+                               uint32_t index,
+                               mongoc_write_result_t *result)
+{
+   ENTRY;
+
+   bson_mutex_lock (&coalescer->mutex);
+   BSON_ASSERT (group->done);
+   _mongoc_write_coalescer_slice (&group->result, index, result);
+
+   if (--group->n_members == 0) {
+      _mongoc_write_coalescer_group_destroy (group);
+   }
+
+   bson_mutex_unlock (&coalescer->mutex);
+
+   EXIT;
+}
@@ -28,6 +28,7 @@
 #include "mongoc-write-concern.h"
 #include "mongoc-server-stream-private.h"
 #include "mongoc-buffer-private.h"
+#include "mongoc-array-private.h"
 
 
 BSON_BEGIN_DECLS
@@ -48,10 +49,23 @@ struct _mongoc_bulk_write_flags_t {
 };
 
 
+/* a document inserted by reference: any bytes the command generated for it,
+ * such as a new "_id", followed by bytes the caller still owns */
+typedef struct {
+   uint32_t prefix_offset; /* into the command's payload */
+   uint32_t prefix_len;
+   const uint8_t *data;
+   uint32_t data_len;
+} mongoc_write_command_ref_t;
+
+
 typedef struct {
    int type;
    mongoc_buffer_t payload;
    uint32_t n_documents;
+   /* if set, documents are in refs and payload only holds their prefixes */
+   bool by_reference;
+   mongoc_array_t refs;
    mongoc_bulk_write_flags_t flags;
    int64_t operation_id;
    bson_t cmd_opts;
@@ -147,6 +161,9 @@ void
 _mongoc_write_command_insert_append (mongoc_write_command_t *command,
                                      const bson_t *document);
 void
+_mongoc_write_command_insert_append_ref (mongoc_write_command_t *command,
+                                         const bson_t *document);
+void
 _mongoc_write_command_update_append (mongoc_write_command_t *command,
                                      const bson_t *selector,
                                      const bson_t *update,
@@ -157,6 +174,12 @@ _mongoc_write_command_delete_append (mongoc_write_command_t *command,
                                      const bson_t *selector,
                                      const bson_t *opts);
 
+void
+_mongoc_write_command_init_slice (mongoc_write_command_t *slice,
+                                  const mongoc_write_command_t *command,
+                                  uint32_t first,
+                                  uint32_t n_documents);
+
 void
 _mongoc_write_command_too_large_error (bson_error_t *error,
                                        int32_t idx,
@@ -197,6 +220,9 @@ _mongoc_write_result_merge (mongoc_write_result_t *result,
                             mongoc_write_command_t *command,
                             const bson_t *reply,
                             uint32_t offset);
+void
+_mongoc_write_result_merge_result (mongoc_write_result_t *result,
+                                   const mongoc_write_result_t *src);
 #define MONGOC_WRITE_RESULT_COMPLETE(_result, ...) \
    _mongoc_write_result_complete (_result, __VA_ARGS__, NULL)
 bool
@@ -78,6 +78,7 @@ _mongoc_write_command_insert_append (mongoc_write_command_t *command,
 
    BSON_ASSERT (command);
    BSON_ASSERT (command->type == MONGOC_WRITE_COMMAND_INSERT);
+   BSON_ASSERT (!command->by_reference);
    BSON_ASSERT (document);
    BSON_ASSERT (document->len >= 5);
 
@@ -102,6 +103,116 @@ _mongoc_write_command_insert_append (mongoc_write_command_t *command,
    EXIT;
 }
 
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_command_insert_append_ref --
+ *
+ *       Like _mongoc_write_command_insert_append, but @document's bytes
+ *       are not copied: the command refers to them whenever it is
+ *       executed, so @document must not be modified or freed until the
+ *       command has been executed for the last time. If @document has
+ *       no "_id", the command writes a new header and "_id" element of
+ *       its own and sends them before the rest of @document. A command's
+ *       documents must be all appended by reference or all copied.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_command_insert_append_ref (mongoc_write_command_t *command,
+                                         const bson_t *document)
+{
+   mongoc_write_command_ref_t ref;
+   bson_iter_t iter;
+   bson_oid_t oid;
+   uint8_t prefix[21];
+   uint32_t len_le;
+
+   ENTRY;
+
+   BSON_ASSERT (command);
+   BSON_ASSERT (command->type == MONGOC_WRITE_COMMAND_INSERT);
+   BSON_ASSERT (command->by_reference || !command->n_documents);
+   BSON_ASSERT (document);
+   BSON_ASSERT (document->len >= 5);
+
+   if (!command->by_reference) {
+      _mongoc_array_init (&command->refs, sizeof (mongoc_write_command_ref_t));
+      command->by_reference = true;
+   }
+
+   ref.prefix_offset = (uint32_t) command->payload.len;
+   ref.prefix_len = 0;
+   ref.data = bson_get_data (document);
+   ref.data_len = document->len;
+
+   if (!bson_iter_init_find (&iter, document, "_id")) {
+      /* the same bytes _mongoc_write_command_insert_append makes: a header,
+       * then a new "_id", then @document's elements and trailing nul */
+      bson_oid_init (&oid, NULL);
+      len_le = BSON_UINT32_TO_LE (document->len + (uint32_t) sizeof prefix - 4);
+      memcpy (prefix, &len_le, 4);
+      prefix[4] = BSON_TYPE_OID;
+      memcpy (prefix + 5, "_id", 4);
+      memcpy (prefix + 9, oid.bytes, 12);
+      _mongoc_buffer_append (&command->payload, prefix, sizeof prefix);
+
+      ref.prefix_len = (uint32_t) sizeof prefix;
+      ref.data += 4;
+      ref.data_len -= 4;
+   }
+
+   _mongoc_array_append_val (&command->refs, ref);
+   command->n_documents++;
+
+   EXIT;
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_command_flatten --
+ *
+ *       Copy the documents of a command whose inserts were appended by
+ *       reference into its payload, for code that reads them from there.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_write_command_flatten (mongoc_write_command_t *command)
+{
+   mongoc_write_command_ref_t *ref;
+   mongoc_buffer_t payload;
+   size_t i;
+
+   if (!command->by_reference) {
+      return;
+   }
+
+   _mongoc_buffer_init (&payload, NULL, 0, NULL, NULL);
+
+   for (i = 0; i < command->refs.len; i++) {
+      ref = (mongoc_write_command_ref_t *) command->refs.data + i;
+      if (ref->prefix_len) {
+         _mongoc_buffer_append (&payload,
+                                command->payload.data + ref->prefix_offset,
+                                ref->prefix_len);
+      }
+
+      _mongoc_buffer_append (&payload, ref->data, ref->data_len);
+   }
+
+   _mongoc_buffer_destroy (&command->payload);
+   command->payload = payload;
+   _mongoc_array_destroy (&command->refs);
+   command->by_reference = false;
+}
+
+
 void
 _mongoc_write_command_update_append (mongoc_write_command_t *command,
                                      const bson_t *selector,
@@ -184,6 +295,7 @@ _mongoc_write_command_init_bulk (mongoc_write_command_t *command,
 
    _mongoc_buffer_init (&command->payload, NULL, 0, NULL, NULL);
    command->n_documents = 0;
+   command->by_reference = false;
 
    EXIT;
 }
@@ -231,9 +343,10 @@ _mongoc_write_command_init_insert_idl (mongoc_write_command_t *command,
       command, MONGOC_WRITE_COMMAND_INSERT, flags, operation_id, cmd_opts);
 
    command->u.insert.allow_bulk_op_insert = (uint8_t) allow_bulk_op_insert;
-   /* must handle NULL document from mongoc_collection_insert_bulk */
+   /* insert_one and insert_many execute the command before they return, so
+    * their documents can be sent without copying them */
    if (document) {
-      _mongoc_write_command_insert_append (command, document);
+      _mongoc_write_command_insert_append_ref (command, document);
    }
 
    EXIT;
@@ -429,6 +542,371 @@ _mongoc_write_command_will_overflow (uint32_t len_so_far,
 }
 
 
+/* MongoDB has a extra allowance to allow updating 16mb document,
+ * as the update operators would otherwise overflow the 16mb object limit
+ */
+#define BSON_OBJECT_ALLOWANCE (16 * 1024)
+
+/* batches sent behind the oldest unanswered one may total this many bytes:
+ * less than the send and receive buffers of a connection hold together on
+ * any common platform */
+#define MONGOC_WRITE_PIPELINE_MAX_QUEUED_BYTES (64 * 1024)
+
+
+/* documents of a write command that are sent as one OP_MSG */
+typedef struct {
+   uint32_t offset; /* payload bytes before the batch */
+   uint32_t size;
+   uint32_t first; /* index of the batch's first document */
+   uint32_t n_documents;
+   mongoc_cluster_pipeline_op_t op;
+} mongoc_write_batch_t;
+
+
+/* the length of document @i, which starts @offset bytes into the payload */
+static int32_t
+_mongoc_write_command_doc_len (const mongoc_write_command_t *command,
+                               uint32_t i,
+                               uint32_t offset)
+{
+   const mongoc_write_command_ref_t *ref;
+   int32_t len;
+
+   if (command->by_reference) {
+      ref = (const mongoc_write_command_ref_t *) command->refs.data + i;
+      return (int32_t) (ref->prefix_len + ref->data_len);
+   }
+
+   memcpy (&len, command->payload.data + offset, 4);
+
+   return BSON_UINT32_FROM_LE (len);
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_command_init_slice --
+ *
+ *       Initialize @slice as a copy of @n_documents of @command's
+ *       documents, starting with document @first, to be executed on its
+ *       own. Documents @command refers to are referred to by @slice too.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_command_init_slice (mongoc_write_command_t *slice,
+                                  const mongoc_write_command_t *command,
+                                  uint32_t first,
+                                  uint32_t n_documents)
+{
+   const mongoc_write_command_ref_t *refs;
+   mongoc_write_command_ref_t ref;
+   uint32_t offset = 0;
+   uint32_t len = 0;
+   uint32_t i;
+
+   ENTRY;
+
+   BSON_ASSERT (slice);
+   BSON_ASSERT (command);
+   BSON_ASSERT (first + n_documents <= command->n_documents);
+
+   _mongoc_write_command_init_bulk (slice,
+                                    command->type,
+                                    command->flags,
+                                    command->operation_id,
+                                    &command->cmd_opts);
+   slice->u = command->u;
+   slice->n_documents = n_documents;
+
+   if (command->by_reference) {
+      _mongoc_array_init (&slice->refs, sizeof (mongoc_write_command_ref_t));
+      slice->by_reference = true;
+      refs = (const mongoc_write_command_ref_t *) command->refs.data;
+
+      for (i = first; i < first + n_documents; i++) {
+         ref = refs[i];
+         ref.prefix_offset = (uint32_t) slice->payload.len;
+         if (ref.prefix_len) {
+            _mongoc_buffer_append (&slice->payload,
+                                   command->payload.data +
+                                      refs[i].prefix_offset,
+                                   ref.prefix_len);
+         }
+
+         _mongoc_array_append_val (&slice->refs, ref);
+      }
+
+      EXIT;
+   }
+
+   /* find the slice's bytes in the payload */
+   for (i = 0; i < first; i++) {
+      offset += (uint32_t) _mongoc_write_command_doc_len (command, i, offset);
+   }
+
+   for (i = first; i < first + n_documents; i++) {
+      len +=
+         (uint32_t) _mongoc_write_command_doc_len (command, i, offset + len);
+   }
+
+   _mongoc_buffer_append (&slice->payload, command->payload.data + offset, len);
+
+   EXIT;
+}
+
+
+/* make @batch the document sequence @cmd sends. documents appended by
+ * reference are sent from where they are, in segments listed in @iov */
+static void
+_mongoc_write_opmsg_set_payload (const mongoc_write_command_t *command,
+                                 const mongoc_write_batch_t *batch,
+                                 mongoc_array_t *iov,
+                                 mongoc_cmd_t *cmd)
+{
+   const mongoc_write_command_ref_t *refs;
+   mongoc_iovec_t segment;
+   uint32_t i;
+
+   if (command->by_reference) {
+      refs = (const mongoc_write_command_ref_t *) command->refs.data;
+      _mongoc_array_clear (iov);
+      for (i = batch->first; i < batch->first + batch->n_documents; i++) {
+         if (refs[i].prefix_len) {
+            segment.iov_base =
+               (void *) (command->payload.data + refs[i].prefix_offset);
+            segment.iov_len = refs[i].prefix_len;
+            _mongoc_array_append_val (iov, segment);
+         }
+
+         segment.iov_base = (void *) refs[i].data;
+         segment.iov_len = refs[i].data_len;
+         _mongoc_array_append_val (iov, segment);
+      }
+
+      cmd->payload_iov = (mongoc_iovec_t *) iov->data;
+      cmd->payload_iovcnt = iov->len;
+   } else {
+      /* Seek past the document offset we have already sent */
+      cmd->payload = command->payload.data + batch->offset;
+   }
+
+   /* Only send the documents up to this size */
+   cmd->payload_size = batch->size;
+   cmd->payload_identifier = gCommandFields[command->type];
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_opmsg_plan_batch --
+ *
+ *       Add as many documents after @batch->first as fit in one OP_MSG
+ *       to @batch, at least one.
+ *
+ * Returns:
+ *       false if the first document is too large to send, and @error is
+ *       set.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static bool
+_mongoc_write_opmsg_plan_batch (const mongoc_write_command_t *command,
+                                mongoc_server_stream_t *server_stream,
+                                uint32_t header,
+                                uint32_t index_offset,
+                                mongoc_write_batch_t *batch,
+                                bson_error_t *error)
+{
+   int32_t max_bson_obj_size;
+   int32_t max_msg_size;
+   int32_t max_document_count;
+   int32_t len;
+
+   max_bson_obj_size = mongoc_server_stream_max_bson_obj_size (server_stream);
+   max_msg_size = mongoc_server_stream_max_msg_size (server_stream);
+   max_document_count =
+      mongoc_server_stream_max_write_batch_size (server_stream);
+
+   batch->size = 0;
+   batch->n_documents = 0;
+
+   while (batch->first + batch->n_documents < command->n_documents &&
+          batch->n_documents < max_document_count) {
+      len = _mongoc_write_command_doc_len (command,
+                                           batch->first + batch->n_documents,
+                                           batch->offset + batch->size);
+
+      if (len > max_bson_obj_size + BSON_OBJECT_ALLOWANCE) {
+         if (batch->n_documents) {
+            break;
+         }
+
+         _mongoc_write_command_too_large_error (
+            error, index_offset + batch->first, len, max_bson_obj_size);
+         return false;
+      }
+
+      if (batch->n_documents && header + batch->size + len > max_msg_size) {
+         break;
+      }
+
+      batch->size += len;
+      batch->n_documents++;
+   }
+
+   return true;
+}
+
+
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_opmsg_pipelined --
+ *
+ *       Send the batches of an unordered write command without waiting
+ *       for the reply to each before sending the next: up to the URI
+ *       option "maxWriteBatchesInFlight" are sent on the connection
+ *       before the oldest reply is read, as long as those behind the
+ *       oldest total at most MONGOC_WRITE_PIPELINE_MAX_QUEUED_BYTES. Each
+ *       reply is merged into @result with the offset of its batch's
+ *       first document.
+ *
+ *       Not for retryable writes: a batch can only be retried with its
+ *       own transaction number, which the server no longer accepts once
+ *       a later batch used a higher one.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+static void
+_mongoc_write_opmsg_pipelined (mongoc_write_command_t *command,
+                               mongoc_client_t *client,
+                               mongoc_server_stream_t *server_stream,
+                               mongoc_cmd_parts_t *parts,
+                               uint32_t header,
+                               uint32_t index_offset,
+                               mongoc_write_result_t *result,
+                               bson_error_t *error)
+{
+   mongoc_cluster_pipeline_t pipeline;
+   mongoc_array_t in_flight; /* mongoc_write_batch_t, oldest first */
+   mongoc_array_t iov;
+   mongoc_write_batch_t batch;
+   mongoc_write_batch_t *batches;
+   uint32_t max_in_flight = client->cluster.max_write_batches_in_flight;
+   int64_t queued_bytes = 0; /* in flight behind the oldest batch */
+   bool planning = true;
+   bool planned = false;
+   bool ret;
+   bson_t reply;
+
+   ENTRY;
+
+   _mongoc_array_init (&in_flight, sizeof (mongoc_write_batch_t));
+   _mongoc_array_init (&iov, sizeof (mongoc_iovec_t));
+   mongoc_cluster_pipeline_init (&pipeline, &client->cluster, server_stream);
+
+   batch.offset = 0;
+   batch.size = 0;
+   batch.first = 0;
+   batch.n_documents = 0;
+
+   while (planning || in_flight.len) {
+      while (planning && in_flight.len < max_in_flight) {
+         if (!planned) {
+            batch.offset += batch.size;
+            batch.first += batch.n_documents;
+            if (batch.first == command->n_documents) {
+               planning = false;
+               break;
+            }
+
+            if (!_mongoc_write_opmsg_plan_batch (command,
+                                                 server_stream,
+                                                 header,
+                                                 index_offset,
+                                                 &batch,
+                                                 error)) {
+               /* stop at a document too large to send, like the serial
+                * path */
+               result->failed = true;
+               planning = false;
+               break;
+            }
+
+            planned = true;
+         }
+
+         /* the server writes each reply before reading on, so only queue
+          * what the connection's buffers surely hold while we do not read:
+          * otherwise both sides could block writing */
+         if (in_flight.len &&
+             queued_bytes + header + batch.size >
+                MONGOC_WRITE_PIPELINE_MAX_QUEUED_BYTES) {
+            break;
+         }
+
+         planned = false;
+         _mongoc_write_opmsg_set_payload (
+            command, &batch, &iov, &parts->assembled);
+
+         if (mongoc_cluster_pipeline_send_monitored (
+                &pipeline, &parts->assembled, &batch.op, error)) {
+            if (in_flight.len) {
+               queued_bytes += header + batch.size;
+            }
+
+            _mongoc_array_append_val (&in_flight, batch);
+         } else {
+            /* the pipeline failed, nothing more can be sent */
+            result->failed = true;
+            result->must_stop = true;
+            planning = false;
+         }
+      }
+
+      if (!in_flight.len) {
+         break;
+      }
+
+      batches = (mongoc_write_batch_t *) in_flight.data;
+      ret = mongoc_cluster_pipeline_recv_monitored (
+         &pipeline, &parts->assembled, &batches[0].op, &reply, error);
+
+      if (!ret) {
+         result->failed = true;
+         result->must_stop = true;
+         planning = false;
+      }
+
+      _mongoc_write_result_merge (
+         result, command, &reply, index_offset + batches[0].first);
+      bson_destroy (&reply);
+
+      /* the next batch is the oldest now */
+      if (in_flight.len > 1) {
+         queued_bytes -= header + batches[1].size;
+      }
+
+      memmove (&batches[0],
+               &batches[1],
+               (in_flight.len - 1) * sizeof (mongoc_write_batch_t));
+      in_flight.len--;
+   }
+
+   mongoc_cluster_pipeline_destroy (&pipeline);
+   _mongoc_array_destroy (&iov);
+   _mongoc_array_destroy (&in_flight);
+
+   EXIT;
+}
+
+
 static void
 _mongoc_write_opmsg (mongoc_write_command_t *command,
                      mongoc_client_t *client,
@@ -456,6 +934,8 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
    int document_count = 0;
    int32_t len;
    mongoc_server_stream_t *retry_server_stream = NULL;
+   mongoc_write_batch_t batch;
+   mongoc_array_t iov;
 
    ENTRY;
 
@@ -465,10 +945,6 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
    BSON_ASSERT (server_stream);
    BSON_ASSERT (collection);
 
-/* MongoDB has a extra allowance to allow updating 16mb document,
- * as the update operators would otherwise overflow the 16mb object limit
- */
-#define BSON_OBJECT_ALLOWANCE (16 * 1024)
    max_bson_obj_size = mongoc_server_stream_max_bson_obj_size (server_stream);
    max_msg_size = mongoc_server_stream_max_msg_size (server_stream);
    max_document_count =
@@ -526,11 +1002,30 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
    header =
       26 + parts.assembled.command->len + gCommandFieldLens[command->type] + 1;
 
+   if (!command->flags.ordered && parts.assembled.is_acknowledged &&
+       !parts.is_retryable_write && !_mongoc_client_session_in_txn (cs) &&
+       client->cluster.max_write_batches_in_flight > 1) {
+      _mongoc_write_opmsg_pipelined (command,
+                                     client,
+                                     server_stream,
+                                     &parts,
+                                     header,
+                                     index_offset,
+                                     result,
+                                     error);
+      bson_destroy (&cmd);
+      mongoc_cmd_parts_cleanup (&parts);
+      EXIT;
+   }
+
+   _mongoc_array_init (&iov, sizeof (mongoc_iovec_t));
+   batch.first = 0;
+
    do {
-      memcpy (&len,
-              command->payload.data + payload_batch_size + payload_total_offset,
-              4);
-      len = BSON_UINT32_FROM_LE (len);
+      len = _mongoc_write_command_doc_len (
+         command,
+         batch.first + document_count,
+         payload_total_offset + payload_batch_size);
 
       if (len > max_bson_obj_size + BSON_OBJECT_ALLOWANCE) {
          /* Quit if the document is too large */
@@ -547,8 +1042,7 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
          if (++document_count == max_document_count) {
             ship_it = true;
             /* If this document is the last document we have */
-         } else if (payload_batch_size + payload_total_offset ==
-                    command->payload.len) {
+         } else if (batch.first + document_count == command->n_documents) {
             ship_it = true;
          } else {
             ship_it = false;
@@ -561,11 +1055,11 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
          bool is_retryable = parts.is_retryable_write;
          mongoc_write_err_type_t error_type;
 
-         /* Seek past the document offset we have already sent */
-         parts.assembled.payload = command->payload.data + payload_total_offset;
-         /* Only send the documents up to this size */
-         parts.assembled.payload_size = payload_batch_size;
-         parts.assembled.payload_identifier = gCommandFields[command->type];
+         batch.offset = payload_total_offset;
+         batch.size = payload_batch_size;
+         batch.n_documents = (uint32_t) document_count;
+         _mongoc_write_opmsg_set_payload (
+            command, &batch, &iov, &parts.assembled);
 
          /* increment the transaction number for the first attempt of each
           * retryable write command */
@@ -623,14 +1117,16 @@ _mongoc_write_opmsg (mongoc_write_command_t *command,
           */
          _mongoc_write_result_merge (result, command, &reply, index_offset);
          index_offset += document_count;
+         batch.first += document_count;
          document_count = 0;
          bson_destroy (&reply);
       }
       /* While we have more documents to write */
-   } while (payload_total_offset < command->payload.len);
+   } while (batch.first < command->n_documents);
 
    bson_destroy (&cmd);
    mongoc_cmd_parts_cleanup (&parts);
+   _mongoc_array_destroy (&iov);
 
    if (retry_server_stream) {
       mongoc_server_stream_cleanup (retry_server_stream);
@@ -954,7 +1450,7 @@ _mongoc_write_command_execute_idl (mongoc_write_command_t *command,
       EXIT;
    }
 
-   if (command->payload.len == 0) {
+   if (!command->n_documents) {
       _empty_error (command, &result->error);
       EXIT;
    }
@@ -971,6 +1467,9 @@ _mongoc_write_command_execute_idl (mongoc_write_command_t *command,
                            result,
                            &result->error);
    } else {
+      /* the legacy paths read documents from the payload */
+      _mongoc_write_command_flatten (command);
+
       if (mongoc_write_concern_is_acknowledged (crud->writeConcern)) {
          _mongoc_write_opquery (command,
                                 client,
@@ -1005,6 +1504,9 @@ _mongoc_write_command_destroy (mongoc_write_command_t *command)
    if (command) {
       bson_destroy (&command->cmd_opts);
       _mongoc_buffer_destroy (&command->payload);
+      if (command->by_reference) {
+         _mongoc_array_destroy (&command->refs);
+      }
    }
 
    EXIT;
@@ -1240,6 +1742,83 @@ _mongoc_write_result_merge (mongoc_write_result_t *result,   /* IN */
 }
 
 
+/*
+ *-------------------------------------------------------------------------
+ *
+ * _mongoc_write_result_merge_result --
+ *
+ *       Add the counts, errors and upserted ids of @src, the result of
+ *       executing part of a bulk operation, to @result. @src's indexes
+ *       must already be relative to the whole bulk operation.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+void
+_mongoc_write_result_merge_result (mongoc_write_result_t *result,
+                                   const mongoc_write_result_t *src)
+{
+   bson_iter_t iter;
+   bson_t wrapper;
+   char str[16];
+   const char *key;
+
+   ENTRY;
+
+   BSON_ASSERT (result);
+   BSON_ASSERT (src);
+
+   result->nInserted += src->nInserted;
+   result->nMatched += src->nMatched;
+   result->nModified += src->nModified;
+   result->nRemoved += src->nRemoved;
+   result->nUpserted += src->nUpserted;
+
+   /* _mongoc_write_result_merge_arrays renumbers the appended elements */
+   bson_init (&wrapper);
+   BSON_APPEND_ARRAY (&wrapper, "upserted", &src->upserted);
+   BSON_APPEND_ARRAY (&wrapper, "writeErrors", &src->writeErrors);
+
+   if (bson_iter_init_find (&iter, &wrapper, "upserted")) {
+      result->upsert_append_count += _mongoc_write_result_merge_arrays (
+         0, result, &result->upserted, &iter);
+   }
+
+   if (bson_iter_init_find (&iter, &wrapper, "writeErrors")) {
+      _mongoc_write_result_merge_arrays (
+         0, result, &result->writeErrors, &iter);
+   }
+
+   bson_destroy (&wrapper);
+
+   if (bson_iter_init (&iter, &src->writeConcernErrors)) {
+      while (bson_iter_next (&iter)) {
+         bson_uint32_to_string (
+            result->n_writeConcernErrors++, &key, str, sizeof str);
+         BSON_APPEND_VALUE (
+            &result->writeConcernErrors, key, bson_iter_value (&iter));
+      }
+   }
+
+   if (bson_iter_init (&iter, &src->errorLabels)) {
+      while (bson_iter_next (&iter)) {
+         if (BSON_ITER_HOLDS_UTF8 (&iter)) {
+            _mongoc_bson_array_add_label (&result->errorLabels,
+                                          bson_iter_utf8 (&iter, NULL));
+         }
+      }
+   }
+
+   result->failed |= src->failed;
+   result->must_stop |= src->must_stop;
+   if (src->error.code && !result->error.code) {
+      memcpy (&result->error, &src->error, sizeof result->error);
+   }
+
+   EXIT;
+}
+
+
 /*
  * If error is not set, set code from first document in array like
  * [{"code": 64, "errmsg": "duplicate"}, ...]. Format the error message
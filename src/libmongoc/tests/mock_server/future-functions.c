@@ -63,6 +63,29 @@ background_mongoc_bulk_operation_execute (void *data)
    return NULL;
 }
 
+static void *
+background_mongoc_bulk_operation_execute_parallel (void *data)
+{
+   future_t *future = (future_t *) data;
+   future_value_t return_value;
+
+   return_value.type = future_value_uint32_t_type;
+
+   future_value_set_uint32_t (
+      &return_value,
+      mongoc_bulk_operation_execute_parallel (
+         future_value_get_mongoc_bulk_operation_ptr (future_get_param (future, 0)),
+         future_value_get_mongoc_client_pool_ptr (future_get_param (future, 1)),
+         future_value_get_uint32_t (future_get_param (future, 2)),
+         future_value_get_bson_ptr (future_get_param (future, 3)),
+         future_value_get_bson_error_ptr (future_get_param (future, 4))
+      ));
+
+   future_resolve (future, return_value);
+
+   return NULL;
+}
+
 static void *
 background_mongoc_database_read_command_with_opts (void *data)
 {
@@ -1347,6 +1370,36 @@ future_bulk_operation_execute (
    return future;
 }
 
+future_t *
+future_bulk_operation_execute_parallel (
+   mongoc_bulk_operation_ptr bulk,
+   mongoc_client_pool_ptr pool,
+   uint32_t max_parallelism,
+   bson_ptr reply,
+   bson_error_ptr error)
+{
+   future_t *future = future_new (future_value_uint32_t_type,
+                                  5);
+   
+   future_value_set_mongoc_bulk_operation_ptr (
+      future_get_param (future, 0), bulk);
+   
+   future_value_set_mongoc_client_pool_ptr (
+      future_get_param (future, 1), pool);
+   
+   future_value_set_uint32_t (
+      future_get_param (future, 2), max_parallelism);
+   
+   future_value_set_bson_ptr (
+      future_get_param (future, 3), reply);
+   
+   future_value_set_bson_error_ptr (
+      future_get_param (future, 4), error);
+   
+   future_start (future, background_mongoc_bulk_operation_execute_parallel);
+   return future;
+}
+
 future_t *
 future_database_read_command_with_opts (
    mongoc_database_ptr database,
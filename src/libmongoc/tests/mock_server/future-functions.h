@@ -31,6 +31,17 @@ future_bulk_operation_execute (
 );
 
 
+future_t *
+future_bulk_operation_execute_parallel (
+
+   mongoc_bulk_operation_ptr bulk,
+   mongoc_client_pool_ptr pool,
+   uint32_t max_parallelism,
+   bson_ptr reply,
+   bson_error_ptr error
+);
+
+
 future_t *
 future_database_read_command_with_opts (
 
@@ -89,6 +89,8 @@ test_buffer_install (TestSuite *suite);
 extern void
 test_bulk_install (TestSuite *suite);
 extern void
+test_bulk_writer_install (TestSuite *suite);
+extern void
 test_change_stream_install (TestSuite *suite);
 extern void
 test_client_install (TestSuite *suite);
@@ -2328,6 +2330,7 @@ main (int argc, char *argv[])
    test_client_pool_install (&suite);
    test_write_command_install (&suite);
    test_bulk_install (&suite);
+   test_bulk_writer_install (&suite);
    test_cluster_install (&suite);
    test_collection_install (&suite);
    test_collection_find_install (&suite);
@@ -9,6 +9,7 @@
 #include "mock_server/future-functions.h"
 #include "mongoc-errno-private.h"
 #include "test-libmongoc.h"
+#include "test-conveniences.h"
 
 #undef MONGOC_LOG_DOMAIN
 #define MONGOC_LOG_DOMAIN "async-test"
@@ -362,6 +363,433 @@ test_ismaster_delay ()
    mock_server_destroy (server);
 }
 
+typedef struct {
+   uint16_t port;
+   int *ninitiated;
+   int initiated;
+   bool finished;
+   mongoc_stream_t *stream;
+} ordered_cmd_t;
+
+static mongoc_stream_t *
+test_timers_initiator (mongoc_async_cmd_t *acmd)
+{
+   ordered_cmd_t *cmd = (ordered_cmd_t *) acmd->data;
+
+   cmd->initiated = ++(*cmd->ninitiated);
+   cmd->stream = get_localhost_stream (cmd->port);
+
+   return cmd->stream;
+}
+
+static void
+test_timers_callback (mongoc_async_cmd_t *acmd,
+                      mongoc_async_cmd_result_t result,
+                      const bson_t *bson,
+                      int64_t rtt_msec)
+{
+   if (result == MONGOC_ASYNC_CMD_SUCCESS) {
+      ((ordered_cmd_t *) acmd->data)->finished = true;
+   }
+}
+
+/* cmds are initiated in order of their delays, however they were added */
+static void
+test_async_timers (void)
+{
+   mock_server_t *server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mongoc_async_t *async = mongoc_async_new ();
+   int64_t delays[] = {40, 0, 30, 10, 20};
+   ordered_cmd_t cmds[5] = {{0}};
+   int ninitiated = 0;
+   int i;
+
+   mock_server_run (server);
+
+   for (i = 0; i < 5; i++) {
+      cmds[i].port = mock_server_get_port (server);
+      cmds[i].ninitiated = &ninitiated;
+      mongoc_async_cmd_new (async,
+                            NULL,
+                            false,
+                            NULL,
+                            test_timers_initiator,
+                            delays[i],
+                            NULL,
+                            NULL,
+                            "admin",
+                            tmp_bson ("{'isMaster': 1}"),
+                            test_timers_callback,
+                            &cmds[i],
+                            TIMEOUT);
+   }
+
+   mongoc_async_run (async);
+   ASSERT_CMPSIZE_T (async->ncmds, ==, (size_t) 0);
+
+   for (i = 0; i < 5; i++) {
+      BSON_ASSERT (cmds[i].finished);
+      ASSERT_CMPINT (cmds[i].initiated, ==, (int) delays[i] / 10 + 1);
+      mongoc_stream_destroy (cmds[i].stream);
+   }
+
+   mongoc_async_destroy (async);
+   mock_server_destroy (server);
+}
+
+
+typedef struct {
+   int ncalls;
+   bool failed;
+   bson_error_t error;
+   bson_t reply;
+} async_op_result_t;
+
+
+static void
+async_op_result_init (async_op_result_t *result)
+{
+   memset (result, 0, sizeof *result);
+   bson_init (&result->reply);
+}
+
+
+static void
+test_async_op_cb (const bson_t *reply, const bson_error_t *error, void *data)
+{
+   async_op_result_t *result = (async_op_result_t *) data;
+
+   result->ncalls++;
+   result->failed = (error != NULL);
+   if (error) {
+      memcpy (&result->error, error, sizeof (bson_error_t));
+   }
+
+   bson_destroy (&result->reply);
+   bson_copy_to (reply, &result->reply);
+}
+
+
+static void *
+async_run_thread (void *data)
+{
+   mongoc_client_async_run ((mongoc_client_t *) data);
+
+   return NULL;
+}
+
+
+/* a request for {'ping': 1, 'n': n}, returning n */
+static int32_t
+receives_ping (mock_server_t *server, request_t **request)
+{
+   *request = mock_server_receives_msg (
+      server, 0, tmp_bson ("{'$db': 'admin', 'ping': 1}"));
+
+   return bson_lookup_int32 (request_get_doc (*request, 0), "n");
+}
+
+
+static void
+test_client_command_async (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   async_op_result_t results[3];
+   bson_thread_t thread;
+   request_t *requests[2];
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+
+   /* two commands in flight at once, on two connections */
+   for (i = 0; i < 2; i++) {
+      async_op_result_init (&results[i]);
+      ASSERT_OR_PRINT (mongoc_client_command_async (client,
+                                                    "admin",
+                                                    tmp_bson ("{'ping': 1, "
+                                                              "'n': %d}",
+                                                              i),
+                                                    NULL,
+                                                    test_async_op_cb,
+                                                    &results[i],
+                                                    &error),
+                       error);
+   }
+
+   bson_thread_create (&thread, async_run_thread, client);
+
+   for (i = 0; i < 2; i++) {
+      request = NULL;
+      requests[receives_ping (server, &request)] = request;
+   }
+
+   /* reply out of order, and fail the first command */
+   mock_server_replies_simple (requests[1], "{'ok': 1, 'n': 1}");
+   mock_server_replies_simple (
+      requests[0], "{'ok': 0, 'code': 2, 'errmsg': 'bad'}");
+
+   bson_thread_join (thread);
+
+   ASSERT_CMPINT (results[0].ncalls, ==, 1);
+   BSON_ASSERT (results[0].failed);
+   ASSERT_ERROR_CONTAINS (
+      results[0].error, MONGOC_ERROR_QUERY, 2, "bad");
+
+   ASSERT_CMPINT (results[1].ncalls, ==, 1);
+   BSON_ASSERT (!results[1].failed);
+   ASSERT_MATCH (&results[1].reply, "{'ok': 1, 'n': 1}");
+
+   /* both connections are idle, and the next command reuses one */
+   ASSERT_CMPSIZE_T (client->async_idle.len, ==, (size_t) 2);
+   async_op_result_init (&results[2]);
+   ASSERT_OR_PRINT (mongoc_client_command_async (client,
+                                                 "admin",
+                                                 tmp_bson ("{'ping': 1, "
+                                                           "'n': 2}"),
+                                                 NULL,
+                                                 test_async_op_cb,
+                                                 &results[2],
+                                                 &error),
+                    error);
+   ASSERT_CMPSIZE_T (client->async_idle.len, ==, (size_t) 1);
+
+   bson_thread_create (&thread, async_run_thread, client);
+   receives_ping (server, &request);
+   mock_server_hangs_up (request);
+   bson_thread_join (thread);
+
+   /* a network error destroys the connection */
+   ASSERT_CMPINT (results[2].ncalls, ==, 1);
+   BSON_ASSERT (results[2].failed);
+   ASSERT_CMPINT (results[2].error.domain, ==, MONGOC_ERROR_STREAM);
+   ASSERT_CMPSIZE_T (client->async_idle.len, ==, (size_t) 1);
+
+   for (i = 0; i < 3; i++) {
+      bson_destroy (&results[i].reply);
+   }
+
+   request_destroy (request);
+   request_destroy (requests[0]);
+   request_destroy (requests[1]);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+/* destroying the client calls the callbacks of commands still in flight */
+static void
+test_client_command_async_destroy (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   async_op_result_t result;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+
+   async_op_result_init (&result);
+   ASSERT_OR_PRINT (mongoc_client_command_async (client,
+                                                 "admin",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 test_async_op_cb,
+                                                 &result,
+                                                 &error),
+                    error);
+
+   mongoc_client_destroy (client);
+
+   ASSERT_CMPINT (result.ncalls, ==, 1);
+   BSON_ASSERT (result.failed);
+   ASSERT_ERROR_CONTAINS (result.error,
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_SOCKET,
+                          "client destroyed");
+   ASSERT (bson_empty (&result.reply));
+
+   bson_destroy (&result.reply);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_collection_async (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   async_op_result_t insert_result;
+   async_op_result_t find_result;
+   bson_thread_t thread;
+   request_t *request;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   collection = mongoc_client_get_collection (client, "db", "collection");
+
+   async_op_result_init (&insert_result);
+   async_op_result_init (&find_result);
+
+   ASSERT_OR_PRINT (mongoc_collection_insert_one_async (collection,
+                                                        tmp_bson ("{'x': 1}"),
+                                                        test_async_op_cb,
+                                                        &insert_result,
+                                                        &error),
+                    error);
+
+   bson_thread_create (&thread, async_run_thread, client);
+   request = mock_server_receives_msg (
+      server,
+      0,
+      tmp_bson ("{'$db': 'db', 'insert': 'collection', 'documents': "
+                "[{'_id': {'$exists': true}, 'x': 1}]}"));
+   mock_server_replies_simple (request, "{'ok': 1, 'n': 1}");
+   request_destroy (request);
+   bson_thread_join (thread);
+
+   ASSERT_CMPINT (insert_result.ncalls, ==, 1);
+   BSON_ASSERT (!insert_result.failed);
+
+   ASSERT_OR_PRINT (mongoc_collection_find_async (collection,
+                                                  tmp_bson ("{'x': 1}"),
+                                                  tmp_bson ("{'limit': 1}"),
+                                                  test_async_op_cb,
+                                                  &find_result,
+                                                  &error),
+                    error);
+
+   bson_thread_create (&thread, async_run_thread, client);
+   request = mock_server_receives_msg (
+      server,
+      0,
+      tmp_bson ("{'$db': 'db', 'find': 'collection', 'filter': {'x': 1}, "
+                "'limit': 1}"));
+   mock_server_replies_simple (request,
+                               "{'ok': 1, 'cursor': {'id': 0, 'ns': "
+                               "'db.collection', 'firstBatch': [{'x': 1}]}}");
+   request_destroy (request);
+   bson_thread_join (thread);
+
+   ASSERT_CMPINT (find_result.ncalls, ==, 1);
+   BSON_ASSERT (!find_result.failed);
+   ASSERT_MATCH (&find_result.reply, "{'cursor': {'firstBatch': [{'x': 1}]}}");
+
+   bson_destroy (&insert_result.reply);
+   bson_destroy (&find_result.reply);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+#ifndef _WIN32
+/* drive async commands from the application's own poll () loop */
+static void
+test_client_async_event_loop (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_uri_t *uri;
+   async_op_result_t results[2];
+   mongoc_client_async_fd_t fds[2];
+   struct pollfd pfd;
+   request_t *request;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_SOCKETTIMEOUTMS, 500);
+   client = mongoc_client_new_from_uri (uri);
+
+   for (i = 0; i < 2; i++) {
+      async_op_result_init (&results[i]);
+   }
+
+   ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 0);
+   ASSERT_OR_PRINT (mongoc_client_command_async (client,
+                                                 "admin",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 test_async_op_cb,
+                                                 &results[0],
+                                                 &error),
+                    error);
+
+   /* the command waits to send */
+   ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 1);
+   ASSERT_CMPINT (fds[0].events, ==, POLLOUT);
+   ASSERT_CMPINT64 (fds[0].deadline, >, bson_get_monotonic_time ());
+   mongoc_client_async_process_ready (client, fds[0].fd, POLLOUT);
+
+   /* then to receive */
+   ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 1);
+   ASSERT_CMPINT (fds[0].events, ==, POLLIN);
+   request = mock_server_receives_msg (
+      server, 0, tmp_bson ("{'$db': 'admin', 'ping': 1}"));
+   mock_server_replies_simple (request, "{'ok': 1}");
+   request_destroy (request);
+
+   while (!results[0].ncalls) {
+      ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 1);
+      pfd.fd = fds[0].fd;
+      pfd.events = (short) fds[0].events;
+      pfd.revents = 0;
+      ASSERT_CMPINT (poll (&pfd, 1, 10000), ==, 1);
+      mongoc_client_async_process_ready (client, pfd.fd, pfd.revents);
+   }
+
+   BSON_ASSERT (!results[0].failed);
+   ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 0);
+
+   /* a command with no reply fails once its deadline has passed */
+   ASSERT_OR_PRINT (mongoc_client_command_async (client,
+                                                 "admin",
+                                                 tmp_bson ("{'ping': 1}"),
+                                                 NULL,
+                                                 test_async_op_cb,
+                                                 &results[1],
+                                                 &error),
+                    error);
+   ASSERT_CMPSIZE_T (mongoc_client_async_get_fds (client, fds, 2), ==, 1);
+   mongoc_client_async_process_ready (client, fds[0].fd, POLLOUT);
+   request = mock_server_receives_msg (
+      server, 0, tmp_bson ("{'$db': 'admin', 'ping': 1}"));
+
+   mongoc_client_async_process_timeouts (client);
+   ASSERT_CMPINT (results[1].ncalls, ==, 0);
+
+   _mongoc_usleep ((fds[0].deadline - bson_get_monotonic_time ()) + 1000);
+   mongoc_client_async_process_timeouts (client);
+   ASSERT_CMPINT (results[1].ncalls, ==, 1);
+   BSON_ASSERT (results[1].failed);
+   ASSERT_ERROR_CONTAINS (results[1].error,
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_CONNECT,
+                          "socket timeout");
+
+   for (i = 0; i < 2; i++) {
+      bson_destroy (&results[i].reply);
+   }
+
+   request_destroy (request);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+#endif
+
+
 void
 test_async_install (TestSuite *suite)
 {
@@ -379,4 +807,16 @@ test_async_install (TestSuite *suite)
                       test_framework_skip_if_not_single);
 #endif
    TestSuite_AddMockServerTest (suite, "/Async/delay", test_ismaster_delay);
+   TestSuite_AddMockServerTest (suite, "/Async/timers", test_async_timers);
+   TestSuite_AddMockServerTest (
+      suite, "/Async/client_command", test_client_command_async);
+   TestSuite_AddMockServerTest (suite,
+                                "/Async/client_command/destroy",
+                                test_client_command_async_destroy);
+   TestSuite_AddMockServerTest (
+      suite, "/Async/collection", test_collection_async);
+#ifndef _WIN32
+   TestSuite_AddMockServerTest (
+      suite, "/Async/event_loop", test_client_async_event_loop);
+#endif
 }
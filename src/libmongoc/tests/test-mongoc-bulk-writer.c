@@ -0,0 +1,272 @@
+#include <mongoc.h>
+
+#include "TestSuite.h"
+#include "mock_server/mock-server.h"
+#include "test-libmongoc.h"
+#include "test-conveniences.h"
+
+
+typedef struct {
+   int n_errors;
+   int64_t index[4];
+   bson_t *operation[4];
+   bson_error_t error[4];
+} writer_errors_t;
+
+
+static void
+writer_error_cb (int64_t index,
+                 const bson_t *operation,
+                 const bson_error_t *error,
+                 void *context)
+{
+   writer_errors_t *errors = (writer_errors_t *) context;
+
+   ASSERT_CMPINT (errors->n_errors, <, 4);
+   errors->index[errors->n_errors] = index;
+   errors->operation[errors->n_errors] = bson_copy (operation);
+   memcpy (&errors->error[errors->n_errors], error, sizeof *error);
+   errors->n_errors++;
+}
+
+
+static void
+writer_errors_cleanup (writer_errors_t *errors)
+{
+   int i;
+
+   for (i = 0; i < errors->n_errors; i++) {
+      bson_destroy (errors->operation[i]);
+   }
+}
+
+
+static mock_server_t *
+writer_mock_server (void)
+{
+   mock_server_t *server;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   return server;
+}
+
+
+static void
+test_bulk_writer_flush (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_bulk_writer_t *writer;
+   writer_errors_t errors = {0};
+   const bson_t *docs[3];
+   request_t *request;
+   bson_error_t error;
+
+   server = writer_mock_server ();
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   writer = mongoc_bulk_writer_new (
+      pool,
+      "db",
+      "collection",
+      tmp_bson ("{'maxBatchDocuments': 2, 'flushIntervalMS': 100}"),
+      &error);
+   ASSERT_OR_PRINT (writer, error);
+   mongoc_bulk_writer_set_error_cb (writer, writer_error_cb, &errors);
+
+   ASSERT_OR_PRINT (
+      mongoc_bulk_writer_insert (writer, tmp_bson ("{'_id': 0}"), NULL, &error),
+      error);
+   ASSERT_OR_PRINT (
+      mongoc_bulk_writer_insert (writer, tmp_bson ("{'_id': 1}"), NULL, &error),
+      error);
+
+   /* flushed once there are "maxBatchDocuments" operations */
+   docs[0] = tmp_bson ("{'insert': 'collection', 'ordered': false}");
+   docs[1] = tmp_bson ("{'_id': 0}");
+   docs[2] = tmp_bson ("{'_id': 1}");
+   request = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (request, 0, docs, 3));
+
+   /* operations are added while the last batch is in flight */
+   ASSERT_OR_PRINT (
+      mongoc_bulk_writer_insert (writer, tmp_bson ("{'_id': 2}"), NULL, &error),
+      error);
+
+   mock_server_replies_simple (
+      request,
+      "{'ok': 1, 'n': 1,"
+      " 'writeErrors': [{'index': 1, 'code': 11000, 'errmsg': 'dupe'}]}");
+   request_destroy (request);
+
+   /* flushed after "flushIntervalMS" */
+   docs[1] = tmp_bson ("{'_id': 2}");
+   request = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (request, 0, docs, 2));
+   mock_server_replies_ok_and_destroys (request);
+
+   mongoc_bulk_writer_destroy (writer);
+
+   ASSERT_CMPINT (errors.n_errors, ==, 1);
+   ASSERT_CMPINT64 (errors.index[0], ==, (int64_t) 1);
+   ASSERT_MATCH (errors.operation[0], "{'_id': 1}");
+   ASSERT_ERROR_CONTAINS (errors.error[0], MONGOC_ERROR_COMMAND, 11000, "dupe");
+
+   writer_errors_cleanup (&errors);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_writer_command_error (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_bulk_writer_t *writer;
+   writer_errors_t errors = {0};
+   request_t *request;
+   bson_error_t error;
+
+   server = writer_mock_server ();
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   writer = mongoc_bulk_writer_new (
+      pool, "db", "collection", tmp_bson ("{'flushIntervalMS': 100}"), &error);
+   ASSERT_OR_PRINT (writer, error);
+   mongoc_bulk_writer_set_error_cb (writer, writer_error_cb, &errors);
+
+   ASSERT_OR_PRINT (mongoc_bulk_writer_remove_one (
+                       writer, tmp_bson ("{'a': 1}"), NULL, &error),
+                    error);
+   ASSERT_OR_PRINT (mongoc_bulk_writer_remove_one (
+                       writer, tmp_bson ("{'a': 2}"), NULL, &error),
+                    error);
+
+   /* invalid operations are rejected at once */
+   BSON_ASSERT (!mongoc_bulk_writer_update_one (writer,
+                                                tmp_bson ("{}"),
+                                                tmp_bson ("{'a': 1}"),
+                                                NULL,
+                                                &error));
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_COMMAND,
+                          MONGOC_ERROR_COMMAND_INVALID_ARG,
+                          "Invalid key 'a'");
+
+   request = mock_server_receives_msg (server,
+                                       0,
+                                       tmp_bson ("{'delete': 'collection'}"),
+                                       tmp_bson ("{'q': {'a': 1}}"),
+                                       tmp_bson ("{'q': {'a': 2}}"));
+   mock_server_replies_simple (request,
+                               "{'ok': 0, 'code': 13, 'errmsg': 'denied'}");
+   request_destroy (request);
+
+   mongoc_bulk_writer_flush (writer);
+
+   /* the command failed, so each of its operations did */
+   ASSERT_CMPINT (errors.n_errors, ==, 2);
+   ASSERT_CMPINT64 (errors.index[0], ==, (int64_t) 0);
+   ASSERT_MATCH (errors.operation[0], "{'q': {'a': 1}, 'limit': 1}");
+   ASSERT_CMPINT64 (errors.index[1], ==, (int64_t) 1);
+   ASSERT_MATCH (errors.operation[1], "{'q': {'a': 2}, 'limit': 1}");
+   ASSERT_ERROR_CONTAINS (errors.error[1], MONGOC_ERROR_QUERY, 13, "denied");
+
+   mongoc_bulk_writer_destroy (writer);
+   writer_errors_cleanup (&errors);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+/* a writer destroyed while the pool has no client for it reports its
+ * operations as failed, instead of waiting for a client forever. a
+ * @wait_queue_timeout_msec of 0 leaves "waitQueueTimeoutMS" unset */
+static void
+_test_bulk_writer_destroy_without_client (int32_t wait_queue_timeout_msec)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_bulk_writer_t *writer;
+   writer_errors_t errors = {0};
+   bson_error_t error;
+
+   server = writer_mock_server ();
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXPOOLSIZE, 1);
+   if (wait_queue_timeout_msec) {
+      mongoc_uri_set_option_as_int32 (
+         uri, MONGOC_URI_WAITQUEUETIMEOUTMS, wait_queue_timeout_msec);
+   }
+
+   pool = mongoc_client_pool_new (uri);
+
+   /* the pool's only client */
+   client = mongoc_client_pool_pop (pool);
+
+   writer = mongoc_bulk_writer_new (
+      pool, "db", "collection", tmp_bson ("{'flushIntervalMS': 10}"), &error);
+   ASSERT_OR_PRINT (writer, error);
+   mongoc_bulk_writer_set_error_cb (writer, writer_error_cb, &errors);
+
+   ASSERT_OR_PRINT (
+      mongoc_bulk_writer_insert (writer, tmp_bson ("{'_id': 0}"), NULL, &error),
+      error);
+
+   mongoc_bulk_writer_destroy (writer);
+
+   ASSERT_CMPINT (errors.n_errors, ==, 1);
+   ASSERT_CMPINT64 (errors.index[0], ==, (int64_t) 0);
+   ASSERT_MATCH (errors.operation[0], "{'_id': 0}");
+   ASSERT_ERROR_CONTAINS (errors.error[0],
+                          MONGOC_ERROR_CLIENT,
+                          MONGOC_ERROR_CLIENT_NOT_READY,
+                          "no client available");
+
+   writer_errors_cleanup (&errors);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_writer_destroy_without_client (void)
+{
+   _test_bulk_writer_destroy_without_client (0);
+}
+
+
+static void
+test_bulk_writer_destroy_without_client_timeout (void)
+{
+   _test_bulk_writer_destroy_without_client (100);
+}
+
+
+void
+test_bulk_writer_install (TestSuite *suite)
+{
+   TestSuite_AddMockServerTest (
+      suite, "/BulkWriter/flush", test_bulk_writer_flush);
+   TestSuite_AddMockServerTest (
+      suite, "/BulkWriter/command_error", test_bulk_writer_command_error);
+   TestSuite_AddMockServerTest (suite,
+                                "/BulkWriter/destroy_without_client",
+                                test_bulk_writer_destroy_without_client);
+   TestSuite_AddMockServerTest (
+      suite,
+      "/BulkWriter/destroy_without_client/wait_queue_timeout",
+      test_bulk_writer_destroy_without_client_timeout);
+}
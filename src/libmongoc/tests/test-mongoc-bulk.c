@@ -3322,6 +3322,425 @@ test_numerous_unordered (void *ctx)
 }
 
 
+static void
+zero_copy_started (const mongoc_apm_command_started_t *event)
+{
+   const bson_t *cmd;
+   bson_iter_t iter;
+   bson_iter_t documents;
+   int *n_documents;
+
+   cmd = mongoc_apm_command_started_get_command (event);
+   n_documents = (int *) mongoc_apm_command_started_get_context (event);
+
+   BSON_ASSERT (bson_iter_init_find (&iter, cmd, "documents"));
+   BSON_ASSERT (bson_iter_recurse (&iter, &documents));
+   while (bson_iter_next (&documents)) {
+      (*n_documents)++;
+   }
+}
+
+
+static void
+test_bulk_zero_copy (void)
+{
+   mock_server_t *server;
+   mongoc_client_t *client;
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t *with_id = tmp_bson ("{'_id': 1, 'a': 1}");
+   bson_t *without_id = tmp_bson ("{'b': 2}");
+   bson_t *third = tmp_bson ("{'_id': 3}");
+   const bson_t *docs[3];
+   bson_iter_t iter;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+   int n_documents = 0;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d,"
+                              " 'maxWriteBatchSize': 2}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   callbacks = mongoc_apm_callbacks_new ();
+   mongoc_apm_set_command_started_cb (callbacks, zero_copy_started);
+   mongoc_client_set_apm_callbacks (client, callbacks, &n_documents);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      collection, tmp_bson ("{'zeroCopy': true}"));
+
+   mongoc_bulk_operation_insert (bulk, with_id);
+   mongoc_bulk_operation_insert (bulk, without_id);
+   mongoc_bulk_operation_insert (bulk, third);
+
+   /* the bulk refers to the caller's documents, it did not copy them */
+   BSON_ASSERT (bson_iter_init_find (&iter, with_id, "a"));
+   bson_iter_overwrite_int32 (&iter, 42);
+
+   future = future_bulk_operation_execute (bulk, NULL, &error);
+
+   docs[0] = tmp_bson ("{'insert': 'collection'}");
+   docs[1] = tmp_bson ("{'_id': 1, 'a': 42}");
+   docs[2] = tmp_bson ("{'_id': {'$exists': true}, 'b': 2}");
+   request = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (request, 0, docs, 3));
+
+   /* the generated "_id" is the document's first field, as when copying */
+   BSON_ASSERT (bson_iter_init (&iter, request_get_doc (request, 2)));
+   BSON_ASSERT (bson_iter_next (&iter));
+   ASSERT_CMPSTR (bson_iter_key (&iter), "_id");
+   BSON_ASSERT (BSON_ITER_HOLDS_OID (&iter));
+   mock_server_replies_ok_and_destroys (request);
+
+   docs[1] = tmp_bson ("{'_id': 3}");
+   request = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (request, 0, docs, 2));
+   mock_server_replies_ok_and_destroys (request);
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_CMPINT (n_documents, ==, 3);
+
+   future_destroy (future);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_apm_callbacks_destroy (callbacks);
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_pipelined_unordered (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   const bson_t *docs[3];
+   request_t *first;
+   request_t *second;
+   request_t *third;
+   bson_error_t error;
+   future_t *future;
+   bson_t reply;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d,"
+                              " 'maxWriteBatchSize': 2}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXWRITEBATCHESINFLIGHT, 2);
+   client = mongoc_client_new_from_uri (uri);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      collection, tmp_bson ("{'ordered': false}"));
+
+   for (i = 0; i < 5; i++) {
+      mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': %d}", i));
+   }
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* the second batch is sent before the first is answered */
+   docs[0] = tmp_bson ("{'insert': 'collection', 'ordered': false}");
+   docs[1] = tmp_bson ("{'_id': 0}");
+   docs[2] = tmp_bson ("{'_id': 1}");
+   first = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (first, 0, docs, 3));
+
+   docs[1] = tmp_bson ("{'_id': 2}");
+   docs[2] = tmp_bson ("{'_id': 3}");
+   second = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (second, 0, docs, 3));
+
+   /* replies may come in any order */
+   mock_server_replies_simple (
+      second,
+      "{'ok': 1, 'n': 1,"
+      " 'writeErrors': [{'index': 1, 'code': 11000, 'errmsg': 'dupe'}]}");
+   mock_server_replies_simple (first, "{'ok': 1, 'n': 2}");
+
+   docs[1] = tmp_bson ("{'_id': 4}");
+   third = mock_server_receives_request (server);
+   BSON_ASSERT (request_matches_msg (third, 0, docs, 2));
+   mock_server_replies_simple (third, "{'ok': 1, 'n': 1}");
+
+   ASSERT (!future_get_uint32_t (future));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND, 11000, "dupe");
+
+   /* the error's index is relative to the whole bulk operation */
+   ASSERT_MATCH (&reply,
+                 "{'nInserted': 4,"
+                 " 'writeErrors': [{'index': 3, 'code': 11000}]}");
+
+   bson_destroy (&reply);
+   request_destroy (first);
+   request_destroy (second);
+   request_destroy (third);
+   future_destroy (future);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+/* a reply too large for the connection's buffers, sent before the server
+ * reads the next batch, must not leave both sides blocked writing */
+static void
+test_bulk_pipelined_large_reply (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   request_t *requests[3];
+   bson_t large_doc = BSON_INITIALIZER;
+   bson_t large_reply = BSON_INITIALIZER;
+   bson_t write_errors;
+   bson_t write_error;
+   bson_error_t error;
+   future_t *future;
+   bson_t reply;
+   char *large_string;
+   size_t large_len = 8 * 1024 * 1024;
+   int i;
+
+   large_string = bson_malloc (large_len + 1);
+   memset (large_string, 'a', large_len);
+   large_string[large_len] = '\0';
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d,"
+                              " 'maxWriteBatchSize': 1}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXWRITEBATCHESINFLIGHT, 3);
+   client = mongoc_client_new_from_uri (uri);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      collection, tmp_bson ("{'ordered': false}"));
+
+   for (i = 0; i < 3; i++) {
+      bson_reinit (&large_doc);
+      BSON_APPEND_INT32 (&large_doc, "_id", i);
+      BSON_APPEND_UTF8 (&large_doc, "s", large_string);
+      mongoc_bulk_operation_insert (bulk, &large_doc);
+   }
+
+   BSON_APPEND_INT32 (&large_reply, "ok", 1);
+   BSON_APPEND_INT32 (&large_reply, "n", 0);
+   BSON_APPEND_ARRAY_BEGIN (&large_reply, "writeErrors", &write_errors);
+   BSON_APPEND_DOCUMENT_BEGIN (&write_errors, "0", &write_error);
+   BSON_APPEND_INT32 (&write_error, "index", 0);
+   BSON_APPEND_INT32 (&write_error, "code", 11000);
+   BSON_APPEND_UTF8 (&write_error, "errmsg", large_string);
+   bson_append_document_end (&write_errors, &write_error);
+   bson_append_array_end (&large_reply, &write_errors);
+
+   future = future_bulk_operation_execute (bulk, &reply, &error);
+
+   /* the server replies to each batch before it reads the next */
+   requests[0] = mock_server_receives_request (server);
+   mock_server_reply_multi (
+      requests[0], MONGOC_REPLY_NONE, &large_reply, 1, 0);
+
+   for (i = 1; i < 3; i++) {
+      requests[i] = mock_server_receives_request (server);
+      ASSERT (requests[i]);
+      mock_server_replies_simple (requests[i], "{'ok': 1, 'n': 1}");
+   }
+
+   ASSERT (!future_get_uint32_t (future));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND, 11000, "aaa");
+   ASSERT_MATCH (&reply,
+                 "{'nInserted': 2,"
+                 " 'writeErrors': [{'index': 0, 'code': 11000}]}");
+
+   bson_destroy (&reply);
+   for (i = 0; i < 3; i++) {
+      request_destroy (requests[i]);
+   }
+
+   future_destroy (future);
+   bson_destroy (&large_reply);
+   bson_destroy (&large_doc);
+   bson_free (large_string);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_bulk_execute_parallel (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   request_t *requests[2];
+   request_t *tmp;
+   bson_error_t error;
+   future_t *future;
+   bson_t reply;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      collection, tmp_bson ("{'ordered': false}"));
+
+   for (i = 0; i < 4; i++) {
+      mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': %d}", i));
+   }
+
+   future =
+      future_bulk_operation_execute_parallel (bulk, pool, 2, &reply, &error);
+
+   /* each half of the inserts is sent on its own connection at once */
+   requests[0] = mock_server_receives_request (server);
+   requests[1] = mock_server_receives_request (server);
+   if (bson_lookup_int32 (request_get_doc (requests[0], 1), "_id") != 0) {
+      tmp = requests[0];
+      requests[0] = requests[1];
+      requests[1] = tmp;
+   }
+
+   ASSERT_CMPINT (request_get_client_port (requests[0]),
+                  !=,
+                  request_get_client_port (requests[1]));
+   ASSERT_MATCH (request_get_doc (requests[0], 2), "{'_id': 1}");
+   ASSERT_MATCH (request_get_doc (requests[1], 1), "{'_id': 2}");
+   ASSERT_MATCH (request_get_doc (requests[1], 2), "{'_id': 3}");
+
+   mock_server_replies_simple (
+      requests[1],
+      "{'ok': 1, 'n': 1,"
+      " 'writeErrors': [{'index': 1, 'code': 11000, 'errmsg': 'dupe'}]}");
+   mock_server_replies_simple (requests[0], "{'ok': 1, 'n': 2}");
+
+   ASSERT (!future_get_uint32_t (future));
+   ASSERT_ERROR_CONTAINS (error, MONGOC_ERROR_COMMAND, 11000, "dupe");
+
+   /* the error's index is relative to the whole bulk operation */
+   ASSERT_MATCH (&reply,
+                 "{'nInserted': 3,"
+                 " 'writeErrors': [{'index': 3, 'code': 11000}]}");
+
+   bson_destroy (&reply);
+   request_destroy (requests[0]);
+   request_destroy (requests[1]);
+   future_destroy (future);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+/* "as many as possible" is capped by the pool and the operations */
+static void
+test_bulk_execute_parallel_unbounded (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   request_t *requests[2];
+   bson_error_t error;
+   future_t *future;
+   bson_t reply;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d}",
+                              WIRE_VERSION_OP_MSG);
+
+   mock_server_run (server);
+
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      collection, tmp_bson ("{'ordered': false}"));
+
+   mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': 0}"));
+   mongoc_bulk_operation_insert (bulk, tmp_bson ("{'_id': 1}"));
+
+   future = future_bulk_operation_execute_parallel (
+      bulk, pool, UINT32_MAX, &reply, &error);
+
+   /* one insert per thread, and no more threads than inserts */
+   requests[0] = mock_server_receives_request (server);
+   requests[1] = mock_server_receives_request (server);
+   ASSERT_CMPINT (request_get_client_port (requests[0]),
+                  !=,
+                  request_get_client_port (requests[1]));
+   mock_server_replies_simple (requests[0], "{'ok': 1, 'n': 1}");
+   mock_server_replies_simple (requests[1], "{'ok': 1, 'n': 1}");
+
+   ASSERT_OR_PRINT (future_get_uint32_t (future), error);
+   ASSERT_MATCH (&reply, "{'nInserted': 2}");
+
+   bson_destroy (&reply);
+   request_destroy (requests[0]);
+   request_destroy (requests[1]);
+   future_destroy (future);
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
 static void
 test_bulk_split (void)
 {
@@ -4789,6 +5208,20 @@ test_bulk_install (TestSuite *suite)
                       NULL,
                       NULL,
                       test_framework_skip_if_slow_or_live);
+   TestSuite_AddMockServerTest (
+      suite, "/BulkOperation/zero_copy", test_bulk_zero_copy);
+   TestSuite_AddMockServerTest (suite,
+                                "/BulkOperation/pipelined_unordered",
+                                test_bulk_pipelined_unordered);
+   TestSuite_AddMockServerTest (suite,
+                                "/BulkOperation/pipelined_large_reply",
+                                test_bulk_pipelined_large_reply);
+   TestSuite_AddMockServerTest (suite,
+                                "/BulkOperation/execute_parallel",
+                                test_bulk_execute_parallel);
+   TestSuite_AddMockServerTest (suite,
+                                "/BulkOperation/execute_parallel/unbounded",
+                                test_bulk_execute_parallel_unbounded);
    TestSuite_AddLive (suite,
                       "/BulkOperation/CDRIVER-372_ordered",
                       test_bulk_edge_case_372_ordered);
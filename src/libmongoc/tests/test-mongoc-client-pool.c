@@ -1,10 +1,14 @@
 #include <mongoc.h>
 #include "mongoc-client-pool-private.h"
+#include "mongoc-client-private.h"
+#include "mongoc-set-private.h"
+#include "mongoc-thread-private.h"
 #include "mongoc-util-private.h"
 
 
 #include "TestSuite.h"
 #include "test-libmongoc.h"
+#include "mock_server/mock-server.h"
 
 
 static void
@@ -135,6 +139,65 @@ test_mongoc_client_pool_min_size_dispose (void)
    mongoc_uri_destroy (uri);
 }
 
+typedef struct {
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+} push_ctx_t;
+
+
+static void *
+push_thread (void *data)
+{
+   push_ctx_t *ctx = (push_ctx_t *) data;
+
+   mongoc_client_pool_push (ctx->pool, ctx->client);
+
+   return NULL;
+}
+
+
+/* with minPoolSize, the oldest idle client is disposed of, even if another
+ * thread pushed it */
+static void
+test_mongoc_client_pool_min_size_dispose_oldest (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_uri_t *uri;
+   mongoc_client_t *c0, *c1, *c2;
+   push_ctx_t ctx;
+   bson_thread_t thread;
+
+   capture_logs (true);
+   uri = mongoc_uri_new ("mongodb://127.0.0.1/?minpoolsize=2");
+   pool = mongoc_client_pool_new (uri);
+
+   c0 = mongoc_client_pool_pop (pool);
+   c1 = mongoc_client_pool_pop (pool);
+   c2 = mongoc_client_pool_pop (pool);
+
+   ctx.pool = pool;
+   ctx.client = c0;
+   bson_thread_create (&thread, push_thread, &ctx);
+   bson_thread_join (thread);
+
+   mongoc_client_pool_push (pool, c1);
+   mongoc_client_pool_push (pool, c2);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_num_pushed (pool), ==, (size_t) 2);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), ==, (size_t) 2);
+
+   client = mongoc_client_pool_pop (pool);
+   BSON_ASSERT (client == c2);
+   client = mongoc_client_pool_pop (pool);
+   BSON_ASSERT (client == c1);
+
+   mongoc_client_pool_push (pool, c1);
+   mongoc_client_pool_push (pool, c2);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
+
 static void
 test_mongoc_client_pool_set_max_size (void)
 {
@@ -282,6 +345,309 @@ test_mongoc_client_pool_handshake (void)
    mongoc_client_pool_destroy (pool);
 }
 
+#define POOL_STRESS_THREADS 16
+#define POOL_STRESS_ITERATIONS 2000
+
+typedef struct {
+   mongoc_client_pool_t *pool;
+   bool reused;
+} pool_stress_ctx_t;
+
+
+static void *
+pool_stress_thread (void *data)
+{
+   pool_stress_ctx_t *ctx = (pool_stress_ctx_t *) data;
+   mongoc_client_t *client;
+   mongoc_client_t *prev = NULL;
+   int i;
+
+   for (i = 0; i < POOL_STRESS_ITERATIONS; i++) {
+      client = (i % 2) ? mongoc_client_pool_pop (ctx->pool)
+                       : mongoc_client_pool_try_pop (ctx->pool);
+      if (!client) {
+         continue;
+      }
+
+      if (client == prev) {
+         ctx->reused = true;
+      }
+
+      mongoc_client_pool_push (ctx->pool, client);
+      prev = client;
+   }
+
+   return NULL;
+}
+
+
+/* many threads checking clients in and out never exceed maxPoolSize, and
+ * every client ends up back in the pool */
+static void
+test_mongoc_client_pool_stress (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_uri_t *uri;
+   bson_thread_t threads[POOL_STRESS_THREADS];
+   pool_stress_ctx_t ctx[POOL_STRESS_THREADS];
+   bool reused = false;
+   int i;
+
+   uri = mongoc_uri_new ("mongodb://localhost/?maxPoolSize=4");
+   pool = mongoc_client_pool_new (uri);
+
+   for (i = 0; i < POOL_STRESS_THREADS; i++) {
+      ctx[i].pool = pool;
+      ctx[i].reused = false;
+      bson_thread_create (&threads[i], pool_stress_thread, &ctx[i]);
+   }
+
+   for (i = 0; i < POOL_STRESS_THREADS; i++) {
+      bson_thread_join (threads[i]);
+      reused = reused || ctx[i].reused;
+   }
+
+   /* threads tend to get their own client back */
+   BSON_ASSERT (reused);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), <=, (size_t) 4);
+   ASSERT_CMPSIZE_T (mongoc_client_pool_num_pushed (pool),
+                     ==,
+                     mongoc_client_pool_get_size (pool));
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
+
+static void
+test_mongoc_client_pool_wait_queue_timeout (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_uri_t *uri;
+   int64_t start;
+
+   uri = mongoc_uri_new (
+      "mongodb://localhost/?maxPoolSize=1&waitQueueTimeoutMS=100");
+   pool = mongoc_client_pool_new (uri);
+
+   client = mongoc_client_pool_pop (pool);
+   BSON_ASSERT (client);
+
+   start = bson_get_monotonic_time ();
+   BSON_ASSERT (!mongoc_client_pool_pop (pool));
+   ASSERT_CMPINT64 (bson_get_monotonic_time () - start, >=, (int64_t) 90000);
+   ASSERT_CMPSIZE_T (_mongoc_client_pool_num_waiters (pool), ==, (size_t) 0);
+
+   mongoc_client_pool_push (pool, client);
+   BSON_ASSERT (client == mongoc_client_pool_pop (pool));
+   mongoc_client_pool_push (pool, client);
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
+
+typedef struct {
+   mongoc_client_pool_t *pool;
+   volatile int32_t *served;
+   int32_t order;
+} pool_waiter_ctx_t;
+
+
+static void *
+pool_waiter_thread (void *data)
+{
+   pool_waiter_ctx_t *ctx = (pool_waiter_ctx_t *) data;
+   mongoc_client_t *client;
+
+   client = mongoc_client_pool_pop (ctx->pool);
+   ctx->order = bson_atomic_int_add (ctx->served, 1);
+   mongoc_client_pool_push (ctx->pool, client);
+
+   return NULL;
+}
+
+
+static void
+_wait_for_waiters (mongoc_client_pool_t *pool, size_t n)
+{
+   int64_t start = bson_get_monotonic_time ();
+
+   while (_mongoc_client_pool_num_waiters (pool) < n) {
+      ASSERT_CMPINT64 (
+         bson_get_monotonic_time () - start, <, (int64_t) 10 * 1000 * 1000);
+      _mongoc_usleep (1000);
+   }
+}
+
+
+/* threads waiting for a client are served in the order they arrived */
+static void
+test_mongoc_client_pool_fifo (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_uri_t *uri;
+   bson_thread_t threads[3];
+   pool_waiter_ctx_t ctx[3];
+   volatile int32_t served = 0;
+   int i;
+
+   uri = mongoc_uri_new ("mongodb://localhost/?maxPoolSize=1");
+   pool = mongoc_client_pool_new (uri);
+   client = mongoc_client_pool_pop (pool);
+
+   for (i = 0; i < 3; i++) {
+      ctx[i].pool = pool;
+      ctx[i].served = &served;
+      ctx[i].order = 0;
+      bson_thread_create (&threads[i], pool_waiter_thread, &ctx[i]);
+      _wait_for_waiters (pool, (size_t) i + 1);
+   }
+
+   mongoc_client_pool_push (pool, client);
+
+   for (i = 0; i < 3; i++) {
+      bson_thread_join (threads[i]);
+      ASSERT_CMPINT (ctx[i].order, ==, i + 1);
+   }
+
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), ==, (size_t) 1);
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
+
+#define POOL_TRY_POP_ITERATIONS 2000
+
+typedef struct {
+   mongoc_client_pool_t *pool;
+   volatile int32_t done;
+} pool_try_pop_ctx_t;
+
+
+static void *
+pool_try_pop_thread (void *data)
+{
+   pool_try_pop_ctx_t *ctx = (pool_try_pop_ctx_t *) data;
+   mongoc_client_t *client;
+   int i;
+
+   for (i = 0; i < POOL_TRY_POP_ITERATIONS; i++) {
+      client = mongoc_client_pool_try_pop (ctx->pool);
+      if (client) {
+         mongoc_client_pool_push (ctx->pool, client);
+      }
+   }
+
+   return NULL;
+}
+
+
+static void *
+pool_pop_thread (void *data)
+{
+   pool_try_pop_ctx_t *ctx = (pool_try_pop_ctx_t *) data;
+   int i;
+
+   for (i = 0; i < POOL_TRY_POP_ITERATIONS; i++) {
+      mongoc_client_pool_push (ctx->pool, mongoc_client_pool_pop (ctx->pool));
+   }
+
+   bson_atomic_int_add (&ctx->done, 1);
+
+   return NULL;
+}
+
+
+/* a try_pop that finds the pool full must not leave a waiter asleep once
+ * it gives its slot back, even with no push to come */
+static void
+test_mongoc_client_pool_try_pop_waiter (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_uri_t *uri;
+   bson_thread_t threads[3];
+   pool_try_pop_ctx_t ctx;
+   int64_t start;
+   int i;
+
+   /* a push that leaves two idle clients destroys one, so slots free up
+    * without an idle client to hand over */
+   uri = mongoc_uri_new ("mongodb://localhost/?maxPoolSize=2&minPoolSize=1");
+   pool = mongoc_client_pool_new (uri);
+
+   ctx.pool = pool;
+   ctx.done = 0;
+   bson_thread_create (&threads[0], pool_pop_thread, &ctx);
+   bson_thread_create (&threads[1], pool_pop_thread, &ctx);
+   bson_thread_create (&threads[2], pool_try_pop_thread, &ctx);
+   bson_thread_join (threads[2]);
+
+   /* waitQueueTimeoutMS is 0, so a stranded waiter would never return */
+   start = bson_get_monotonic_time ();
+   while (ctx.done < 2) {
+      ASSERT_CMPINT64 (
+         bson_get_monotonic_time () - start, <, (int64_t) 10 * 1000 * 1000);
+      _mongoc_usleep (1000);
+   }
+
+   for (i = 0; i < 2; i++) {
+      bson_thread_join (threads[i]);
+   }
+
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), <=, (size_t) 2);
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
+
+
+/* with warmPoolSize, the pool creates idle clients connected ahead of use,
+ * without touching the clients already in use or idle */
+static void
+test_mongoc_client_pool_warm (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *clients[3];
+   mongoc_uri_t *uri;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_WARMPOOLSIZE, 2);
+   pool = mongoc_client_pool_new (uri);
+
+   /* starts the background thread, the client has not connected yet */
+   clients[0] = mongoc_client_pool_pop (pool);
+   ASSERT (!mongoc_set_get (clients[0]->cluster.nodes, 1));
+
+   WAIT_UNTIL (mongoc_client_pool_get_size (pool) == 3 &&
+               mongoc_client_pool_num_pushed (pool) == 2);
+
+   ASSERT (!mongoc_set_get (clients[0]->cluster.nodes, 1));
+
+   for (i = 1; i < 3; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      ASSERT (mongoc_set_get (clients[i]->cluster.nodes, 1));
+   }
+
+   ASSERT_CMPSIZE_T (mongoc_client_pool_get_size (pool), ==, (size_t) 3);
+
+   for (i = 0; i < 3; i++) {
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
 void
 test_client_pool_install (TestSuite *suite)
 {
@@ -294,6 +660,9 @@ test_client_pool_install (TestSuite *suite)
    TestSuite_Add (suite,
                   "/ClientPool/min_size_dispose",
                   test_mongoc_client_pool_min_size_dispose);
+   TestSuite_Add (suite,
+                  "/ClientPool/min_size_dispose/oldest",
+                  test_mongoc_client_pool_min_size_dispose_oldest);
    TestSuite_Add (
       suite, "/ClientPool/set_max_size", test_mongoc_client_pool_set_max_size);
    TestSuite_Add (
@@ -301,6 +670,16 @@ test_client_pool_install (TestSuite *suite)
 
    TestSuite_Add (
       suite, "/ClientPool/handshake", test_mongoc_client_pool_handshake);
+   TestSuite_Add (suite, "/ClientPool/stress", test_mongoc_client_pool_stress);
+   TestSuite_Add (suite,
+                  "/ClientPool/wait_queue_timeout",
+                  test_mongoc_client_pool_wait_queue_timeout);
+   TestSuite_Add (suite, "/ClientPool/fifo", test_mongoc_client_pool_fifo);
+   TestSuite_Add (suite,
+                  "/ClientPool/try_pop_waiter",
+                  test_mongoc_client_pool_try_pop_waiter);
+   TestSuite_AddMockServerTest (
+      suite, "/ClientPool/warm", test_mongoc_client_pool_warm);
 
 #ifndef MONGOC_ENABLE_SSL
    TestSuite_Add (
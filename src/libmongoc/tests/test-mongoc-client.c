@@ -7,6 +7,7 @@
 #include "mongoc-handshake-private.h"
 #include "mongoc-host-list-private.h"
 #include "mongoc-read-concern-private.h"
+#include "mongoc-stream-private.h"
 #include "mongoc-util-private.h"
 #include "mongoc-write-concern-private.h"
 
@@ -530,7 +531,14 @@ test_mongoc_client_authenticate_cached (bool pooled)
    }
 
    /* screw up the cache */
-   memcpy (client->cluster.scram_cache->client_key, "foo", 3);
+   ASSERT_CMPSIZE_T (
+      client->topology->scram_cache->entries.len, ==, (size_t) 1);
+   memcpy (_mongoc_array_index (&client->topology->scram_cache->entries,
+                                mongoc_scram_cache_entry_t,
+                                0)
+              .client_key,
+           "foo",
+           3);
    cursor = mongoc_collection_find_with_opts (collection, &insert, NULL, NULL);
    capture_logs (true);
    r = mongoc_cursor_next (cursor, &doc);
@@ -3428,6 +3436,162 @@ test_get_database (void)
 }
 
 
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+/* a compressible 300-byte command is sent uncompressed with the default
+ * compressionMinSize of 512, and compressed with compressionMinSize=0 */
+static void
+_test_compression_min_size (bool min_size_zero)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   char filler[301];
+   bson_t cmd = BSON_INITIALIZER;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1, 'ismaster': true,"
+                              " 'maxWireVersion': %d,"
+                              " 'compression': ['zlib']}",
+                              WIRE_VERSION_OP_MSG);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_utf8 (uri, MONGOC_URI_COMPRESSORS, "zlib");
+   if (min_size_zero) {
+      mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_COMPRESSIONMINSIZE, 0);
+   }
+
+   client = mongoc_client_new_from_uri (uri);
+
+   memset (filler, 'a', sizeof filler - 1);
+   filler[sizeof filler - 1] = '\0';
+   BSON_APPEND_INT32 (&cmd, "ping", 1);
+   BSON_APPEND_UTF8 (&cmd, "filler", filler);
+
+   future =
+      future_client_command_simple (client, "db", &cmd, NULL, NULL, &error);
+   request = mock_server_receives_request (server);
+
+   if (min_size_zero) {
+      /* the mock server can't decompress it */
+      ASSERT_CMPINT ((int) request->opcode, ==, MONGOC_OPCODE_COMPRESSED);
+      mock_server_hangs_up (request);
+      BSON_ASSERT (!future_get_bool (future));
+      request_destroy (request);
+   } else {
+      ASSERT_CMPINT ((int) request->opcode, ==, MONGOC_OPCODE_MSG);
+      mock_server_replies_ok_and_destroys (request);
+      ASSERT_OR_PRINT (future_get_bool (future), error);
+   }
+
+   future_destroy (future);
+   bson_destroy (&cmd);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_compression_min_size_default (void)
+{
+   _test_compression_min_size (false);
+}
+
+
+static void
+test_compression_min_size_zero (void)
+{
+   _test_compression_min_size (true);
+}
+#endif
+
+
+static void
+test_io_uring_stream_initiator (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_host_list_t host;
+   mongoc_stream_t *stream;
+   mongoc_stream_t *root;
+   char *big;
+   char *reply_json;
+   bson_t reply;
+   bson_error_t error;
+   future_t *future;
+   request_t *request;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MIN);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, "socketTimeoutMS", 500);
+   client = mongoc_client_new_from_uri (uri);
+   mongoc_client_set_stream_initiator (
+      client, mongoc_client_io_uring_stream_initiator, client);
+
+   /* falls back to a socket stream if the kernel lacks io_uring */
+   BSON_ASSERT (_mongoc_host_list_from_string (
+      &host, mock_server_get_host_and_port (server)));
+   stream =
+      mongoc_client_io_uring_stream_initiator (uri, &host, client, &error);
+   ASSERT_OR_PRINT (stream, error);
+   root = mongoc_stream_get_root_stream (stream);
+#ifdef MONGOC_ENABLE_IO_URING
+   if (root->type == MONGOC_STREAM_IO_URING) {
+      /* not wrapped in a buffered stream */
+      BSON_ASSERT (root == stream);
+   } else {
+      ASSERT_CMPINT (root->type, ==, MONGOC_STREAM_SOCKET);
+   }
+#else
+   ASSERT_CMPINT (root->type, ==, MONGOC_STREAM_SOCKET);
+#endif
+   mongoc_stream_destroy (stream);
+
+   /* a reply larger than the read-ahead buffer */
+   big = bson_malloc (100 * 1024 + 1);
+   memset (big, 'a', 100 * 1024);
+   big[100 * 1024] = '\0';
+   reply_json = bson_strdup_printf ("{'ok': 1, 'big': '%s'}", big);
+
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, &reply, &error);
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   mock_server_replies_simple (request, reply_json);
+   ASSERT_OR_PRINT (future_get_bool (future), error);
+   ASSERT_CMPSTR (bson_lookup_utf8 (&reply, "big"), big);
+   bson_destroy (&reply);
+   future_destroy (future);
+   request_destroy (request);
+
+   /* don't reply, the read times out */
+   future = future_client_command_simple (
+      client, "admin", tmp_bson ("{'ping': 1}"), NULL, &reply, &error);
+   request = mock_server_receives_command (
+      server, "admin", MONGOC_QUERY_SLAVE_OK, "{'ping': 1}");
+   BSON_ASSERT (!future_get_bool (future));
+   ASSERT_ERROR_CONTAINS (error,
+                          MONGOC_ERROR_STREAM,
+                          MONGOC_ERROR_STREAM_SOCKET,
+                          "socket error or timeout");
+   bson_destroy (&reply);
+   future_destroy (future);
+   request_destroy (request);
+
+   bson_free (reply_json);
+   bson_free (big);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
 void
 test_client_install (TestSuite *suite)
 {
@@ -3680,4 +3844,14 @@ test_client_install (TestSuite *suite)
                       NULL,
                       test_framework_skip_if_slow);
    TestSuite_Add (suite, "/Client/get_database", test_get_database);
+   TestSuite_AddMockServerTest (
+      suite, "/Client/io_uring_stream", test_io_uring_stream_initiator);
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   TestSuite_AddMockServerTest (suite,
+                                "/Client/compression_min_size/default",
+                                test_compression_min_size_default);
+   TestSuite_AddMockServerTest (suite,
+                                "/Client/compression_min_size/zero",
+                                test_compression_min_size_zero);
+#endif
 }
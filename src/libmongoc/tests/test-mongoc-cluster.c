@@ -1553,6 +1553,231 @@ test_advanced_cluster_time_not_sent_to_standalone (void)
    mock_server_destroy (server);
 }
 
+static void
+_test_cluster_pipeline (bool pooled)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool = NULL;
+   mongoc_client_t *client;
+   mongoc_server_stream_t *server_stream;
+   mongoc_cluster_pipeline_t pipeline;
+   mongoc_cmd_parts_t parts[3];
+   uint32_t request_ids[3];
+   request_t *requests[3];
+   bson_t reply;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_OP_MSG);
+   mock_server_run (server);
+   if (pooled) {
+      pool = mongoc_client_pool_new (mock_server_get_uri (server));
+      client = mongoc_client_pool_pop (pool);
+   } else {
+      client = mongoc_client_new_from_uri (mock_server_get_uri (server));
+   }
+
+   server_stream =
+      mongoc_cluster_stream_for_writes (&client->cluster, NULL, NULL, &error);
+   ASSERT_OR_PRINT (server_stream, error);
+   mongoc_cluster_pipeline_init (&pipeline, &client->cluster, server_stream);
+
+   /* all three requests are in flight before the server replies */
+   for (i = 0; i < 3; i++) {
+      mongoc_cmd_parts_init (&parts[i],
+                             client,
+                             "db",
+                             MONGOC_QUERY_NONE,
+                             tmp_bson ("{'ping': %d}", i));
+      ASSERT_OR_PRINT (
+         mongoc_cmd_parts_assemble (&parts[i], server_stream, &error), error);
+      ASSERT_OR_PRINT (mongoc_cluster_pipeline_send (&pipeline,
+                                                     &parts[i].assembled,
+                                                     &request_ids[i],
+                                                     &error),
+                       error);
+   }
+
+   for (i = 0; i < 3; i++) {
+      requests[i] =
+         mock_server_receives_msg (server, 0, tmp_bson ("{'ping': %d}", i));
+   }
+
+   /* reply out of order, the client matches replies by responseTo */
+   mock_server_replies_simple (requests[2], "{'ok': 1, 'n': 2}");
+   mock_server_replies_simple (requests[0], "{'ok': 1, 'n': 0}");
+   mock_server_replies_simple (requests[1], "{'ok': 0, 'code': 1}");
+
+   ASSERT_OR_PRINT (mongoc_cluster_pipeline_recv (&pipeline,
+                                                  &parts[0].assembled,
+                                                  request_ids[0],
+                                                  &reply,
+                                                  &error),
+                    error);
+   ASSERT_MATCH (&reply, "{'n': 0}");
+   bson_destroy (&reply);
+
+   /* a command error doesn't fail the pipeline */
+   BSON_ASSERT (!mongoc_cluster_pipeline_recv (&pipeline,
+                                               &parts[1].assembled,
+                                               request_ids[1],
+                                               &reply,
+                                               &error));
+   ASSERT_CMPINT (error.domain, ==, MONGOC_ERROR_QUERY);
+   bson_destroy (&reply);
+
+   ASSERT_OR_PRINT (mongoc_cluster_pipeline_recv (&pipeline,
+                                                  &parts[2].assembled,
+                                                  request_ids[2],
+                                                  &reply,
+                                                  &error),
+                    error);
+   ASSERT_MATCH (&reply, "{'n': 2}");
+   bson_destroy (&reply);
+
+   mongoc_cluster_pipeline_destroy (&pipeline);
+
+   for (i = 0; i < 3; i++) {
+      mongoc_cmd_parts_cleanup (&parts[i]);
+      request_destroy (requests[i]);
+   }
+
+   mongoc_server_stream_cleanup (server_stream);
+
+   if (pooled) {
+      mongoc_client_pool_push (pool, client);
+      mongoc_client_pool_destroy (pool);
+   } else {
+      mongoc_client_destroy (client);
+   }
+
+   mock_server_destroy (server);
+}
+
+
+static void
+test_cluster_pipeline_single (void)
+{
+   _test_cluster_pipeline (false);
+}
+
+
+static void
+test_cluster_pipeline_pooled (void)
+{
+   _test_cluster_pipeline (true);
+}
+
+
+static mongoc_stream_t *
+_node_stream (mongoc_client_t *client)
+{
+   mongoc_cluster_node_t *node;
+
+   node = (mongoc_cluster_node_t *) mongoc_set_get (client->cluster.nodes, 1);
+
+   return node ? node->stream : NULL;
+}
+
+
+static void
+_connect_to_server (mongoc_client_t *client)
+{
+   mongoc_server_stream_t *server_stream;
+   bson_error_t error;
+
+   /* the background thread's first connection starts generation 1, which
+    * would make connections opened before it stale */
+   WAIT_UNTIL (mongoc_topology_server_generation (client->topology, 1) > 0);
+
+   server_stream = mongoc_cluster_stream_for_server (
+      &client->cluster, 1, true, NULL, NULL, &error);
+   ASSERT_OR_PRINT (server_stream, error);
+   mongoc_server_stream_cleanup (server_stream);
+}
+
+
+/* invalidating a server starts a new connection generation, and every pooled
+ * client drops its older connection to the server before using it again */
+static void
+test_cluster_generation (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *clients[2];
+   mongoc_stream_t *stream;
+   bson_error_t error;
+   int i;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+
+   for (i = 0; i < 2; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      _connect_to_server (clients[i]);
+      BSON_ASSERT (_node_stream (clients[i]));
+   }
+
+   /* nothing changed, the connection is reused */
+   stream = _node_stream (clients[1]);
+   _connect_to_server (clients[1]);
+   BSON_ASSERT (_node_stream (clients[1]) == stream);
+
+   bson_set_error (
+      &error, MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET, "error");
+   mongoc_cluster_disconnect_node (&clients[0]->cluster, 1, true, &error);
+   BSON_ASSERT (!_node_stream (clients[0]));
+
+   /* the other client's connection is dropped the next time it is checked */
+   BSON_ASSERT (_node_stream (clients[1]) == stream);
+   _mongoc_cluster_prune_nodes (&clients[1]->cluster);
+   BSON_ASSERT (!_node_stream (clients[1]));
+
+   /* both reconnect in the new generation */
+   for (i = 0; i < 2; i++) {
+      _connect_to_server (clients[i]);
+      stream = _node_stream (clients[i]);
+      _mongoc_cluster_prune_nodes (&clients[i]->cluster);
+      BSON_ASSERT (_node_stream (clients[i]) == stream);
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+/* pooled connections idle longer than maxIdleTimeMS are closed */
+static void
+test_cluster_max_idle_time (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MAX);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXIDLETIMEMS, 100);
+   pool = mongoc_client_pool_new (uri);
+   client = mongoc_client_pool_pop (pool);
+
+   _connect_to_server (client);
+   _mongoc_cluster_prune_nodes (&client->cluster);
+   BSON_ASSERT (_node_stream (client));
+
+   _mongoc_usleep (200 * 1000);
+   _mongoc_cluster_prune_nodes (&client->cluster);
+   BSON_ASSERT (!_node_stream (client));
+
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
 void
 test_cluster_install (TestSuite *suite)
 {
@@ -1688,4 +1913,12 @@ test_cluster_install (TestSuite *suite)
    TestSuite_AddMockServerTest (suite,
                                 "/Cluster/command_error/op_query",
                                 test_cluster_command_error_op_query);
+   TestSuite_AddMockServerTest (
+      suite, "/Cluster/pipeline/single", test_cluster_pipeline_single);
+   TestSuite_AddMockServerTest (
+      suite, "/Cluster/pipeline/pooled", test_cluster_pipeline_pooled);
+   TestSuite_AddMockServerTest (
+      suite, "/Cluster/generation", test_cluster_generation);
+   TestSuite_AddMockServerTest (
+      suite, "/Cluster/max_idle_time", test_cluster_max_idle_time);
 }
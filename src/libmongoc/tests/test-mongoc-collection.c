@@ -607,6 +607,98 @@ test_insert_oversize (void *ctx)
 }
 
 
+static void
+test_insert_one_coalesced (void)
+{
+   mock_server_t *server;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *clients[3];
+   mongoc_collection_t *collections[3];
+   future_t *futures[3];
+   bson_t replies[3];
+   bson_error_t errors[3];
+   request_t *request;
+   bson_iter_t iter;
+   int32_t dupe_index = -1;
+   char *reply_json;
+   int i;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1.0,"
+                              " 'ismaster': true,"
+                              " 'minWireVersion': 0,"
+                              " 'maxWireVersion': %d}",
+                              WIRE_VERSION_OP_MSG);
+   mock_server_run (server);
+
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_WRITECOALESCINGMS, 500);
+   pool = mongoc_client_pool_new (uri);
+
+   /* each thread inserts with its own client */
+   for (i = 0; i < 3; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      collections[i] =
+         mongoc_client_get_collection (clients[i], "db", "collection");
+      futures[i] = future_collection_insert_one (collections[i],
+                                                 tmp_bson ("{'_id': %d}", i),
+                                                 NULL,
+                                                 &replies[i],
+                                                 &errors[i]);
+   }
+
+   /* one "insert" command, with the documents in the order they joined */
+   request = mock_server_receives_request (server);
+   ASSERT_MATCH (request_get_doc (request, 0),
+                 "{'insert': 'collection', 'ordered': false}");
+   ASSERT_CMPSIZE_T (request->docs.len, ==, (size_t) 4);
+   for (i = 0; i < 3; i++) {
+      BSON_ASSERT (bson_iter_init_find (
+         &iter, request_get_doc (request, i + 1), "_id"));
+      if (bson_iter_int32 (&iter) == 1) {
+         dupe_index = i;
+      }
+   }
+
+   ASSERT_CMPINT (dupe_index, !=, -1);
+   reply_json = bson_strdup_printf ("{'ok': 1, 'n': 2, 'writeErrors': [{"
+                                    "'index': %d, 'code': 11000,"
+                                    " 'errmsg': 'dupe'}]}",
+                                    dupe_index);
+   mock_server_replies_simple (request, reply_json);
+   bson_free (reply_json);
+   request_destroy (request);
+
+   /* each caller gets the result for its own document */
+   for (i = 0; i < 3; i++) {
+      if (i == 1) {
+         BSON_ASSERT (!future_get_bool (futures[i]));
+         ASSERT_ERROR_CONTAINS (
+            errors[i], MONGOC_ERROR_COLLECTION, 11000, "dupe");
+         ASSERT_MATCH (&replies[i],
+                       "{'insertedCount': 0,"
+                       " 'writeErrors': [{'index': 0, 'code': 11000}]}");
+      } else {
+         ASSERT_OR_PRINT (future_get_bool (futures[i]), errors[i]);
+         ASSERT_MATCH (&replies[i],
+                       "{'insertedCount': 1,"
+                       " 'writeErrors': {'$exists': false}}");
+      }
+
+      future_destroy (futures[i]);
+      bson_destroy (&replies[i]);
+      mongoc_collection_destroy (collections[i]);
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_server_destroy (server);
+}
+
+
 static void
 test_insert_many (void)
 {
@@ -5916,6 +6008,8 @@ test_collection_install (TestSuite *suite)
                       NULL,
                       test_framework_skip_if_offline);
    TestSuite_AddLive (suite, "/Collection/insert_one", test_insert_one);
+   TestSuite_AddMockServerTest (
+      suite, "/Collection/insert_one/coalesced", test_insert_one_coalesced);
    TestSuite_AddLive (
       suite, "/Collection/update_and_replace", test_update_and_replace);
    TestSuite_AddLive (
@@ -16,6 +16,8 @@
 
 #include <mongoc-util-private.h>
 #include "mongoc-counters-private.h"
+#include "mongoc-compression-private.h"
+#include "mongoc-server-description-private.h"
 #include "mock_server/mock-server.h"
 #include "test-conveniences.h"
 #include "test-libmongoc.h"
@@ -77,6 +79,8 @@ _client_new_disable_ss (bool use_compression)
       char *compressors = test_framework_get_compressors ();
       mongoc_uri_set_option_as_utf8 (uri, MONGOC_URI_COMPRESSORS, compressors);
       bson_free (compressors);
+      /* compress every message, even a ping */
+      mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_COMPRESSIONMINSIZE, -1);
    }
    client = mongoc_client_new_from_uri (uri);
    test_framework_set_ssl_opts (client);
@@ -553,6 +557,83 @@ test_counters_streams_timeout ()
    mongoc_client_destroy (client);
    mock_server_destroy (server);
 }
+
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+static void
+test_counters_compression_skipped (void)
+{
+   mock_server_t *server;
+   bson_error_t err;
+   future_t *future;
+   mongoc_client_t *client;
+   request_t *request;
+   mongoc_uri_t *uri;
+   mongoc_server_description_t *sd;
+
+   server = mock_server_new ();
+   mock_server_auto_ismaster (server,
+                              "{'ok': 1, 'ismaster': true,"
+                              " 'maxWireVersion': %d,"
+                              " 'compression': ['zlib']}",
+                              WIRE_VERSION_OP_MSG);
+   mock_server_run (server);
+   uri = mongoc_uri_copy (mock_server_get_uri (server));
+   mongoc_uri_set_option_as_utf8 (uri, MONGOC_URI_COMPRESSORS, "zlib");
+   client = mongoc_client_new_from_uri (uri);
+   mongoc_uri_destroy (uri);
+   sd = mongoc_client_select_server (client, true, NULL, &err);
+   ASSERT_OR_PRINT (sd, err);
+   ASSERT_CMPINT (mongoc_server_description_compressor_id (sd),
+                  ==,
+                  MONGOC_COMPRESSOR_ZLIB_ID);
+   mongoc_server_description_destroy (sd);
+   reset_all_counters ();
+
+   /* the ping is below compressionMinSize, the mock server can read it */
+   future = future_client_command_simple (
+      client, "test", tmp_bson ("{'ping': 1}"), NULL, NULL, &err);
+   request = mock_server_receives_msg (
+      server, MONGOC_QUERY_NONE, tmp_bson ("{'ping': 1}"));
+   mock_server_replies_ok_and_destroys (request);
+   ASSERT_OR_PRINT (future_get_bool (future), err);
+   future_destroy (future);
+
+   DIFF_AND_RESET (compression_skipped, ==, 1);
+   DIFF_AND_RESET (compression_bytes_in, ==, 0);
+   DIFF_AND_RESET (op_egress_compressed, ==, 0);
+
+   mongoc_client_destroy (client);
+   mock_server_destroy (server);
+}
+#endif
+
+
+static void
+test_counters_client_pool_wait (void)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_uri_t *uri;
+
+   uri = mongoc_uri_new (
+      "mongodb://localhost/?maxPoolSize=1&waitQueueTimeoutMS=50");
+   pool = mongoc_client_pool_new (uri);
+   reset_all_counters ();
+
+   client = mongoc_client_pool_pop (pool);
+   DIFF_AND_RESET (client_pool_waits, ==, 0);
+
+   BSON_ASSERT (!mongoc_client_pool_pop (pool));
+   DIFF_AND_RESET (client_pool_waits, ==, 1);
+   DIFF_AND_RESET (client_pool_wait_timeouts, ==, 1);
+   DIFF_AND_RESET (client_pool_wait_msec, >=, 40);
+   DIFF_AND_RESET (client_pool_waiting, ==, 0);
+
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+}
 #endif
 
 void
@@ -612,5 +693,12 @@ test_counters_install (TestSuite *suite)
    TestSuite_AddLive (suite, "/counters/dns", test_counters_dns);
    TestSuite_AddMockServerTest (
       suite, "/counters/streams_timeout", test_counters_streams_timeout);
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+   TestSuite_AddMockServerTest (suite,
+                                "/counters/compression_skipped",
+                                test_counters_compression_skipped);
+#endif
+   TestSuite_Add (
+      suite, "/counters/client_pool_wait", test_counters_client_pool_wait);
 #endif
 }
\ No newline at end of file
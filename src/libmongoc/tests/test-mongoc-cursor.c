@@ -6,6 +6,7 @@
 #include "mock_server/mock-rs.h"
 #include "mock_server/future-functions.h"
 #include "mongoc-cursor-private.h"
+#include "mongoc-server-description-private.h"
 #include "mongoc-collection-private.h"
 #include "mongoc-read-concern-private.h"
 #include "mongoc-write-concern-private.h"
@@ -2301,6 +2302,283 @@ test_find_error_is_alive (void)
 }
 
 
+/* a client with hedgedReads, in a replica set of a primary and two
+ * secondaries, that has seen every server answer in 1ms and has an idle
+ * connection to each for hedged reads */
+static mongoc_client_t *
+_hedged_read_client (mock_rs_t *rs, int32_t socket_timeout_ms)
+{
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_read_prefs_t *prefs;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   size_t i;
+   int j;
+
+   uri = mongoc_uri_copy (mock_rs_get_uri (rs));
+   mongoc_uri_set_option_as_bool (uri, MONGOC_URI_HEDGEDREADS, true);
+   if (socket_timeout_ms) {
+      mongoc_uri_set_option_as_int32 (
+         uri, MONGOC_URI_SOCKETTIMEOUTMS, socket_timeout_ms);
+   }
+
+   client = mongoc_client_new_from_uri (uri);
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+   sd = mongoc_client_select_server (client, false, prefs, &error);
+   ASSERT_OR_PRINT (sd, error);
+   mongoc_server_description_destroy (sd);
+
+   for (i = 0; i < client->topology->description.servers->items_len; i++) {
+      sd = (mongoc_server_description_t *) mongoc_set_get_item (
+         client->topology->description.servers, (int) i);
+      for (j = 0; j < 20; j++) {
+         mongoc_server_description_op_started (sd);
+         mongoc_server_description_op_finished (sd, 1000);
+      }
+
+      _mongoc_client_async_connect_node (client, sd->id);
+   }
+
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_uri_destroy (uri);
+
+   return client;
+}
+
+
+/* with hedgedReads, a single-batch find that a secondary is slow to answer is
+ * also sent to the other secondary, without the session, and the reply that
+ * arrives first is used */
+static void
+test_cursor_hedged_read (void)
+{
+   mock_rs_t *rs;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_read_prefs_t *prefs;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *first;
+   request_t *hedge;
+   bson_error_t error;
+
+   rs = mock_rs_with_autoismaster (WIRE_VERSION_OP_MSG, true, 2, 0);
+   mock_rs_run (rs);
+   client = _hedged_read_client (rs, 0);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson ("{}"), tmp_bson ("{'singleBatch': true}"), prefs);
+   future = future_cursor_next (cursor, &doc);
+   first = mock_rs_receives_msg (
+      rs,
+      0,
+      tmp_bson ("{'find': 'collection', 'singleBatch': true, "
+                "'lsid': {'$exists': true}}"));
+   BSON_ASSERT (mock_rs_request_is_to_secondary (rs, first));
+
+   /* no reply, so the find is sent to the other secondary */
+   hedge = mock_rs_receives_msg (
+      rs,
+      0,
+      tmp_bson ("{'find': 'collection', 'singleBatch': true, "
+                "'lsid': {'$exists': false}}"));
+   BSON_ASSERT (mock_rs_request_is_to_secondary (rs, hedge));
+   ASSERT_CMPINT (request_get_server_port (first),
+                  !=,
+                  request_get_server_port (hedge));
+
+   mock_rs_replies_simple (hedge,
+                           "{'ok': 1, 'cursor': {'id': 0, 'ns': "
+                           "'db.collection', 'firstBatch': [{'_id': 1}]}}");
+   BSON_ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'_id': 1}");
+   future_destroy (future);
+
+   BSON_ASSERT (!mongoc_cursor_next (cursor, &doc));
+   ASSERT_OR_PRINT (!mongoc_cursor_error (cursor, &error), error);
+
+   request_destroy (hedge);
+   request_destroy (first);
+   mongoc_cursor_destroy (cursor);
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_rs_destroy (rs);
+}
+
+
+/* when the first server's reply wins, the hedge connection is kept: it drops
+ * the late reply and hedges the next slow read */
+static void
+test_cursor_hedged_read_first_wins (void)
+{
+   mock_rs_t *rs;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_read_prefs_t *prefs;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *first;
+   request_t *hedge;
+   request_t *first2;
+   request_t *hedge2;
+   size_t n_idle;
+   const char *find = "{'find': 'collection', 'lsid': {'$exists': true}}";
+   const char *hedged = "{'find': 'collection', 'lsid': {'$exists': false}}";
+   const char *reply = "{'ok': 1, 'cursor': {'id': 0, 'ns': "
+                       "'db.collection', 'firstBatch': [{'_id': 1}]}}";
+
+   rs = mock_rs_with_autoismaster (WIRE_VERSION_OP_MSG, true, 2, 0);
+   mock_rs_run (rs);
+   client = _hedged_read_client (rs, 0);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+   n_idle = client->async_idle.len;
+
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson ("{}"), tmp_bson ("{'singleBatch': true}"), prefs);
+   future = future_cursor_next (cursor, &doc);
+   first = mock_rs_receives_msg (rs, 0, tmp_bson (find));
+   hedge = mock_rs_receives_msg (rs, 0, tmp_bson (hedged));
+   mock_rs_replies_simple (first, reply);
+   BSON_ASSERT (future_get_bool (future));
+   future_destroy (future);
+   mongoc_cursor_destroy (cursor);
+
+   /* every idle connection remains, one awaiting the hedge's reply */
+   ASSERT_CMPSIZE_T (client->async_idle.len, ==, n_idle);
+
+   mock_rs_replies_simple (hedge, reply);
+   _mongoc_usleep (100 * 1000);
+
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson ("{}"), tmp_bson ("{'singleBatch': true}"), prefs);
+   future = future_cursor_next (cursor, &doc);
+   first2 = mock_rs_receives_msg (rs, 0, tmp_bson (find));
+   hedge2 = mock_rs_receives_msg (rs, 0, tmp_bson (hedged));
+
+   /* a hedge to the same server reuses the connection */
+   if (request_get_server_port (hedge2) == request_get_server_port (hedge)) {
+      ASSERT_CMPINT (request_get_client_port (hedge2),
+                     ==,
+                     request_get_client_port (hedge));
+   }
+
+   mock_rs_replies_simple (first2, reply);
+   BSON_ASSERT (future_get_bool (future));
+   ASSERT_MATCH (doc, "{'_id': 1}");
+
+   future_destroy (future);
+   request_destroy (hedge2);
+   request_destroy (first2);
+   request_destroy (hedge);
+   request_destroy (first);
+   mongoc_cursor_destroy (cursor);
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_rs_destroy (rs);
+}
+
+
+/* a pooled client's hedged reads ask for connections they lack, which the
+ * pool's warming thread makes while the client is idle */
+static void
+test_cursor_hedged_read_pooled_connect (void)
+{
+   mock_rs_t *rs;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_read_prefs_t *prefs;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   int64_t deadline;
+   bool connected = false;
+
+   rs = mock_rs_with_autoismaster (WIRE_VERSION_OP_MSG, true, 2, 0);
+   mock_rs_run (rs);
+   uri = mongoc_uri_copy (mock_rs_get_uri (rs));
+   mongoc_uri_set_option_as_bool (uri, MONGOC_URI_HEDGEDREADS, true);
+   /* pop waits while the warming thread has the client */
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXPOOLSIZE, 1);
+   pool = mongoc_client_pool_new (uri);
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY);
+
+   client = mongoc_client_pool_pop (pool);
+   sd = mongoc_client_select_server (client, false, prefs, &error);
+   ASSERT_OR_PRINT (sd, error);
+   _mongoc_client_async_want_node (client, sd->id);
+   ASSERT_CMPSIZE_T (client->async_idle.len, ==, (size_t) 0);
+   mongoc_client_pool_push (pool, client);
+
+   deadline = bson_get_monotonic_time () + 10 * 1000 * 1000;
+   while (!connected && bson_get_monotonic_time () < deadline) {
+      _mongoc_usleep (10 * 1000);
+      client = mongoc_client_pool_pop (pool);
+      connected = client->async_idle.len == 1;
+      mongoc_client_pool_push (pool, client);
+   }
+
+   BSON_ASSERT (connected);
+
+   mongoc_server_description_destroy (sd);
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_client_pool_destroy (pool);
+   mongoc_uri_destroy (uri);
+   mock_rs_destroy (rs);
+}
+
+
+/* a hedged read waits no longer than socketTimeoutMS for either reply */
+static void
+test_cursor_hedged_read_timeout (void)
+{
+   mock_rs_t *rs;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_read_prefs_t *prefs;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   future_t *future;
+   request_t *first;
+   request_t *hedge;
+   bson_error_t error;
+
+   rs = mock_rs_with_autoismaster (WIRE_VERSION_OP_MSG, true, 2, 0);
+   mock_rs_run (rs);
+   client = _hedged_read_client (rs, 500);
+   collection = mongoc_client_get_collection (client, "db", "collection");
+   prefs = mongoc_read_prefs_new (MONGOC_READ_SECONDARY_PREFERRED);
+
+   cursor = mongoc_collection_find_with_opts (
+      collection, tmp_bson ("{}"), tmp_bson ("{'singleBatch': true}"), prefs);
+   future = future_cursor_next (cursor, &doc);
+   first = mock_rs_receives_msg (rs, 0, tmp_bson ("{'find': 'collection'}"));
+   hedge = mock_rs_receives_msg (rs, 0, tmp_bson ("{'find': 'collection'}"));
+
+   /* neither server replies */
+   BSON_ASSERT (!future_get_bool (future));
+   BSON_ASSERT (mongoc_cursor_error (cursor, &error));
+   ASSERT_ERROR_CONTAINS (
+      error, MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET, "timeout");
+
+   future_destroy (future);
+   request_destroy (hedge);
+   request_destroy (first);
+   mongoc_cursor_destroy (cursor);
+   mongoc_read_prefs_destroy (prefs);
+   mongoc_collection_destroy (collection);
+   mongoc_client_destroy (client);
+   mock_rs_destroy (rs);
+}
+
+
 void
 test_cursor_install (TestSuite *suite)
 {
@@ -2390,6 +2668,16 @@ test_cursor_install (TestSuite *suite)
       suite, "/Cursor/empty_final_batch_live", test_empty_final_batch_live);
    TestSuite_AddMockServerTest (
       suite, "/Cursor/empty_final_batch", test_empty_final_batch);
+   TestSuite_AddMockServerTest (
+      suite, "/Cursor/hedged_read", test_cursor_hedged_read);
+   TestSuite_AddMockServerTest (
+      suite, "/Cursor/hedged_read/timeout", test_cursor_hedged_read_timeout);
+   TestSuite_AddMockServerTest (suite,
+                                "/Cursor/hedged_read/first_wins",
+                                test_cursor_hedged_read_first_wins);
+   TestSuite_AddMockServerTest (suite,
+                                "/Cursor/hedged_read/pooled_connect",
+                                test_cursor_hedged_read_pooled_connect);
    TestSuite_AddLive (
       suite, "/Cursor/error_document/query", test_error_document_query);
    TestSuite_AddLive (
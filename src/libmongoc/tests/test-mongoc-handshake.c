@@ -641,6 +641,10 @@ test_handshake_platform_config ()
    BSON_ASSERT (_get_bit (config_str, MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZLIB));
 #endif
 
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   BSON_ASSERT (_get_bit (config_str, MONGOC_MD_FLAG_ENABLE_COMPRESSION_ZSTD));
+#endif
+
 #ifdef MONGOC_MD_FLAG_ENABLE_SASL_GSSAPI
    BSON_ASSERT (_get_bit (config_str, MONGOC_MD_FLAG_ENABLE_SASL_GSSAPI));
 #endif
@@ -660,6 +660,115 @@ test_mongoc_rpc_buffer_iov (void)
 }
 
 
+static void
+_test_compress_iovec (mongoc_compressor_ctx_t *ctx,
+                      int32_t compressor_id,
+                      int32_t compression_level)
+{
+   char data[3000];
+   mongoc_iovec_t iov[3];
+   const uint8_t *compressed;
+   size_t compressed_len;
+   uint8_t uncompressed[sizeof data];
+   size_t uncompressed_len = sizeof uncompressed;
+   size_t i;
+
+   for (i = 0; i < sizeof data; i++) {
+      data[i] = (char) (i % 7);
+   }
+
+   /* the 16 skipped bytes end inside the second segment */
+   iov[0].iov_base = data;
+   iov[0].iov_len = 10;
+   iov[1].iov_base = data + 10;
+   iov[1].iov_len = 1000;
+   iov[2].iov_base = data + 1010;
+   iov[2].iov_len = sizeof data - 1010;
+
+   BSON_ASSERT (mongoc_compress_iovec (ctx,
+                                       compressor_id,
+                                       compression_level,
+                                       iov,
+                                       3,
+                                       16,
+                                       &compressed,
+                                       &compressed_len));
+
+   BSON_ASSERT (mongoc_uncompress (compressor_id,
+                                   compressed,
+                                   compressed_len,
+                                   uncompressed,
+                                   &uncompressed_len));
+
+   ASSERT_CMPSIZE_T (uncompressed_len, ==, sizeof data - 16);
+   ASSERT_MEMCMP (uncompressed, data + 16, (int) uncompressed_len);
+}
+
+
+static void
+test_mongoc_rpc_compress_iovec (void)
+{
+   mongoc_compressor_ctx_t *ctx;
+   int i;
+
+   ctx = mongoc_compressor_ctx_new ();
+
+   /* reuse the context, and change zlib levels between messages */
+   for (i = 0; i < 2; i++) {
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_NOOP_ID, -1);
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_ZLIB_ID, -1);
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_ZLIB_ID, 9);
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_SNAPPY_ID, -1);
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_ZSTD_ID, 0);
+      _test_compress_iovec (ctx, MONGOC_COMPRESSOR_ZSTD_ID, 19);
+#endif
+   }
+
+   mongoc_compressor_ctx_destroy (ctx);
+}
+
+
+static void
+test_mongoc_rpc_compress_policy (void)
+{
+   mongoc_compressor_ctx_t *ctx;
+   int i;
+
+   ctx = mongoc_compressor_ctx_new ();
+
+   /* small messages aren't compressed, unless the policy is off */
+   BSON_ASSERT (!mongoc_compressor_ctx_should_compress (ctx, 1, 100, 512));
+   BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 1, 100, -1));
+   BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 1, 1000, 512));
+
+   /* a good ratio keeps compression on */
+   mongoc_compressor_ctx_record (ctx, 1, 1000, 200);
+   BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 1, 1000, 512));
+
+   /* poor ratios back off, then probe again */
+   for (i = 0; i < 20; i++) {
+      mongoc_compressor_ctx_record (ctx, 1, 1000, 1000);
+   }
+
+   for (i = 0; i < MONGOC_COMPRESSION_BACKOFF; i++) {
+      BSON_ASSERT (!mongoc_compressor_ctx_should_compress (ctx, 1, 1000, 512));
+      BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 1, 1000, -1));
+   }
+
+   BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 1, 1000, 512));
+
+   /* other servers are unaffected */
+   BSON_ASSERT (mongoc_compressor_ctx_should_compress (ctx, 2, 1000, 512));
+
+   mongoc_compressor_ctx_destroy (ctx);
+}
+
+
 void
 test_rpc_install (TestSuite *suite)
 {
@@ -683,4 +792,8 @@ test_rpc_install (TestSuite *suite)
    TestSuite_Add (suite, "/Rpc/update/gather", test_mongoc_rpc_update_gather);
    TestSuite_Add (suite, "/Rpc/update/scatter", test_mongoc_rpc_update_scatter);
    TestSuite_Add (suite, "/Rpc/buffer/iov", test_mongoc_rpc_buffer_iov);
+   TestSuite_Add (
+      suite, "/Rpc/compress/iovec", test_mongoc_rpc_compress_iovec);
+   TestSuite_Add (
+      suite, "/Rpc/compress/policy", test_mongoc_rpc_compress_policy);
 }
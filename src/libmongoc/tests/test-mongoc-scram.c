@@ -93,6 +93,110 @@ test_mongoc_scram_iteration_count (void)
    test_iteration_count (10000, true);
 }
 
+/* run a conversation with the given cache up to step 2, the client proof,
+ * which is where the salted password is computed or taken from the cache */
+static void
+_scram_step_2 (mongoc_scram_t *scram,
+               mongoc_crypto_hash_algorithm_t algo,
+               mongoc_scram_cache_t *cache,
+               const char *user,
+               int iterations)
+{
+   uint8_t buf[4096] = {0};
+   uint32_t buflen = 0;
+   bson_error_t error;
+   const char *client_nonce = "YWJjZA==";
+   /* the salt is as long as the hash, minus 4 bytes */
+   const char *salt = algo == MONGOC_CRYPTO_ALGORITHM_SHA_1
+                         ? "r6+P1iLmSJvhrRyuFi6Wsg=="
+                         : "MDEyMzQ1Njc4OWFiY2RlZjAxMjM0NTY3ODlhYg==";
+   char *server_response;
+
+   server_response = bson_strdup_printf (
+      "r=YWJjZA==YWJjZA==,s=%s,i=%d", salt, iterations);
+   _mongoc_scram_init (scram, algo);
+   _mongoc_scram_set_user (scram, user);
+   _mongoc_scram_set_pass (scram, "password");
+   _mongoc_scram_set_cache (scram, cache);
+   bson_strncpy (
+      scram->encoded_nonce, client_nonce, sizeof (scram->encoded_nonce));
+   scram->encoded_nonce_len = (int32_t) strlen (client_nonce);
+   scram->auth_message = bson_malloc0 (4096);
+   scram->auth_messagemax = 4096;
+   memcpy (buf, server_response, strlen (server_response) + 1);
+   buflen = (int32_t) strlen (server_response);
+   scram->step = 1;
+   ASSERT_OR_PRINT (
+      _mongoc_scram_step (scram, buf, buflen, buf, sizeof buf, &buflen, &error),
+      error);
+   bson_free (server_response);
+}
+
+
+static void
+test_mongoc_scram_cache (void)
+{
+   mongoc_scram_cache_t *cache;
+   mongoc_scram_cache_entry_t *entry;
+   mongoc_scram_t scram;
+   uint8_t salted_password[MONGOC_SCRAM_HASH_MAX_SIZE];
+
+   cache = _mongoc_scram_cache_new ();
+
+   /* a successful conversation fills the cache */
+   _scram_step_2 (&scram, MONGOC_CRYPTO_ALGORITHM_SHA_1, cache, "user", 4096);
+   _mongoc_scram_update_cache (&scram);
+   _mongoc_scram_destroy (&scram);
+   ASSERT_CMPSIZE_T (cache->entries.len, ==, (size_t) 1);
+
+   /* mark the cached secret so we can tell when it is used */
+   entry =
+      &_mongoc_array_index (&cache->entries, mongoc_scram_cache_entry_t, 0);
+   memset (entry->salted_password, 'x', sizeof entry->salted_password);
+   memset (salted_password, 'x', sizeof salted_password);
+
+   /* same user, mechanism, salt and iterations: no need to salt again */
+   _scram_step_2 (&scram, MONGOC_CRYPTO_ALGORITHM_SHA_1, cache, "user", 4096);
+   ASSERT_CMPINT (memcmp (scram.salted_password,
+                          salted_password,
+                          sizeof salted_password),
+                  ==,
+                  0);
+   _mongoc_scram_destroy (&scram);
+
+   /* any difference in the key means the password is salted again */
+   _scram_step_2 (&scram, MONGOC_CRYPTO_ALGORITHM_SHA_1, cache, "user", 4097);
+   ASSERT_CMPINT (memcmp (scram.salted_password,
+                          salted_password,
+                          sizeof salted_password),
+                  !=,
+                  0);
+   _mongoc_scram_destroy (&scram);
+
+   _scram_step_2 (&scram, MONGOC_CRYPTO_ALGORITHM_SHA_256, cache, "user", 4096);
+   ASSERT_CMPINT (memcmp (scram.salted_password,
+                          salted_password,
+                          sizeof salted_password),
+                  !=,
+                  0);
+   _mongoc_scram_update_cache (&scram);
+   _mongoc_scram_destroy (&scram);
+
+   _scram_step_2 (&scram, MONGOC_CRYPTO_ALGORITHM_SHA_1, cache, "other", 4096);
+   ASSERT_CMPINT (memcmp (scram.salted_password,
+                          salted_password,
+                          sizeof salted_password),
+                  !=,
+                  0);
+   _mongoc_scram_destroy (&scram);
+
+   /* one entry per user and mechanism */
+   ASSERT_CMPSIZE_T (cache->entries.len, ==, (size_t) 2);
+
+   _mongoc_scram_cache_destroy (cache);
+}
+
+
 static void
 test_mongoc_scram_sasl_prep (void)
 {
@@ -553,6 +657,7 @@ test_scram_install (TestSuite *suite)
    TestSuite_Add (suite, "/scram/sasl_prep", test_mongoc_scram_sasl_prep);
    TestSuite_Add (
       suite, "/scram/iteration_count", test_mongoc_scram_iteration_count);
+   TestSuite_Add (suite, "/scram/cache", test_mongoc_scram_cache);
 #endif
    TestSuite_AddFull (suite,
                       "/scram/auth_tests",
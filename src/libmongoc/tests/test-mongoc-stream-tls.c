@@ -3,6 +3,15 @@
 
 #ifdef MONGOC_ENABLE_SSL_OPENSSL
 #include <openssl/err.h>
+
+#include "mongoc-openssl-private.h"
+#include "mongoc-stream-tls-openssl-private.h"
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 #endif
 
 #include "ssl-test.h"
@@ -363,6 +372,239 @@ test_mongoc_tls_ip (void)
 #endif
 
 
+#ifdef MONGOC_ENABLE_SSL_OPENSSL
+static mongoc_stream_t *
+_tls_stream_new (const char *host,
+                 uint16_t port,
+                 mongoc_ssl_opt_t *opt,
+                 mongoc_tls_cache_t *cache,
+                 SSL **ssl /* OUT */)
+{
+   mongoc_stream_t *base;
+   mongoc_stream_t *stream;
+   mongoc_stream_tls_openssl_t *openssl;
+
+   base =
+      mongoc_stream_socket_new (mongoc_socket_new (AF_INET, SOCK_STREAM, 0));
+   stream =
+      _mongoc_stream_tls_new_with_cache (base, host, port, opt, 1, cache);
+   BSON_ASSERT (stream);
+
+   openssl =
+      (mongoc_stream_tls_openssl_t *) ((mongoc_stream_tls_t *) stream)->ctx;
+   BIO_get_ssl (openssl->bio, ssl);
+
+   return stream;
+}
+
+
+static void
+test_mongoc_tls_cache_shared_ctx (void)
+{
+   mongoc_ssl_opt_t copt = {0};
+   mongoc_tls_cache_t *cache;
+   mongoc_stream_t *a, *b, *c, *d;
+   SSL *ssl_a, *ssl_b, *ssl_c, *ssl_d;
+   mongoc_stream_tls_openssl_t *openssl;
+
+   copt.ca_file = CERT_CA;
+   cache = _mongoc_tls_cache_new ();
+
+   /* client streams with a cache share one context whatever their host */
+   a = _tls_stream_new ("host-a", 27017, &copt, cache, &ssl_a);
+   b = _tls_stream_new ("host-b", 27017, &copt, cache, &ssl_b);
+   ASSERT (SSL_get_SSL_CTX (ssl_a) == SSL_get_SSL_CTX (ssl_b));
+   ASSERT (SSL_get_SSL_CTX (ssl_a) ==
+           _mongoc_openssl_cache_get_ctx (cache, &copt));
+
+   /* nothing was negotiated, so nothing is offered for resumption */
+   ASSERT (!SSL_session_reused (ssl_a));
+   ASSERT_CMPSIZE_T (
+      _mongoc_openssl_cache_session_count (cache), ==, (size_t) 0);
+
+   /* without a cache each stream builds its own */
+   c = _tls_stream_new ("host-a", 27017, &copt, NULL, &ssl_c);
+   ASSERT (SSL_get_SSL_CTX (ssl_a) != SSL_get_SSL_CTX (ssl_c));
+
+   /* sessions are kept per server, not per host */
+   d = _tls_stream_new ("host-a", 27018, &copt, cache, &ssl_d);
+   openssl = (mongoc_stream_tls_openssl_t *) ((mongoc_stream_tls_t *) a)->ctx;
+   ASSERT_CMPSTR (openssl->session_key, "host-a:27017");
+   openssl = (mongoc_stream_tls_openssl_t *) ((mongoc_stream_tls_t *) d)->ctx;
+   ASSERT_CMPSTR (openssl->session_key, "host-a:27018");
+
+   mongoc_stream_destroy (a);
+   mongoc_stream_destroy (b);
+   mongoc_stream_destroy (c);
+   mongoc_stream_destroy (d);
+   _mongoc_tls_cache_destroy (cache);
+}
+
+
+#ifndef _WIN32
+#define TLS_RESUME_CONNECTIONS 3
+
+typedef struct {
+   int listen_fd;
+   uint16_t port;
+} tls_resume_server_t;
+
+
+/* accept TLS_RESUME_CONNECTIONS connections one at a time with a single
+ * server context, so that its session tickets stay valid across them. each
+ * connection gets one byte, then stays open until the client closes it */
+static void *
+tls_resume_server_thread (void *data)
+{
+   tls_resume_server_t *server = (tls_resume_server_t *) data;
+   SSL_CTX *ctx;
+   SSL *ssl;
+   char buf;
+   int fd;
+   int i;
+
+   ctx = SSL_CTX_new (SSLv23_server_method ());
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+   /* the test certificates are signed with SHA-1 */
+   SSL_CTX_set_security_level (ctx, 0);
+#endif
+   BSON_ASSERT (SSL_CTX_use_certificate_chain_file (ctx, CERT_SERVER) == 1);
+   BSON_ASSERT (
+      SSL_CTX_use_PrivateKey_file (ctx, CERT_SERVER, SSL_FILETYPE_PEM) == 1);
+
+   for (i = 0; i < TLS_RESUME_CONNECTIONS; i++) {
+      fd = accept (server->listen_fd, NULL, NULL);
+      BSON_ASSERT (fd >= 0);
+      ssl = SSL_new (ctx);
+      SSL_set_fd (ssl, fd);
+      BSON_ASSERT (SSL_accept (ssl) == 1);
+      BSON_ASSERT (SSL_write (ssl, "x", 1) == 1);
+      while (SSL_read (ssl, &buf, 1) > 0) {
+      }
+      SSL_free (ssl);
+      close (fd);
+   }
+
+   SSL_CTX_free (ctx);
+
+   return NULL;
+}
+
+
+/* connect to the test server, complete the handshake, and read its byte,
+ * which processes any session tickets sent after the handshake */
+static mongoc_stream_t *
+_tls_resume_connect (uint16_t port,
+                     mongoc_ssl_opt_t *opt,
+                     mongoc_tls_cache_t *cache,
+                     SSL **ssl /* OUT */)
+{
+   mongoc_socket_t *sock;
+   mongoc_stream_t *stream;
+   mongoc_stream_tls_openssl_t *openssl;
+   struct sockaddr_in addr = {0};
+   bson_error_t error;
+
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons (port);
+   addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+   sock = mongoc_socket_new (AF_INET, SOCK_STREAM, 0);
+   BSON_ASSERT (mongoc_socket_connect (
+                   sock, (struct sockaddr *) &addr, sizeof addr, -1) == 0);
+   stream = _mongoc_stream_tls_new_with_cache (
+      mongoc_stream_socket_new (sock), "127.0.0.1", port, opt, 1, cache);
+   BSON_ASSERT (stream);
+   ASSERT_OR_PRINT (mongoc_stream_tls_handshake_block (
+                       stream, "127.0.0.1", 10 * 1000, &error),
+                    error);
+
+   openssl =
+      (mongoc_stream_tls_openssl_t *) ((mongoc_stream_tls_t *) stream)->ctx;
+   BIO_get_ssl (openssl->bio, ssl);
+
+   return stream;
+}
+
+
+static void
+_tls_resume_read_byte (mongoc_stream_t *stream)
+{
+   char buf;
+
+   ASSERT_CMPSSIZE_T (
+      mongoc_stream_read (stream, &buf, 1, 1, 10 * 1000), ==, (ssize_t) 1);
+}
+
+
+/* a second connection to a server resumes the first one's session, and a
+ * cache reset while a stream is open neither frees what the stream uses nor
+ * keeps the old context's sessions */
+static void
+test_mongoc_tls_cache_resume (void)
+{
+   tls_resume_server_t server;
+   bson_thread_t thread;
+   struct sockaddr_in addr = {0};
+   socklen_t addr_len = sizeof addr;
+   mongoc_ssl_opt_t copt = {0};
+   mongoc_tls_cache_t *cache;
+   mongoc_stream_t *stream;
+   SSL *ssl;
+
+   server.listen_fd = socket (AF_INET, SOCK_STREAM, 0);
+   BSON_ASSERT (server.listen_fd >= 0);
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   BSON_ASSERT (
+      bind (server.listen_fd, (struct sockaddr *) &addr, sizeof addr) == 0);
+   BSON_ASSERT (listen (server.listen_fd, 10) == 0);
+   BSON_ASSERT (getsockname (
+                   server.listen_fd, (struct sockaddr *) &addr, &addr_len) ==
+                0);
+   server.port = ntohs (addr.sin_port);
+   BSON_ASSERT (bson_thread_create (
+                   &thread, tls_resume_server_thread, &server) == 0);
+
+   copt.weak_cert_validation = true;
+   cache = _mongoc_tls_cache_new ();
+
+   /* a full handshake, whose session is kept */
+   stream = _tls_resume_connect (server.port, &copt, cache, &ssl);
+   ASSERT (!SSL_session_reused (ssl));
+   _tls_resume_read_byte (stream);
+   ASSERT_CMPSIZE_T (
+      _mongoc_openssl_cache_session_count (cache), ==, (size_t) 1);
+   mongoc_stream_destroy (stream);
+
+   /* the next connection resumes it */
+   stream = _tls_resume_connect (server.port, &copt, cache, &ssl);
+   ASSERT (SSL_session_reused (ssl));
+
+   /* like mongoc_client_set_ssl_opts with a connection open: the stream
+    * still works, and its new sessions are not kept for the new options */
+   _mongoc_tls_cache_reset (cache);
+   _tls_resume_read_byte (stream);
+   ASSERT_CMPSIZE_T (
+      _mongoc_openssl_cache_session_count (cache), ==, (size_t) 0);
+   mongoc_stream_destroy (stream);
+
+   /* and the next connection after the reset starts over */
+   stream = _tls_resume_connect (server.port, &copt, cache, &ssl);
+   ASSERT (!SSL_session_reused (ssl));
+   _tls_resume_read_byte (stream);
+   ASSERT_CMPSIZE_T (
+      _mongoc_openssl_cache_session_count (cache), ==, (size_t) 1);
+   mongoc_stream_destroy (stream);
+
+   bson_thread_join (thread);
+   close (server.listen_fd);
+   _mongoc_tls_cache_destroy (cache);
+}
+#endif /* !_WIN32 */
+#endif
+
+
 #if !defined(__APPLE__) && !defined(_WIN32) && \
    defined(MONGOC_ENABLE_SSL_OPENSSL) && OPENSSL_VERSION_NUMBER >= 0x10000000L
 static void
@@ -412,6 +654,11 @@ test_stream_tls_install (TestSuite *suite)
    TestSuite_Add (
       suite, "/TLS/weak_cert_validation", test_mongoc_tls_weak_cert_validation);
    TestSuite_Add (suite, "/TLS/crl", test_mongoc_tls_crl);
+   TestSuite_Add (
+      suite, "/TLS/cache/shared_ctx", test_mongoc_tls_cache_shared_ctx);
+#ifndef _WIN32
+   TestSuite_Add (suite, "/TLS/cache/resume", test_mongoc_tls_cache_resume);
+#endif
 #endif
 
 #if !defined(__APPLE__) && !defined(_WIN32) && \
@@ -43,6 +43,38 @@ test_buffered_basic (void)
 }
 
 
+static void
+test_buffered_min_bytes (void)
+{
+   mongoc_stream_t *stream;
+   mongoc_stream_t *buffered;
+   mongoc_iovec_t iov;
+   ssize_t r;
+   char buf[2048];
+
+   stream =
+      mongoc_stream_file_new_for_path (BINARY_DIR "/reply2.dat", O_RDONLY, 0);
+   BSON_ASSERT (stream);
+
+   /* buffered assumes ownership of stream */
+   buffered = mongoc_stream_buffered_new (stream, 1024);
+
+   /* a small read fills the buffer but only returns what fits */
+   iov.iov_len = 16;
+   iov.iov_base = buf;
+   r = mongoc_stream_readv (buffered, &iov, 1, 4, -1);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) 16);
+
+   /* min_bytes is already buffered, return it without reading more */
+   iov.iov_len = sizeof buf;
+   r = mongoc_stream_readv (buffered, &iov, 1, 1, -1);
+   ASSERT_CMPSSIZE_T (r, ==, (ssize_t) (1024 - 16));
+
+   /* cleanup */
+   mongoc_stream_destroy (buffered);
+}
+
+
 static void
 test_buffered_oversized (void)
 {
@@ -166,5 +198,6 @@ test_stream_install (TestSuite *suite)
 {
    TestSuite_Add (suite, "/Stream/buffered/basic", test_buffered_basic);
    TestSuite_Add (suite, "/Stream/buffered/oversized", test_buffered_oversized);
+   TestSuite_Add (suite, "/Stream/buffered/min_bytes", test_buffered_min_bytes);
    TestSuite_Add (suite, "/Stream/writev_full", test_stream_writev_full);
 }
@@ -8,6 +8,7 @@
 
 #include "test-libmongoc.h"
 #include "mock_server/mock-server.h"
+#include "mock_server/mock-rs.h"
 #include "mock_server/future.h"
 #include "mock_server/future-functions.h"
 #include "test-conveniences.h"
@@ -1894,6 +1895,198 @@ test_request_scan_on_error ()
 }
 
 
+static void
+test_topology_snapshot (void)
+{
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_topology_t *topology;
+   mongoc_topology_snapshot_t *snapshot;
+   mongoc_server_description_t *sd;
+   uint32_t id;
+   bson_error_t error;
+
+   server = mock_server_with_autoismaster (WIRE_VERSION_MIN);
+   mock_server_run (server);
+   pool = mongoc_client_pool_new (mock_server_get_uri (server));
+   client = mongoc_client_pool_pop (pool);
+   topology = client->topology;
+
+   id = mongoc_topology_select_server_id (
+      topology, MONGOC_SS_READ, NULL, &error);
+   ASSERT_OR_PRINT (id, error);
+
+   /* selection doesn't need the topology mutex while a server is suitable */
+   bson_mutex_lock (&topology->mutex);
+   ASSERT_CMPUINT32 (
+      mongoc_topology_select_server_id (topology, MONGOC_SS_READ, NULL, &error),
+      ==,
+      id);
+   ASSERT_CMPINT ((int) _mongoc_topology_get_type (topology),
+                  ==,
+                  (int) MONGOC_TOPOLOGY_SINGLE);
+   bson_mutex_unlock (&topology->mutex);
+
+   snapshot = _mongoc_topology_snapshot_acquire (topology);
+   bson_set_error (
+      &error, MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET, "failed");
+   mongoc_topology_invalidate_server (topology, id, &error);
+
+   /* the change is published as a new snapshot, the old one is unchanged */
+   BSON_ASSERT (topology->snapshot != snapshot);
+   sd = mongoc_topology_description_server_by_id (&snapshot->td, id, NULL);
+   ASSERT_CMPINT ((int) sd->type, ==, (int) MONGOC_SERVER_STANDALONE);
+   _mongoc_topology_snapshot_release (snapshot);
+
+   sd = mongoc_topology_server_by_id (topology, id, NULL);
+   ASSERT_CMPINT ((int) sd->type, ==, (int) MONGOC_SERVER_UNKNOWN);
+   mongoc_server_description_destroy (sd);
+
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_server_destroy (server);
+}
+
+
+static void
+test_topology_snapshot_ss_cache (void)
+{
+   mock_rs_t *rs;
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   mongoc_topology_t *topology;
+   mongoc_topology_snapshot_t *snapshot;
+   mongoc_read_prefs_t *secondary;
+   mongoc_read_prefs_t *tagged;
+   mongoc_server_description_t *sd;
+   unsigned int rand_seed = 0;
+   uint32_t id;
+   bson_error_t error;
+   int i;
+
+   rs = mock_rs_with_autoismaster (WIRE_VERSION_MIN, true, 2, 0);
+   mock_rs_run (rs);
+   pool = mongoc_client_pool_new (mock_rs_get_uri (rs));
+   client = mongoc_client_pool_pop (pool);
+   topology = client->topology;
+   secondary = mongoc_read_prefs_new (MONGOC_READ_SECONDARY);
+   tagged = mongoc_read_prefs_new (MONGOC_READ_SECONDARY);
+   mongoc_read_prefs_add_tag (tagged, tmp_bson ("{'dc': 'ny'}"));
+
+   id = mongoc_topology_select_server_id (
+      topology, MONGOC_SS_READ, secondary, &error);
+   ASSERT_OR_PRINT (id, error);
+
+   snapshot = _mongoc_topology_snapshot_acquire (topology);
+   for (i = 0; i < 10; i++) {
+      sd = _mongoc_topology_snapshot_select (
+         snapshot, MONGOC_SS_READ, secondary, 15, &rand_seed);
+      BSON_ASSERT (sd);
+      ASSERT_CMPINT ((int) sd->type, ==, (int) MONGOC_SERVER_RS_SECONDARY);
+   }
+
+   /* each read preference gets its own entry */
+   sd = _mongoc_topology_snapshot_select (
+      snapshot, MONGOC_SS_READ, NULL, 15, &rand_seed);
+   ASSERT_CMPINT ((int) sd->type, ==, (int) MONGOC_SERVER_RS_PRIMARY);
+   BSON_ASSERT (!_mongoc_topology_snapshot_select (
+      snapshot, MONGOC_SS_READ, tagged, 15, &rand_seed));
+   ASSERT_CMPINT (snapshot->ss_cache_len, ==, 3);
+
+   /* a copy of the read prefs finds the same entry */
+   mongoc_read_prefs_destroy (tagged);
+   tagged = mongoc_read_prefs_copy (secondary);
+   BSON_ASSERT (_mongoc_topology_snapshot_select (
+      snapshot, MONGOC_SS_READ, tagged, 15, &rand_seed));
+   BSON_ASSERT (_mongoc_topology_snapshot_select (
+      snapshot, MONGOC_SS_WRITE, NULL, 15, &rand_seed));
+   ASSERT_CMPINT (snapshot->ss_cache_len, ==, 4);
+
+   /* a new snapshot starts with an empty cache */
+   bson_set_error (
+      &error, MONGOC_ERROR_STREAM, MONGOC_ERROR_STREAM_SOCKET, "failed");
+   mongoc_topology_invalidate_server (topology, sd->id, &error);
+   _mongoc_topology_snapshot_release (snapshot);
+   snapshot = _mongoc_topology_snapshot_acquire (topology);
+   ASSERT_CMPINT (snapshot->ss_cache_len, ==, 0);
+   _mongoc_topology_snapshot_release (snapshot);
+
+   mongoc_read_prefs_destroy (tagged);
+   mongoc_read_prefs_destroy (secondary);
+   mongoc_client_pool_push (pool, client);
+   mongoc_client_pool_destroy (pool);
+   mock_rs_destroy (rs);
+}
+
+
+static void
+test_topology_pick_server_load (void)
+{
+   mongoc_server_description_t *sds[3];
+   mongoc_server_description_t *copy;
+   mongoc_array_t suitable;
+   unsigned int rand_seed = 0;
+   int picked[3] = {0};
+   int i;
+
+   _mongoc_array_init (&suitable, sizeof (mongoc_server_description_t *));
+   for (i = 0; i < 3; i++) {
+      sds[i] = bson_malloc0 (sizeof (mongoc_server_description_t));
+      mongoc_server_description_init (sds[i], "localhost:27017", (uint32_t) i);
+      mongoc_server_description_update_rtt (sds[i], 5);
+      _mongoc_array_append_val (&suitable, sds[i]);
+   }
+
+   /* copies share the load: server 0 becomes slow */
+   copy = mongoc_server_description_new_copy (sds[0]);
+   mongoc_server_description_op_started (copy);
+   mongoc_server_description_op_finished (copy, 100 * 1000);
+   mongoc_server_description_destroy (copy);
+   ASSERT_CMPINT (sds[0]->load->latency_usec, ==, 100 * 1000);
+   ASSERT_CMPINT (sds[0]->load->in_flight, ==, 0);
+
+   /* so does a description made from a handshake, once attached */
+   copy = bson_malloc0 (sizeof (mongoc_server_description_t));
+   mongoc_server_description_init (copy, "localhost:27017", 0);
+   mongoc_server_description_share_load (copy, sds[0]);
+   ASSERT (copy->load == sds[0]->load);
+   mongoc_server_description_op_started (copy);
+   ASSERT_CMPINT (sds[0]->load->in_flight, ==, 1);
+   mongoc_server_description_op_abandoned (copy);
+   mongoc_server_description_destroy (copy);
+   ASSERT_CMPINT (sds[0]->load->refcount, ==, 1);
+
+   /* server 1 is as fast as its RTT, but busy */
+   for (i = 0; i < 10; i++) {
+      mongoc_server_description_op_started (sds[1]);
+   }
+
+   ASSERT_CMPINT64 (mongoc_server_description_load_score (sds[2]),
+                    <,
+                    mongoc_server_description_load_score (sds[1]));
+   ASSERT_CMPINT64 (mongoc_server_description_load_score (sds[1]),
+                    <,
+                    mongoc_server_description_load_score (sds[0]));
+
+   for (i = 0; i < 300; i++) {
+      picked[_mongoc_topology_description_pick_server (&suitable, &rand_seed)
+                ->id]++;
+   }
+
+   /* the most loaded server only wins if picked twice, which can't happen */
+   ASSERT_CMPINT (picked[0], ==, 0);
+   /* server 1 only wins against server 0 */
+   ASSERT_CMPINT (picked[1], <, picked[2]);
+
+   for (i = 0; i < 3; i++) {
+      mongoc_server_description_destroy (sds[i]);
+   }
+
+   _mongoc_array_destroy (&suitable);
+}
+
+
 void
 test_topology_install (TestSuite *suite)
 {
@@ -2035,4 +2228,11 @@ test_topology_install (TestSuite *suite)
                                 test_cluster_time_updated_during_handshake);
    TestSuite_AddMockServerTest (
       suite, "/Topology/request_scan_on_error", test_request_scan_on_error);
+   TestSuite_AddMockServerTest (
+      suite, "/Topology/snapshot", test_topology_snapshot);
+   TestSuite_AddMockServerTest (suite,
+                                "/Topology/snapshot/ss_cache",
+                                test_topology_snapshot_ss_cache);
+   TestSuite_Add (
+      suite, "/Topology/pick_server/load", test_topology_pick_server_load);
 }
@@ -1090,6 +1090,54 @@ test_mongoc_uri_compressors (void)
       "Invalid \"zlibcompressionlevel\" of 10: must be between -1 and 9");
    mongoc_uri_destroy (uri);
 
+#endif
+
+   uri = mongoc_uri_new ("mongodb://localhost/?compressionMinSize=-1");
+   ASSERT_CMPINT32 (
+      mongoc_uri_get_option_as_int32 (uri, MONGOC_URI_COMPRESSIONMINSIZE, 1),
+      ==,
+      -1);
+   mongoc_uri_destroy (uri);
+
+   uri = mongoc_uri_new ("mongodb://localhost/");
+   ASSERT (!mongoc_uri_has_option (uri, MONGOC_URI_COMPRESSIONMINSIZE));
+   mongoc_uri_destroy (uri);
+
+   /* the getter can't tell 0 from unset */
+   uri = mongoc_uri_new ("mongodb://localhost/?compressionMinSize=0");
+   ASSERT (mongoc_uri_has_option (uri, MONGOC_URI_COMPRESSIONMINSIZE));
+   mongoc_uri_destroy (uri);
+
+   capture_logs (true);
+   uri = mongoc_uri_new ("mongodb://localhost/?compressionMinSize=-2");
+   ASSERT_CAPTURED_LOG ("mongoc_uri_new",
+                        MONGOC_LOG_LEVEL_WARNING,
+                        "Invalid \"compressionminsize\" of -2: must be at "
+                        "least -1");
+   mongoc_uri_destroy (uri);
+
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+   uri = mongoc_uri_new ("mongodb://localhost/?compressors=zstd,zlib");
+   ASSERT (bson_has_field (mongoc_uri_get_compressors (uri), "zstd"));
+   mongoc_uri_destroy (uri);
+
+   uri = mongoc_uri_new (
+      "mongodb://localhost/?compressors=zstd&zstdCompressionLevel=22");
+   ASSERT (bson_has_field (mongoc_uri_get_compressors (uri), "zstd"));
+   ASSERT_CMPINT32 (
+      mongoc_uri_get_option_as_int32 (uri, MONGOC_URI_ZSTDCOMPRESSIONLEVEL, 1),
+      ==,
+      22);
+   mongoc_uri_destroy (uri);
+
+   capture_logs (true);
+   uri = mongoc_uri_new (
+      "mongodb://localhost/?compressors=zstd&zstdCompressionLevel=23");
+   ASSERT_CAPTURED_LOG (
+      "mongoc_uri_set_compressors",
+      MONGOC_LOG_LEVEL_WARNING,
+      "Invalid \"zstdcompressionlevel\" of 23: must be between 0 and 22");
+   mongoc_uri_destroy (uri);
 #endif
 }
 